@@ -0,0 +1,252 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "AssetPackArchive.h"
+
+#include <cstring>
+#include <cctype>
+
+#include "LZ4Codec.h"
+#include "Logger.h"
+
+const irr::u32 AssetPackArchive::VERSION;
+const irr::u32 AssetPackArchive::ALIGNMENT;
+
+AssetPackReadFile::AssetPackReadFile(AssetPackArchive* pArchive, const irr::io::path& fileName, const irr::u8* pData, irr::u32 size, std::vector<irr::u8>* pDecompressed)
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->pArchive = pArchive;
+    this->pArchive->grab();
+    this->fileName = fileName;
+    this->pDecompressed = pDecompressed;
+    this->pData = (pDecompressed != 0 && pDecompressed->empty() == false) ? &(*pDecompressed)[0] : pData;
+    this->size = size;
+    this->position = 0;
+}
+
+AssetPackReadFile::~AssetPackReadFile()
+{
+    // **************
+    // * DESTRUCTOR *
+    // **************
+
+    delete this->pDecompressed;
+    this->pArchive->drop();
+}
+
+irr::s32 AssetPackReadFile::read(void* buffer, irr::u32 sizeToRead)
+{
+    irr::u32 count = irr::core::min_(sizeToRead, this->size - this->position);
+    if (count > 0)
+        memcpy(buffer, this->pData + this->position, count);
+    this->position += count;
+    return (irr::s32)count;
+}
+
+bool AssetPackReadFile::seek(long finalPos, bool relativeMovement)
+{
+    long target = (relativeMovement == true) ? (long)this->position + finalPos : finalPos;
+    if (target < 0 || target > (long)this->size)
+        return false;
+    this->position = (irr::u32)target;
+    return true;
+}
+
+AssetPackArchive::AssetPackArchive(irr::io::IFileSystem* pFileSystem)
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->pFileSystem = pFileSystem;
+    this->pEntries = 0;
+    this->entryCount = 0;
+    this->pNames = 0;
+    this->pFileList = 0;
+}
+
+AssetPackArchive::~AssetPackArchive()
+{
+    // **************
+    // * DESTRUCTOR *
+    // **************
+
+    if (this->pFileList != 0)
+        this->pFileList->drop();
+}
+
+std::string AssetPackArchive::normalizeName(const std::string& name, const std::string& workingDirectory)
+{
+    std::string normalized = name;
+    for (size_t i = 0; i < normalized.size(); i++)
+        normalized[i] = (normalized[i] == '\\') ? '/' : (char)tolower((unsigned char)normalized[i]);
+    // Names are relative to the working directory
+    if (workingDirectory.empty() == false)
+    {
+        std::string directory = AssetPackArchive::normalizeName(workingDirectory, "");
+        if (directory[directory.size() - 1] != '/')
+            directory += '/';
+        if (directory.size() > 1 && normalized.compare(0, directory.size(), directory) == 0)
+            normalized.erase(0, directory.size());
+    }
+    while (normalized.compare(0, 2, "./") == 0)
+        normalized.erase(0, 2);
+    return normalized;
+}
+
+irr::u64 AssetPackArchive::hashName(const std::string& name)
+{
+    return AssetPackArchive::hashData(name.c_str(), name.size());
+}
+
+irr::u64 AssetPackArchive::hashData(const void* pData, size_t size)
+{
+    irr::u64 hash = 14695981039346656037ULL;
+    const unsigned char* pBytes = (const unsigned char*)pData;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= pBytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool AssetPackArchive::open(const std::string& fileName)
+{
+    if (this->file.open(fileName) == false)
+        return false;
+    // Read the working directory once (getWorkingDirectory updates the file system, so workers must not call it)
+    this->workingDirectory = AssetPackArchive::normalizeName(this->pFileSystem->getWorkingDirectory().c_str(), "");
+
+    // HEADER
+    SAssetPackHeader header;
+    const irr::u8* pData = this->file.getData();
+    size_t size = this->file.getSize();
+    if (size < sizeof(header))
+    {
+        LogMessage(ELS_WARNING) << "Asset pack " << fileName << " is too small";
+        return false;
+    }
+    memcpy(&header, pData, sizeof(header));
+    if (memcmp(header.magic, "IPAK", 4) != 0 || header.version != AssetPackArchive::VERSION)
+    {
+        LogMessage(ELS_WARNING) << "Asset pack " << fileName << " is not a version " << AssetPackArchive::VERSION << " pack";
+        return false;
+    }
+    // INDEX
+    // (read in place, so it has to be aligned and inside the file)
+    if (header.indexOffset % 8 != 0 || header.indexOffset > size || header.entryCount > (size - header.indexOffset) / sizeof(SAssetPackEntry) || header.namesOffset > size)
+    {
+        LogMessage(ELS_WARNING) << "Asset pack " << fileName << " has a corrupt index";
+        return false;
+    }
+    this->pEntries = (const SAssetPackEntry*)(pData + header.indexOffset);
+    this->entryCount = header.entryCount;
+    this->pNames = (const char*)(pData + header.namesOffset);
+    size_t namesSize = size - header.namesOffset;
+    this->pFileList = this->pFileSystem->createEmptyFileList("", true, false);
+    for (size_t i = 0; i < this->entryCount; i++)
+    {
+        const SAssetPackEntry& entry = this->pEntries[i];
+        bool valid = (entry.nameOffset <= namesSize && entry.nameLength <= namesSize - entry.nameOffset &&
+            entry.dataOffset <= size && entry.storedSize <= size - entry.dataOffset &&
+            (i == 0 || this->pEntries[i - 1].hash <= entry.hash));
+        if ((entry.flags & EAPEF_LZ4) == 0)
+            valid = valid && (entry.storedSize == entry.size);
+        if (valid == false)
+        {
+            LogMessage(ELS_WARNING) << "Asset pack " << fileName << " has a corrupt entry (" << i << ")";
+            this->pFileList->drop();
+            this->pFileList = 0;
+            this->entryCount = 0;
+            return false;
+        }
+        this->pFileList->addItem(std::string(this->pNames + entry.nameOffset, entry.nameLength).c_str(), (irr::u32)entry.dataOffset, entry.size, false, (irr::u32)i);
+    }
+    this->pFileList->sort();
+    return true;
+}
+
+AssetPackArchive* AssetPackArchive::mount(irr::io::IFileSystem* pFileSystem, const std::string& fileName)
+{
+    AssetPackArchive* pArchive = new AssetPackArchive(pFileSystem);
+    bool mounted = (pArchive->open(fileName) == true && pFileSystem->addFileArchive(pArchive) == true);
+    if (mounted == true)
+        LogMessage(ELS_INFO) << "Serving " << pArchive->getEntryCount() << " files from asset pack " << fileName;
+    else
+        LogMessage(ELS_DEBUG) << "No asset pack " << fileName << ", using the loose files";
+    // The file system holds the reference
+    pArchive->drop();
+    return (mounted == true) ? pArchive : 0;
+}
+
+irr::s32 AssetPackArchive::findEntry(const std::string& name) const
+{
+    irr::u64 hash = AssetPackArchive::hashName(name);
+    // Binary search for the first entry with the hash
+    size_t low = 0;
+    size_t high = this->entryCount;
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (this->pEntries[middle].hash < hash)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    // Compare the names of every entry sharing the hash
+    for (size_t i = low; i < this->entryCount && this->pEntries[i].hash == hash; i++)
+    {
+        const SAssetPackEntry& entry = this->pEntries[i];
+        if (entry.nameLength == name.size() && memcmp(this->pNames + entry.nameOffset, name.c_str(), name.size()) == 0)
+            return (irr::s32)i;
+    }
+    return -1;
+}
+
+bool AssetPackArchive::findData(const std::string& fileName, irr::u64& hash, irr::u64& size) const
+{
+    irr::s32 index = this->findEntry(AssetPackArchive::normalizeName(fileName, this->workingDirectory));
+    if (index < 0)
+        return false;
+    hash = this->pEntries[index].dataHash;
+    size = this->pEntries[index].size;
+    return true;
+}
+
+irr::io::IReadFile* AssetPackArchive::createAndOpenFile(const irr::io::path& filename)
+{
+    irr::s32 index = this->findEntry(AssetPackArchive::normalizeName(filename.c_str(), this->workingDirectory));
+    if (index < 0)
+        return 0;
+    return this->openEntry((irr::u32)index, filename);
+}
+
+irr::io::IReadFile* AssetPackArchive::createAndOpenFile(irr::u32 index)
+{
+    if (this->pFileList == 0 || index >= this->pFileList->getFileCount())
+        return 0;
+    return this->openEntry(this->pFileList->getID(index), this->pFileList->getFullFileName(index));
+}
+
+irr::io::IReadFile* AssetPackArchive::openEntry(irr::u32 index, const irr::io::path& fileName)
+{
+    const SAssetPackEntry& entry = this->pEntries[index];
+    const irr::u8* pData = this->file.getData() + entry.dataOffset;
+    if ((entry.flags & EAPEF_LZ4) == 0)
+        return new AssetPackReadFile(this, fileName, pData, entry.size, 0);
+    std::vector<irr::u8>* pDecompressed = new std::vector<irr::u8>(entry.size);
+    if (LZ4Codec::decompress(pData, entry.storedSize, (entry.size > 0) ? &(*pDecompressed)[0] : 0, entry.size) == false)
+    {
+        LogMessage(ELS_ERROR) << "Asset pack entry " << fileName.c_str() << " is corrupt";
+        delete pDecompressed;
+        return 0;
+    }
+    return new AssetPackReadFile(this, fileName, 0, entry.size, pDecompressed);
+}
@@ -0,0 +1,185 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef ASSETPACKARCHIVE_H
+#define ASSETPACKARCHIVE_H
+
+// C/C++ Includes
+#include <string>
+#include <vector>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+// Game Includes
+#include "MappedFile.h"
+
+//! Flags of an asset pack entry
+enum E_ASSET_PACK_ENTRY_FLAG
+{
+    // The entry is an LZ4 block
+    EAPEF_LZ4 = 0x1
+};
+
+//! The start of an asset pack
+struct SAssetPackHeader
+{
+    // "IPAK"
+    char magic[4];
+    // AssetPackArchive::VERSION when written
+    irr::u32 version;
+    // Entries in the index
+    irr::u32 entryCount;
+    // Unused (zero)
+    irr::u32 reserved;
+    // Where the index and the names start
+    irr::u64 indexOffset;
+    irr::u64 namesOffset;
+};
+
+//! An asset pack index entry (the index is sorted by hash)
+struct SAssetPackEntry
+{
+    // AssetPackArchive::hashName of the name
+    irr::u64 hash;
+    // Where the entry's data starts
+    irr::u64 dataOffset;
+    // AssetPackArchive::hashData of the decompressed data (lets caches check their source without reading it)
+    irr::u64 dataHash;
+    // The name (normalised, relative to the names)
+    irr::u32 nameOffset;
+    irr::u32 nameLength;
+    // Bytes stored in the pack and bytes once decompressed
+    irr::u32 storedSize;
+    irr::u32 size;
+    // E_ASSET_PACK_ENTRY_FLAG
+    irr::u32 flags;
+    // Unused (zero)
+    irr::u32 reserved;
+};
+
+class AssetPackArchive;
+
+/** The AssetPackReadFile Class reads an asset pack entry. An uncompressed
+    entry is a view of the pack's mapping, so reading it copies straight out
+    of the page cache. A compressed entry is decompressed when it is opened.
+    The file holds a reference to its archive so the mapping outlives it **/
+class AssetPackReadFile : public irr::io::IReadFile
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor (a view of pData, or of the decompressed copy when one is given)
+        AssetPackReadFile(AssetPackArchive* pArchive, const irr::io::path& fileName, const irr::u8* pData, irr::u32 size, std::vector<irr::u8>* pDecompressed);
+        //! Destructor
+        virtual ~AssetPackReadFile();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Read bytes from the current position (returns the number read)
+        virtual irr::s32 read(void* buffer, irr::u32 sizeToRead);
+        //! Move the current position (returns false if it would leave the file)
+        virtual bool seek(long finalPos, bool relativeMovement = false);
+        //! Get the size of the file
+        virtual long getSize() const { return (long)this->size; }
+        //! Get the current position
+        virtual long getPos() const { return (long)this->position; }
+        //! Get the name of the file
+        virtual const irr::io::path& getFileName() const { return this->fileName; }
+
+    protected:
+        // The archive (grabbed)
+        AssetPackArchive* pArchive;
+        // Name the file was opened with
+        irr::io::path fileName;
+        // The entry's data and size
+        const irr::u8* pData;
+        irr::u32 size;
+        // Current position
+        irr::u32 position;
+        // The decompressed copy of a compressed entry (owned)
+        std::vector<irr::u8>* pDecompressed;
+};
+
+/** The AssetPackArchive Class serves the files of an asset pack (written by
+    the AssetPacker) from a single memory mapped file. Registered with
+    Irrlicht's file system, it is searched before the disk, so getTexture,
+    getMesh, getFont and the shader loader read media/ from the pack without
+    changing their paths. Names are found by a binary search of the index,
+    which is sorted by a hash of the normalised name (lower case, forward
+    slashes, relative to the working directory when the pack was opened,
+    so finding a name never touches the file system) **/
+class AssetPackArchive : public irr::io::IFileArchive
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        AssetPackArchive(irr::io::IFileSystem* pFileSystem);
+        //! Destructor
+        virtual ~AssetPackArchive();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Map a pack and check its header and index (returns false if it is missing or corrupt, call on the main thread)
+        bool open(const std::string& fileName);
+        //! Open a file by name (returns 0 if it is not in the pack)
+        virtual irr::io::IReadFile* createAndOpenFile(const irr::io::path& filename);
+        //! Open a file by its index in the file list
+        virtual irr::io::IReadFile* createAndOpenFile(irr::u32 index);
+        //! Get the list of files in the pack
+        virtual const irr::io::IFileList* getFileList() const { return this->pFileList; }
+        //! Get the number of entries
+        irr::u32 getEntryCount() const { return (irr::u32)this->entryCount; }
+        //! Get a file's data hash and decompressed size from the index (any thread, returns false if it is not in the pack)
+        bool findData(const std::string& fileName, irr::u64& hash, irr::u64& size) const;
+        //! Open a pack and register it with a file system (returns the pack, which the file system owns, or 0 to use the loose files)
+        static AssetPackArchive* mount(irr::io::IFileSystem* pFileSystem, const std::string& fileName);
+        //! Normalise a name the way the index stores it
+        static std::string normalizeName(const std::string& name, const std::string& workingDirectory);
+        //! Hash a normalised name (FNV-1a)
+        static irr::u64 hashName(const std::string& name);
+        //! Hash a file's data (FNV-1a)
+        static irr::u64 hashData(const void* pData, size_t size);
+
+    public:
+        // Version of the pack format (bump it whenever the layout changes)
+        static const irr::u32 VERSION = 2;
+        // Entries' data starts on multiples of this
+        static const irr::u32 ALIGNMENT = 16;
+
+    protected:
+        //! Find an entry by normalised name (returns -1 if it is not in the pack)
+        irr::s32 findEntry(const std::string& name) const;
+        //! Open an entry
+        irr::io::IReadFile* openEntry(irr::u32 index, const irr::io::path& fileName);
+
+    protected:
+        // The file system the pack is registered with
+        irr::io::IFileSystem* pFileSystem;
+        // The file system's working directory when the pack was opened (normalised, names are relative to it)
+        std::string workingDirectory;
+        // The mapped pack
+        MappedFile file;
+        // The index and names inside the mapping
+        const SAssetPackEntry* pEntries;
+        size_t entryCount;
+        const char* pNames;
+        // The files for Irrlicht's file system (ids are entry indices)
+        irr::io::IFileList* pFileList;
+};
+
+#endif // ASSETPACKARCHIVE_H
@@ -0,0 +1,169 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "AssetPacker.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#include "AssetPackArchive.h"
+#include "LZ4Codec.h"
+#include "Logger.h"
+
+// An entry being packed (sorted by hash)
+struct SPackedFile
+{
+    SAssetPackEntry entry;
+    std::string name;
+    std::vector<irr::u8> data;
+
+    bool operator<(const SPackedFile& other) const
+    {
+        return (this->entry.hash < other.entry.hash) || (this->entry.hash == other.entry.hash && this->name < other.name);
+    }
+};
+
+// Pad the pack with zeros to a multiple of alignment
+static void pad(std::vector<irr::u8>& output, size_t alignment)
+{
+    while (output.size() % alignment != 0)
+        output.push_back(0);
+}
+
+AssetPacker::AssetPacker()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->compression = false;
+}
+
+void AssetPacker::addDirectory(irr::io::IFileSystem* pFileSystem, const std::string& directory, std::vector<std::string>& fileNames)
+{
+    // List the directory from inside it, then go back
+    irr::io::path previousDirectory = pFileSystem->getWorkingDirectory();
+    if (pFileSystem->changeWorkingDirectoryTo(directory.c_str()) == false)
+    {
+        LogMessage(ELS_WARNING) << "AssetPacker::pack() unable to open directory " << directory;
+        return;
+    }
+    irr::io::IFileList* pFileList = pFileSystem->createFileList();
+    pFileSystem->changeWorkingDirectoryTo(previousDirectory);
+    if (pFileList == 0)
+        return;
+    for (irr::u32 i = 0; i < pFileList->getFileCount(); i++)
+    {
+        std::string name = pFileList->getFileName(i).c_str();
+        if (name == "." || name == "..")
+            continue;
+        std::string path = directory + "/" + name;
+        if (pFileList->isDirectory(i) == true)
+            this->addDirectory(pFileSystem, path, fileNames);
+        else
+            fileNames.push_back(path);
+    }
+    pFileList->drop();
+}
+
+bool AssetPacker::pack(const std::string& sourceDirectory, const std::string& packFile)
+{
+    // ********
+    // * PACK *
+    // ********
+
+    LogMessage(ELS_INFO) << "AssetPacker::pack() " << sourceDirectory << " into " << packFile << ((this->compression == true) ? " with LZ4" : "");
+    // The null device's file system lists directories without opening a window
+    irr::IrrlichtDevice* pDevice = irr::createDevice(irr::video::EDT_NULL);
+    if (pDevice == 0)
+    {
+        LogMessage(ELS_ERROR) << "AssetPacker::pack() could not create the null device";
+        return false;
+    }
+    std::vector<std::string> fileNames;
+    this->addDirectory(pDevice->getFileSystem(), sourceDirectory, fileNames);
+    pDevice->drop();
+
+    // READ
+    std::vector<SPackedFile> files(fileNames.size());
+    std::vector<irr::u8> compressed;
+    size_t totalSize = 0;
+    size_t compressedCount = 0;
+    for (size_t i = 0; i < fileNames.size(); i++)
+    {
+        SPackedFile& file = files[i];
+        std::ifstream stream(fileNames[i].c_str(), std::ios::binary);
+        if (stream.is_open() == false)
+        {
+            LogMessage(ELS_ERROR) << "AssetPacker::pack() unable to read " << fileNames[i];
+            return false;
+        }
+        file.data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        file.name = AssetPackArchive::normalizeName(fileNames[i], "");
+        memset(&file.entry, 0, sizeof(file.entry));
+        file.entry.hash = AssetPackArchive::hashName(file.name);
+        file.entry.size = (irr::u32)file.data.size();
+        file.entry.dataHash = AssetPackArchive::hashData((file.data.empty() == false) ? &file.data[0] : 0, file.data.size());
+        totalSize += file.data.size();
+        // Keep the compressed copy when it saves at least an eighth
+        if (this->compression == true && file.data.empty() == false)
+        {
+            LZ4Codec::compress(&file.data[0], file.data.size(), compressed);
+            if (compressed.size() <= file.data.size() - file.data.size() / 8)
+            {
+                file.data.swap(compressed);
+                file.entry.flags |= EAPEF_LZ4;
+                compressedCount++;
+            }
+        }
+        file.entry.storedSize = (irr::u32)file.data.size();
+    }
+    if (files.empty() == true)
+    {
+        LogMessage(ELS_ERROR) << "AssetPacker::pack() found no files in " << sourceDirectory;
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+
+    // LAYOUT
+    // (header, each entry's aligned data, the index, then the names)
+    std::vector<irr::u8> output(sizeof(SAssetPackHeader), 0);
+    std::string names;
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        pad(output, AssetPackArchive::ALIGNMENT);
+        files[i].entry.dataOffset = output.size();
+        output.insert(output.end(), files[i].data.begin(), files[i].data.end());
+        files[i].entry.nameOffset = (irr::u32)names.size();
+        files[i].entry.nameLength = (irr::u32)files[i].name.size();
+        names += files[i].name;
+    }
+    pad(output, AssetPackArchive::ALIGNMENT);
+    SAssetPackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "IPAK", 4);
+    header.version = AssetPackArchive::VERSION;
+    header.entryCount = (irr::u32)files.size();
+    header.indexOffset = output.size();
+    for (size_t i = 0; i < files.size(); i++)
+        output.insert(output.end(), (const irr::u8*)&files[i].entry, (const irr::u8*)&files[i].entry + sizeof(SAssetPackEntry));
+    header.namesOffset = output.size();
+    output.insert(output.end(), names.begin(), names.end());
+    memcpy(&output[0], &header, sizeof(header));
+
+    // WRITE
+    std::ofstream stream(packFile.c_str(), std::ios::binary);
+    if (stream.is_open() == false)
+    {
+        LogMessage(ELS_ERROR) << "AssetPacker::pack() unable to write " << packFile;
+        return false;
+    }
+    stream.write((const char*)&output[0], output.size());
+    LogMessage(ELS_INFO) << "AssetPacker::pack() " << files.size() << " files (" << compressedCount << " compressed), " << totalSize << " bytes packed into " << output.size();
+    return stream.good();
+}
@@ -0,0 +1,51 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef ASSETPACKER_H
+#define ASSETPACKER_H
+
+// C/C++ Includes
+#include <string>
+#include <vector>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+/** The AssetPacker Class writes every file under a directory into an asset
+    pack read by the AssetPackArchive. It runs without a window, listing the
+    directory with the null device's file system. Entries are stored under
+    their normalised names, sorted by the hash of the name, with their data
+    aligned for the mapping. With compression on, each entry is LZ4
+    compressed and kept that way only when it shrinks by at least an eighth
+    (images already compressed as JPEG or PNG are stored as they are) **/
+class AssetPacker
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        AssetPacker();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Pack a directory (relative to the working directory, returns false if nothing could be packed or the pack could not be written)
+        bool pack(const std::string& sourceDirectory, const std::string& packFile);
+
+    protected:
+        //! Add the files under a directory to the list (recursively)
+        void addDirectory(irr::io::IFileSystem* pFileSystem, const std::string& directory, std::vector<std::string>& fileNames);
+
+    public:
+        // LZ4 compress entries that shrink enough
+        bool compression;
+};
+
+#endif // ASSETPACKER_H
@@ -0,0 +1,203 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "AssetPrefetcher.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "Logger.h"
+
+// Is a file a JPEG (by its extension, as Irrlicht picks its loader)
+static bool isJPEG(const std::string& fileName)
+{
+    std::string extension = fileName.substr(fileName.find_last_of('.') + 1);
+    for (size_t i = 0; i < extension.size(); i++)
+        extension[i] = (char)tolower((unsigned char)extension[i]);
+    return (extension == "jpg" || extension == "jpeg");
+}
+
+AssetPrefetcher::AssetPrefetcher()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->pJobSystem = 0;
+    this->pVideoDriver = 0;
+    this->pSceneManager = 0;
+    this->pMeshCache = 0;
+    this->started = false;
+}
+
+AssetPrefetcher::~AssetPrefetcher()
+{
+    // **************
+    // * DESTRUCTOR *
+    // **************
+
+    this->clear();
+}
+
+void AssetPrefetcher::addImage(const std::string& fileName)
+{
+    SPrefetchAsset asset;
+    asset.fileName = fileName;
+    asset.type = EPAT_IMAGE;
+    asset.pFile = 0;
+    asset.pImage = 0;
+    asset.pSkinnedMesh = 0;
+    asset.pJob = 0;
+    asset.decodeTime = 0.0;
+    this->assets.push_back(asset);
+}
+
+void AssetPrefetcher::addMesh(const std::string& fileName)
+{
+    this->addImage(fileName);
+    this->assets.back().type = EPAT_MESH;
+}
+
+void AssetPrefetcher::start(JobSystem* pJobSystem, irr::IrrlichtDevice* pIrrlichtDevice, MeshCache* pMeshCache)
+{
+    // *********
+    // * START *
+    // *********
+
+    this->pJobSystem = pJobSystem;
+    this->pVideoDriver = pIrrlichtDevice->getVideoDriver();
+    this->pSceneManager = pIrrlichtDevice->getSceneManager();
+    this->pMeshCache = pMeshCache;
+    this->startTime = std::chrono::steady_clock::now();
+    this->started = true;
+    for (size_t i = 0; i < this->assets.size(); i++)
+    {
+        SPrefetchAsset& asset = this->assets[i];
+        // Files are opened here as Irrlicht's file system is not thread safe
+        if (asset.type == EPAT_IMAGE)
+        {
+            asset.pFile = pIrrlichtDevice->getFileSystem()->createAndOpenFile(asset.fileName.c_str());
+            if (asset.pFile == 0)
+            {
+                LogMessage(ELS_WARNING) << "AssetPrefetcher::start() unable to open " << asset.fileName;
+                continue;
+            }
+        }
+        asset.pJob = this->pJobSystem->createJob([this, i]() { this->decode(this->assets[i]); });
+        this->pJobSystem->run(asset.pJob);
+    }
+}
+
+void AssetPrefetcher::decode(SPrefetchAsset& asset)
+{
+    /* NOTES: everything decode reaches, and what stays on the main thread
+        - Images: IVideoDriver::createImageFromFile only reads the driver's list of image loaders and the asset's
+          own IReadFile. The file is opened on the main thread in start (IFileSystem caches its working directory
+          and file list and is not thread safe) and is only read here
+        - Irrlicht's JPEG loader keeps the file name in a static, so JPEGs are decoded under jpegMutex. The main
+          thread must not load a JPEG itself while jobs run (the game's JPEGs are all prefetched and completed
+          before their getTexture calls)
+        - Image loaders report errors through Irrlicht's logger, which posts a log event to Game::OnEvent. That
+          only passes the text to LogMessage, which is safe on any thread
+        - Meshes: MeshCache::decodeCache maps the cache and the source with MappedFile (no file system), looks the
+          source up in the asset pack's index (AssetPackArchive::findData only reads the mapping and the working
+          directory it stored when it opened), and builds the mesh with createSkinnedMesh, which only news a
+          CSkinnedMesh. The mesh cache's asset pack and settings must not change while jobs run
+        - Main thread only (done in complete): creating textures (addTexture and getTexture for a mesh's textures
+          in MeshCache::setTextures) and adding meshes to Irrlicht's mesh cache
+        - Reference counts are not atomic, so the images and meshes made here are only grabbed or dropped on the
+          main thread once their jobs have been waited for
+    */
+    std::chrono::steady_clock::time_point decodeStart = std::chrono::steady_clock::now();
+    if (asset.type == EPAT_IMAGE)
+    {
+        if (isJPEG(asset.fileName) == true)
+        {
+            std::lock_guard<std::mutex> lock(this->jpegMutex);
+            asset.pImage = this->pVideoDriver->createImageFromFile(asset.pFile);
+        }
+        else
+            asset.pImage = this->pVideoDriver->createImageFromFile(asset.pFile);
+    }
+    else
+        asset.pSkinnedMesh = this->pMeshCache->decodeCache(this->pSceneManager, asset.fileName, asset.textures);
+    asset.decodeTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decodeStart).count();
+}
+
+bool AssetPrefetcher::complete(const std::string& fileName)
+{
+    for (size_t i = 0; i < this->assets.size(); i++)
+    {
+        SPrefetchAsset& asset = this->assets[i];
+        if (asset.fileName != fileName || asset.pJob == 0)
+            continue;
+        this->pJobSystem->wait(asset.pJob);
+        asset.pJob = 0;
+        bool completed = false;
+        if (asset.pImage != 0)
+        {
+            // Upload it under the file's name, which getTexture looks for first
+            if (this->pVideoDriver->findTexture(asset.fileName.c_str()) == 0)
+                completed = (this->pVideoDriver->addTexture(asset.fileName.c_str(), asset.pImage) != 0);
+            asset.pImage->drop();
+            asset.pImage = 0;
+        }
+        else if (asset.pSkinnedMesh != 0)
+        {
+            MeshCache::setTextures(this->pVideoDriver, asset.pSkinnedMesh, asset.textures);
+            if (this->pSceneManager->getMeshCache()->getMeshByName(asset.fileName.c_str()) == 0)
+            {
+                this->pMeshCache->addMesh(this->pSceneManager, asset.fileName, asset.pSkinnedMesh);
+                completed = true;
+            }
+            asset.pSkinnedMesh->drop();
+            asset.pSkinnedMesh = 0;
+        }
+        if (asset.pFile != 0)
+        {
+            asset.pFile->drop();
+            asset.pFile = 0;
+        }
+        return completed;
+    }
+    return false;
+}
+
+void AssetPrefetcher::completeAll()
+{
+    if (this->started == false)
+        return;
+    double decodeTotal = 0.0;
+    double decodeLongest = 0.0;
+    for (size_t i = 0; i < this->assets.size(); i++)
+    {
+        this->complete(this->assets[i].fileName);
+        decodeTotal += this->assets[i].decodeTime;
+        decodeLongest = std::max(decodeLongest, this->assets[i].decodeTime);
+    }
+    double wallTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->startTime).count();
+    LogMessage(ELS_INFO) << "AssetPrefetcher::completeAll() " << this->assets.size() << " assets decoded in " << decodeTotal << "ms (longest " << decodeLongest << "ms), " << wallTime << "ms after starting";
+    this->assets.clear();
+    this->started = false;
+}
+
+void AssetPrefetcher::clear()
+{
+    for (size_t i = 0; i < this->assets.size(); i++)
+    {
+        SPrefetchAsset& asset = this->assets[i];
+        if (asset.pJob != 0)
+            this->pJobSystem->wait(asset.pJob);
+        if (asset.pImage != 0)
+            asset.pImage->drop();
+        if (asset.pSkinnedMesh != 0)
+            asset.pSkinnedMesh->drop();
+        if (asset.pFile != 0)
+            asset.pFile->drop();
+    }
+    this->assets.clear();
+    this->started = false;
+}
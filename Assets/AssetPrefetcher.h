@@ -0,0 +1,112 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef ASSETPREFETCHER_H
+#define ASSETPREFETCHER_H
+
+// C/C++ Includes
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+// Game Includes
+#include "JobSystem.h"
+#include "MeshCache.h"
+
+//! Kinds of asset the AssetPrefetcher decodes
+enum E_PREFETCH_ASSET_TYPE
+{
+    // An image, uploaded as a texture named after its file
+    EPAT_IMAGE = 0,
+    // A skinned mesh decoded from its binary mesh cache
+    EPAT_MESH
+};
+
+//! An asset being prefetched
+struct SPrefetchAsset
+{
+    // Name the game loads the asset by
+    std::string fileName;
+    E_PREFETCH_ASSET_TYPE type;
+    // The file, opened on the main thread (images only)
+    irr::io::IReadFile* pFile;
+    // The decoded image or mesh (0 if decoding failed)
+    irr::video::IImage* pImage;
+    irr::scene::ISkinnedMesh* pSkinnedMesh;
+    // Textures of the decoded mesh
+    std::vector<SMeshCacheTexture> textures;
+    // The job decoding it (0 once it has been handed to Irrlicht)
+    SJob* pJob;
+    // Milliseconds spent decoding
+    double decodeTime;
+};
+
+/** The AssetPrefetcher Class decodes the assets the game is known to load
+    on the JobSystem's workers while the main thread carries on with init.
+    Images are decoded into IImages, and meshes are rebuilt from their
+    binary mesh caches (a mesh without a current cache is left for the main
+    thread to parse). Only the steps needing the video driver or Irrlicht's
+    caches stay on the main thread: when an asset is completed its image is
+    uploaded as a texture named after the file, or its mesh gets its
+    textures and is added to Irrlicht's mesh cache, so the game's own
+    getTexture and getMesh calls find them already loaded. Irrlicht's JPEG
+    loader keeps the file name in a static, so JPEGs are decoded one at a
+    time **/
+class AssetPrefetcher
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        AssetPrefetcher();
+        //! Destructor (waits for the jobs and drops anything not completed)
+        virtual ~AssetPrefetcher();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Add an image to prefetch (before start)
+        void addImage(const std::string& fileName);
+        //! Add a mesh to prefetch from its binary cache (before start)
+        void addMesh(const std::string& fileName);
+        //! Open the files and start decoding on the job system (main thread)
+        void start(JobSystem* pJobSystem, irr::IrrlichtDevice* pIrrlichtDevice, MeshCache* pMeshCache);
+        //! Wait for an asset and hand it to Irrlicht (main thread, returns false if it was not prefetched or failed)
+        bool complete(const std::string& fileName);
+        //! Complete every asset left and report the times
+        void completeAll();
+        //! Wait for the jobs and drop anything not completed
+        void clear();
+
+    protected:
+        //! Decode an asset (worker thread)
+        void decode(SPrefetchAsset& asset);
+
+    protected:
+        // The assets (not resized once started, the jobs hold references)
+        std::vector<SPrefetchAsset> assets;
+        // The job system, device and mesh cache used
+        JobSystem* pJobSystem;
+        irr::video::IVideoDriver* pVideoDriver;
+        irr::scene::ISceneManager* pSceneManager;
+        MeshCache* pMeshCache;
+        // Serialises Irrlicht's JPEG loader
+        std::mutex jpegMutex;
+        // When start was called
+        std::chrono::steady_clock::time_point startTime;
+        // Has start been called
+        bool started;
+};
+
+#endif // ASSETPREFETCHER_H
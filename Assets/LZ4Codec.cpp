@@ -0,0 +1,153 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "LZ4Codec.h"
+
+#include <cstring>
+
+// Shortest match a sequence can hold
+static const size_t minMatch = 4;
+// The last five bytes are always literals
+static const size_t lastLiterals = 5;
+// The last match starts at least twelve bytes before the end
+static const size_t matchFindLimit = 12;
+// Bits of the match finder's hash table
+static const unsigned int hashBits = 16;
+
+// Read four bytes in any alignment
+static unsigned int read32(const unsigned char* pData)
+{
+    unsigned int value;
+    memcpy(&value, pData, sizeof(value));
+    return value;
+}
+
+void LZ4Codec::appendLength(std::vector<unsigned char>& output, size_t length)
+{
+    while (length >= 255)
+    {
+        output.push_back(255);
+        length -= 255;
+    }
+    output.push_back((unsigned char)length);
+}
+
+void LZ4Codec::appendSequence(std::vector<unsigned char>& output, const unsigned char* pLiterals, size_t literalLength, size_t offset, size_t matchLength)
+{
+    // Token: the literal length in the high four bits, the match length (less minMatch) in the low four
+    size_t tokenPosition = output.size();
+    output.push_back(0);
+    unsigned char token = (unsigned char)(((literalLength >= 15) ? 15 : literalLength) << 4);
+    if (literalLength >= 15)
+        LZ4Codec::appendLength(output, literalLength - 15);
+    output.insert(output.end(), pLiterals, pLiterals + literalLength);
+    if (matchLength > 0)
+    {
+        output.push_back((unsigned char)offset);
+        output.push_back((unsigned char)(offset >> 8));
+        size_t length = matchLength - minMatch;
+        token |= (unsigned char)((length >= 15) ? 15 : length);
+        if (length >= 15)
+            LZ4Codec::appendLength(output, length - 15);
+    }
+    output[tokenPosition] = token;
+}
+
+void LZ4Codec::compress(const unsigned char* pSource, size_t sourceSize, std::vector<unsigned char>& output)
+{
+    output.clear();
+    output.reserve(sourceSize + sourceSize / 255 + 16);
+    size_t anchor = 0;
+    if (sourceSize > matchFindLimit)
+    {
+        // Last position each hash of four bytes was seen at, plus one (zero is empty)
+        std::vector<unsigned int> table((size_t)1 << hashBits, 0);
+        size_t position = 0;
+        size_t matchLimit = sourceSize - lastLiterals;
+        while (position < sourceSize - matchFindLimit)
+        {
+            unsigned int sequence = read32(pSource + position);
+            unsigned int hash = (sequence * 2654435761u) >> (32 - hashBits);
+            size_t candidate = table[hash];
+            table[hash] = (unsigned int)(position + 1);
+            if (candidate == 0 || position - (candidate - 1) > 65535 || read32(pSource + candidate - 1) != sequence)
+            {
+                position++;
+                continue;
+            }
+            // Extend the match as far as it goes
+            size_t reference = candidate - 1;
+            size_t matchLength = minMatch;
+            while (position + matchLength < matchLimit && pSource[reference + matchLength] == pSource[position + matchLength])
+                matchLength++;
+            LZ4Codec::appendSequence(output, pSource + anchor, position - anchor, position - reference, matchLength);
+            position += matchLength;
+            anchor = position;
+        }
+    }
+    LZ4Codec::appendSequence(output, pSource + anchor, sourceSize - anchor, 0, 0);
+}
+
+bool LZ4Codec::decompress(const unsigned char* pSource, size_t sourceSize, unsigned char* pDestination, size_t destinationSize)
+{
+    size_t input = 0;
+    size_t output = 0;
+    while (true)
+    {
+        if (input >= sourceSize)
+            return false;
+        unsigned char token = pSource[input++];
+        // Literals
+        size_t literalLength = token >> 4;
+        if (literalLength == 15)
+        {
+            unsigned char extra = 255;
+            while (extra == 255)
+            {
+                if (input >= sourceSize)
+                    return false;
+                extra = pSource[input++];
+                literalLength += extra;
+            }
+        }
+        if (literalLength > sourceSize - input || literalLength > destinationSize - output)
+            return false;
+        memcpy(pDestination + output, pSource + input, literalLength);
+        input += literalLength;
+        output += literalLength;
+        // The last sequence has no match
+        if (input == sourceSize)
+            break;
+        // Match
+        if (sourceSize - input < 2)
+            return false;
+        size_t offset = pSource[input] | ((size_t)pSource[input + 1] << 8);
+        input += 2;
+        if (offset == 0 || offset > output)
+            return false;
+        size_t matchLength = token & 15;
+        if (matchLength == 15)
+        {
+            unsigned char extra = 255;
+            while (extra == 255)
+            {
+                if (input >= sourceSize)
+                    return false;
+                extra = pSource[input++];
+                matchLength += extra;
+            }
+        }
+        matchLength += minMatch;
+        if (matchLength > destinationSize - output)
+            return false;
+        // Byte by byte as the match may overlap what it writes
+        const unsigned char* pMatch = pDestination + output - offset;
+        for (size_t i = 0; i < matchLength; i++)
+            pDestination[output + i] = pMatch[i];
+        output += matchLength;
+    }
+    return (output == destinationSize);
+}
@@ -0,0 +1,39 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef LZ4CODEC_H
+#define LZ4CODEC_H
+
+// C/C++ Includes
+#include <cstddef>
+#include <vector>
+
+/** The LZ4Codec Class compresses and decompresses LZ4 blocks (the raw
+    block format, no frame header or checksum). Compression is a single
+    greedy pass with a hash table of the last position each four bytes were
+    seen at, so it is quick rather than small. Decompression checks every
+    length and offset against the buffers so a corrupt block fails instead
+    of reading or writing past them **/
+class LZ4Codec
+{
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Compress a block (output is replaced)
+        static void compress(const unsigned char* pSource, size_t sourceSize, std::vector<unsigned char>& output);
+        //! Decompress a block into exactly destinationSize bytes (returns false if the block is corrupt or a different size)
+        static bool decompress(const unsigned char* pSource, size_t sourceSize, unsigned char* pDestination, size_t destinationSize);
+
+    protected:
+        //! Append a length that did not fit in its token (runs of 255 then the remainder)
+        static void appendLength(std::vector<unsigned char>& output, size_t length);
+        //! Append a sequence of literals followed by a match (matchLength 0 appends the last literals only)
+        static void appendSequence(std::vector<unsigned char>& output, const unsigned char* pLiterals, size_t literalLength, size_t offset, size_t matchLength);
+};
+
+#endif // LZ4CODEC_H
@@ -0,0 +1,115 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#endif
+
+MappedFile::MappedFile()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->pData = 0;
+    this->size = 0;
+    this->opened = false;
+    this->fileHandle = 0;
+    this->mappingHandle = 0;
+}
+
+MappedFile::~MappedFile()
+{
+    // **************
+    // * DESTRUCTOR *
+    // **************
+
+    this->close();
+}
+
+bool MappedFile::open(const std::string& fileName)
+{
+    this->close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) == FALSE)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    this->fileHandle = file;
+    this->size = (size_t)fileSize.QuadPart;
+    this->opened = true;
+    // Empty files cannot be mapped
+    if (this->size == 0)
+        return true;
+    HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    if (mapping == 0)
+    {
+        this->close();
+        return false;
+    }
+    this->mappingHandle = mapping;
+    this->pData = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    int file = ::open(fileName.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+    struct stat fileStat;
+    if (fstat(file, &fileStat) != 0)
+    {
+        ::close(file);
+        return false;
+    }
+    this->fileHandle = (void*)(intptr_t)file;
+    this->size = (size_t)fileStat.st_size;
+    this->opened = true;
+    // Empty files cannot be mapped
+    if (this->size == 0)
+        return true;
+    void* pMapping = mmap(0, this->size, PROT_READ, MAP_PRIVATE, file, 0);
+    this->pData = (pMapping != MAP_FAILED) ? (const unsigned char*)pMapping : 0;
+#endif
+    if (this->pData == 0)
+    {
+        this->close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (this->opened == false)
+        return;
+#ifdef _WIN32
+    if (this->pData != 0)
+        UnmapViewOfFile(this->pData);
+    if (this->mappingHandle != 0)
+        CloseHandle((HANDLE)this->mappingHandle);
+    CloseHandle((HANDLE)this->fileHandle);
+#else
+    if (this->pData != 0)
+        munmap((void*)this->pData, this->size);
+    ::close((int)(intptr_t)this->fileHandle);
+#endif
+    this->pData = 0;
+    this->size = 0;
+    this->opened = false;
+    this->fileHandle = 0;
+    this->mappingHandle = 0;
+}
@@ -0,0 +1,61 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+// C/C++ Includes
+#include <string>
+#include <cstddef>
+
+/** The MappedFile Class maps a whole file into memory read only, so it is
+    read straight out of the operating system's page cache with no copy
+    and no read calls. The data stays valid until the file is closed **/
+class MappedFile
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        MappedFile();
+        //! Destructor (closes the file)
+        virtual ~MappedFile();
+
+    private:
+        //! Not copyable (the mapping is owned)
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Map a file (returns false if it could not be opened, an empty file maps to no data)
+        bool open(const std::string& fileName);
+        //! Unmap the file
+        void close();
+        //! Is a file open
+        bool isOpen() const { return this->opened; }
+        //! Get the file's data
+        const unsigned char* getData() const { return this->pData; }
+        //! Get the file's size in bytes
+        size_t getSize() const { return this->size; }
+
+    protected:
+        // The mapped data and its size
+        const unsigned char* pData;
+        size_t size;
+        // Is a file open
+        bool opened;
+        // The file and mapping handles (a file descriptor on POSIX, only fileHandle is used there)
+        void* fileHandle;
+        void* mappingHandle;
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,571 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "MeshCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <map>
+
+#include "MappedFile.h"
+#include "Logger.h"
+
+// Material flags stored in a cache (bit i of the flag mask is materialFlags[i])
+static const irr::video::E_MATERIAL_FLAG materialFlags[] =
+{
+    irr::video::EMF_WIREFRAME, irr::video::EMF_POINTCLOUD, irr::video::EMF_GOURAUD_SHADING, irr::video::EMF_LIGHTING,
+    irr::video::EMF_ZBUFFER, irr::video::EMF_ZWRITE_ENABLE, irr::video::EMF_BACK_FACE_CULLING, irr::video::EMF_FRONT_FACE_CULLING,
+    irr::video::EMF_BILINEAR_FILTER, irr::video::EMF_TRILINEAR_FILTER, irr::video::EMF_ANISOTROPIC_FILTER, irr::video::EMF_FOG_ENABLE,
+    irr::video::EMF_NORMALIZE_NORMALS, irr::video::EMF_TEXTURE_WRAP, irr::video::EMF_ANTI_ALIASING, irr::video::EMF_COLOR_MASK,
+    irr::video::EMF_COLOR_MATERIAL, irr::video::EMF_USE_MIP_MAPS, irr::video::EMF_BLEND_OPERATION, irr::video::EMF_POLYGON_OFFSET
+};
+static const irr::u32 materialFlagCount = sizeof(materialFlags) / sizeof(materialFlags[0]);
+
+// Append raw bytes to a cache being written
+static void append(std::vector<irr::u8>& output, const void* pData, size_t size)
+{
+    if (size > 0)
+        output.insert(output.end(), (const irr::u8*)pData, (const irr::u8*)pData + size);
+}
+
+// Append a value to a cache being written
+template <class T> static void appendValue(std::vector<irr::u8>& output, const T& value)
+{
+    append(output, &value, sizeof(T));
+}
+
+// Append a length prefixed string to a cache being written
+static void appendString(std::vector<irr::u8>& output, const irr::core::stringc& text)
+{
+    appendValue(output, (irr::u32)text.size());
+    append(output, text.c_str(), text.size());
+}
+
+// Append an array's size followed by its elements copied as they are
+template <class T> static void appendArray(std::vector<irr::u8>& output, const irr::core::array<T>& values)
+{
+    appendValue(output, (irr::u32)values.size());
+    if (values.size() > 0)
+        append(output, values.const_pointer(), values.size() * sizeof(T));
+}
+
+// Write a cache to disk
+static bool writeFile(const std::string& fileName, const std::vector<irr::u8>& data)
+{
+    std::ofstream file(fileName.c_str(), std::ios::binary);
+    if (file.is_open() == false)
+    {
+        LogMessage(ELS_WARNING) << "Unable to write mesh cache " << fileName;
+        return false;
+    }
+    file.write((const char*)&data[0], data.size());
+    LogMessage(ELS_INFO) << "Mesh cache " << fileName << " written (" << data.size() << " bytes)";
+    return true;
+}
+
+/* Reads a mapped cache, checking every read against the end of the mapping so
+    a truncated or corrupt cache fails rather than reading past it (decodeData
+    also checks every index and weight against its buffer's vertex count) */
+struct SMeshCacheReader
+{
+    const irr::u8* pData;
+    size_t size;
+    size_t offset;
+
+    bool read(void* pOut, size_t count)
+    {
+        if (count > this->size - this->offset)
+            return false;
+        if (count > 0)
+            memcpy(pOut, this->pData + this->offset, count);
+        this->offset += count;
+        return true;
+    }
+    template <class T> bool readValue(T& value)
+    {
+        return this->read(&value, sizeof(T));
+    }
+    bool readString(irr::core::stringc& text)
+    {
+        irr::u32 length = 0;
+        if (this->readValue(length) == false || length > this->size - this->offset)
+            return false;
+        text = irr::core::stringc((const irr::c8*)this->pData + this->offset, length);
+        this->offset += length;
+        return true;
+    }
+    template <class T> bool readArray(irr::core::array<T>& values)
+    {
+        irr::u32 count = 0;
+        if (this->readValue(count) == false || count > (this->size - this->offset) / sizeof(T))
+            return false;
+        values.set_used(count);
+        return (count == 0 || this->read(values.pointer(), count * sizeof(T)));
+    }
+};
+
+MeshCache::MeshCache()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->enabled = true;
+    this->optimizing = true;
+    this->pAssetPack = 0;
+    this->hitCount = 0;
+    this->missCount = 0;
+}
+
+MeshCache::~MeshCache()
+{
+    // **************
+    // * DESTRUCTOR *
+    // **************
+
+    this->setAssetPack(0);
+}
+
+void MeshCache::setAssetPack(AssetPackArchive* pAssetPack)
+{
+    if (pAssetPack != 0)
+        pAssetPack->grab();
+    if (this->pAssetPack != 0)
+        this->pAssetPack->drop();
+    this->pAssetPack = pAssetPack;
+}
+
+bool MeshCache::hashFile(const std::string& fileName, irr::u64& hash, irr::u64& size)
+{
+    MappedFile file;
+    if (file.open(fileName) == false)
+        return false;
+    hash = AssetPackArchive::hashData(file.getData(), file.getSize());
+    size = file.getSize();
+    return true;
+}
+
+bool MeshCache::makeHeader(const std::string& fileName, SMeshCacheHeader& header) const
+{
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "IMSH", 4);
+    header.version = MeshCache::VERSION;
+    header.vertexSizes[0] = sizeof(irr::video::S3DVertex);
+    header.vertexSizes[1] = sizeof(irr::video::S3DVertex2TCoords);
+    header.vertexSizes[2] = sizeof(irr::video::S3DVertexTangents);
+    header.keySizes[0] = sizeof(irr::scene::ISkinnedMesh::SPositionKey);
+    header.keySizes[1] = sizeof(irr::scene::ISkinnedMesh::SScaleKey);
+    header.keySizes[2] = sizeof(irr::scene::ISkinnedMesh::SRotationKey);
+    // The pack is searched before the disk (as Irrlicht's file system does), and its index already holds the hash
+    if (this->pAssetPack != 0 && this->pAssetPack->findData(fileName, header.sourceHash, header.sourceSize) == true)
+        return true;
+    return MeshCache::hashFile(fileName, header.sourceHash, header.sourceSize);
+}
+
+irr::scene::IAnimatedMesh* MeshCache::getMesh(irr::scene::ISceneManager* pSceneManager, const std::string& fileName)
+{
+    // Already loaded
+    irr::scene::IAnimatedMesh* pAnimatedMesh = pSceneManager->getMeshCache()->getMeshByName(fileName.c_str());
+    if (pAnimatedMesh != 0)
+        return pAnimatedMesh;
+
+    // Load the binary cache
+    if (this->enabled == true)
+    {
+        irr::scene::ISkinnedMesh* pSkinnedMesh = this->loadCache(pSceneManager, fileName);
+        if (pSkinnedMesh != 0)
+        {
+            this->addMesh(pSceneManager, fileName, pSkinnedMesh);
+            pSkinnedMesh->drop();
+            return pSkinnedMesh;
+        }
+    }
+
+    // Parse it (writing the binary cache before anything animates the mesh)
+    pAnimatedMesh = pSceneManager->getMesh(fileName.c_str());
+    if (pAnimatedMesh == 0)
+        return 0;
+    this->missCount++;
+    if (pAnimatedMesh->getMeshType() != irr::scene::EAMT_SKINNED)
+        return pAnimatedMesh;
+    irr::scene::ISkinnedMesh* pParsed = (irr::scene::ISkinnedMesh*)pAnimatedMesh;
+    if (this->optimizing == false)
+    {
+        if (this->enabled == true)
+            this->writeCache(pParsed, fileName);
+        return pAnimatedMesh;
+    }
+
+    // Optimise it (writing the binary cache) and swap the parsed mesh for the one rebuilt from the optimised copy
+    std::vector<irr::u8> data;
+    if (this->encodeCache(pParsed, fileName, data, 0, 0) == false)
+        return pAnimatedMesh;
+    if (this->enabled == true)
+        writeFile(MeshCache::getCacheFileName(fileName), data);
+    std::vector<SMeshCacheTexture> textures;
+    irr::scene::ISkinnedMesh* pSkinnedMesh = this->decodeData(pSceneManager, fileName, &data[0], data.size(), textures);
+    if (pSkinnedMesh == 0)
+        return pAnimatedMesh;
+    MeshCache::setTextures(pSceneManager->getVideoDriver(), pSkinnedMesh, textures);
+    pSceneManager->getMeshCache()->removeMesh(pParsed);
+    pSceneManager->getMeshCache()->addMesh(fileName.c_str(), pSkinnedMesh);
+    pSkinnedMesh->drop();
+    return pSkinnedMesh;
+}
+
+void MeshCache::addMesh(irr::scene::ISceneManager* pSceneManager, const std::string& fileName, irr::scene::ISkinnedMesh* pSkinnedMesh)
+{
+    // Irrlicht's mesh cache keeps the mesh alive from here on
+    pSceneManager->getMeshCache()->addMesh(fileName.c_str(), pSkinnedMesh);
+    this->hitCount++;
+    LogMessage(ELS_DEBUG) << "Loaded " << fileName << " from its mesh cache";
+}
+
+irr::scene::ISkinnedMesh* MeshCache::loadCache(irr::scene::ISceneManager* pSceneManager, const std::string& fileName)
+{
+    std::vector<SMeshCacheTexture> textures;
+    irr::scene::ISkinnedMesh* pSkinnedMesh = this->decodeCache(pSceneManager, fileName, textures);
+    if (pSkinnedMesh != 0)
+        MeshCache::setTextures(pSceneManager->getVideoDriver(), pSkinnedMesh, textures);
+    return pSkinnedMesh;
+}
+
+void MeshCache::setTextures(irr::video::IVideoDriver* pVideoDriver, irr::scene::ISkinnedMesh* pSkinnedMesh, const std::vector<SMeshCacheTexture>& textures)
+{
+    irr::core::array<irr::scene::SSkinMeshBuffer*>& meshBuffers = pSkinnedMesh->getMeshBuffers();
+    for (size_t i = 0; i < textures.size(); i++)
+        meshBuffers[textures[i].bufferIndex]->Material.setTexture(textures[i].layer, pVideoDriver->getTexture(textures[i].fileName.c_str()));
+}
+
+irr::scene::ISkinnedMesh* MeshCache::decodeCache(irr::scene::ISceneManager* pSceneManager, const std::string& fileName, std::vector<SMeshCacheTexture>& textures)
+{
+    MappedFile file;
+    if (file.open(MeshCache::getCacheFileName(fileName)) == false)
+        return 0;
+    return this->decodeData(pSceneManager, fileName, file.getData(), file.getSize(), textures);
+}
+
+irr::scene::ISkinnedMesh* MeshCache::decodeData(irr::scene::ISceneManager* pSceneManager, const std::string& fileName, const irr::u8* pData, size_t size, std::vector<SMeshCacheTexture>& textures)
+{
+    std::string cacheFileName = MeshCache::getCacheFileName(fileName);
+
+    // HEADER
+    // (a cache from another version, build, source or optimizer setting is parsed again)
+    SMeshCacheHeader header;
+    SMeshCacheHeader expected;
+    SMeshCacheReader reader = { pData, size, 0 };
+    if (reader.readValue(header) == false || this->makeHeader(fileName, expected) == false)
+        return 0;
+    if (memcmp(header.magic, expected.magic, 4) != 0 || header.version != expected.version ||
+        memcmp(header.vertexSizes, expected.vertexSizes, sizeof(header.vertexSizes)) != 0 ||
+        memcmp(header.keySizes, expected.keySizes, sizeof(header.keySizes)) != 0)
+    {
+        LogMessage(ELS_INFO) << cacheFileName << " was written by another version, parsing " << fileName;
+        return 0;
+    }
+    if (header.optimized != ((this->optimizing == true) ? 1u : 0u))
+    {
+        LogMessage(ELS_INFO) << cacheFileName << " was written " << ((header.optimized != 0) ? "optimised" : "unoptimised") << ", parsing " << fileName;
+        return 0;
+    }
+    if (header.sourceHash != expected.sourceHash || header.sourceSize != expected.sourceSize)
+    {
+        LogMessage(ELS_INFO) << fileName << " has changed since " << cacheFileName << " was written, parsing it";
+        return 0;
+    }
+
+    irr::scene::ISkinnedMesh* pSkinnedMesh = pSceneManager->createSkinnedMesh();
+    textures.clear();
+    bool valid = true;
+
+    // MESH BUFFERS
+    for (irr::u32 i = 0; i < header.bufferCount && valid == true; i++)
+    {
+        irr::scene::SSkinMeshBuffer* pMeshBuffer = pSkinnedMesh->addMeshBuffer();
+        irr::u32 vertexType = 0;
+        valid = reader.readValue(vertexType) && vertexType <= irr::video::EVT_TANGENTS && reader.readValue(pMeshBuffer->BoundingBox);
+        if (valid == false)
+            break;
+        pMeshBuffer->VertexType = (irr::video::E_VERTEX_TYPE)vertexType;
+        // Material
+        irr::video::SMaterial& material = pMeshBuffer->Material;
+        irr::u32 materialType = 0;
+        irr::u32 colors[4] = { 0 };
+        irr::u32 flagMask = 0;
+        valid = reader.readValue(materialType) && reader.readValue(colors) &&
+            reader.readValue(material.Shininess) && reader.readValue(material.MaterialTypeParam) &&
+            reader.readValue(material.MaterialTypeParam2) && reader.readValue(material.Thickness) &&
+            reader.readValue(flagMask);
+        material.MaterialType = (irr::video::E_MATERIAL_TYPE)materialType;
+        material.AmbientColor.color = colors[0];
+        material.DiffuseColor.color = colors[1];
+        material.EmissiveColor.color = colors[2];
+        material.SpecularColor.color = colors[3];
+        for (irr::u32 j = 0; j < materialFlagCount; j++)
+            material.setFlag(materialFlags[j], ((flagMask >> j) & 1) != 0);
+        for (irr::u32 j = 0; j < _IRR_MATERIAL_MAX_TEXTURES_ && valid == true; j++)
+        {
+            irr::core::stringc textureName;
+            valid = reader.readString(textureName);
+            if (valid == true && textureName.size() > 0)
+            {
+                SMeshCacheTexture texture;
+                texture.bufferIndex = i;
+                texture.layer = j;
+                texture.fileName = textureName.c_str();
+                textures.push_back(texture);
+            }
+        }
+        // Vertices and indices, copied straight out of the mapping
+        if (valid == true)
+        {
+            if (pMeshBuffer->VertexType == irr::video::EVT_TANGENTS)
+                valid = reader.readArray(pMeshBuffer->Vertices_Tangents);
+            else if (pMeshBuffer->VertexType == irr::video::EVT_2TCOORDS)
+                valid = reader.readArray(pMeshBuffer->Vertices_2TCoords);
+            else
+                valid = reader.readArray(pMeshBuffer->Vertices_Standard);
+        }
+        valid = valid && reader.readArray(pMeshBuffer->Indices);
+        // Every index must name one of the buffer's vertices
+        irr::u32 vertexCount = pMeshBuffer->getVertexCount();
+        for (irr::u32 j = 0; j < pMeshBuffer->Indices.size() && valid == true; j++)
+            valid = (pMeshBuffer->Indices[j] < vertexCount);
+    }
+
+    // JOINTS
+    // (parents are always written before their children)
+    irr::core::array<irr::scene::ISkinnedMesh::SJoint*> joints;
+    for (irr::u32 i = 0; i < header.jointCount && valid == true; i++)
+    {
+        irr::s32 parentIndex = -1;
+        valid = reader.readValue(parentIndex) && parentIndex < (irr::s32)joints.size();
+        if (valid == false)
+            break;
+        irr::scene::ISkinnedMesh::SJoint* pJoint = pSkinnedMesh->addJoint((parentIndex >= 0) ? joints[parentIndex] : 0);
+        joints.push_back(pJoint);
+        valid = reader.readString(pJoint->Name) &&
+            reader.read(pJoint->LocalMatrix.pointer(), 16 * sizeof(irr::f32)) &&
+            reader.read(pJoint->GlobalInversedMatrix.pointer(), 16 * sizeof(irr::f32)) &&
+            reader.readArray(pJoint->AttachedMeshes) &&
+            reader.readArray(pJoint->PositionKeys) &&
+            reader.readArray(pJoint->ScaleKeys) &&
+            reader.readArray(pJoint->RotationKeys);
+        irr::u32 weightCount = 0;
+        valid = valid && reader.readValue(weightCount);
+        for (irr::u32 j = 0; j < weightCount && valid == true; j++)
+        {
+            irr::u16 bufferId = 0;
+            irr::u32 vertexId = 0;
+            irr::f32 strength = 0.0f;
+            valid = reader.readValue(bufferId) && reader.readValue(vertexId) && reader.readValue(strength) &&
+                bufferId < header.bufferCount && vertexId < pSkinnedMesh->getMeshBuffers()[bufferId]->getVertexCount();
+            if (valid == false)
+                break;
+            irr::scene::ISkinnedMesh::SWeight* pWeight = pSkinnedMesh->addWeight(pJoint);
+            pWeight->buffer_id = bufferId;
+            pWeight->vertex_id = vertexId;
+            pWeight->strength = strength;
+        }
+        for (irr::u32 j = 0; j < pJoint->AttachedMeshes.size() && valid == true; j++)
+            valid = (pJoint->AttachedMeshes[j] < header.bufferCount);
+    }
+
+    if (valid == false || reader.offset != reader.size)
+    {
+        LogMessage(ELS_WARNING) << cacheFileName << " is corrupt, parsing " << fileName;
+        pSkinnedMesh->drop();
+        return 0;
+    }
+    pSkinnedMesh->setAnimationSpeed(header.animationSpeed);
+    pSkinnedMesh->finalize();
+    return pSkinnedMesh;
+}
+
+bool MeshCache::writeCache(irr::scene::ISkinnedMesh* pSkinnedMesh, const std::string& fileName, SMeshOptimizerStats* pBefore, SMeshOptimizerStats* pAfter)
+{
+    std::vector<irr::u8> output;
+    if (this->encodeCache(pSkinnedMesh, fileName, output, pBefore, pAfter) == false)
+        return false;
+    return writeFile(MeshCache::getCacheFileName(fileName), output);
+}
+
+bool MeshCache::encodeCache(irr::scene::ISkinnedMesh* pSkinnedMesh, const std::string& fileName, std::vector<irr::u8>& output, SMeshOptimizerStats* pBefore, SMeshOptimizerStats* pAfter)
+{
+    SMeshCacheHeader header;
+    if (this->makeHeader(fileName, header) == false)
+        return false;
+    irr::core::array<irr::scene::SSkinMeshBuffer*>& meshBuffers = pSkinnedMesh->getMeshBuffers();
+    const irr::core::array<irr::scene::ISkinnedMesh::SJoint*>& joints = pSkinnedMesh->getAllJoints();
+    header.animationSpeed = pSkinnedMesh->getAnimationSpeed();
+    header.bufferCount = meshBuffers.size();
+    header.jointCount = joints.size();
+    header.optimized = (this->optimizing == true) ? 1 : 0;
+    output.clear();
+    appendValue(output, header);
+
+    // WELD CLASSES
+    // (vertices only weld when the same joints weight them by the same amounts, in the same order)
+    std::vector<std::vector<irr::u32> > vertexClasses(meshBuffers.size());
+    if (this->optimizing == true)
+    {
+        std::vector<std::vector<std::vector<std::pair<irr::u32, irr::f32> > > > vertexWeights(meshBuffers.size());
+        for (irr::u32 i = 0; i < meshBuffers.size(); i++)
+            vertexWeights[i].resize(meshBuffers[i]->getVertexCount());
+        for (irr::u32 i = 0; i < joints.size(); i++)
+        {
+            for (irr::u32 j = 0; j < joints[i]->Weights.size(); j++)
+            {
+                const irr::scene::ISkinnedMesh::SWeight& weight = joints[i]->Weights[j];
+                if (weight.buffer_id < vertexWeights.size() && weight.vertex_id < vertexWeights[weight.buffer_id].size())
+                    vertexWeights[weight.buffer_id][weight.vertex_id].push_back(std::make_pair(i, weight.strength));
+            }
+        }
+        std::map<std::vector<std::pair<irr::u32, irr::f32> >, irr::u32> classes;
+        for (irr::u32 i = 0; i < meshBuffers.size(); i++)
+        {
+            vertexClasses[i].resize(vertexWeights[i].size());
+            for (size_t j = 0; j < vertexWeights[i].size(); j++)
+                vertexClasses[i][j] = classes.insert(std::make_pair(vertexWeights[i][j], (irr::u32)classes.size())).first->second;
+        }
+    }
+
+    // MESH BUFFERS
+    SMeshOptimizerStats before = { 0, 0, 0 };
+    SMeshOptimizerStats after = { 0, 0, 0 };
+    std::vector<std::vector<irr::u32> > remaps(meshBuffers.size());
+    std::vector<std::vector<irr::u32> > firstVertices(meshBuffers.size());
+    for (irr::u32 i = 0; i < meshBuffers.size(); i++)
+    {
+        const irr::scene::SSkinMeshBuffer* pMeshBuffer = meshBuffers[i];
+        appendValue(output, (irr::u32)pMeshBuffer->VertexType);
+        appendValue(output, pMeshBuffer->BoundingBox);
+        // Material
+        const irr::video::SMaterial& material = pMeshBuffer->Material;
+        irr::u32 colors[4] = { material.AmbientColor.color, material.DiffuseColor.color, material.EmissiveColor.color, material.SpecularColor.color };
+        irr::u32 flagMask = 0;
+        for (irr::u32 j = 0; j < materialFlagCount; j++)
+        {
+            if (material.getFlag(materialFlags[j]) == true)
+                flagMask |= (1 << j);
+        }
+        appendValue(output, (irr::u32)material.MaterialType);
+        appendValue(output, colors);
+        appendValue(output, material.Shininess);
+        appendValue(output, material.MaterialTypeParam);
+        appendValue(output, material.MaterialTypeParam2);
+        appendValue(output, material.Thickness);
+        appendValue(output, flagMask);
+        for (irr::u32 j = 0; j < _IRR_MATERIAL_MAX_TEXTURES_; j++)
+        {
+            irr::video::ITexture* pTexture = material.getTexture(j);
+            appendString(output, (pTexture != 0) ? irr::core::stringc(pTexture->getName().getPath()) : irr::core::stringc());
+        }
+        // Vertices and indices
+        if (this->optimizing == false)
+        {
+            if (pMeshBuffer->VertexType == irr::video::EVT_TANGENTS)
+                appendArray(output, pMeshBuffer->Vertices_Tangents);
+            else if (pMeshBuffer->VertexType == irr::video::EVT_2TCOORDS)
+                appendArray(output, pMeshBuffer->Vertices_2TCoords);
+            else
+                appendArray(output, pMeshBuffer->Vertices_Standard);
+            appendArray(output, pMeshBuffer->Indices);
+            continue;
+        }
+        // Optimised (written the way appendArray writes them)
+        irr::u32 vertexPitch = irr::video::getVertexPitchFromType(pMeshBuffer->VertexType);
+        const irr::u8* pVertices = (const irr::u8*)pMeshBuffer->getVertices();
+        std::vector<irr::u8> vertices(pVertices, pVertices + pMeshBuffer->getVertexCount() * vertexPitch);
+        std::vector<irr::u32> indices(pMeshBuffer->Indices.const_pointer(), pMeshBuffer->Indices.const_pointer() + pMeshBuffer->Indices.size());
+        SMeshOptimizerStats bufferBefore = MeshOptimizer::analyze(indices, pMeshBuffer->getVertexCount(), this->optimizer.fifoSize);
+        this->optimizer.optimize(vertices, vertexPitch, indices, &vertexClasses[i], remaps[i]);
+        irr::u32 vertexCount = (irr::u32)(vertices.size() / vertexPitch);
+        // The first of each set of welded vertices keeps its weights (its copies had the same ones)
+        firstVertices[i].assign(vertexCount, MeshOptimizer::NO_VERTEX);
+        for (irr::u32 j = 0; j < remaps[i].size(); j++)
+        {
+            if (remaps[i][j] != MeshOptimizer::NO_VERTEX && firstVertices[i][remaps[i][j]] == MeshOptimizer::NO_VERTEX)
+                firstVertices[i][remaps[i][j]] = j;
+        }
+        SMeshOptimizerStats bufferAfter = MeshOptimizer::analyze(indices, vertexCount, this->optimizer.fifoSize);
+        before.vertexCount += bufferBefore.vertexCount;
+        before.triangleCount += bufferBefore.triangleCount;
+        before.transformCount += bufferBefore.transformCount;
+        after.vertexCount += bufferAfter.vertexCount;
+        after.triangleCount += bufferAfter.triangleCount;
+        after.transformCount += bufferAfter.transformCount;
+        appendValue(output, vertexCount);
+        append(output, (vertexCount > 0) ? &vertices[0] : 0, vertices.size());
+        // Irrlicht's skinned mesh buffers are 16 bit, welding only ever leaves fewer vertices to index
+        std::vector<irr::u16> shortIndices(indices.begin(), indices.end());
+        appendValue(output, (irr::u32)shortIndices.size());
+        append(output, (shortIndices.empty() == false) ? &shortIndices[0] : 0, shortIndices.size() * sizeof(irr::u16));
+    }
+    if (this->optimizing == true)
+        LogMessage(ELS_INFO) << "Optimised " << fileName << ": " << before.vertexCount << " -> " << after.vertexCount << " vertices, ACMR " << before.getACMR() << " -> " << after.getACMR() << ", ATVR " << before.getATVR() << " -> " << after.getATVR();
+    if (pBefore != 0)
+        *pBefore = before;
+    if (pAfter != 0)
+        *pAfter = after;
+
+    // JOINTS
+    for (irr::u32 i = 0; i < joints.size(); i++)
+    {
+        // Find the parent (Irrlicht's loaders add parents before their children)
+        irr::s32 parentIndex = -1;
+        for (irr::u32 j = 0; j < joints.size() && parentIndex < 0; j++)
+        {
+            for (irr::u32 k = 0; k < joints[j]->Children.size(); k++)
+            {
+                if (joints[j]->Children[k] == joints[i])
+                {
+                    parentIndex = (irr::s32)j;
+                    break;
+                }
+            }
+        }
+        if (parentIndex >= (irr::s32)i)
+        {
+            LogMessage(ELS_WARNING) << "Unable to cache " << fileName << ", a joint comes before its parent";
+            return false;
+        }
+        const irr::scene::ISkinnedMesh::SJoint* pJoint = joints[i];
+        appendValue(output, parentIndex);
+        appendString(output, pJoint->Name);
+        append(output, pJoint->LocalMatrix.pointer(), 16 * sizeof(irr::f32));
+        append(output, pJoint->GlobalInversedMatrix.pointer(), 16 * sizeof(irr::f32));
+        appendArray(output, pJoint->AttachedMeshes);
+        appendArray(output, pJoint->PositionKeys);
+        appendArray(output, pJoint->ScaleKeys);
+        appendArray(output, pJoint->RotationKeys);
+        // Weights follow their vertices (dropping those of welded copies and of vertices no triangle uses)
+        std::vector<irr::scene::ISkinnedMesh::SWeight> weights;
+        for (irr::u32 j = 0; j < pJoint->Weights.size(); j++)
+        {
+            irr::scene::ISkinnedMesh::SWeight weight = pJoint->Weights[j];
+            if (this->optimizing == true)
+            {
+                if (weight.buffer_id >= remaps.size() || weight.vertex_id >= remaps[weight.buffer_id].size())
+                    continue;
+                irr::u32 vertex = remaps[weight.buffer_id][weight.vertex_id];
+                if (vertex == MeshOptimizer::NO_VERTEX || firstVertices[weight.buffer_id][vertex] != weight.vertex_id)
+                    continue;
+                weight.vertex_id = vertex;
+            }
+            weights.push_back(weight);
+        }
+        appendValue(output, (irr::u32)weights.size());
+        for (size_t j = 0; j < weights.size(); j++)
+        {
+            appendValue(output, weights[j].buffer_id);
+            appendValue(output, weights[j].vertex_id);
+            appendValue(output, weights[j].strength);
+        }
+    }
+    return true;
+}
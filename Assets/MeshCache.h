@@ -0,0 +1,147 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+// C/C++ Includes
+#include <string>
+#include <vector>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+// Game Includes
+#include "MeshOptimizer.h"
+#include "AssetPackArchive.h"
+
+//! The start of a binary mesh cache file
+struct SMeshCacheHeader
+{
+    // "IMSH"
+    char magic[4];
+    // MeshCache::VERSION when written
+    irr::u32 version;
+    // FNV-1a hash and size of the source file (the cache is stale when either differs)
+    irr::u64 sourceHash;
+    irr::u64 sourceSize;
+    // Sizes of the structures copied as they are (the cache is unusable if a build lays them out differently)
+    irr::u32 vertexSizes[3];
+    irr::u32 keySizes[3];
+    // Frames per second of the animation
+    irr::f32 animationSpeed;
+    // Records following the header
+    irr::u32 bufferCount;
+    irr::u32 jointCount;
+    // 1 when the mesh buffers were written by the MeshOptimizer
+    irr::u32 optimized;
+    // Unused (zero)
+    irr::u32 reserved;
+};
+
+//! A texture of a mesh decoded from its cache, set once the mesh reaches the main thread
+struct SMeshCacheTexture
+{
+    // Mesh buffer and texture layer
+    irr::u32 bufferIndex;
+    irr::u32 layer;
+    // Name the texture is loaded by
+    std::string fileName;
+};
+
+/** The MeshCache Class keeps a binary copy of each skinned mesh next to its
+    source file (Doominator.x gets Doominator.x.mbin). The first time a mesh
+    is loaded it is parsed by Irrlicht and the cache is written; after that
+    the cache is memory mapped and the mesh rebuilt by copying its vertex,
+    index and key arrays straight out of the mapping, so nothing is parsed.
+    The cache holds a hash of the source, which is checked on every load,
+    and a version, so an edited source or an older cache is parsed again.
+    Unless optimizing is turned off each mesh buffer goes through the
+    MeshOptimizer on its way into the cache (welding, then vertex cache,
+    overdraw and vertex fetch order), with the joints' weights remapped to
+    the new vertices, and a freshly parsed mesh is replaced by the mesh
+    rebuilt from its optimised copy.
+    Meshes are added to Irrlicht's mesh cache under the source's name so
+    that ISceneManager::getMesh finds them. Decoding a cache touches neither
+    the video driver nor Irrlicht's mesh cache, so it can run on a worker
+    thread; setting its textures and adding it must happen on the main
+    thread. When an asset pack is set, a source found in it is checked
+    against the hash in the pack's index instead of being read **/
+class MeshCache
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        MeshCache();
+        //! Destructor
+        virtual ~MeshCache();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Get a mesh from Irrlicht's mesh cache, the binary cache or by parsing it (writing the binary cache)
+        irr::scene::IAnimatedMesh* getMesh(irr::scene::ISceneManager* pSceneManager, const std::string& fileName);
+        //! Build a mesh from its binary cache (0 if there is none or it is stale, the caller drops the mesh)
+        irr::scene::ISkinnedMesh* loadCache(irr::scene::ISceneManager* pSceneManager, const std::string& fileName);
+        //! Build a mesh from its binary cache without its textures (any thread while the settings and asset pack are not changed, 0 if there is none or it is stale, the caller drops the mesh)
+        irr::scene::ISkinnedMesh* decodeCache(irr::scene::ISceneManager* pSceneManager, const std::string& fileName, std::vector<SMeshCacheTexture>& textures);
+        //! Load and set the textures of a decoded mesh (main thread)
+        static void setTextures(irr::video::IVideoDriver* pVideoDriver, irr::scene::ISkinnedMesh* pSkinnedMesh, const std::vector<SMeshCacheTexture>& textures);
+        //! Add a mesh loaded from its cache to Irrlicht's mesh cache under its source's name (main thread)
+        void addMesh(irr::scene::ISceneManager* pSceneManager, const std::string& fileName, irr::scene::ISkinnedMesh* pSkinnedMesh);
+        //! Write a skinned mesh's binary cache, optimised unless optimizing is off (returns false if the source or cache could not be opened, fills in the vertex cache statistics when given)
+        bool writeCache(irr::scene::ISkinnedMesh* pSkinnedMesh, const std::string& fileName, SMeshOptimizerStats* pBefore = 0, SMeshOptimizerStats* pAfter = 0);
+        //! Use the binary cache (false always parses)
+        void setEnabled(bool state) { this->enabled = state; }
+        //! Is the binary cache used
+        bool isEnabled() const { return this->enabled; }
+        //! Optimise meshes as they are cached (false caches them as they were parsed)
+        void setOptimizing(bool state) { this->optimizing = state; }
+        //! Are meshes optimised as they are cached
+        bool isOptimizing() const { return this->optimizing; }
+        //! Check sources found in an asset pack against its index (grabbed, 0 checks the loose files only)
+        void setAssetPack(AssetPackArchive* pAssetPack);
+        //! Get the number of meshes loaded from the binary cache
+        irr::u32 getHitCount() const { return this->hitCount; }
+        //! Get the number of meshes parsed
+        irr::u32 getMissCount() const { return this->missCount; }
+        //! Get the name of a source file's binary cache
+        static std::string getCacheFileName(const std::string& fileName) { return fileName + ".mbin"; }
+        //! Hash a loose file's contents (FNV-1a, returns false if it could not be opened)
+        static bool hashFile(const std::string& fileName, irr::u64& hash, irr::u64& size);
+
+    public:
+        // Version of the cache format (bump it whenever the layout changes)
+        static const irr::u32 VERSION = 2;
+
+    protected:
+        //! Fill in a header for a source file, taking its hash from the asset pack when it is in one (returns false if it could not be hashed)
+        bool makeHeader(const std::string& fileName, SMeshCacheHeader& header) const;
+        //! Serialise a skinned mesh the way its binary cache stores it (returns false if the source could not be hashed)
+        bool encodeCache(irr::scene::ISkinnedMesh* pSkinnedMesh, const std::string& fileName, std::vector<irr::u8>& output, SMeshOptimizerStats* pBefore, SMeshOptimizerStats* pAfter);
+        //! Build a mesh from a serialised cache without its textures (0 if it is stale or corrupt, the caller drops the mesh)
+        irr::scene::ISkinnedMesh* decodeData(irr::scene::ISceneManager* pSceneManager, const std::string& fileName, const irr::u8* pData, size_t size, std::vector<SMeshCacheTexture>& textures);
+
+    protected:
+        // Is the binary cache used
+        bool enabled;
+        // Are meshes optimised as they are cached
+        bool optimizing;
+        // Optimises the mesh buffers
+        MeshOptimizer optimizer;
+        // The asset pack sources are read from first (grabbed, may be 0)
+        AssetPackArchive* pAssetPack;
+        // Meshes loaded from the binary cache and parsed
+        irr::u32 hitCount;
+        irr::u32 missCount;
+};
+
+#endif // MESHCACHE_H
@@ -0,0 +1,219 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "MeshCacheBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <Irrlicht.h>
+
+#include "Benchmark.h"
+#include "Logger.h"
+#include "MeshCache.h"
+
+// A triangle's corners, keyed by the bytes of its vertices
+struct SMeshCacheTriangle
+{
+    std::string key;
+    irr::u32 corners[3];
+
+    bool operator<(const SMeshCacheTriangle& other) const { return this->key < other.key; }
+};
+
+// Get a mesh buffer's triangles sorted by their vertices, which the optimizer's welding and reordering leave unchanged
+static void getTriangles(irr::scene::IMeshBuffer* pMeshBuffer, std::vector<SMeshCacheTriangle>& triangles)
+{
+    irr::u32 vertexPitch = irr::video::getVertexPitchFromType(pMeshBuffer->getVertexType());
+    const char* pVertices = (const char*)pMeshBuffer->getVertices();
+    triangles.resize(pMeshBuffer->getIndexCount() / 3);
+    for (size_t i = 0; i < triangles.size(); i++)
+    {
+        triangles[i].key.clear();
+        for (irr::u32 k = 0; k < 3; k++)
+        {
+            triangles[i].corners[k] = pMeshBuffer->getIndices()[i * 3 + k];
+            triangles[i].key.append(pVertices + triangles[i].corners[k] * vertexPitch, vertexPitch);
+        }
+    }
+    std::sort(triangles.begin(), triangles.end());
+}
+
+// Compare a cached mesh with the parsed one, at rest and skinned halfway through its animation (returns the number of differences)
+static int compareMeshes(irr::scene::ISkinnedMesh* pParsed, irr::scene::ISkinnedMesh* pCached)
+{
+    int differences = 0;
+    if (pParsed->getFrameCount() != pCached->getFrameCount())
+        differences++;
+    if (pParsed->getAllJoints().size() != pCached->getAllJoints().size())
+        differences++;
+    if (pParsed->getMeshBufferCount() != pCached->getMeshBufferCount())
+        return differences + 1;
+    // At rest every triangle must have the same vertices (in any order)
+    std::vector<std::vector<SMeshCacheTriangle> > expected(pParsed->getMeshBufferCount());
+    std::vector<std::vector<SMeshCacheTriangle> > loaded(pParsed->getMeshBufferCount());
+    for (irr::u32 i = 0; i < pParsed->getMeshBufferCount(); i++)
+    {
+        if (pParsed->getMeshBuffer(i)->getVertexType() != pCached->getMeshBuffer(i)->getVertexType() || pParsed->getMeshBuffer(i)->getIndexCount() != pCached->getMeshBuffer(i)->getIndexCount())
+        {
+            differences++;
+            continue;
+        }
+        getTriangles(pParsed->getMeshBuffer(i), expected[i]);
+        getTriangles(pCached->getMeshBuffer(i), loaded[i]);
+        for (size_t j = 0; j < expected[i].size(); j++)
+        {
+            if (expected[i][j].key != loaded[i][j].key)
+            {
+                differences++;
+                break;
+            }
+        }
+    }
+    if (differences > 0)
+        return differences;
+    // Skinned, the matching corners must land in the same place (checking the remapped weights)
+    irr::s32 frame = (irr::s32)pParsed->getFrameCount() / 2;
+    irr::scene::IMesh* pExpectedMesh = pParsed->getMesh(frame);
+    irr::scene::IMesh* pLoadedMesh = pCached->getMesh(frame);
+    for (irr::u32 i = 0; i < pExpectedMesh->getMeshBufferCount(); i++)
+    {
+        irr::scene::IMeshBuffer* pExpected = pExpectedMesh->getMeshBuffer(i);
+        irr::scene::IMeshBuffer* pLoaded = pLoadedMesh->getMeshBuffer(i);
+        bool matched = true;
+        for (size_t j = 0; j < expected[i].size() && matched == true; j++)
+        {
+            for (irr::u32 k = 0; k < 3 && matched == true; k++)
+            {
+                const irr::core::vector3df& expectedPosition = pExpected->getPosition(expected[i][j].corners[k]);
+                matched = (expectedPosition.getDistanceFrom(pLoaded->getPosition(loaded[i][j].corners[k])) <= 0.001f * (1.0f + expectedPosition.getLength()));
+            }
+        }
+        if (matched == false)
+            differences++;
+    }
+    return differences;
+}
+
+MeshCacheBenchmark::MeshCacheBenchmark()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->meshFiles.push_back("media/meshes/Doominator.x");
+    this->meshFiles.push_back("media/meshes/plane.x");
+    this->optimizing = true;
+}
+
+bool MeshCacheBenchmark::run(int frameCount, int warmupFrames, const std::string& outputFile)
+{
+    // *******
+    // * RUN *
+    // *******
+
+    LogMessage(ELS_INFO) << "MeshCacheBenchmark::run() " << this->meshFiles.size() << " meshes, " << frameCount << " frames";
+    // The null driver loads meshes without opening a window
+    irr::IrrlichtDevice* pDevice = irr::createDevice(irr::video::EDT_NULL);
+    if (pDevice == 0)
+    {
+        LogMessage(ELS_ERROR) << "MeshCacheBenchmark::run() could not create the null device";
+        return false;
+    }
+    irr::scene::ISceneManager* pSceneManager = pDevice->getSceneManager();
+    irr::scene::IMeshCache* pIrrlichtMeshCache = pSceneManager->getMeshCache();
+    MeshCache meshCache;
+    meshCache.setOptimizing(this->optimizing);
+
+    // Write each mesh's binary cache from a fresh parse
+    Benchmark benchmark;
+    std::vector<std::string> phaseNames;
+    for (size_t i = 0; i < this->meshFiles.size(); i++)
+    {
+        const std::string& meshFile = this->meshFiles[i];
+        // Phases are named after the file (Doominator.x records ParseDoominator and CachedDoominator)
+        std::string name = meshFile.substr(meshFile.find_last_of("/\\") + 1);
+        name = name.substr(0, name.find_last_of('.'));
+        SMeshOptimizerStats before = { 0, 0, 0 };
+        SMeshOptimizerStats after = { 0, 0, 0 };
+        irr::scene::IAnimatedMesh* pAnimatedMesh = pSceneManager->getMesh(meshFile.c_str());
+        if (pAnimatedMesh == 0 || pAnimatedMesh->getMeshType() != irr::scene::EAMT_SKINNED || meshCache.writeCache(static_cast<irr::scene::ISkinnedMesh*>(pAnimatedMesh), meshFile, &before, &after) == false)
+        {
+            LogMessage(ELS_ERROR) << "MeshCacheBenchmark::run() unable to cache " << meshFile;
+            pDevice->drop();
+            return false;
+        }
+        pIrrlichtMeshCache->removeMesh(pAnimatedMesh);
+        phaseNames.push_back("Parse" + name);
+        phaseNames.push_back("Cached" + name);
+        // The vertex cache statistics as parsed and as optimised (ACMR and ATVR for a 16 entry FIFO cache)
+        if (this->optimizing == true)
+        {
+            benchmark.setProperty(name + "Vertices", (double)before.vertexCount);
+            benchmark.setProperty(name + "OptimizedVertices", (double)after.vertexCount);
+            benchmark.setProperty(name + "ACMR", (double)before.getACMR());
+            benchmark.setProperty(name + "OptimizedACMR", (double)after.getACMR());
+            benchmark.setProperty(name + "ATVR", (double)before.getATVR());
+            benchmark.setProperty(name + "OptimizedATVR", (double)after.getATVR());
+        }
+    }
+    benchmark.setPhaseNames(phaseNames);
+    benchmark.setProperty("mode", std::string("meshCache"));
+    benchmark.setProperty("cacheVersion", (double)MeshCache::VERSION);
+    benchmark.setBooleanProperty("optimized", this->optimizing);
+    benchmark.start(frameCount, warmupFrames);
+
+    std::vector<double> phaseTimes(phaseNames.size(), 0.0);
+    int differences = 0;
+    bool compared = false;
+    while (benchmark.isFinished() == false)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < this->meshFiles.size(); i++)
+        {
+            const std::string& meshFile = this->meshFiles[i];
+            // Cold parse (the mesh was removed from Irrlicht's mesh cache so getMesh reads the file again)
+            std::chrono::steady_clock::time_point phaseStart = std::chrono::steady_clock::now();
+            irr::scene::IAnimatedMesh* pParsed = pSceneManager->getMesh(meshFile.c_str());
+            std::chrono::steady_clock::time_point phaseEnd = std::chrono::steady_clock::now();
+            phaseTimes[2 * i] = std::chrono::duration<double, std::milli>(phaseEnd - phaseStart).count();
+            // Cached load (hashing the source to check the cache is current is part of it)
+            phaseStart = std::chrono::steady_clock::now();
+            irr::scene::ISkinnedMesh* pCached = meshCache.loadCache(pSceneManager, meshFile);
+            phaseEnd = std::chrono::steady_clock::now();
+            phaseTimes[2 * i + 1] = std::chrono::duration<double, std::milli>(phaseEnd - phaseStart).count();
+            if (pParsed == 0 || pCached == 0)
+            {
+                LogMessage(ELS_ERROR) << "MeshCacheBenchmark::run() unable to load " << meshFile << ((pParsed == 0) ? " by parsing it" : " from its cache");
+                differences++;
+            }
+            // Check each mesh the first frame (they are the same files every frame)
+            else if (compared == false)
+            {
+                int meshDifferences = compareMeshes(static_cast<irr::scene::ISkinnedMesh*>(pParsed), pCached);
+                if (meshDifferences > 0)
+                    LogMessage(ELS_ERROR) << "MeshCacheBenchmark::run() " << meshFile << " differs from its cache in " << meshDifferences << " places";
+                differences += meshDifferences;
+            }
+            if (pParsed != 0)
+                pIrrlichtMeshCache->removeMesh(pParsed);
+            if (pCached != 0)
+                pCached->drop();
+        }
+        compared = true;
+        double frameTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        benchmark.addFrame(frameTime, &phaseTimes[0]);
+        if (differences > 0)
+            break;
+    }
+    // Report
+    benchmark.setProperty("differences", (double)differences);
+    pDevice->drop();
+    if (differences > 0)
+        return false;
+    return benchmark.writeJSON(outputFile);
+}
@@ -0,0 +1,49 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef MESHCACHEBENCHMARK_H
+#define MESHCACHEBENCHMARK_H
+
+// C/C++ Includes
+#include <string>
+#include <vector>
+
+/** The MeshCacheBenchmark Class measures startup mesh loading without a
+    window. Each frame it loads every mesh twice with the null driver: a
+    cold parse of the .x file by Irrlicht (after removing it from Irrlicht's
+    mesh cache) and a load from the MeshCache's binary cache (written once
+    before the first frame). The cached mesh's triangles, joints and frame
+    count must match the parsed mesh's. As the optimizer welds and reorders
+    them, the triangles are compared by their vertices in any order, both
+    at rest and skinned halfway through the animation. The per frame times
+    are written with the Benchmark class, along with each mesh's ACMR and
+    ATVR before and after optimising **/
+class MeshCacheBenchmark
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        MeshCacheBenchmark();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Run the benchmark (returns false if a mesh could not be loaded or cached, the meshes differ or the results could not be written)
+        bool run(int frameCount, int warmupFrames, const std::string& outputFile);
+
+    public:
+        // Meshes to load (relative to the working directory)
+        std::vector<std::string> meshFiles;
+        // Optimise the meshes as they are cached
+        bool optimizing;
+};
+
+#endif // MESHCACHEBENCHMARK_H
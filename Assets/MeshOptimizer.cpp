@@ -0,0 +1,385 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+const irr::u32 MeshOptimizer::NO_VERTEX;
+
+// Score of a vertex for Forsyth's ordering (by its LRU cache position, -1 when not cached, and its triangles left)
+static irr::f32 scoreVertex(irr::s32 cachePosition, irr::u32 trianglesLeft, irr::u32 cacheSize)
+{
+    // A vertex with no triangles left is never picked
+    if (trianglesLeft == 0)
+        return -1.0f;
+    irr::f32 score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // The last triangle's vertices score a fixed amount so it is not simply repeated
+        if (cachePosition < 3)
+            score = 0.75f;
+        else
+            score = powf(1.0f - (irr::f32)(cachePosition - 3) / (irr::f32)(cacheSize - 3), 1.5f);
+    }
+    // Favour vertices with few triangles left so they are finished off and leave the cache
+    return score + 2.0f * powf((irr::f32)trianglesLeft, -0.5f);
+}
+
+// Push a triangle through a FIFO cache of timestamps (returns the vertices transformed)
+static irr::u32 cacheTriangle(const irr::u32* pTriangle, std::vector<irr::u32>& timestamps, irr::u32& time, irr::u32 cacheSize)
+{
+    irr::u32 misses = 0;
+    for (irr::u32 k = 0; k < 3; k++)
+    {
+        // A vertex is cached while fewer than cacheSize vertices have been transformed after it
+        if (time - timestamps[pTriangle[k]] > cacheSize)
+        {
+            timestamps[pTriangle[k]] = time++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+// Get the position at the start of a vertex
+static irr::core::vector3df getPosition(const std::vector<irr::u8>& vertices, irr::u32 vertexPitch, irr::u32 vertex)
+{
+    irr::f32 position[3];
+    memcpy(position, &vertices[vertex * vertexPitch], sizeof(position));
+    return irr::core::vector3df(position[0], position[1], position[2]);
+}
+
+MeshOptimizer::MeshOptimizer()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->cacheSize = 32;
+    this->fifoSize = 16;
+    this->overdrawThreshold = 1.05f;
+}
+
+void MeshOptimizer::optimize(std::vector<irr::u8>& vertices, irr::u32 vertexPitch, std::vector<irr::u32>& indices, const std::vector<irr::u32>* pVertexClasses, std::vector<irr::u32>& remap) const
+{
+    irr::u32 vertexCount = (irr::u32)(vertices.size() / vertexPitch);
+    std::vector<irr::u32> weldRemap;
+    MeshOptimizer::weld(vertices, vertexPitch, pVertexClasses, indices, weldRemap);
+    this->reorderForVertexCache(indices, vertexCount);
+    this->reorderForOverdraw(indices, vertices, vertexPitch);
+    std::vector<irr::u32> fetchRemap;
+    MeshOptimizer::reorderForVertexFetch(vertices, vertexPitch, indices, fetchRemap);
+    // Welded vertices go where their first copy went
+    remap.resize(vertexCount);
+    for (irr::u32 i = 0; i < vertexCount; i++)
+        remap[i] = fetchRemap[weldRemap[i]];
+}
+
+irr::u32 MeshOptimizer::weld(const std::vector<irr::u8>& vertices, irr::u32 vertexPitch, const std::vector<irr::u32>* pVertexClasses, std::vector<irr::u32>& indices, std::vector<irr::u32>& remap)
+{
+    irr::u32 vertexCount = (irr::u32)(vertices.size() / vertexPitch);
+    // Sort the vertices by a hash of their bytes and class (FNV-1a), so copies are neighbours
+    std::vector<std::pair<irr::u64, irr::u32> > keys(vertexCount);
+    for (irr::u32 i = 0; i < vertexCount; i++)
+    {
+        irr::u64 hash = 14695981039346656037ULL;
+        const irr::u8* pVertex = &vertices[i * vertexPitch];
+        for (irr::u32 j = 0; j < vertexPitch; j++)
+        {
+            hash ^= pVertex[j];
+            hash *= 1099511628211ULL;
+        }
+        if (pVertexClasses != 0)
+        {
+            hash ^= (*pVertexClasses)[i];
+            hash *= 1099511628211ULL;
+        }
+        keys[i] = std::make_pair(hash, i);
+    }
+    std::sort(keys.begin(), keys.end());
+    // Point each vertex at the first identical vertex sharing its hash
+    remap.resize(vertexCount);
+    for (irr::u32 i = 0; i < vertexCount; i++)
+        remap[i] = i;
+    irr::u32 uniqueCount = 0;
+    for (irr::u32 start = 0; start < vertexCount; )
+    {
+        irr::u32 end = start + 1;
+        while (end < vertexCount && keys[end].first == keys[start].first)
+            end++;
+        for (irr::u32 j = start; j < end; j++)
+        {
+            irr::u32 vertex = keys[j].second;
+            for (irr::u32 k = start; k < j; k++)
+            {
+                irr::u32 first = keys[k].second;
+                if (remap[first] == first && memcmp(&vertices[first * vertexPitch], &vertices[vertex * vertexPitch], vertexPitch) == 0 &&
+                    (pVertexClasses == 0 || (*pVertexClasses)[first] == (*pVertexClasses)[vertex]))
+                {
+                    remap[vertex] = first;
+                    break;
+                }
+            }
+            if (remap[vertex] == vertex)
+                uniqueCount++;
+        }
+        start = end;
+    }
+    for (size_t i = 0; i < indices.size(); i++)
+        indices[i] = remap[indices[i]];
+    return uniqueCount;
+}
+
+void MeshOptimizer::reorderForVertexCache(std::vector<irr::u32>& indices, irr::u32 vertexCount) const
+{
+    irr::u32 triangleCount = (irr::u32)(indices.size() / 3);
+    if (triangleCount == 0)
+        return;
+
+    // ADJACENCY
+    // (the triangles using vertex v are adjacency[offsets[v]] onwards, the live ones first)
+    std::vector<irr::u32> trianglesLeft(vertexCount, 0);
+    for (size_t i = 0; i < indices.size(); i++)
+        trianglesLeft[indices[i]]++;
+    std::vector<irr::u32> offsets(vertexCount + 1, 0);
+    for (irr::u32 v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + trianglesLeft[v];
+    std::vector<irr::u32> adjacency(indices.size());
+    std::vector<irr::u32> filled(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+        adjacency[filled[indices[i]]++] = (irr::u32)(i / 3);
+
+    // SCORES
+    std::vector<irr::s32> cachePositions(vertexCount, -1);
+    std::vector<irr::f32> vertexScores(vertexCount);
+    for (irr::u32 v = 0; v < vertexCount; v++)
+        vertexScores[v] = scoreVertex(-1, trianglesLeft[v], this->cacheSize);
+    std::vector<irr::f32> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    irr::u32 bestTriangle = 0;
+    for (irr::u32 t = 0; t < triangleCount; t++)
+    {
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+        if (triangleScores[t] > triangleScores[bestTriangle])
+            bestTriangle = t;
+    }
+
+    // EMIT THE TRIANGLES
+    std::vector<irr::u32> ordered;
+    ordered.reserve(indices.size());
+    std::vector<irr::u32> cache;
+    std::vector<irr::u32> nextCache;
+    irr::u32 deadEndCursor = 0;
+    for (irr::u32 n = 0; n < triangleCount; n++)
+    {
+        // When no cached vertex has triangles left carry on from the first triangle not emitted
+        if (bestTriangle == MeshOptimizer::NO_VERTEX)
+        {
+            while (emitted[deadEndCursor] == true)
+                deadEndCursor++;
+            bestTriangle = deadEndCursor;
+        }
+        const irr::u32* pTriangle = &indices[bestTriangle * 3];
+        ordered.insert(ordered.end(), pTriangle, pTriangle + 3);
+        emitted[bestTriangle] = true;
+        // Take the triangle off its vertices' live lists
+        for (irr::u32 k = 0; k < 3; k++)
+        {
+            irr::u32 v = pTriangle[k];
+            irr::u32* pLive = &adjacency[offsets[v]];
+            for (irr::u32 j = 0; j < trianglesLeft[v]; j++)
+            {
+                if (pLive[j] == bestTriangle)
+                {
+                    std::swap(pLive[j], pLive[trianglesLeft[v] - 1]);
+                    trianglesLeft[v]--;
+                    break;
+                }
+            }
+        }
+        // Move the triangle's vertices to the front of the cache
+        nextCache.clear();
+        for (irr::u32 k = 0; k < 3; k++)
+        {
+            if (std::find(nextCache.begin(), nextCache.end(), pTriangle[k]) == nextCache.end())
+                nextCache.push_back(pTriangle[k]);
+        }
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            if (cache[i] != pTriangle[0] && cache[i] != pTriangle[1] && cache[i] != pTriangle[2])
+                nextCache.push_back(cache[i]);
+        }
+        // Rescore the cached vertices (and those just pushed out) and their triangles left
+        for (size_t i = 0; i < nextCache.size(); i++)
+        {
+            irr::u32 v = nextCache[i];
+            cachePositions[v] = (i < this->cacheSize) ? (irr::s32)i : -1;
+            vertexScores[v] = scoreVertex(cachePositions[v], trianglesLeft[v], this->cacheSize);
+        }
+        bestTriangle = MeshOptimizer::NO_VERTEX;
+        irr::f32 bestScore = -1.0f;
+        for (size_t i = 0; i < nextCache.size(); i++)
+        {
+            irr::u32 v = nextCache[i];
+            for (irr::u32 j = 0; j < trianglesLeft[v]; j++)
+            {
+                irr::u32 t = adjacency[offsets[v] + j];
+                triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+                if (triangleScores[t] > bestScore)
+                {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+        if (nextCache.size() > this->cacheSize)
+            nextCache.resize(this->cacheSize);
+        cache.swap(nextCache);
+    }
+    indices.swap(ordered);
+}
+
+void MeshOptimizer::reorderForOverdraw(std::vector<irr::u32>& indices, const std::vector<irr::u8>& vertices, irr::u32 vertexPitch) const
+{
+    irr::u32 vertexCount = (irr::u32)(vertices.size() / vertexPitch);
+    irr::u32 triangleCount = (irr::u32)(indices.size() / 3);
+    if (triangleCount == 0)
+        return;
+    std::vector<irr::u32> timestamps(vertexCount, 0);
+    irr::u32 time = this->fifoSize + 1;
+
+    // HARD BOUNDARIES
+    // (a triangle sharing no vertex with the cache usually starts a new patch of the mesh)
+    std::vector<irr::u32> hardClusters;
+    for (irr::u32 t = 0; t < triangleCount; t++)
+    {
+        if (cacheTriangle(&indices[t * 3], timestamps, time, this->fifoSize) == 3 || t == 0)
+            hardClusters.push_back(t);
+    }
+
+    // SOFT BOUNDARIES
+    // (each patch is split wherever the triangles so far are within the threshold of the patch's miss ratio)
+    std::vector<irr::u32> clusters;
+    for (size_t c = 0; c < hardClusters.size(); c++)
+    {
+        irr::u32 start = hardClusters[c];
+        irr::u32 end = (c + 1 < hardClusters.size()) ? hardClusters[c + 1] : triangleCount;
+        time += this->fifoSize + 1;
+        irr::u32 clusterMisses = 0;
+        for (irr::u32 t = start; t < end; t++)
+            clusterMisses += cacheTriangle(&indices[t * 3], timestamps, time, this->fifoSize);
+        irr::f32 threshold = this->overdrawThreshold * (irr::f32)clusterMisses / (irr::f32)(end - start);
+        clusters.push_back(start);
+        time += this->fifoSize + 1;
+        irr::u32 runningMisses = 0;
+        irr::u32 runningTriangles = 0;
+        for (irr::u32 t = start; t < end; t++)
+        {
+            runningMisses += cacheTriangle(&indices[t * 3], timestamps, time, this->fifoSize);
+            runningTriangles++;
+            if ((irr::f32)runningMisses / (irr::f32)runningTriangles <= threshold)
+            {
+                clusters.push_back(t + 1);
+                time += this->fifoSize + 1;
+                runningMisses = 0;
+                runningTriangles = 0;
+            }
+        }
+        // The triangles after the last split are merged into the cluster before them
+        if (clusters.back() != start)
+            clusters.pop_back();
+    }
+
+    // SORT THE CLUSTERS
+    // (by how far each cluster's area weighted centre is in front of the mesh's centre along its normal)
+    irr::core::vector3df meshCentre(0.0f, 0.0f, 0.0f);
+    for (size_t i = 0; i < indices.size(); i++)
+        meshCentre += getPosition(vertices, vertexPitch, indices[i]);
+    meshCentre /= (irr::f32)indices.size();
+    std::vector<std::pair<irr::f32, irr::u32> > sortKeys(clusters.size());
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        irr::u32 start = clusters[c];
+        irr::u32 end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+        irr::core::vector3df centre(0.0f, 0.0f, 0.0f);
+        irr::core::vector3df normal(0.0f, 0.0f, 0.0f);
+        irr::f32 area = 0.0f;
+        for (irr::u32 t = start; t < end; t++)
+        {
+            irr::core::vector3df p0 = getPosition(vertices, vertexPitch, indices[t * 3]);
+            irr::core::vector3df p1 = getPosition(vertices, vertexPitch, indices[t * 3 + 1]);
+            irr::core::vector3df p2 = getPosition(vertices, vertexPitch, indices[t * 3 + 2]);
+            irr::core::vector3df triangleNormal = (p1 - p0).crossProduct(p2 - p0);
+            irr::f32 triangleArea = triangleNormal.getLength();
+            centre += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal += triangleNormal;
+            area += triangleArea;
+        }
+        if (area > 0.0f)
+            centre /= area;
+        normal.normalize();
+        // Negated so the outermost cluster sorts first (ties keep their cache order)
+        sortKeys[c] = std::make_pair(-(centre - meshCentre).dotProduct(normal), (irr::u32)c);
+    }
+    std::sort(sortKeys.begin(), sortKeys.end());
+    std::vector<irr::u32> ordered;
+    ordered.reserve(indices.size());
+    for (size_t i = 0; i < sortKeys.size(); i++)
+    {
+        irr::u32 c = sortKeys[i].second;
+        irr::u32 start = clusters[c];
+        irr::u32 end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+        ordered.insert(ordered.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+    }
+    indices.swap(ordered);
+}
+
+irr::u32 MeshOptimizer::reorderForVertexFetch(std::vector<irr::u8>& vertices, irr::u32 vertexPitch, std::vector<irr::u32>& indices, std::vector<irr::u32>& remap)
+{
+    irr::u32 vertexCount = (irr::u32)(vertices.size() / vertexPitch);
+    remap.assign(vertexCount, MeshOptimizer::NO_VERTEX);
+    irr::u32 nextVertex = 0;
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        if (remap[indices[i]] == MeshOptimizer::NO_VERTEX)
+            remap[indices[i]] = nextVertex++;
+        indices[i] = remap[indices[i]];
+    }
+    // Vertices no triangle uses are dropped
+    std::vector<irr::u8> ordered(nextVertex * vertexPitch);
+    for (irr::u32 v = 0; v < vertexCount; v++)
+    {
+        if (remap[v] != MeshOptimizer::NO_VERTEX)
+            memcpy(&ordered[remap[v] * vertexPitch], &vertices[v * vertexPitch], vertexPitch);
+    }
+    vertices.swap(ordered);
+    return nextVertex;
+}
+
+SMeshOptimizerStats MeshOptimizer::analyze(const std::vector<irr::u32>& indices, irr::u32 vertexCount, irr::u32 cacheSize)
+{
+    SMeshOptimizerStats stats;
+    stats.vertexCount = 0;
+    stats.triangleCount = (irr::u32)(indices.size() / 3);
+    stats.transformCount = 0;
+    std::vector<bool> referenced(vertexCount, false);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        if (referenced[indices[i]] == false)
+        {
+            referenced[indices[i]] = true;
+            stats.vertexCount++;
+        }
+    }
+    std::vector<irr::u32> timestamps(vertexCount, 0);
+    irr::u32 time = cacheSize + 1;
+    for (irr::u32 t = 0; t < stats.triangleCount; t++)
+        stats.transformCount += cacheTriangle(&indices[t * 3], timestamps, time, cacheSize);
+    return stats;
+}
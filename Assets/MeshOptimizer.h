@@ -0,0 +1,84 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+// C/C++ Includes
+#include <vector>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+//! Post-transform vertex cache statistics of a triangle list
+struct SMeshOptimizerStats
+{
+    // Vertices referenced by the triangles
+    irr::u32 vertexCount;
+    // Triangles
+    irr::u32 triangleCount;
+    // Vertices transformed (misses of a FIFO cache)
+    irr::u32 transformCount;
+
+    //! Average cache miss ratio (vertices transformed per triangle, 0.5 is the best a regular grid gets)
+    irr::f32 getACMR() const { return (this->triangleCount > 0) ? (irr::f32)this->transformCount / (irr::f32)this->triangleCount : 0.0f; }
+    //! Average transform to vertex ratio (vertices transformed per vertex, 1 is ideal)
+    irr::f32 getATVR() const { return (this->vertexCount > 0) ? (irr::f32)this->transformCount / (irr::f32)this->vertexCount : 0.0f; }
+};
+
+/** The MeshOptimizer Class reorders an indexed triangle list for the GPU.
+    Vertices whose bytes (and class, which keeps vertices with different
+    skinning weights apart) are identical are welded. The triangles are
+    then ordered for the post-transform vertex cache with Tom Forsyth's
+    linear-speed algorithm, which scores each vertex by its position in a
+    simulated LRU cache and by the triangles it has left. The cache ordered
+    sequence is then split into clusters whose cache efficiency stays close
+    to the whole sequence's, and the clusters are sorted so those facing
+    away from the mesh's centre are drawn first, to reduce overdraw.
+    Finally the vertices are renumbered in the order the triangles first
+    use them so vertex fetches walk forward through memory. Vertices are
+    raw bytes starting with their position (as every Irrlicht vertex type
+    does), so the optimizer does not depend on the vertex type **/
+class MeshOptimizer
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        MeshOptimizer();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Weld, then order for the vertex cache, then for overdraw, then for vertex fetch (remap gets each old vertex's new index, NO_VERTEX when it was dropped)
+        void optimize(std::vector<irr::u8>& vertices, irr::u32 vertexPitch, std::vector<irr::u32>& indices, const std::vector<irr::u32>* pVertexClasses, std::vector<irr::u32>& remap) const;
+        //! Point the indices at the first of each set of identical vertices (remap gets each vertex's first copy, returns the number of unique vertices)
+        static irr::u32 weld(const std::vector<irr::u8>& vertices, irr::u32 vertexPitch, const std::vector<irr::u32>* pVertexClasses, std::vector<irr::u32>& indices, std::vector<irr::u32>& remap);
+        //! Order the triangles for an LRU vertex cache (Forsyth)
+        void reorderForVertexCache(std::vector<irr::u32>& indices, irr::u32 vertexCount) const;
+        //! Sort clusters of the cache ordered triangles so outward facing ones are drawn first
+        void reorderForOverdraw(std::vector<irr::u32>& indices, const std::vector<irr::u8>& vertices, irr::u32 vertexPitch) const;
+        //! Renumber and pack the vertices in the order the triangles first use them (remap gets each old vertex's new index, returns the number kept)
+        static irr::u32 reorderForVertexFetch(std::vector<irr::u8>& vertices, irr::u32 vertexPitch, std::vector<irr::u32>& indices, std::vector<irr::u32>& remap);
+        //! Measure a triangle list with a FIFO post-transform cache
+        static SMeshOptimizerStats analyze(const std::vector<irr::u32>& indices, irr::u32 vertexCount, irr::u32 cacheSize);
+
+    public:
+        // Remapped index of a vertex which is no longer used
+        static const irr::u32 NO_VERTEX = 0xffffffff;
+        // Size of the LRU cache triangles are ordered for
+        irr::u32 cacheSize;
+        // Size of the FIFO cache clusters are measured with (and the statistics are reported for)
+        irr::u32 fifoSize;
+        // Most a cluster's cache miss ratio may exceed its part of the sequence's (1.05 allows 5%)
+        irr::f32 overdrawThreshold;
+};
+
+#endif // MESHOPTIMIZER_H
@@ -0,0 +1,109 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "StagedLoader.h"
+
+#include "Logger.h"
+
+StagedLoader::StagedLoader()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->nextStage = 0;
+    this->updateCount = 0;
+    this->startTime = std::chrono::steady_clock::now();
+    this->finishTime = this->startTime;
+}
+
+StagedLoader::~StagedLoader()
+{
+    // **************
+    // * DESTRUCTOR *
+    // **************
+
+}
+
+void StagedLoader::add(const std::string& name, std::function<bool()> function)
+{
+    SLoadStage stage;
+    stage.name = name;
+    stage.function = function;
+    stage.time = 0.0;
+    this->stages.push_back(stage);
+}
+
+void StagedLoader::start()
+{
+    // *********
+    // * START *
+    // *********
+
+    this->nextStage = 0;
+    this->updateCount = 0;
+    this->startTime = std::chrono::steady_clock::now();
+    this->finishTime = this->startTime;
+}
+
+bool StagedLoader::runStage()
+{
+    SLoadStage& stage = this->stages[this->nextStage];
+    std::chrono::steady_clock::time_point stageStart = std::chrono::steady_clock::now();
+    bool success = stage.function();
+    this->finishTime = std::chrono::steady_clock::now();
+    stage.time = std::chrono::duration<double, std::milli>(this->finishTime - stageStart).count();
+    if (success == false)
+    {
+        LogMessage(ELS_ERROR) << "StagedLoader::runStage() " << stage.name << " failed";
+        return false;
+    }
+    LogMessage(ELS_DEBUG) << "StagedLoader::runStage() " << stage.name << " took " << stage.time << "ms";
+    this->nextStage++;
+    if (this->isFinished() == true)
+        LogMessage(ELS_INFO) << "StagedLoader::runStage() " << this->stages.size() << " stages loaded over " << this->updateCount << " frames, " << this->getElapsedTime() << "ms after starting";
+    return true;
+}
+
+bool StagedLoader::update(double budget)
+{
+    if (this->isFinished() == true)
+        return true;
+    this->updateCount++;
+    std::chrono::steady_clock::time_point updateStart = std::chrono::steady_clock::now();
+    // At least one stage runs so loading always moves on
+    do
+    {
+        if (this->runStage() == false)
+            return false;
+    }
+    while (this->isFinished() == false && std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - updateStart).count() < budget);
+    return true;
+}
+
+bool StagedLoader::finish()
+{
+    if (this->isFinished() == false)
+        this->updateCount++;
+    while (this->isFinished() == false)
+    {
+        if (this->runStage() == false)
+            return false;
+    }
+    return true;
+}
+
+void StagedLoader::clear()
+{
+    this->stages.clear();
+    this->nextStage = 0;
+}
+
+double StagedLoader::getElapsedTime() const
+{
+    std::chrono::steady_clock::time_point endTime = (this->isFinished() == true) ? this->finishTime : std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(endTime - this->startTime).count();
+}
@@ -0,0 +1,91 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef STAGEDLOADER_H
+#define STAGEDLOADER_H
+
+// C/C++ Includes
+#include <string>
+#include <vector>
+#include <functional>
+#include <chrono>
+
+// Irrlicht Includes
+
+// Game Includes
+
+//! A stage of loading
+struct SLoadStage
+{
+    // Name reported in the log and the loading text
+    std::string name;
+    // Does the work (returns false if loading cannot carry on)
+    std::function<bool()> function;
+    // Milliseconds the stage took
+    double time;
+};
+
+/** The StagedLoader Class runs the loading left after the first frame a few
+    stages at a time. Each call to update runs stages in order until the
+    frame's time budget is spent. A stage is never split, so a frame runs
+    at least one stage and overruns its budget by at most the stage that
+    crossed it. The time from start to the last stage finishing is the time
+    to fully loaded **/
+class StagedLoader
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        StagedLoader();
+        //! Destructor
+        virtual ~StagedLoader();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Add a stage (run after the stages already added)
+        void add(const std::string& name, std::function<bool()> function);
+        //! Start timing (the stages run from the next update)
+        void start();
+        //! Run stages until the budget (in milliseconds) is spent (returns false if a stage failed)
+        bool update(double budget);
+        //! Run every stage left (returns false if a stage failed)
+        bool finish();
+        //! Forget the stages left
+        void clear();
+        //! Have all of the stages run
+        bool isFinished() const { return (this->nextStage >= this->stages.size()); }
+        //! Get the number of stages
+        size_t getStageCount() const { return this->stages.size(); }
+        //! Get the number of stages run
+        size_t getCompletedCount() const { return this->nextStage; }
+        //! Get the name of the next stage (empty when finished)
+        std::string getNextStageName() const { return (this->isFinished() == true) ? std::string() : this->stages[this->nextStage].name; }
+        //! Get the milliseconds from start to the last stage finishing (or to now while loading)
+        double getElapsedTime() const;
+
+    protected:
+        //! Run the next stage (returns false if it failed)
+        bool runStage();
+
+    protected:
+        // The stages in the order they run
+        std::vector<SLoadStage> stages;
+        // Index of the next stage to run
+        size_t nextStage;
+        // When start was called and when the last stage finished
+        std::chrono::steady_clock::time_point startTime;
+        std::chrono::steady_clock::time_point finishTime;
+        // Number of updates that ran stages
+        unsigned int updateCount;
+};
+
+#endif // STAGEDLOADER_H
@@ -0,0 +1,181 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "Benchmark.h"
+
+// C/C++ Includes
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+
+// Game Includes
+#include "Logger.h"
+
+Benchmark::Benchmark()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    // Benchmark is disabled until start is called
+    this->frameCount = 0;
+    this->warmupFrames = 0;
+    this->skippedFrames = 0;
+}
+
+Benchmark::~Benchmark()
+{
+    // **************
+    // * DESTRUCTOR *
+    // **************
+}
+
+void Benchmark::start(int frameCount, int warmupFrames)
+{
+    // *********
+    // * START *
+    // *********
+
+    this->frameCount = frameCount;
+    this->warmupFrames = warmupFrames;
+    this->skippedFrames = 0;
+    // Reserve storage up front so recording a frame never allocates
+    this->frameTimes.clear();
+    this->frameTimes.reserve(frameCount);
+    for (unsigned int i = 0; i < this->phaseTimes.size(); i++)
+    {
+        this->phaseTimes[i].clear();
+        this->phaseTimes[i].reserve(frameCount);
+    }
+}
+
+void Benchmark::setPhaseNames(const std::vector<std::string>& phaseNames)
+{
+    this->phaseNames = phaseNames;
+    this->phaseTimes.clear();
+    this->phaseTimes.resize(phaseNames.size());
+    for (unsigned int i = 0; i < this->phaseTimes.size(); i++)
+        this->phaseTimes[i].reserve(this->frameCount);
+}
+
+void Benchmark::addFrame(double frameTime, const double* phaseTimes)
+{
+    // Ignore frames when disabled or finished
+    if (this->isEnabled() == false || this->isFinished() == true)
+        return;
+    // Skip the warmup frames (shader compiles, texture uploads etc)
+    if (this->skippedFrames < this->warmupFrames)
+    {
+        this->skippedFrames++;
+        return;
+    }
+    // Record the frame
+    this->frameTimes.push_back(frameTime);
+    for (unsigned int i = 0; i < this->phaseTimes.size(); i++)
+        this->phaseTimes[i].push_back(phaseTimes[i]);
+}
+
+void Benchmark::setProperty(const std::string& name, const std::string& value)
+{
+    // Escape the string so that it is valid JSON
+    std::string escaped = "\"";
+    for (unsigned int i = 0; i < value.size(); i++)
+    {
+        if (value[i] == '"' || value[i] == '\\')
+            escaped += '\\';
+        escaped += value[i];
+    }
+    escaped += "\"";
+    this->properties.push_back(std::make_pair(name, escaped));
+}
+
+void Benchmark::setProperty(const std::string& name, double value)
+{
+    std::ostringstream stream;
+    stream << value;
+    this->properties.push_back(std::make_pair(name, stream.str()));
+}
+
+void Benchmark::setBooleanProperty(const std::string& name, bool value)
+{
+    this->properties.push_back(std::make_pair(name, std::string(value ? "true" : "false")));
+}
+
+bool Benchmark::writeJSON(const std::string& fileName)
+{
+    // ******************
+    // * WRITE THE JSON *
+    // ******************
+
+    std::ofstream file(fileName.c_str());
+    if (file.is_open() == false)
+    {
+        LogMessage(ELS_ERROR) << "Unable to write benchmark results to " << fileName;
+        return false;
+    }
+    file << std::fixed << std::setprecision(4);
+    file << "{" << std::endl;
+    // Properties of the run
+    for (unsigned int i = 0; i < this->properties.size(); i++)
+        file << "    \"" << this->properties[i].first << "\": " << this->properties[i].second << "," << std::endl;
+    file << "    \"frames\": " << this->frameTimes.size() << "," << std::endl;
+    file << "    \"warmupFrames\": " << this->skippedFrames << "," << std::endl;
+    // Whole frame statistics
+    file << "    \"frameTime\": ";
+    this->writeStatistics(file, this->frameTimes);
+    file << "," << std::endl;
+    // Per phase statistics
+    file << "    \"phases\": {" << std::endl;
+    for (unsigned int i = 0; i < this->phaseNames.size(); i++)
+    {
+        file << "        \"" << this->phaseNames[i] << "\": ";
+        this->writeStatistics(file, this->phaseTimes[i]);
+        file << ((i + 1 < this->phaseNames.size()) ? "," : "") << std::endl;
+    }
+    file << "    }" << std::endl;
+    file << "}" << std::endl;
+
+    LogMessage(ELS_INFO) << "Benchmark results written to " << fileName;
+
+    // Success
+    return true;
+}
+
+void Benchmark::writeStatistics(std::ostream& stream, std::vector<double> samples)
+{
+    // Calculate statistics (all times are in milliseconds)
+    double minimum = 0.0;
+    double maximum = 0.0;
+    double mean = 0.0;
+    if (samples.empty() == false)
+    {
+        std::sort(samples.begin(), samples.end());
+        minimum = samples.front();
+        maximum = samples.back();
+        for (unsigned int i = 0; i < samples.size(); i++)
+            mean += samples[i];
+        mean = mean / (double)samples.size();
+    }
+    stream << "{ \"min\": " << minimum
+           << ", \"mean\": " << mean
+           << ", \"p50\": " << Benchmark::getPercentile(samples, 50.0)
+           << ", \"p95\": " << Benchmark::getPercentile(samples, 95.0)
+           << ", \"p99\": " << Benchmark::getPercentile(samples, 99.0)
+           << ", \"max\": " << maximum << " }";
+}
+
+double Benchmark::getPercentile(const std::vector<double>& sortedSamples, double percentile)
+{
+    if (sortedSamples.empty() == true)
+        return 0.0;
+    // Nearest rank method
+    int rank = (int)std::ceil(percentile / 100.0 * (double)sortedSamples.size());
+    if (rank < 1)
+        rank = 1;
+    if (rank > (int)sortedSamples.size())
+        rank = (int)sortedSamples.size();
+    return sortedSamples[rank - 1];
+}
@@ -0,0 +1,82 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// C/C++ Includes
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+/** The Benchmark Class records the time taken by each frame (and each
+    phase of each frame) of the games main loop so that frame cost can be
+    compared between builds. When the requested number of frames has been
+    recorded the statistics are written out as a JSON document **/
+class Benchmark
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        Benchmark();
+        //! Destructor
+        virtual ~Benchmark();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Start a benchmark run (warmupFrames are run but not recorded)
+        virtual void start(int frameCount, int warmupFrames);
+        //! Set the names of the phases recorded each frame
+        virtual void setPhaseNames(const std::vector<std::string>& phaseNames);
+        //! Add a frame (phaseTimes holds one time in milliseconds for each phase name)
+        virtual void addFrame(double frameTime, const double* phaseTimes);
+        //! Has the benchmark recorded all of its frames
+        virtual bool isFinished() { return (this->frameCount > 0 && (int)this->frameTimes.size() >= this->frameCount); }
+        //! Is the benchmark enabled
+        virtual bool isEnabled() { return (this->frameCount > 0); }
+        //! Write the statistics to a JSON file
+        virtual bool writeJSON(const std::string& fileName);
+
+    public:
+        //! Set a descriptive property of the run (driver, resolution etc) which is written to the JSON file
+        virtual void setProperty(const std::string& name, const std::string& value);
+        //! Set a numeric property of the run which is written to the JSON file
+        virtual void setProperty(const std::string& name, double value);
+        //! Set a true/false property of the run which is written to the JSON file
+        virtual void setBooleanProperty(const std::string& name, bool value);
+
+    protected:
+        //! Write the statistics of a list of samples as a JSON object
+        virtual void writeStatistics(std::ostream& stream, std::vector<double> samples);
+        //! Get the nearest rank percentile from a sorted list of samples
+        static double getPercentile(const std::vector<double>& sortedSamples, double percentile);
+
+    protected:
+        // Number of frames to record
+        int frameCount;
+        // Number of frames to skip before recording
+        int warmupFrames;
+        // Number of frames skipped so far
+        int skippedFrames;
+        // Recorded frame times in milliseconds
+        std::vector<double> frameTimes;
+        // Names of the phases
+        std::vector<std::string> phaseNames;
+        // Recorded phase times in milliseconds (one list per phase)
+        std::vector<std::vector<double> > phaseTimes;
+        // Properties written to the JSON file (name, pre-formatted JSON value)
+        std::vector<std::pair<std::string, std::string> > properties;
+};
+
+#endif // BENCHMARK_H
@@ -67,6 +67,57 @@ Game::Game()
     // Pointer to the Default SceneNodeFacotry
     this->pDefaultSceneNodeFactory = 0;
 
+    // COMMAND LINE ARGUMENTS
+    // Driver
+    this->driverType = irr::video::EDT_OPENGL;
+    // Benchmark
+    this->benchmarkFrames = 0;
+    this->benchmarkWarmupFrames = 0;
+    this->benchmarkOutputFile = "benchmark.json";
+    // Trace
+    this->traceOutputFile = "";
+    this->traceCapacity = 262144;
+    this->lightsPerNode = 8;
+    this->lightBenchmarkCount = 0;
+    this->clusteredLightingEnabled = false;
+    this->clusterBenchmarkCount = 0;
+    this->renderQueueSorting = true;
+    this->instanceCount = 100;
+    this->gpuSkinningEnabled = true;
+    this->batchedSkinningEnabled = true;
+    this->jobWorkerCount = -1;
+    this->skinningBenchmark = false;
+    this->pipelined = false;
+    this->tickRate = 60;
+    this->maxTicksPerFrame = 5;
+    this->logSeverity = ELS_INFO;
+    this->logRateLimit = 1000;
+    this->captureFrameCount = 300;
+    this->captureFormat = ECFMT_PNG;
+    this->meshCacheEnabled = true;
+    this->meshOptimizeEnabled = true;
+    this->meshCacheBenchmark = false;
+    this->shaderConstantBenchmark = false;
+    this->assetPackFile = "media.pak";
+    this->packAssets = false;
+    this->packCompression = false;
+    this->prefetchEnabled = true;
+    this->loadBudget = 8.0;
+    // Startup
+    this->timeToFirstFrame = -1.0;
+    this->timeToFullyLoaded = -1.0;
+    // Shader callback
+    this->pShaderMaterial = 0;
+    // Light manager
+    this->pCurrentNode = 0;
+    this->pRenderQueue = 0;
+    this->pInstancedNode = 0;
+    // Pipeline
+    this->simulationState = 0;
+    this->pSimulationJob = 0;
+    this->lastTickTime = 0;
+    this->tickAccumulator = 0.0;
+
     // DEMO
     // Window
     this->xResolution = 1920;
@@ -112,6 +163,58 @@ int Game::run(int argc, char* argv[])
 
     // Process Command Lines Arguments
     this->processCommandLineArguments(argc, argv);
+    // Write log messages on a background thread from here on
+    Logger::getInstance()->setSeverity(this->logSeverity);
+    Logger::getInstance()->setRateLimit(this->logRateLimit);
+    Logger::getInstance()->start();
+    // Packing the assets runs without a window
+    if (this->packAssets == true)
+    {
+        AssetPacker assetPacker;
+        assetPacker.compression = this->packCompression;
+        bool success = assetPacker.pack("media", (this->assetPackFile.empty() == false) ? this->assetPackFile : std::string("media.pak"));
+        return (success == true) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    // The light culling benchmark runs without a device
+    if (this->lightBenchmarkCount > 0)
+    {
+        LightBenchmark lightBenchmark;
+        bool success = lightBenchmark.run(this->lightBenchmarkCount, (this->benchmarkFrames > 0) ? this->benchmarkFrames : 300, this->benchmarkWarmupFrames, this->benchmarkOutputFile);
+        return (success == true) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    // So does the light cluster benchmark (which fails if binning disagrees with brute force)
+    if (this->clusterBenchmarkCount > 0)
+    {
+        LightBenchmark lightBenchmark;
+        bool success = lightBenchmark.runClusters(this->clusterBenchmarkCount, (this->benchmarkFrames > 0) ? this->benchmarkFrames : 300, this->benchmarkWarmupFrames, this->benchmarkOutputFile);
+        return (success == true) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    // The mesh cache benchmark only needs the null driver (and fails if a cached mesh differs from the parsed one)
+    if (this->meshCacheBenchmark == true)
+    {
+        MeshCacheBenchmark meshCacheBenchmark;
+        meshCacheBenchmark.optimizing = this->meshOptimizeEnabled;
+        bool success = meshCacheBenchmark.run((this->benchmarkFrames > 0) ? this->benchmarkFrames : 20, this->benchmarkWarmupFrames, this->benchmarkOutputFile);
+        return (success == true) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    // So does the shader constant benchmark (which fails if the upload plan disagrees with the test program)
+    if (this->shaderConstantBenchmark == true)
+    {
+        ShaderConstantBenchmark shaderConstantBenchmark;
+        bool success = shaderConstantBenchmark.run((this->benchmarkFrames > 0) ? this->benchmarkFrames : 300, this->benchmarkWarmupFrames, this->benchmarkOutputFile);
+        return (success == true) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    // The job system's worker threads (the main thread runs jobs too)
+    if (this->jobWorkerCount < 0)
+        this->jobWorkerCount = (int)JobSystem::getDefaultWorkerCount();
+    // The skinning benchmark only needs the null driver (and fails if the batched pass disagrees with Irrlicht)
+    if (this->skinningBenchmark == true)
+    {
+        SkinningBenchmark skinningBenchmark;
+        skinningBenchmark.workerCount = this->jobWorkerCount;
+        bool success = skinningBenchmark.run((this->benchmarkFrames > 0) ? this->benchmarkFrames : 300, this->benchmarkWarmupFrames, this->benchmarkOutputFile);
+        return (success == true) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
     // Init the Game
     if (this->init() == true)
     {
@@ -120,20 +223,87 @@ int Game::run(int argc, char* argv[])
                 // While the is Running flag is true keep running
         while (this->pIrrlichtDevice->run())
         {
+            // Spend the load budget on the load stages left (a failed stage shuts down)
+            if (this->stagedLoader.isFinished() == false)
+            {
+                ProfilerScope profilerScope(&this->profiler, EPS_LOAD);
+                if (this->stagedLoader.update(this->loadBudget) == false)
+                    this->pIrrlichtDevice->closeDevice();
+            }
             // Handle events such as keypresses, mouse movements and gamepad input
-            this->handleEvents();
-            // Process logic
-            this->think();
-            // Update
-            this->update();
+            {
+                ProfilerScope profilerScope(&this->profiler, EPS_HANDLE_EVENTS);
+                this->handleEvents();
+            }
+            if (this->pipelined == true)
+            {
+                // Take the state simulated while the last frame was drawn and start simulating the next one
+                this->handOff();
+                this->beginSimulation();
+                this->pSimulationJob = this->jobSystem.createJob([this]() { this->simulate(); });
+                this->jobSystem.run(this->pSimulationJob);
+            }
+            else
+            {
+                this->beginSimulation();
+                for (irr::u32 i = 0; i < this->getSimulationState().tickCount; i++)
+                {
+                    // Process logic
+                    {
+                        ProfilerScope profilerScope(&this->profiler, EPS_THINK);
+                        this->think();
+                    }
+                    // Update
+                    {
+                        ProfilerScope profilerScope(&this->profiler, EPS_UPDATE);
+                        this->update();
+                    }
+                }
+                // Draw what was just simulated
+                this->handOff();
+            }
             // Draw all graphics
-            this->draw();
+            {
+                ProfilerScope profilerScope(&this->profiler, EPS_DRAW);
+                this->draw();
+            }
+            // The latency of the frame is from the start of simulating what was drawn to the end of drawing it
+            this->profiler.addSectionTime(EPS_LATENCY, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->getRenderState().simulationStart).count());
+            // End the frame (the frame time includes the device's message pump)
+            this->profiler.endFrame();
+            // Report the startup times and start the benchmark once fully loaded
+            if (this->timeToFirstFrame < 0.0)
+            {
+                this->timeToFirstFrame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->initStartTime).count();
+                LogMessage(ELS_INFO) << "Game::run() time to first frame " << this->timeToFirstFrame << "ms";
+            }
+            if (this->timeToFullyLoaded < 0.0 && this->stagedLoader.isFinished() == true)
+            {
+                this->timeToFullyLoaded = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->initStartTime).count();
+                LogMessage(ELS_INFO) << "Game::run() time to fully loaded " << this->timeToFullyLoaded << "ms";
+                this->startBenchmark();
+            }
+
+            // Record the frame (phases follow the whole frame in the profiler's sections)
+            const double* pFrameTimes = this->profiler.getLastFrame();
+            this->benchmark.addFrame(pFrameTimes[EPS_FRAME], &pFrameTimes[EPS_FRAME + 1]);
+            // When the benchmark has all of its frames shut down
+            if (this->benchmark.isFinished() == true)
+                this->pIrrlichtDevice->closeDevice();
+        }
+        // Let the simulation running ahead finish before anything it reads is shut down
+        if (this->pSimulationJob != 0)
+        {
+            this->jobSystem.wait(this->pSimulationJob);
+            this->pSimulationJob = 0;
         }
         // Stop the engine
         this->stop();
     }
     // Quit the Game
     this->quit();
+    // Write the last log messages
+    Logger::getInstance()->shutdown();
 
     // Exit Success
     return EXIT_SUCCESS;
@@ -147,9 +317,149 @@ void Game::processCommandLineArguments(int argc, char* argv[])
 
     // Send parameters ot the console
     for(int i = 0; i < argc; i++)
-        std::cout << argv[i] << std::endl;
+        LogMessage(ELS_INFO) << argv[i];
 
-    // TODO: Parse command line parameters here
+    // Parse parameters of the form --name=value (argv[0] is the executable)
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        std::string name = argument;
+        std::string value = "";
+        // Split the argument into a name and a value
+        std::string::size_type equals = argument.find('=');
+        if (equals != std::string::npos)
+        {
+            name = argument.substr(0, equals);
+            value = argument.substr(equals + 1);
+        }
+        // Driver
+        if (name == "--driver")
+        {
+            if (value == "null")
+                this->driverType = irr::video::EDT_NULL;
+            else if (value == "software")
+                this->driverType = irr::video::EDT_SOFTWARE;
+            else if (value == "burnings")
+                this->driverType = irr::video::EDT_BURNINGSVIDEO;
+            else if (value == "opengl")
+                this->driverType = irr::video::EDT_OPENGL;
+            else
+                LogMessage(ELS_WARNING) << "Unknown driver " << value << " (expected null, software, burnings or opengl)";
+        }
+        // Benchmark frame count
+        else if (name == "--frames")
+            this->benchmarkFrames = atoi(value.c_str());
+        // Benchmark warmup frame count
+        else if (name == "--warmup")
+            this->benchmarkWarmupFrames = atoi(value.c_str());
+        // Benchmark output file
+        else if (name == "--output")
+            this->benchmarkOutputFile = value;
+        // Trace output file
+        else if (name == "--trace")
+            this->traceOutputFile = value;
+        // Trace buffer size
+        else if (name == "--trace-events")
+            this->traceCapacity = (unsigned int)atoi(value.c_str());
+        // Lights per node
+        else if (name == "--lights-per-node")
+            this->lightsPerNode = (unsigned int)atoi(value.c_str());
+        // Light culling benchmark
+        else if (name == "--light-benchmark")
+            this->lightBenchmarkCount = atoi(value.c_str());
+        // Clustered lighting
+        else if (name == "--clustered")
+            this->clusteredLightingEnabled = true;
+        // Light cluster benchmark
+        else if (name == "--cluster-benchmark")
+            this->clusterBenchmarkCount = atoi(value.c_str());
+        // Render queue in scene graph order
+        else if (name == "--unsorted")
+            this->renderQueueSorting = false;
+        // Instance count
+        else if (name == "--instances")
+            this->instanceCount = atoi(value.c_str());
+        // CPU skinning
+        else if (name == "--cpu-skinning")
+            this->gpuSkinningEnabled = false;
+        // Irrlicht's own CPU skinning
+        else if (name == "--irrlicht-skinning")
+            this->batchedSkinningEnabled = false;
+        // Job system worker threads
+        else if (name == "--job-threads")
+            this->jobWorkerCount = atoi(value.c_str());
+        // CPU skinning benchmark
+        else if (name == "--skinning-benchmark")
+            this->skinningBenchmark = true;
+        // Pipelined simulation
+        else if (name == "--pipelined")
+            this->pipelined = true;
+        // Time steps per second
+        else if (name == "--tick-rate")
+            this->tickRate = std::max(atoi(value.c_str()), 1);
+        // Most time steps per frame
+        else if (name == "--max-ticks")
+            this->maxTicksPerFrame = std::max(atoi(value.c_str()), 1);
+        // Log severity
+        else if (name == "--log-level")
+        {
+            if (Logger::parseSeverity(value, this->logSeverity) == false)
+                LogMessage(ELS_WARNING) << "Unknown log level " << value << " (expected debug, info, warning, error or none)";
+        }
+        // Log rate limit
+        else if (name == "--log-rate")
+            this->logRateLimit = (unsigned int)std::max(atoi(value.c_str()), 0);
+        // Frames in a capture sequence
+        else if (name == "--capture-frames")
+            this->captureFrameCount = (unsigned int)std::max(atoi(value.c_str()), 1);
+        // Capture file format
+        else if (name == "--capture-format")
+        {
+            if (FrameCapture::parseFormat(value, this->captureFormat) == false)
+                LogMessage(ELS_WARNING) << "Unknown capture format " << value << " (expected png or tga)";
+        }
+        // Always parse meshes
+        else if (name == "--no-mesh-cache")
+            this->meshCacheEnabled = false;
+        // Cache meshes as they were parsed
+        else if (name == "--no-mesh-optimize")
+            this->meshOptimizeEnabled = false;
+        // Mesh cache benchmark
+        else if (name == "--mesh-cache-benchmark")
+            this->meshCacheBenchmark = true;
+        // Shader constant benchmark
+        else if (name == "--shader-constant-benchmark")
+            this->shaderConstantBenchmark = true;
+        // Asset pack
+        else if (name == "--asset-pack")
+            this->assetPackFile = value;
+        // Read the loose files
+        else if (name == "--no-asset-pack")
+            this->assetPackFile.clear();
+        // Write the asset pack
+        else if (name == "--pack-assets")
+            this->packAssets = true;
+        // Compress the asset pack
+        else if (name == "--pack-lz4")
+            this->packCompression = true;
+        // Load the assets one after another
+        else if (name == "--no-prefetch")
+            this->prefetchEnabled = false;
+        // Loading time per frame
+        else if (name == "--load-budget")
+            this->loadBudget = std::max(atof(value.c_str()), 0.0);
+        // Window width
+        else if (name == "--width")
+            this->xResolution = atoi(value.c_str());
+        // Window height
+        else if (name == "--height")
+            this->yResolution = atoi(value.c_str());
+        // Windowed mode
+        else if (name == "--windowed")
+            this->fullScreen = false;
+        else
+            LogMessage(ELS_WARNING) << "Unknown command line argument " << argument;
+    }
 }
 
 bool Game::init()
@@ -158,9 +468,20 @@ bool Game::init()
     // * INIT *
     // ********
 
+    // Time to first frame and to fully loaded count from here
+    this->initStartTime = std::chrono::steady_clock::now();
+    // Init Job System (first so the other systems can fan work out on it)
+    if (this->jobSystem.init((unsigned int)this->jobWorkerCount) == false)
+        return false;
     // Init irrlicht Device
     if (this->initIrrlichtDevice() == false)
         return false;
+    // Set up the mesh cache before the prefetch decodes from it
+    this->meshCache.setEnabled(this->meshCacheEnabled);
+    this->meshCache.setOptimizing(this->meshOptimizeEnabled);
+    // Init Prefetch (decoding the assets below on the job system while init carries on)
+    if (this->initPrefetch() == false)
+        return false;
     // Init Window
     if (this->initWindow() == false)
         return false;
@@ -179,14 +500,17 @@ bool Game::init()
     // Init Lights
     if (this->initLights() == false)
         return false;
-    // Init Demo System
+    // Init Demo System (the nodes are added by the load stages)
     if (this->initDemo() == false)
         return false;
-    // Init GUI
-    if (this->initGUI() == false)
+    // Init Scene State (once the lights and camera exist)
+    if (this->initSceneState() == false)
+        return false;
+    // Init Frame Capture
+    if (this->initFrameCapture() == false)
         return false;
-    // Init Sky
-    if (this->initSky() == false)
+    // Init Load Stages (the shaders, meshes, GUI and sky load while the first frames are drawn)
+    if (this->initLoadStages() == false)
         return false;
 
     // Success
@@ -200,10 +524,10 @@ bool Game::initIrrlichtDevice()
     // ************************
 
     // Send a message to the console
-    std::cout << "Game::initIrrlichtDevice()" << std::endl;
+    LogMessage(ELS_INFO) << "Game::initIrrlichtDevice()";
 
     // create Irrlicht Device
-    this->pIrrlichtDevice = irr::createDevice(irr::video::EDT_OPENGL, irr::core::dimension2d<irr::u32>(this->xResolution, this->yResolution), 32, this->fullScreen, false, false, 0);
+    this->pIrrlichtDevice = irr::createDevice(this->driverType, irr::core::dimension2d<irr::u32>(this->xResolution, this->yResolution), 32, this->fullScreen, false, false, 0);
     // If null return false
     if (this->pIrrlichtDevice == NULL)
         return false;
@@ -220,6 +544,9 @@ bool Game::initIrrlichtDevice()
     this->pGUIEnvironment = this->pIrrlichtDevice->getGUIEnvironment();
     // Set the handle to the FileSystem
     this->pFileSystem = this->pIrrlichtDevice->getFileSystem();
+    // Read media/ from the asset pack when there is one (searched before the loose files, and the mesh cache checks its sources against it)
+    if (this->assetPackFile.empty() == false)
+        this->meshCache.setAssetPack(AssetPackArchive::mount(this->pFileSystem, this->assetPackFile));
     // Set the handle to the CursorControl
     this->pCursorControl = this->pIrrlichtDevice->getCursorControl();
     // Set the handle to the EventReceiver
@@ -241,11 +568,11 @@ bool Game::initIrrlichtDevice()
     // Set the handle to the Default Scene Node Factory
     this->pDefaultSceneNodeFactory = this->pIrrlichtDevice->getSceneManager()->getDefaultSceneNodeFactory();
 
-    // Set the Log level
-    this->pIrrlichtDevice->getLogger()->setLogLevel(irr::ELL_DEBUG);
+    // Set the Log level (Irrlicht's messages below it are not even sent)
+    this->pIrrlichtDevice->getLogger()->setLogLevel(Game::getIrrlichtLogLevel(this->logSeverity));
 
     // Send a message to the console
-    std::cout << "Game::initIrrlichtDevice() success" << std::endl;
+    LogMessage(ELS_INFO) << "Game::initIrrlichtDevice() success";
 
     // Success
     return true;
@@ -258,13 +585,13 @@ bool Game::initWindow()
     // ****************
 
     // Send a message to the console
-    std::cout << "Game::initWindow()" << std::endl;
+    LogMessage(ELS_INFO) << "Game::initWindow()";
 
     // Set Window Caption
     this->pIrrlichtDevice->setWindowCaption(L"IrrlichtShaders");
 
     // Send a message to the console
-    std::cout << "Game::initWindow() successs" << std::endl;
+    LogMessage(ELS_INFO) << "Game::initWindow() successs";
 
     // Success
     return true;
@@ -277,13 +604,13 @@ bool Game::initInputSystem()
     // *********************
 
     // Send a message to the console
-    std::cout << "Game::initInputSystem()" << std::endl;
+    LogMessage(ELS_INFO) << "Game::initInputSystem()";
 
     // Set the Event handle
     this->pIrrlichtDevice->setEventReceiver(this);
 
     // Send a message to the console
-    std::cout << "Game::initInputSystem() success" << std::endl;
+    LogMessage(ELS_INFO) << "Game::initInputSystem() success";
 
     // Success
     return true;
@@ -296,13 +623,17 @@ bool Game::initLightManager()
     // **********************
 
     // send a message to the console
-    std::cout << "Game::initLightManager()" << std::endl;
+    LogMessage(ELS_INFO) << "Game::initLightManager()";
 
     // Set the light manager
     this->pSceneManager->setLightManager(this);
+    // Set the region the light index's octree covers
+    this->lightIndex.reset(irr::core::vector3df(0.0f, 0.0f, 0.0f), 4096.0f, 8);
+    // Set how many point and spot lights each node may use
+    this->lightSelector.setMaxLightsPerNode(this->lightsPerNode);
 
     // send a message to the console
-    std::cout << "Game::initLightManager() success" << std::endl;
+    LogMessage(ELS_INFO) << "Game::initLightManager() success";
 
     // Success
     return true;
@@ -315,7 +646,7 @@ bool Game::initCamera()
     // ***************
 
     // send a message to the console
-    std::cout << "Game::initCamera()" << std::endl;
+    LogMessage(ELS_INFO) << "Game::initCamera()";
 
     // Make a Default Camera
     irr::SKeyMap keyMap[8];
@@ -341,7 +672,7 @@ bool Game::initCamera()
         this->pSceneManager->setActiveCamera(pCamera);
 
     // send a message to the console
-    std::cout << "Game::initCamera() success" << std::endl;
+    LogMessage(ELS_INFO) << "Game::initCamera() success";
 
     // Success
     return true;
@@ -350,13 +681,14 @@ bool Game::initCamera()
 bool Game::initFonts()
 {
     // send a message to the console
-    std::cout << "bool Game::initFonts()" << std::endl;
+    LogMessage(ELS_INFO) << "bool Game::initFonts()";
 
     // Load a font
+    this->assetPrefetcher.complete("media/fonts/ConsoleFont.png");
     this->pGUIFont = this->pGUIEnvironment->getFont("media/fonts/ConsoleFont.png");
 
     // send a message to the console
-    std::cout << "bool Game::initFonts() success" << std::endl;
+    LogMessage(ELS_INFO) << "bool Game::initFonts() success";
     // Success
     return true;
 }
@@ -368,13 +700,16 @@ bool Game::initLights()
     // ***************
 
     // send a message to the console
-    std::cout << "Game::initLights()" << std::endl;
+    LogMessage(ELS_INFO) << "Game::initLights()";
 
     irr::scene::ISceneNode* pNode = 0;
     irr::scene::ILightSceneNode* pLightNode = 0;
     irr::video::ITexture* pTexture = 0;
     irr::scene::IBillboardSceneNode* pBillboardNode = 0;
 
+    // Marker texture
+    this->assetPrefetcher.complete("media/particles/white.png");
+
     // LIGHTING
     irr::video::SLight lightData;
     // Ambient Light
@@ -474,7 +809,7 @@ bool Game::initLights()
         pBillboardNode->setMaterialType(irr:: video::EMT_TRANSPARENT_ADD_COLOR);
 
     // send a message to the console
-    std::cout << "Game::initLights() success" << std::endl;
+    LogMessage(ELS_INFO) << "Game::initLights() success";
 
     // Success
     return true;
@@ -486,24 +821,109 @@ bool Game::initDemo()
     // * INIT DEMO *
     // *************
 
-    irr::scene::IMesh* pMesh = 0;
-    irr::scene::IAnimatedMesh* pAnimatedMesh = 0;
-    irr::scene::IMeshSceneNode* pMeshSceneNode = 0;
-    irr::scene::IAnimatedMeshSceneNode* pAnimatedmeshSceneNode = 0;
-    irr::scene::ISceneNode* pNode = 0;
+    // RENDER QUEUE
+    // The demo nodes are added under the render queue which draws them sorted by shader program and textures
+    this->pRenderQueue = new RenderQueueSceneNode(this->pSceneManager->getRootSceneNode(), this->pSceneManager);
+        this->pRenderQueue->setName("Render Queue");
+        this->pRenderQueue->setLightManager(this);
+        this->pRenderQueue->setSorting(this->renderQueueSorting);
+        // The root scene node holds the reference
+        this->pRenderQueue->drop();
+
+    // Success
+    return true;
+}
+
+bool Game::initShaders()
+{
+    // ****************
+    // * INIT SHADERS *
+    // ****************
 
     // LOAD SHADERS
     this->shaderMaterial01 = this->loadShader("media/shaders/BasicVertexShader.glsl", "media/shaders/BasicFragmentShader.glsl");
     this->shaderMaterial02 = this->loadShader("media/shaders/LambertVertexShader.glsl", "media/shaders/LambertFragmentShader.glsl");
     this->shaderMaterial03 = this->loadShader("media/shaders/PhongVertexShader.glsl", "media/shaders/PhongFragmentShader.glsl");
+    // The clustered Phong shader takes the Phong shader's place when asked for (--clustered)
+    if (this->clusteredLightingEnabled == true)
+    {
+        irr::s32 clusteredMaterial = this->loadShader("media/shaders/ClusteredPhongVertexShader.glsl", "media/shaders/ClusteredPhongFragmentShader.glsl");
+        if (clusteredMaterial != -1 && this->clusteredLighting.init(this->pVideoDriver) == true)
+            this->shaderMaterial03 = clusteredMaterial;
+        else
+        {
+            LogMessage(ELS_WARNING) << "Clustered lighting is not available, using the Phong shader";
+            this->clusteredLightingEnabled = false;
+        }
+    }
+    // GPU skinning needs every demo shader's skinned variant (checked before any mesh is handed to it, as a node
+    // skinned on the GPU without one would be drawn in the bind pose)
+    const irr::s32 demoMaterials[3] = { this->shaderMaterial01, this->shaderMaterial02, this->shaderMaterial03 };
+    for (int i = 0; i < 3 && this->gpuSkinningEnabled == true; i++)
+    {
+        if (demoMaterials[i] == -1)
+        {
+            this->gpuSkinningEnabled = false;
+            break;
+        }
+        irr::u32 shaderIndex = (irr::u32)this->materialPermutations[demoMaterials[i]];
+        if ((this->shaderPermutations[shaderIndex].getSupportedFeatures() & (1u << ESF_SKINNED)) == 0 ||
+            this->getShaderVariant(shaderIndex, ShaderPermutations::DEFAULT_FEATURES | (1u << ESF_SKINNED), 0) == -1)
+        {
+            LogMessage(ELS_WARNING) << "No skinned variant of " << this->shaderPermutations[shaderIndex].getVertexShader() << ", skinning on the CPU";
+            this->gpuSkinningEnabled = false;
+        }
+    }
+    // Drivers without GLSL support (null, software, Burning's Video) fall back to the solid material
+    if (this->shaderMaterial01 == -1)
+        this->shaderMaterial01 = irr::video::EMT_SOLID;
+    if (this->shaderMaterial02 == -1)
+        this->shaderMaterial02 = irr::video::EMT_SOLID;
+    if (this->shaderMaterial03 == -1)
+        this->shaderMaterial03 = irr::video::EMT_SOLID;
+
+    // Success
+    return true;
+}
+
+bool Game::initDoominators()
+{
+    // ********************
+    // * INIT DOOMINATORS *
+    // ********************
+
+    irr::scene::IAnimatedMesh* pAnimatedMesh = 0;
+    irr::scene::IAnimatedMeshSceneNode* pAnimatedmeshSceneNode = 0;
+    irr::scene::ISceneNode* pNode = 0;
+
+    // LOAD MESH
+    /* Loaded through the mesh cache, which adds it to Irrlicht's mesh cache
+        so the getMesh calls below find it without parsing the .x file */
+    this->assetPrefetcher.complete("media/meshes/Doominator.x");
+    if (this->meshCache.getMesh(this->pSceneManager, "media/meshes/Doominator.x") == 0)
+        return false;
 
     // SHADER 1 TEST
     // Load a Mesh
     pAnimatedMesh = pSceneManager->getMesh("media/meshes/Doominator.x");
     if (pAnimatedMesh == 0)
         return false;
+    // Skin it in the vertex shader (the mesh is shared by every Doominator node)
+    if (this->gpuSkinningEnabled == true && pAnimatedMesh->getMeshType() == irr::scene::EAMT_SKINNED)
+        this->gpuSkinningEnabled = this->gpuSkinning.addMesh(static_cast<irr::scene::ISkinnedMesh*>(pAnimatedMesh));
+    // Otherwise skin every visible Doominator in one batched pass, split across worker threads
+    if (this->gpuSkinningEnabled == false && this->batchedSkinningEnabled == true && pAnimatedMesh->getMeshType() == irr::scene::EAMT_SKINNED)
+        this->batchedSkinningEnabled = this->cpuSkinning.addMesh(static_cast<irr::scene::ISkinnedMesh*>(pAnimatedMesh));
+    else
+        this->batchedSkinningEnabled = false;
+    if (this->batchedSkinningEnabled == true)
+    {
+        this->cpuSkinning.setJobSystem(&this->jobSystem);
+        this->pRenderQueue->setCPUSkinning(&this->cpuSkinning);
+    }
     // Add the mesh to a scene node
-    pAnimatedmeshSceneNode = this->pSceneManager->addAnimatedMeshSceneNode(pAnimatedMesh);
+    pAnimatedmeshSceneNode = this->pSceneManager->addAnimatedMeshSceneNode(pAnimatedMesh, this->pRenderQueue);
+        pAnimatedmeshSceneNode->setName("Doominator (Basic)");
         pAnimatedmeshSceneNode->setPosition(irr::core::vector3df(-150.0f, 0.0f, 0.0f));
         pAnimatedmeshSceneNode->setScale(irr::core::vector3df(0.1f, 0.1f, 0.1f));
         pAnimatedmeshSceneNode->setMaterialFlag(irr::video::EMF_LIGHTING, true);
@@ -548,7 +968,8 @@ bool Game::initDemo()
     if (pAnimatedMesh == 0)
         return false;
     // Add the mesh to a scene node
-    pAnimatedmeshSceneNode = this->pSceneManager->addAnimatedMeshSceneNode(pAnimatedMesh);
+    pAnimatedmeshSceneNode = this->pSceneManager->addAnimatedMeshSceneNode(pAnimatedMesh, this->pRenderQueue);
+        pAnimatedmeshSceneNode->setName("Doominator (Lambert)");
         pAnimatedmeshSceneNode->setPosition(irr::core::vector3df(0.0f, 0.0f, 0.0f));
         pAnimatedmeshSceneNode->setScale(irr::core::vector3df(0.1f, 0.1f, 0.1f));
         pAnimatedmeshSceneNode->setMaterialFlag(irr::video::EMF_LIGHTING, true);
@@ -619,15 +1040,16 @@ bool Game::initDemo()
     //pAnimatedMesh = pSceneManager->getMesh("media/meshes/LevelTest.x");
     if (pAnimatedMesh == 0)
     {
-        std::cout << "AnimatedMesh was null" << std::endl;
+        LogMessage(ELS_INFO) << "AnimatedMesh was null";
         return false;
     }
     // Add the mesh to a scene node
-    pAnimatedmeshSceneNode = this->pSceneManager->addAnimatedMeshSceneNode(pAnimatedMesh);
+    pAnimatedmeshSceneNode = this->pSceneManager->addAnimatedMeshSceneNode(pAnimatedMesh, this->pRenderQueue);
+        pAnimatedmeshSceneNode->setName("Doominator (Phong)");
         pAnimatedmeshSceneNode->setPosition(irr::core::vector3df(150.0f, 0.0f, 0.0f));
         pAnimatedmeshSceneNode->setRotation(irr::core::vector3df(0.0f, 0.0f, 0.0f));
         pAnimatedmeshSceneNode->setScale(irr::core::vector3df(0.1f, 0.1f, 0.1f));
-        pAnimatedmeshSceneNode->setMaterialFlag(irr::video::EMF_LIGHTING, false);
+        pAnimatedmeshSceneNode->setMaterialFlag(irr::video::EMF_LIGHTING, true);
         pAnimatedmeshSceneNode->setMaterialFlag(irr::video::EMF_BACK_FACE_CULLING, false);
         pAnimatedmeshSceneNode->setMaterialFlag(irr::video::EMF_FRONT_FACE_CULLING, false);
         pAnimatedmeshSceneNode->setMaterialFlag(irr::video::EMF_BLEND_OPERATION, true);
@@ -637,6 +1059,9 @@ bool Game::initDemo()
         pAnimatedmeshSceneNode->setMaterialFlag(irr::video::EMF_TRILINEAR_FILTER, false);
         pAnimatedmeshSceneNode->setMaterialFlag(irr::video::EMF_USE_MIP_MAPS, false);
         pAnimatedmeshSceneNode->setMaterialType((irr::video::E_MATERIAL_TYPE)this->shaderMaterial03);
+        // The clustered Phong shader reads its lights from textures bound to the material
+        if (this->clusteredLightingEnabled == true)
+            this->clusteredLighting.applyToNode(pAnimatedmeshSceneNode);
     pNode = this->pSceneManager->addTextSceneNode(pGUIFont, L"Phong Shader");
         pNode->setPosition(irr::core::vector3df(0.0f, 150.0f, 0.0f));
         pNode->setParent(pAnimatedmeshSceneNode);
@@ -663,16 +1088,35 @@ bool Game::initDemo()
 //        pMeshSceneNode->setMaterialTexture(2, 0);
 //        pMeshSceneNode->setMaterialTexture(3, 0);
 
+    // Success
+    return true;
+}
+
+bool Game::initPlane()
+{
+    // **************
+    // * INIT PLANE *
+    // **************
+
+    irr::scene::IAnimatedMesh* pAnimatedMesh = 0;
+    irr::scene::IAnimatedMeshSceneNode* pAnimatedmeshSceneNode = 0;
+
+    // LOAD MESH
+    this->assetPrefetcher.complete("media/meshes/plane.x");
+    if (this->meshCache.getMesh(this->pSceneManager, "media/meshes/plane.x") == 0)
+        return false;
+
     // SHADER 4 TEST
     // Load a Mesh
     pAnimatedMesh = pSceneManager->getMesh("media/meshes/plane.x");
     if (pAnimatedMesh == 0)
     {
-        std::cout << "Mesh was null" << std::endl;
+        LogMessage(ELS_INFO) << "Mesh was null";
         return false;
     }
     // Add the mesh to a scene node
-    pAnimatedmeshSceneNode = this->pSceneManager->addAnimatedMeshSceneNode(pAnimatedMesh);
+    pAnimatedmeshSceneNode = this->pSceneManager->addAnimatedMeshSceneNode(pAnimatedMesh, this->pRenderQueue);
+        pAnimatedmeshSceneNode->setName("Plane (Phong)");
         pAnimatedmeshSceneNode->setPosition(irr::core::vector3df(0.0f, -25.0f, 0.0f));
 //        pAnimatedmeshSceneNode->setScale(irr::core::vector3df(0.1f, 0.1f, 0.1f));
         pAnimatedmeshSceneNode->setMaterialFlag(irr::video::EMF_LIGHTING, true);
@@ -692,6 +1136,58 @@ bool Game::initDemo()
         pAnimatedmeshSceneNode->setMaterialTexture(1, 0);
         pAnimatedmeshSceneNode->setMaterialTexture(2, 0);
         pAnimatedmeshSceneNode->setMaterialTexture(3, 0);
+        // The clustered Phong shader reads its lights from textures bound to the material
+        if (this->clusteredLightingEnabled == true)
+            this->clusteredLighting.applyToNode(pAnimatedmeshSceneNode);
+
+    // Success
+    return true;
+}
+
+bool Game::initInstances()
+{
+    // ******************
+    // * INIT INSTANCES *
+    // ******************
+
+    irr::scene::IAnimatedMesh* pAnimatedMesh = 0;
+
+    // SHADER 5 TEST
+    // Draw a grid of Doominators with one instanced node (a batch per draw call)
+    pAnimatedMesh = pSceneManager->getMesh("media/meshes/Doominator.x");
+    if (pAnimatedMesh == 0)
+        return false;
+    if (this->instanceCount > 0)
+    {
+        this->pInstancedNode = new InstancedMeshSceneNode(pAnimatedMesh->getMesh(0), this->pRenderQueue, this->pSceneManager);
+            this->pInstancedNode->setName("Doominators (Instanced Phong)");
+            this->pInstancedNode->setPosition(irr::core::vector3df(0.0f, 0.0f, 300.0f));
+            this->pInstancedNode->setMaterialFlag(irr::video::EMF_LIGHTING, true);
+            this->pInstancedNode->setMaterialFlag(irr::video::EMF_BACK_FACE_CULLING, false);
+            this->pInstancedNode->setMaterialFlag(irr::video::EMF_ANISOTROPIC_FILTER, false);
+            this->pInstancedNode->setMaterialFlag(irr::video::EMF_ANTI_ALIASING, false);
+            this->pInstancedNode->setMaterialFlag(irr::video::EMF_BILINEAR_FILTER, false);
+            this->pInstancedNode->setMaterialFlag(irr::video::EMF_TRILINEAR_FILTER, false);
+            this->pInstancedNode->setMaterialFlag(irr::video::EMF_USE_MIP_MAPS, false);
+            this->pInstancedNode->setMaterialType((irr::video::E_MATERIAL_TYPE)this->shaderMaterial03);
+            // The clustered Phong shader reads its lights from textures bound to the material
+            if (this->clusteredLightingEnabled == true)
+                this->clusteredLighting.applyToNode(this->pInstancedNode);
+        // Lay the instances out in a square grid, each with its own turn and tint
+        int columns = (int)ceilf(sqrtf((float)this->instanceCount));
+        for (int i = 0; i < this->instanceCount; i++)
+        {
+            irr::core::matrix4 transform;
+            transform.setTranslation(irr::core::vector3df(((i % columns) - (columns - 1) * 0.5f) * 60.0f, 0.0f, (irr::f32)(i / columns) * 60.0f));
+            transform.setRotationDegrees(irr::core::vector3df(0.0f, (irr::f32)((i * 37) % 360), 0.0f));
+            irr::core::matrix4 scale;
+            scale.setScale(irr::core::vector3df(0.1f, 0.1f, 0.1f));
+            irr::video::SColorf color((i % 3 == 0) ? 1.0f : 0.5f, (i % 3 == 1) ? 1.0f : 0.5f, (i % 3 == 2) ? 1.0f : 0.5f, 1.0f);
+            this->pInstancedNode->addInstance(transform * scale, color);
+        }
+        // The render queue holds the reference
+        this->pInstancedNode->drop();
+    }
 
     // Success
     return true;
@@ -706,6 +1202,7 @@ bool Game::initGUI()
     // SETUP GUI ELEMENTS
     this->pCursorControl->setVisible(false);
     // Apply Dodgee Software Logo
+    this->assetPrefetcher.complete("media/logos/Dodgee Software.jpg");
     irr::gui::IGUIImage* pLogo = this->pGUIEnvironment->addImage(this->pVideoDriver->getTexture("media/logos/Dodgee Software.jpg"), irr::core::position2d<int>(0.0f, 0.0f));
     if (pLogo != 0)
     {
@@ -725,6 +1222,7 @@ bool Game::initSky()
     // ************
 
     // Add Sky
+    this->assetPrefetcher.complete("media/sky/space1.jpg");
     irr::scene::ISceneNode* pSkyBox = this->pSceneManager->addSkyBoxSceneNode(this->pVideoDriver->getTexture("media/sky/space1.jpg"),
                                                                               this->pVideoDriver->getTexture("media/sky/space1.jpg"),
                                                                               this->pVideoDriver->getTexture("media/sky/space1.jpg"),
@@ -736,6 +1234,60 @@ bool Game::initSky()
     return true;
 }
 
+bool Game::initPrefetch()
+{
+    // *****************
+    // * INIT PREFETCH *
+    // *****************
+
+    if (this->prefetchEnabled == false)
+        return true;
+    // The assets the init functions load (the meshes only when they have binary caches to decode)
+    this->assetPrefetcher.addImage("media/fonts/ConsoleFont.png");
+    this->assetPrefetcher.addImage("media/particles/white.png");
+    this->assetPrefetcher.addImage("media/logos/Dodgee Software.jpg");
+    this->assetPrefetcher.addImage("media/sky/space1.jpg");
+    if (this->meshCacheEnabled == true)
+    {
+        this->assetPrefetcher.addMesh("media/meshes/Doominator.x");
+        this->assetPrefetcher.addMesh("media/meshes/plane.x");
+    }
+    this->assetPrefetcher.start(&this->jobSystem, this->pIrrlichtDevice, &this->meshCache);
+    return true;
+}
+
+bool Game::initLoadStages()
+{
+    // ********************
+    // * INIT LOAD STAGES *
+    // ********************
+
+    // In the order they appear (each mesh's nodes as soon as it has loaded)
+    this->stagedLoader.add("Shaders", [this]() { return this->initShaders(); });
+    this->stagedLoader.add("Doominators", [this]() { return this->initDoominators(); });
+    this->stagedLoader.add("Plane", [this]() { return this->initPlane(); });
+    this->stagedLoader.add("Instances", [this]() { return this->initInstances(); });
+    this->stagedLoader.add("GUI", [this]() { return this->initGUI(); });
+    this->stagedLoader.add("Sky", [this]() { return this->initSky(); });
+    // Hand over any prefetched assets left and report the decode times
+    this->stagedLoader.add("Prefetch", [this]() { this->assetPrefetcher.completeAll(); return true; });
+    this->stagedLoader.start();
+    // Without a budget everything loads before the first frame
+    if (this->loadBudget <= 0.0)
+        return this->stagedLoader.finish();
+    return true;
+}
+
+bool Game::initFrameCapture()
+{
+    // **********************
+    // * INIT FRAME CAPTURE *
+    // **********************
+
+    // Four slots let a short burst be read back while earlier frames are still being written
+    return this->frameCapture.init("screenShots", "screenshot", this->captureFormat, 4);
+}
+
 void Game::handleEvents()
 {
     // *****************
@@ -759,12 +1311,119 @@ void Game::update()
     // **********
 
     // ANIMATE THE POINT LIGHTS
-    static float theta = 0.0f;
-    theta = theta + 0.001f;
-    this->pLight02->setPosition(irr::core::vector3df(-150.0f + cos(theta * 2.0f) * 25.0f, sin(theta) * 25.0f, cos(theta) * 25.0f));
-    this->pLight03->setPosition(irr::core::vector3df(0.0f + cos(theta * 2.0f) * 25.0f, sin(theta) * 25.0f, cos(theta) * 25.0f));
-    this->pLight04->setPosition(irr::core::vector3df(150.0f + cos(theta * 2.0f) * 25.0f, sin(theta) * 25.0f, cos(theta) * 25.0f));
+    // (only the scene state is written, the lights are moved at the handoff)
+    SSceneState& state = this->getSimulationState();
+    state.previousLightPositions = state.lightPositions;
+    state.theta = state.theta + 0.06f * this->getTickLength();
+    const irr::f32 lightCentres[3] = { -150.0f, 0.0f, 150.0f };
+    for (size_t i = 0; i < state.lightPositions.size() && i < 3; i++)
+        state.lightPositions[i] = irr::core::vector3df(lightCentres[i] + cos(state.theta * 2.0f) * 25.0f, sin(state.theta) * 25.0f, cos(state.theta) * 25.0f);
+
+}
+
+bool Game::initSceneState()
+{
+    // ********************
+    // * INIT SCENE STATE *
+    // ********************
+
+    // The point lights animated by update
+    this->animatedLights.clear();
+    this->animatedLights.push_back(this->pLight02);
+    this->animatedLights.push_back(this->pLight03);
+    this->animatedLights.push_back(this->pLight04);
+    // Both states start as the scene is now
+    SSceneState& state = this->sceneStates[0];
+    state.theta = 0.0f;
+    state.lightPositions.clear();
+    for (size_t i = 0; i < this->animatedLights.size(); i++)
+        state.lightPositions.push_back(this->animatedLights[i]->getPosition());
+    state.previousLightPositions = state.lightPositions;
+    state.tickCount = 0;
+    state.interpolation = 1.0f;
+    state.simulationStart = std::chrono::steady_clock::now();
+    state.thinkTime = 0.0;
+    state.updateTime = 0.0;
+    this->sceneStates[1] = state;
+    this->simulationState = 0;
+    this->pSimulationJob = 0;
+    LogMessage(ELS_INFO) << "Game::initSceneState() " << ((this->pipelined == true) ? "pipelined" : "serial") << " simulation";
+
+    // Success
+    return true;
+}
+
+void Game::beginSimulation()
+{
+    // The simulation carries on from the state being drawn
+    SSceneState& state = this->getSimulationState();
+    state = this->getRenderState();
+    state.simulationStart = std::chrono::steady_clock::now();
+    state.thinkTime = 0.0;
+    state.updateTime = 0.0;
+
+    // COUNT THE TIME STEPS
+    double tickLength = 1000.0 / (double)this->tickRate;
+    if (this->benchmark.isEnabled() == true)
+    {
+        // Benchmarks simulate one step per frame so every run simulates the same thing
+        this->tickAccumulator = tickLength;
+    }
+    else
+    {
+        irr::u32 now = this->pIrrlichtDevice->getTimer()->getTime();
+        this->tickAccumulator += (double)(now - this->lastTickTime);
+        this->lastTickTime = now;
+    }
+    state.tickCount = (irr::u32)(this->tickAccumulator / tickLength);
+    // After a stall drop the time that would take too many steps to catch up on
+    if (state.tickCount > (irr::u32)this->maxTicksPerFrame)
+    {
+        state.tickCount = (irr::u32)this->maxTicksPerFrame;
+        this->tickAccumulator = state.tickCount * tickLength;
+    }
+    this->tickAccumulator -= state.tickCount * tickLength;
+    state.interpolation = (irr::f32)(this->tickAccumulator / tickLength);
+}
 
+void Game::simulate()
+{
+    // The profiler belongs to the main thread so the times are kept with the state
+    SSceneState& state = this->getSimulationState();
+    for (irr::u32 i = 0; i < state.tickCount; i++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        this->think();
+        std::chrono::steady_clock::time_point thought = std::chrono::steady_clock::now();
+        this->update();
+        state.thinkTime += std::chrono::duration<double, std::milli>(thought - start).count();
+        state.updateTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - thought).count();
+    }
+}
+
+void Game::handOff()
+{
+    // ***********
+    // * HANDOFF *
+    // ***********
+
+    // Wait for the simulation running ahead (the main thread runs jobs while it waits)
+    if (this->pSimulationJob != 0)
+    {
+        ProfilerScope profilerScope(&this->profiler, EPS_HANDOFF);
+        this->jobSystem.wait(this->pSimulationJob);
+        this->pSimulationJob = 0;
+        // Report its times as this frame's
+        const SSceneState& simulated = this->getSimulationState();
+        this->profiler.addSectionTime(EPS_THINK, simulated.thinkTime);
+        this->profiler.addSectionTime(EPS_UPDATE, simulated.updateTime);
+    }
+    // The simulated state is drawn and the drawn one is simulated next
+    this->simulationState = 1 - this->simulationState;
+    // Apply the state to the scene between its last two time steps
+    const SSceneState& state = this->getRenderState();
+    for (size_t i = 0; i < this->animatedLights.size() && i < state.lightPositions.size(); i++)
+        this->animatedLights[i]->setPosition(state.previousLightPositions[i].getInterpolated(state.lightPositions[i], 1.0f - state.interpolation));
 }
 
 void Game::draw()
@@ -776,7 +1435,24 @@ void Game::draw()
     // Being the Scene
     this->pVideoDriver->beginScene(true, true, irr::video::SColor(255, 0, 0, 0));
         // Draw everything in the scene
+        this->profiler.beginSection(EPS_DRAW_SCENE);
         this->pSceneManager->drawAll();
+        this->profiler.endSection(EPS_DRAW_SCENE);
+        // Report what the render queue bound
+        if (this->pRenderQueue != 0)
+        {
+            this->profiler.setCounter(EPC_QUEUED_NODES, this->pRenderQueue->getNodeCount());
+            this->profiler.setCounter(EPC_PROGRAM_BINDS, this->pRenderQueue->getProgramBindCount());
+            this->profiler.setCounter(EPC_TEXTURE_BINDS, this->pRenderQueue->getTextureBindCount());
+        }
+        // Report what the instanced node drew
+        if (this->pInstancedNode != 0)
+        {
+            this->profiler.setCounter(EPC_INSTANCES, this->pInstancedNode->getVisibleInstanceCount());
+            this->profiler.setCounter(EPC_INSTANCE_DRAW_CALLS, this->pInstancedNode->getDrawCallCount());
+        }
+        // Report what the batched skinning pass skinned
+        this->profiler.setCounter(EPC_SKINNED_NODES, this->cpuSkinning.getSkinnedNodeCount());
         // Cache the current camera matrix and the current world matrix
         irr::core::matrix4 previous_camera = getCamera()->getViewMatrix();
         irr::core::matrix4 previous_world = pIrrlichtDevice->getVideoDriver()->getTransform(irr::video::ETS_WORLD);
@@ -818,9 +1494,28 @@ void Game::draw()
                 // Draw text at positions
                 this->pGUIFont->draw(L"Irrlicht Shader Tutorial 01 (GLSL) (c) Dodgee Software 2021", rect, irr::video::SColor(255, 255, 255, 255), false, false, 0);
             }
+            // While loading show the stage being loaded in the bottom left corner
+            if (this->stagedLoader.isFinished() == false)
+            {
+                irr::core::stringw text = L"Loading ";
+                text += irr::core::stringw(this->stagedLoader.getNextStageName().c_str());
+                text += L" (";
+                text += (irr::u32)this->stagedLoader.getCompletedCount();
+                text += L"/";
+                text += (irr::u32)this->stagedLoader.getStageCount();
+                text += L")";
+                irr::core::rect<irr::s32> rect(10, (irr::s32)this->pVideoDriver->getScreenSize().Height - 30, (irr::s32)this->pVideoDriver->getScreenSize().Width, (irr::s32)this->pVideoDriver->getScreenSize().Height);
+                this->pGUIFont->draw(text, rect, irr::video::SColor(255, 255, 255, 255), false, false, 0);
+            }
         }
         // Draw the GUI
+        this->profiler.beginSection(EPS_DRAW_GUI);
         this->pGUIEnvironment->drawAll();
+        this->profiler.endSection(EPS_DRAW_GUI);
+        // Draw the profiler overlay (when toggled on with F3)
+        this->profiler.drawOverlay(this->pVideoDriver, this->pGUIFont, irr::core::position2di(10, 30));
+        // Read the finished frame back when a screenshot or sequence wants it
+        this->frameCapture.captureFrame(this->pVideoDriver);
     // Swap the buffers
     this->pVideoDriver->endScene();
 }
@@ -843,10 +1538,20 @@ void Game::quit()
     this->shutdownInputSystem();
     // Shutdown Fonts
     this->shutdownFont();
+    // Forget the load stages not run (the game was closed while loading)
+    this->stagedLoader.clear();
+    // Drop any prefetched assets not handed over (init or loading stopped early)
+    this->assetPrefetcher.clear();
+    // Shutdown Frame Capture (writing the frames left)
+    this->frameCapture.shutdown();
+    // Release the asset pack before the file system that serves it goes
+    this->meshCache.setAssetPack(0);
     // Shutdown Window
     this->shutdownWindow();
     // Shutdown Device
     this->shutdownDevice();
+    // Shutdown Job System
+    this->jobSystem.shutdown();
 }
 
 void Game::shutdownDevice()
@@ -856,7 +1561,7 @@ void Game::shutdownDevice()
     // *******************
 
     // Send a message to the console
-    std::cout << "void Game::shutdownDevice()" << std::endl;
+    LogMessage(ELS_INFO) << "void Game::shutdownDevice()";
 
     // Drop the Irrlicht device
     this->pIrrlichtDevice->drop();
@@ -895,7 +1600,7 @@ void Game::shutdownDevice()
     this->pDefaultSceneNodeFactory = 0;
 
     // Send a message to the console
-    std::cout << "void Game::shutdownDevice() success" << std::endl;
+    LogMessage(ELS_INFO) << "void Game::shutdownDevice() success";
 }
 
 void Game::shutdownLightManager()
@@ -905,12 +1610,14 @@ void Game::shutdownLightManager()
     // **************************
 
     // Send message to the console
-    std::cout << "void Game::shutdownLightManager()" << std::endl;
+    LogMessage(ELS_INFO) << "void Game::shutdownLightManager()";
 
     // NOTE: there is no way I know to shut down the light factory, this function exists for design symmetry (for now anyway)
+    // Drop the lights the light index holds while the scene manager is still alive
+    this->lightIndex.clear();
 
     // Send message to the console
-    std::cout << "void Game::shutdownLightManager() success" << std::endl;
+    LogMessage(ELS_INFO) << "void Game::shutdownLightManager() success";
 }
 
 void Game::shutdownFont()
@@ -920,14 +1627,14 @@ void Game::shutdownFont()
     // ***********************
 
     // Send message to the console
-    std::cout << "void Game::shutdownLightManager()" << std::endl;
+    LogMessage(ELS_INFO) << "void Game::shutdownLightManager()";
 
     // Clean up fonts here
     this->pGUIEnvironment->removeFont(this->pGUIFont);
     this->pGUIFont = 0;
 
     // Send message to the console
-    std::cout << "void Game::shutdownLightManager() success" << std::endl;
+    LogMessage(ELS_INFO) << "void Game::shutdownLightManager() success";
 }
 
 void Game::shutdownWindow()
@@ -937,13 +1644,13 @@ void Game::shutdownWindow()
     // *******************
 
     // Send a message to the console
-    std::cout << "void Game::shutdownWindow()" << std::endl;
+    LogMessage(ELS_INFO) << "void Game::shutdownWindow()";
 
     // Set Window Caption
     this->pIrrlichtDevice->setWindowCaption(L"");
 
     // Send a message to the console
-    std::cout << "void Game::shutdownWindow() success" << std::endl;
+    LogMessage(ELS_INFO) << "void Game::shutdownWindow() success";
 }
 
 void Game::shutdownInputSystem()
@@ -953,13 +1660,13 @@ void Game::shutdownInputSystem()
     // *************************
 
     // Send a message to the console
-    std::cout << "void Game::shutdownInputSystem()" << std::endl;
+    LogMessage(ELS_INFO) << "void Game::shutdownInputSystem()";
 
     // Set the Event handle
     this->pIrrlichtDevice->setEventReceiver(0);
 
     // Send a message to the console
-    std::cout << "void Game::shutdownInputSystem() success" << std::endl;
+    LogMessage(ELS_INFO) << "void Game::shutdownInputSystem() success";
 }
 
 void Game::shutdownLights()
@@ -969,24 +1676,24 @@ void Game::shutdownLights()
     // *******************
 
     // Send a message to the console
-    std::cout << "void Game::shutdownLights()" << std::endl;
+    LogMessage(ELS_INFO) << "void Game::shutdownLights()";
 
     // If necessary clean up lights here mainly global lights like a global directinal light
 
     // Send a message to the console
-    std::cout << "void Game::shutdownLights() success" << std::endl;
+    LogMessage(ELS_INFO) << "void Game::shutdownLights() success";
 }
 
 void Game::shutdownCamera()
 {
     // Send a message to the console
-    std::cout << "void Game::shutdownCamera()" << std::endl;
+    LogMessage(ELS_INFO) << "void Game::shutdownCamera()";
 
     // Remove the Camera
     this->pSceneManager->getActiveCamera()->remove();
 
     // Send a message to the console
-    std::cout << "void Game::shutdownCamera() success" << std::endl;
+    LogMessage(ELS_INFO) << "void Game::shutdownCamera() success";
 }
 
 void Game::shutdownDemo()
@@ -996,6 +1703,11 @@ void Game::shutdownDemo()
     // *****************
 
     // TODO: clean up the demo stuff here
+    // The scene manager removes the render queue with the rest of the scene
+    this->pRenderQueue = 0;
+    this->pInstancedNode = 0;
+    // Forget the nodes skinned by the batched pass
+    this->cpuSkinning.clearNodes();
 }
 
 void Game::start()
@@ -1003,6 +1715,52 @@ void Game::start()
     // *********
     // * START *
     // *********
+
+    // Start tracing when a trace file was passed on the command line
+    if (this->traceOutputFile.empty() == false)
+    {
+        if (this->traceRecorder.start(this->traceCapacity) == true)
+            this->profiler.setTraceRecorder(&this->traceRecorder);
+    }
+    // Restart the profiler so that init time is not counted as a frame
+    this->profiler.reset();
+    // Start the simulation clock so that init time is not simulated
+    this->lastTickTime = this->pIrrlichtDevice->getTimer()->getTime();
+    this->tickAccumulator = 0.0;
+}
+
+void Game::startBenchmark()
+{
+    // *******************
+    // * START BENCHMARK *
+    // *******************
+
+    // Only when a frame count was passed on the command line
+    if (this->benchmarkFrames > 0)
+    {
+        // Name the phases timed by the profiler
+        std::vector<std::string> phaseNames;
+        for (int i = EPS_FRAME + 1; i < EPS_COUNT; i++)
+            phaseNames.push_back(Profiler::getSectionName((E_PROFILER_SECTION)i));
+        this->benchmark.setPhaseNames(phaseNames);
+        // Describe the run
+        this->benchmark.setProperty("driver", std::string(irr::core::stringc(this->pVideoDriver->getName()).c_str()));
+        this->benchmark.setProperty("width", (double)this->pVideoDriver->getScreenSize().Width);
+        this->benchmark.setProperty("height", (double)this->pVideoDriver->getScreenSize().Height);
+        this->benchmark.setBooleanProperty("fullscreen", this->fullScreen);
+        this->benchmark.setBooleanProperty("renderQueueSorting", this->renderQueueSorting);
+        this->benchmark.setBooleanProperty("gpuSkinning", this->gpuSkinningEnabled);
+        this->benchmark.setBooleanProperty("batchedSkinning", this->batchedSkinningEnabled);
+        this->benchmark.setProperty("jobWorkers", (double)this->jobSystem.getWorkerCount());
+        this->benchmark.setBooleanProperty("pipelined", this->pipelined);
+        this->benchmark.setProperty("tickRate", (double)this->tickRate);
+        this->benchmark.setProperty("maxTicksPerFrame", (double)this->maxTicksPerFrame);
+        this->benchmark.setProperty("loadBudget", this->loadBudget);
+        this->benchmark.setProperty("timeToFirstFrame", this->timeToFirstFrame);
+        this->benchmark.setProperty("timeToFullyLoaded", this->timeToFullyLoaded);
+        // Start recording
+        this->benchmark.start(this->benchmarkFrames, this->benchmarkWarmupFrames);
+    }
 }
 
 void Game::stop()
@@ -1011,6 +1769,16 @@ void Game::stop()
     // * STOP *
     // ********
 
+    // Write the benchmark results
+    if (this->benchmark.isEnabled() == true)
+        this->benchmark.writeJSON(this->benchmarkOutputFile);
+    // Write the trace
+    if (this->traceRecorder.isRecording() == true)
+    {
+        this->traceRecorder.stop();
+        this->profiler.setTraceRecorder(0);
+        this->traceRecorder.writeJSON(this->traceOutputFile);
+    }
 }
 
 void Game::pause()
@@ -1029,12 +1797,36 @@ void Game::resume()
 
 }
 
+E_LOG_SEVERITY Game::getLogSeverity(irr::ELOG_LEVEL logLevel)
+{
+    switch (logLevel)
+    {
+        case irr::ELL_DEBUG: return ELS_DEBUG;
+        case irr::ELL_INFORMATION: return ELS_INFO;
+        case irr::ELL_WARNING: return ELS_WARNING;
+        case irr::ELL_ERROR: return ELS_ERROR;
+        default: return ELS_NONE;
+    }
+}
+
+irr::ELOG_LEVEL Game::getIrrlichtLogLevel(E_LOG_SEVERITY severity)
+{
+    switch (severity)
+    {
+        case ELS_DEBUG: return irr::ELL_DEBUG;
+        case ELS_INFO: return irr::ELL_INFORMATION;
+        case ELS_WARNING: return irr::ELL_WARNING;
+        case ELS_ERROR: return irr::ELL_ERROR;
+        default: return irr::ELL_NONE;
+    }
+}
+
 bool Game::OnEvent(const irr::SEvent& event)
 {
     // LOG ALL EVENTS TO THE CONSOLE
     if (event.EventType  == irr::EET_LOG_TEXT_EVENT)
     {
-        std::cout << event.LogEvent.Text << std::endl;
+        LogMessage(Game::getLogSeverity(event.LogEvent.Level)) << event.LogEvent.Text;
     }
     // HANDLE KEY INPUT
     if (event.EventType == irr::EET_KEY_INPUT_EVENT)
@@ -1086,175 +1878,64 @@ void Game::OnSetConstants(irr::video::IMaterialRendererServices* pServices, irr:
     // * ONSETCONSTANTS *
     // ******************
 
-    // GET SOME HANDY GLOBALS
-    // Get the VideoDriver
-    irr::video::IVideoDriver* pVideoDriver = Game::getInstance()->getVideoDriver();
-    // Get the type of Video Driver (OpenGL / DirectX etc)
-    irr::video::E_DRIVER_TYPE driverType = Game::getInstance()->getVideoDriver()->getDriverType();
-
-    // SET THE SHADER'S SCREEN DIMENSIONS
-    // Get the ScreenWidth
-    irr::f32 screenWidth = (irr::f32)pVideoDriver->getScreenSize().Width;
-    // Set the vertex shader's ScreenWidth
-    pServices->setVertexShaderConstant("ScreenWidth", reinterpret_cast<irr::f32*>(&screenWidth), 1);
-    // Set the pixel shader's ScreenWidth
-    pServices->setPixelShaderConstant("ScreenWidth", reinterpret_cast<irr::f32*>(&screenWidth), 1);
-    // Get the ScreenHeight
-    irr::f32 screenHeight = (irr::f32)pVideoDriver->getScreenSize().Height;
-    // Set the vertex shader's ScreenHeight
-    pServices->setVertexShaderConstant("ScreenHeight", reinterpret_cast<irr::f32*>(&screenHeight), 1);
-    // Set the pixel shader's ScreenHeight
-    pServices->setPixelShaderConstant("ScreenHeight", reinterpret_cast<irr::f32*>(&screenHeight), 1);
-
-    // SET THE SHADER'S WORLDVIEWPROJECTMATRIX
-    // Set the shader's WorldViewProjection Matrix
-    irr::core::matrix4 WorldViewProjection;
-    // Calculate the WorldViewProjection Matrix
-    WorldViewProjection = pVideoDriver->getTransform(irr::video::ETS_PROJECTION) * pVideoDriver->getTransform(irr::video::ETS_VIEW) * pVideoDriver->getTransform(irr::video::ETS_WORLD);
-    //WorldViewProjection = pVideoDriver->getTransform(irr::video::ETS_WORLD) * pVideoDriver->getTransform(irr::video::ETS_VIEW) * pVideoDriver->getTransform(irr::video::ETS_PROJECTION); // This calc is incorrect
-    // Pass the WorldViewProjection Matrix to the Vertex Shader
-    pServices->setVertexShaderConstant("WorldViewProjectionMatrix", WorldViewProjection.pointer(), 16);
-    // Pass the WorldViewProjection Matrix to the Pixel Shader
-    pServices->setPixelShaderConstant("WorldViewProjectionMatrix", WorldViewProjection.pointer(), 16);
-
-    // SET THE SHADER's WORLDMATRIX
-    irr::core::matrix4 WorldMatrix;
-    // Get the world matrix
-    WorldMatrix = pVideoDriver->getTransform(irr::video::ETS_WORLD);
-    // Pass the WorldViewProjection Matrix to the Vertex Shader
-    pServices->setVertexShaderConstant("WorldMatrix", WorldMatrix.pointer(), 16);
-    // Pass the WorldViewProjection Matrix to the Pixel Shader
-    pServices->setPixelShaderConstant("WorldMatrix", WorldMatrix.pointer(), 16);
-
-    // SET THE SHADER's INVERSEWORLDMATRIX
-    irr::core::matrix4 InverseWorldMatrix;
-    // Calculate the InverseWorldMatrix
-    InverseWorldMatrix = pVideoDriver->getTransform(irr::video::ETS_WORLD);
-        InverseWorldMatrix.makeInverse();
-    // Pass the WorldViewProjection Matrix to the Vertex Shader
-    pServices->setVertexShaderConstant("InverseWorldMatrix", InverseWorldMatrix.pointer(), 16);
-    // Pass the WorldViewProjection Matrix to the Pixel Shader
-    pServices->setPixelShaderConstant("InverseWorldMatrix", InverseWorldMatrix.pointer(), 16);
-
-    // SET THE SHADER'S WORLDVIEW MATRIX
-    // Grab the ViewMatrix
-    irr::core::matrix4 ViewMatrix = pVideoDriver->getTransform(irr::video::ETS_VIEW);
-    // Set the vertex shader's View Matrix
-    pServices->setVertexShaderConstant("ViewMatrix", ViewMatrix.pointer(), 16);
-    // Set the pixel shader's View Matrix
-    pServices->setPixelShaderConstant("ViewMatrix", ViewMatrix.pointer(), 16);
-
-    // SET THE SHADERS INVERSEWORLDVIEW
-    // Calculate the InverseWorldViewMatrix
-    irr::core::matrix4 InverseViewMatrix = pVideoDriver->getTransform(irr::video::ETS_VIEW);
-        // Invert the World Matrix
-        InverseViewMatrix.makeInverse();
-    // Set the vertex shader's InverseView Matrix
-    pServices->setVertexShaderConstant("InverseViewMatrix", InverseViewMatrix.pointer(), 16);
-    // Set the pixel shader's InverseView Matrix
-    pServices->setPixelShaderConstant("InverseViewMatrix", InverseViewMatrix.pointer(), 16);
-
-    // SET THE SHADER'S PROJECTIONMATRIX
-    // Create the ProjectionMatrix
-    irr::core::matrix4 ProjectionMatrix;
-    // Grab the ProjectionMatrix
-    ProjectionMatrix = pVideoDriver->getTransform(irr::video::ETS_PROJECTION);
-    // Pass the ProjectionMatrix Matrix to the Vertex Shader
-    pServices->setVertexShaderConstant("ProjectionMatrix", ProjectionMatrix.pointer(), 16);
-    // Pass the ProjectionMatrix Matrix to the Pixel Shader
-    pServices->setPixelShaderConstant("ProjectionMatrix", ProjectionMatrix.pointer(), 16);
-
-    // SET THE SHADER'S INVERSEPROJECTIONMATRIX
-    // Create the InverseProjectionMatrix
-    irr::core::matrix4 InverseProjectionMatrix;
-    // Calculate the InverseProjectionMatrix
-    InverseProjectionMatrix = pVideoDriver->getTransform(irr::video::ETS_PROJECTION);
-        InverseProjectionMatrix.makeInverse();
-    // Pass the InverseProjectionMatrix Matrix to the Vertex Shader
-    pServices->setVertexShaderConstant("InverseProjectionMatrix", InverseProjectionMatrix.pointer(), 16);
-    // Pass the InverseProjectionMatrix Matrix to the Pixel Shader
-    pServices->setPixelShaderConstant("InverseProjectionMatrix", InverseProjectionMatrix.pointer(), 16);
-
-    // SET THE SHADER's NORMAL MATRIX
-    irr::core::matrix4 NormalMatrix = pVideoDriver->getTransform(irr::video::ETS_WORLD);
-    /* We calculate the Normal Matrix here using the 'World' Matrix (this is a meshes transformation
-        matrix). To convert this to a normal matrix what I do is remove the translation part of the
-        matrix viola, the correct normal matrix. */
-        // Remove Translation from the World Matrix
-        NormalMatrix.setTranslation(irr::core::vector3df(0.0f, 0.0f, 0.0f));
-    // Pass the WorldViewProjection Matrix to the Vertex Shader
-    pServices->setVertexShaderConstant("NormalMatrix", NormalMatrix.pointer(), 16);
-    // Pass the WorldViewProjection Matrix to the Pixel Shader
-    pServices->setPixelShaderConstant("NormalMatrix", NormalMatrix.pointer(), 16);
-
-    // SET THE SHADER'S TIMER
-    // Set the shader's time value
-    irr::f32 time = ((irr::f32)(pIrrlichtDevice->getTimer()->getTime()) / 1000.0f);
-    // Set the vertex shader's timer
-    pServices->setVertexShaderConstant("Time", reinterpret_cast<irr::f32*>(&time), 1);
-    // Set the pixel shader's timer
-    pServices->setPixelShaderConstant("Time", reinterpret_cast<irr::f32*>(&time), 1);
-
-    // SET THE SHADER'S CAMERA PROPERTIES
-    if (pIrrlichtDevice->getSceneManager()->getActiveCamera() != 0)
+    // Trace the upload tagged with the node and material being drawn
+    TraceScope traceScope(&this->traceRecorder, "OnSetConstants", "shader", "node", Game::getTraceNodeName(this->pCurrentNode), "materialType", (this->pShaderMaterial != 0) ? (int)this->pShaderMaterial->MaterialType : -1);
+
+    // GET THE CONSTANT TABLE FOR THIS SHADER
+    /* loadShader gives each shader its own userData which indexes its constant table. The first
+        time a shader is used the IDs of its constants are looked up by name and from then on every
+        upload goes straight to an ID (once per program, GLSL shares constants between stages) */
+    if (userData < 0 || userData >= (irr::s32)this->shaderConstantTables.size())
+        return;
+    ShaderConstantTable& shaderConstantTable = this->shaderConstantTables[userData];
+    if (shaderConstantTable.isResolved() == false)
+        shaderConstantTable.resolve(pServices);
+
+    // PASS THE FRAME CONSTANTS TO THE SHADER
+    /* Everything which is the same for every node drawn this frame (screen, time, view, projection,
+        camera, fog and the packed lights) was computed once in OnPreRender */
+    this->shaderFrameConstants.upload(pServices, shaderConstantTable);
+    // Only the point and spot lights selected for this node in OnNodePreRender are passed
+    this->shaderFrameConstants.uploadNodeLights(pServices, shaderConstantTable, this->nodePointLights, this->nodeSpotLights);
+    // The clustered Phong shader looks its point and spot lights up in the cluster grid instead
+    if (shaderConstantTable.isGroupUsed(ESCG_CLUSTERS) == true)
+        this->clusteredLighting.upload(pServices, shaderConstantTable);
+    // Instanced shaders read the matrices and colours of the batch being drawn
+    if (shaderConstantTable.isGroupUsed(ESCG_INSTANCES) == true && this->pCurrentNode != 0 && this->pCurrentNode->getType() == InstancedMeshSceneNode::NODE_TYPE)
+        static_cast<InstancedMeshSceneNode*>(this->pCurrentNode)->uploadInstances(pServices, shaderConstantTable);
+    // Skinned shaders read the bone palette of the node being drawn
+    if (shaderConstantTable.isGroupUsed(ESCG_SKINNING) == true)
+        this->gpuSkinning.upload(pServices, shaderConstantTable, this->pCurrentNode);
+
+    // SET THE SHADER'S WORLD MATRICES
+    if (shaderConstantTable.isGroupUsed(ESCG_WORLD) == true)
     {
-        // Get the camera position
-        irr::core::vector3df cameraPosition = pIrrlichtDevice->getSceneManager()->getActiveCamera()->getPosition();
-        // Get the camera target normal
-        irr::core::vector3df cameraTarget = (pIrrlichtDevice->getSceneManager()->getActiveCamera()->getTarget() - pIrrlichtDevice->getSceneManager()->getActiveCamera()->getAbsolutePosition()).normalize();
-        // Get the camera view matrix
-        irr::core::matrix4 cameraViewMatrix = pIrrlichtDevice->getSceneManager()->getActiveCamera()->getViewMatrix();
-        // Calculate camera inverse view matrix
-        irr::core::matrix4 inverseCameraViewMatrix;
-            cameraViewMatrix.getInverse(inverseCameraViewMatrix);
-        // Get the camera projection matrix
-        irr::core::matrix4 cameraProjectionMatrix = pIrrlichtDevice->getSceneManager()->getActiveCamera()->getProjectionMatrix();
-        // Calculate camera inverse projection matrix
-        irr::core::matrix4 inverseCameraProjectionMatrix;
-            cameraProjectionMatrix.getInverse(inverseCameraProjectionMatrix);
-        // Get Camera Near Plane
-        float cameraNearPlane = pIrrlichtDevice->getSceneManager()->getActiveCamera()->getNearValue();
-        // Get Camera Far Plane
-        float cameraFarPlane = pIrrlichtDevice->getSceneManager()->getActiveCamera()->getFarValue();
-        // Get Camera FOV
-        float cameraFOV = pIrrlichtDevice->getSceneManager()->getActiveCamera()->getFOV();
-
-        // Set vertex shader's camera position
-        pServices->setVertexShaderConstant("CameraPosition", reinterpret_cast<irr::f32*>(&cameraPosition), 3);
-        // Set pixel shader's camera position
-        pServices->setPixelShaderConstant("CameraPosition", reinterpret_cast<irr::f32*>(&cameraPosition), 3);
-        // Set vertex shader's camera target
-        pServices->setVertexShaderConstant("CameraTarget", reinterpret_cast<irr::f32*>(&cameraTarget), 3);
-        // Set pixel shader's camera target
-        pServices->setPixelShaderConstant("CameraTarget", reinterpret_cast<irr::f32*>(&cameraTarget), 3);
-        // Set vertex shader's camera view matrix
-        pServices->setVertexShaderConstant("CameraViewMatrix", cameraViewMatrix.pointer(), 16);
-        // Set pixel shader's camera view matrix
-        pServices->setPixelShaderConstant("CameraViewMatrix", cameraViewMatrix.pointer(), 16);
-        // Set vertex shader's inverse camera view matrix
-        pServices->setVertexShaderConstant("InverseCameraViewMatrix", inverseCameraViewMatrix.pointer(), 16);
-        // Set pixel shader's inverse camera view matrix
-        pServices->setPixelShaderConstant("InverseCameraViewMatrix", inverseCameraViewMatrix.pointer(), 16);
-        // Set vertex shader's camera view matrix
-        pServices->setVertexShaderConstant("CameraProjectionMatrix", cameraProjectionMatrix.pointer(), 16);
-        // Set pixel shader's camera view matrix
-        pServices->setPixelShaderConstant("CameraProjectionMatrix", cameraProjectionMatrix.pointer(), 16);
-        // Set vertex shader's inverse camera view matrix
-        pServices->setVertexShaderConstant("InverseCameraProjectionMatrix", inverseCameraProjectionMatrix.pointer(), 16);
-        // Set pixel shader's inverse camera view matrix
-        pServices->setPixelShaderConstant("InverseCameraProjectionMatrix", inverseCameraProjectionMatrix.pointer(), 16);
-        // Set vertex shader's cameraNearPlane
-        pServices->setVertexShaderConstant("CameraNearPlane", &cameraNearPlane, 1);
-        // Set pixel shader's cameraNearPlane
-        pServices->setPixelShaderConstant("CameraNearPlane", &cameraNearPlane, 1);
-        // Set vertex shader's cameraFarPlane
-        pServices->setVertexShaderConstant("CameraFarPlane", &cameraFarPlane, 1);
-        // Set pixel shader's cameraFarPlane
-        pServices->setPixelShaderConstant("CameraFarPlane", &cameraFarPlane, 1);
-        // Set vertex shader's cameraFOV
-        pServices->setVertexShaderConstant("CameraFOV", &cameraFOV, 1);
-        // Set pixel shader's cameraFOV
-        pServices->setPixelShaderConstant("CameraFOV", &cameraFOV, 1);
+        // Get the world matrix
+        const irr::core::matrix4& WorldMatrix = this->pVideoDriver->getTransform(irr::video::ETS_WORLD);
+        // Pass the World Matrix to the Shader
+        shaderConstantTable.set(pServices, ESC_WORLD_MATRIX, WorldMatrix.pointer(), 16);
+        // Calculate the WorldViewProjection Matrix (Projection * View was calculated for the frame)
+        irr::core::matrix4 WorldViewProjection = this->shaderFrameConstants.getViewProjectionMatrix() * WorldMatrix;
+        // Pass the WorldViewProjection Matrix to the Shader
+        shaderConstantTable.set(pServices, ESC_WORLD_VIEW_PROJECTION_MATRIX, WorldViewProjection.pointer(), 16);
+        // Only invert the World Matrix when the shader wants it
+        if (shaderConstantTable.isUsed(ESC_INVERSE_WORLD_MATRIX) == true)
+        {
+            // Calculate the InverseWorldMatrix
+            irr::core::matrix4 InverseWorldMatrix;
+                WorldMatrix.getInverse(InverseWorldMatrix);
+            // Pass the InverseWorldMatrix to the Shader
+            shaderConstantTable.set(pServices, ESC_INVERSE_WORLD_MATRIX, InverseWorldMatrix.pointer(), 16);
+        }
+        // SET THE SHADER's NORMAL MATRIX
+        irr::core::matrix4 NormalMatrix = WorldMatrix;
+        /* We calculate the Normal Matrix here using the 'World' Matrix (this is a meshes transformation
+            matrix). To convert this to a normal matrix what I do is remove the translation part of the
+            matrix viola, the correct normal matrix. */
+            // Remove Translation from the World Matrix
+            NormalMatrix.setTranslation(irr::core::vector3df(0.0f, 0.0f, 0.0f));
+        // Pass the NormalMatrix to the Shader
+        shaderConstantTable.set(pServices, ESC_NORMAL_MATRIX, NormalMatrix.pointer(), 16);
     }
 
     // PASS IRRLICHT MATERIAL PROPERTIES TO THE SHADER
@@ -1262,496 +1943,71 @@ void Game::OnSetConstants(irr::video::IMaterialRendererServices* pServices, irr:
     const irr::video::SMaterial& material = *(this->pShaderMaterial);
     /* TODO: We are going to need to pass more properties from the material, such as EMF_LIGHTING for a lighting flag
     and anything else we think could be of relevance to a shader */
-    // Set the shader variables for this material
-    irr::f32 specularPower = material.Shininess;
-
-    // Is lighting enabled?
-    int lightingEnabled = material.Lighting;
-    // Is lighting enabled?
-    int zWriteEnabled = material.ZWriteEnable;
-    // Get the material Type Param
-    float materialTypeParam = material.MaterialTypeParam;
-    // Get the material Type Param2
-    float materialTypeParam2 = material.MaterialTypeParam2;
-    // Get the material's thickness
-    float thickness = material.Thickness;
-    // Get the material's ambient color
-    irr::video::SColorf ambientMaterialColor = material.AmbientColor;
-    // Get the material's diffuse color
-    irr::video::SColorf diffuseMaterialColor = material.DiffuseColor;
-    // Get the material's specular color
-    irr::video::SColorf specularMaterialColor = material.SpecularColor;
-    // Get the material's emissive color
-    irr::video::SColorf emissiveMaterialColor = material.EmissiveColor;
-    // Set the LightingEnabled Flag for the Vertex Shader
-    pServices->setVertexShaderConstant("LightingEnabled", &lightingEnabled, 1);
-    // Set the LightingEnabled Flag for the Pixel Shader
-    pServices->setPixelShaderConstant("LightingEnabled", &lightingEnabled, 1);
-    // Set the LightingEnabled Flag for the Vertex Shader
-    pServices->setVertexShaderConstant("ZWriteEnable", &zWriteEnabled, 1);
-    // Set the LightingEnabled Flag for the Pixel Shader
-    pServices->setPixelShaderConstant("ZWriteEnable", &zWriteEnabled, 1);
-    // Set the Specular Power for the Vertex Shader
-    pServices->setVertexShaderConstant("SpecularPower", reinterpret_cast<irr::f32*>(&specularPower), 1);
-    // Set the Specular Power for the Pixel Shader
-    pServices->setPixelShaderConstant("SpecularPower", reinterpret_cast<irr::f32*>(&specularPower), 1);
-    // Set the Ambient Material Color for the Vertex Shader
-    pServices->setVertexShaderConstant("AmbientMaterialColor", reinterpret_cast<irr::f32*>(&ambientMaterialColor), 4);
-    // Set the Ambient Material Color for the Pixel Shader
-    pServices->setPixelShaderConstant("AmbientMaterialColor", reinterpret_cast<irr::f32*>(&ambientMaterialColor), 4);
-    // Set the Diffuse Material Color for the Vertex Shader
-    pServices->setVertexShaderConstant("DiffuseMaterialColor", reinterpret_cast<irr::f32*>(&diffuseMaterialColor), 4);
-    // Set the Diffuse Material Color for the Pixel Shader
-    pServices->setPixelShaderConstant("DiffuseMaterialColor", reinterpret_cast<irr::f32*>(&diffuseMaterialColor), 4);
-    // Set the Specular Material Color for the Vertex Shader
-    pServices->setVertexShaderConstant("SpecularMaterialColor", reinterpret_cast<irr::f32*>(&specularMaterialColor), 4);
-    // Set the Specular Material Color for the Pixel Shader
-    pServices->setPixelShaderConstant("SpecularMaterialColor", reinterpret_cast<irr::f32*>(&specularMaterialColor), 4);
-    // Set the Emissive Material Color for the Vertex Shader
-    pServices->setVertexShaderConstant("EmissiveMaterialColor", reinterpret_cast<irr::f32*>(&emissiveMaterialColor), 4);
-    // Set the Emissive Material Color for the Pixel Shader
-    pServices->setPixelShaderConstant("EmissiveMaterialColor", reinterpret_cast<irr::f32*>(&emissiveMaterialColor), 4);
-    // Set the MaterialTypeParam for the Vertex Shader
-    pServices->setVertexShaderConstant("MaterialTypeParam", reinterpret_cast<irr::f32*>(&materialTypeParam), 1);
-    // Set the MaterialTypeParam for the Pixel Shader
-    pServices->setPixelShaderConstant("MaterialTypeParam", reinterpret_cast<irr::f32*>(&materialTypeParam), 1);
-    // Set the MaterialTypeParam2 for the Vertex Shader
-    pServices->setVertexShaderConstant("MaterialTypeParam2", reinterpret_cast<irr::f32*>(&materialTypeParam2), 1);
-    // Set the MaterialTypeParam2 for the Pixel Shader
-    pServices->setPixelShaderConstant("MaterialTypeParam2", reinterpret_cast<irr::f32*>(&materialTypeParam2), 1);
-
-    // Assign texture IDs to variables
-    int textureNULL = -1;
-    int texture0 = 0;  // Irrlicht automatically binds 'material.getTexture(0)' to location 0
-    int texture1 = 1;  // Irrlicht automatically binds 'material.getTexture(1)' to location 1
-    int texture2 = 2;  // Irrlicht automatically binds 'material.getTexture(2)' to location 2
-    int texture3 = 3;  // Irrlicht automatically binds 'material.getTexture(3)' to location 3
-    int texture4 = 4;  // Irrlicht automatically binds 'material.getTexture(4)' to location 4
-    int texture5 = 5;  // Irrlicht automatically binds 'material.getTexture(5)' to location 5
-    int texture6 = 6;  // Irrlicht automatically binds 'material.getTexture(6)' to location 6
-    int texture7 = 7;  // Irrlicht automatically binds 'material.getTexture(7)' to location 7
+    if (shaderConstantTable.isGroupUsed(ESCG_MATERIAL) == true)
+    {
+        // Set the shader variables for this material
+        irr::f32 specularPower = material.Shininess;
+
+        // Is lighting enabled?
+        int lightingEnabled = material.Lighting;
+        // Is lighting enabled?
+        int zWriteEnabled = material.ZWriteEnable;
+        // Get the material Type Param
+        float materialTypeParam = material.MaterialTypeParam;
+        // Get the material Type Param2
+        float materialTypeParam2 = material.MaterialTypeParam2;
+        // Get the material's thickness
+        float thickness = material.Thickness;
+        // Get the material's ambient color
+        irr::video::SColorf ambientMaterialColor = material.AmbientColor;
+        // Get the material's diffuse color
+        irr::video::SColorf diffuseMaterialColor = material.DiffuseColor;
+        // Get the material's specular color
+        irr::video::SColorf specularMaterialColor = material.SpecularColor;
+        // Get the material's emissive color
+        irr::video::SColorf emissiveMaterialColor = material.EmissiveColor;
+        // Set the LightingEnabled Flag for the Shader
+        shaderConstantTable.set(pServices, ESC_LIGHTING_ENABLED, &lightingEnabled, 1);
+        // Set the LightingEnabled Flag for the Shader
+        shaderConstantTable.set(pServices, ESC_ZWRITE_ENABLE, &zWriteEnabled, 1);
+        // Set the Specular Power for the Shader
+        shaderConstantTable.set(pServices, ESC_SPECULAR_POWER, reinterpret_cast<irr::f32*>(&specularPower), 1);
+        // Set the Ambient Material Color for the Shader
+        shaderConstantTable.set(pServices, ESC_AMBIENT_MATERIAL_COLOR, reinterpret_cast<irr::f32*>(&ambientMaterialColor), 4);
+        // Set the Diffuse Material Color for the Shader
+        shaderConstantTable.set(pServices, ESC_DIFFUSE_MATERIAL_COLOR, reinterpret_cast<irr::f32*>(&diffuseMaterialColor), 4);
+        // Set the Specular Material Color for the Shader
+        shaderConstantTable.set(pServices, ESC_SPECULAR_MATERIAL_COLOR, reinterpret_cast<irr::f32*>(&specularMaterialColor), 4);
+        // Set the Emissive Material Color for the Shader
+        shaderConstantTable.set(pServices, ESC_EMISSIVE_MATERIAL_COLOR, reinterpret_cast<irr::f32*>(&emissiveMaterialColor), 4);
+        // Set the MaterialTypeParam for the Shader
+        shaderConstantTable.set(pServices, ESC_MATERIAL_TYPE_PARAM, reinterpret_cast<irr::f32*>(&materialTypeParam), 1);
+        // Set the MaterialTypeParam2 for the Shader
+        shaderConstantTable.set(pServices, ESC_MATERIAL_TYPE_PARAM2, reinterpret_cast<irr::f32*>(&materialTypeParam2), 1);
+    }
+
     /* A default compilation of irrlicht will only allow 0 - 3 texture numbers
         or a total of four textures. To change this up to a maximum of 8 textures per material
         you will need to build irrlicht with the _IRR_MATERIAL_MAX_TEXTURES_ flag set to 8.
         DirectX Model Importer: the format contrains one texture per material, this means
         that texture 0 will always be present and unless you use it otherwise will be the the diffuse map.
     *   Textures are passed by texture slot on the graphics card in HLSL and GLSL and CG*/
-    if (_IRR_MATERIAL_MAX_TEXTURES_ > 0)
-    {
-        // Is Texutre0 in use?
-        float texture0InUse = ((material.getTexture(0) == 0) ? 0.0f : 1.0f);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture0InUse", &texture0InUse, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture0InUse", &texture0InUse, 1);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture0", &texture0, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture0", &texture0, 1);
-        // Get the Texture0Matrix
-        irr::core::matrix4 Texture0Matrix = material.getTextureMatrix(0);
-        // Set the vertex shader's Texture0Matrix Matrix
-        pServices->setVertexShaderConstant("Texture0Matrix", Texture0Matrix.pointer(), 16);
-        // Set the pixel shader's Texture0Matrix Matrix
-        pServices->setPixelShaderConstant("Texture0Matrix", Texture0Matrix.pointer(), 16);
-    }
-    if (_IRR_MATERIAL_MAX_TEXTURES_ > 1)
-    {
-        // Is Texutre1 in use?
-        float texture1InUse = ((material.getTexture(1) == 0) ? 0.0f : 1.0f);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture1InUse", &texture1InUse, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture1InUse", &texture1InUse, 1);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture1", &texture1, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture1", &texture1, 1);
-        // Get the Texture1Matrix
-        irr::core::matrix4 Texture1Matrix = material.getTextureMatrix(1);
-        // Set the vertex shader's Texture1Matrix Matrix
-        pServices->setVertexShaderConstant("Texture1Matrix", Texture1Matrix.pointer(), 16);
-        // Set the pixel shader's Texture1Matrix Matrix
-        pServices->setPixelShaderConstant("Texture1Matrix", Texture1Matrix.pointer(), 16);
-    }
-    if (_IRR_MATERIAL_MAX_TEXTURES_ > 2)
-    {
-        // Is Texutre2 in use?
-        float texture2InUse = ((material.getTexture(2) == 0) ? 0.0f : 1.0f);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture2InUse", &texture2InUse, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture2InUse", &texture2InUse, 1);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture2", &texture2, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture2", &texture2, 1);
-        // Get the Texture2Matrix
-        irr::core::matrix4 Texture2Matrix = material.getTextureMatrix(2);
-        // Set the vertex shader's Texture2Matrix Matrix
-        pServices->setVertexShaderConstant("Texture2Matrix", Texture2Matrix.pointer(), 16);
-        // Set the pixel shader's Texture2Matrix Matrix
-        pServices->setPixelShaderConstant("Texture2Matrix", Texture2Matrix.pointer(), 16);
-    }
-    if (_IRR_MATERIAL_MAX_TEXTURES_ > 3)
-    {
-        // Is Texutre3 in use?
-        float texture3InUse = ((material.getTexture(3) == 0) ? 0.0f : 1.0f);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture3InUse", &texture3InUse, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture3InUse", &texture3InUse, 1);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture3", &texture3, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture3", &texture3, 1);
-        // Get the Texture3Matrix
-        irr::core::matrix4 Texture3Matrix = material.getTextureMatrix(3);
-        // Set the vertex shader's Texture3Matrix Matrix
-        pServices->setVertexShaderConstant("Texture3Matrix", Texture3Matrix.pointer(), 16);
-        // Set the pixel shader's Texture3Matrix Matrix
-        pServices->setPixelShaderConstant("Texture3Matrix", Texture3Matrix.pointer(), 16);
-    }
-    if (_IRR_MATERIAL_MAX_TEXTURES_ > 4)
-    {
-        // Is Texutre4 in use?
-        float texture4InUse = ((material.getTexture(4) == 0) ? 0.0f : 1.0f);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture4InUse", &texture4InUse, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture4InUse", &texture4InUse, 1);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture4", &texture4, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture4", &texture4, 1);
-        // Get the Texture4Matrix
-        irr::core::matrix4 Texture4Matrix = material.getTextureMatrix(4);
-        // Set the vertex shader's Texture4Matrix Matrix
-        pServices->setVertexShaderConstant("Texture4Matrix", Texture4Matrix.pointer(), 16);
-        // Set the pixel shader's Texture4Matrix Matrix
-        pServices->setPixelShaderConstant("Texture4Matrix", Texture4Matrix.pointer(), 16);
-    }
-    if (_IRR_MATERIAL_MAX_TEXTURES_ > 5)
-    {
-        // Is Texutre5 in use?
-        float texture5InUse = ((material.getTexture(5) == 0) ? 0.0f : 1.0f);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture5InUse", &texture5InUse, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture5InUse", &texture5InUse, 1);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture5", &texture5, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture5", &texture5, 1);
-        // Get the Texture5Matrix
-        irr::core::matrix4 Texture5Matrix = material.getTextureMatrix(5);
-        // Set the vertex shader's Texture5Matrix Matrix
-        pServices->setVertexShaderConstant("Texture5Matrix", Texture5Matrix.pointer(), 16);
-        // Set the pixel shader's Texture5Matrix Matrix
-        pServices->setPixelShaderConstant("Texture5Matrix", Texture5Matrix.pointer(), 16);
-    }
-    if (_IRR_MATERIAL_MAX_TEXTURES_ > 6)
-    {
-        // Is Texutre6 in use?
-        float texture6InUse = ((material.getTexture(6) == 0) ? 0.0f : 1.0f);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture6InUse", &texture6InUse, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture6InUse", &texture6InUse, 1);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture6", &texture6, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture6", &texture6, 1);
-        // Get the Texture6Matrix
-        irr::core::matrix4 Texture6Matrix = material.getTextureMatrix(6);
-        // Set the vertex shader's Texture6Matrix Matrix
-        pServices->setVertexShaderConstant("Texture6Matrix", Texture6Matrix.pointer(), 16);
-        // Set the pixel shader's Texture6Matrix Matrix
-        pServices->setPixelShaderConstant("Texture6Matrix", Texture6Matrix.pointer(), 16);
-    }
-    if (_IRR_MATERIAL_MAX_TEXTURES_ > 7)
-    {
-        // Is Texutre7 in use?
-        float texture7InUse = ((material.getTexture(7) == 0) ? 0.0f : 1.0f);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture7InUse", &texture7InUse, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture7InUse", &texture7InUse, 1);
-        // Pass the texture into the Vertex Shader
-        pServices->setVertexShaderConstant("Texture7", &texture7, 1);
-        // Pass the texture into the Pixel Shader
-        pServices->setPixelShaderConstant("Texture7", &texture7, 1);
-        // Get the Texture7Matrix
-        irr::core::matrix4 Texture7Matrix = material.getTextureMatrix(7);
-        // Set the vertex shader's Texture7Matrix Matrix
-        pServices->setVertexShaderConstant("Texture7Matrix", Texture7Matrix.pointer(), 16);
-        // Set the pixel shader's Texture7Matrix Matrix
-        pServices->setPixelShaderConstant("Texture7Matrix", Texture7Matrix.pointer(), 16);
-    }
-    // PASS LIGHTS TO THE SHADER
-    // Get Ambient Light
-    irr::video::SColorf ambientLight = this->pSceneManager->getAmbientLight();
-    // Array for the ambient light
-    float ambientLightArray[4] = {ambientLight.getRed(), ambientLight.getGreen(), ambientLight.getBlue(), ambientLight.getAlpha()};
-    // Set vertex shader's AmbientLight
-    pServices->setVertexShaderConstant("AmbientLight", reinterpret_cast<irr::f32*>(&ambientLightArray[0]), 4);
-    // Set pxiel shader's AmbientLight
-    pServices->setPixelShaderConstant("AmbientLight", reinterpret_cast<irr::f32*>(&ambientLightArray[0]), 4);
-
-    // Get the Shadow Colour
-    irr::video::SColorf shadowColour = this->pSceneManager->getShadowColor();
-    // Array for the shadow colour
-    float shadowColourArray[4] = {shadowColour.getRed(), shadowColour.getGreen(), shadowColour.getBlue(), shadowColour.getAlpha()};
-    // Set vertex shader's AmbientLight
-    pServices->setVertexShaderConstant("ShadowColor", reinterpret_cast<irr::f32*>(&shadowColourArray[0]), 4);
-    // Set pxiel shader's AmbientLight
-    pServices->setPixelShaderConstant("ShadowColor", reinterpret_cast<irr::f32*>(&shadowColourArray[0]), 4);
-
-    // 8888888888888 Work in progress - Start 888888888888888888
-        // The Fog Colour
-        irr::video::SColor fogColour;
-        // The Fog Type
-        irr::video::E_FOG_TYPE fogType; // EFT_FOG_EXP=0, EFT_FOG_LINEAR, EFT_FOG_EXP2
-        // Start of the Fog
-        float fogStart = 0.0f; // Used in Linear Fog (ignored in exponential fog)
-        // End of the Fog
-        float fogEnd = 0.0f; // Used in Linear Fog (ignored in exponential fog)
-        // Density of the Fog
-        float fogDensity = 0.0f; // Only used in Exponential Fog (ignored in linear fog)
-        // TODO: Comment me
-        bool fogPixel = false; // false for vertex based fog true for pixel fog (for the sake of our shader (pixel shader) this is irrelevant
-        // TODO: Comment me
-        bool fogRange = false; // Ignore this parameter it is not cross platform
-        // Get Information about the fog
-        this->pVideoDriver->getFog(fogColour, fogType, fogStart, fogEnd, fogDensity, fogPixel, fogRange);
-        // Array for the shadow colour
-        float fogColourArray[4] = {(float)fogColour.getRed() / 255.0f, (float)fogColour.getGreen() / 255.0f, (float)fogColour.getBlue() / 255.0f, (float)fogColour.getAlpha() / 255.0f };
-        // Set vertex shader's AmbientLight
-        pServices->setVertexShaderConstant("FogColor", reinterpret_cast<irr::f32*>(&shadowColourArray[0]), 4);
-        // Set pxiel shader's AmbientLight
-        pServices->setPixelShaderConstant("FogColor", reinterpret_cast<irr::f32*>(&shadowColourArray[0]), 4);
-        // Set the vertex shader's timer
-        pServices->setVertexShaderConstant("FogStart", reinterpret_cast<irr::f32*>(&fogStart), 1);
-        // Set the pixel shader's timer
-        pServices->setPixelShaderConstant("FogStart", reinterpret_cast<irr::f32*>(&fogStart), 1);
-        // Set the vertex shader's timer
-        pServices->setVertexShaderConstant("FogEnd", reinterpret_cast<irr::f32*>(&fogEnd), 1);
-        // Set the pixel shader's timer
-        pServices->setPixelShaderConstant("FogEnd", reinterpret_cast<irr::f32*>(&fogEnd), 1);
-        // Set the vertex shader's timer
-        pServices->setVertexShaderConstant("FogDensity", reinterpret_cast<irr::f32*>(&fogDensity), 1);
-        // Set the pixel shader's timer
-        pServices->setPixelShaderConstant("FogDensity", reinterpret_cast<irr::f32*>(&fogDensity), 1);
-    // 8888888888888 Work in progress - End 888888888888888888
-
-    // DO DIRECTIONAL LIGHTS
-    // Get the DirectionalLightCount
-    int directionalLightCount = this->directionalLights.size();
-    // Set Directional Light Count for the Vertex Shader
-    pServices->setVertexShaderConstant("DirectionalLightCount", &directionalLightCount, 1);
-    // Set Directional Light Count for the Pixel Shader
-    pServices->setPixelShaderConstant("DirectionalLightCount", &directionalLightCount, 1);
-    // Make a container for the DirectionalLightDirections
-    float DirectionalLightDirectionArray[3 * 25];
-    // Make a container for the DirectionalLightColor
-    float DirectionalLightColorArray[3 * 25];
-    // Make the list of point lights for the scene node
-    for (int i = 0; i < directionalLightCount; i++)
+    for (irr::u32 i = 0; i < _IRR_MATERIAL_MAX_TEXTURES_ && i < 8; i++)
     {
-        // Get a light from the list
-        irr::scene::ILightSceneNode* pLightSceneNode = this->directionalLights.at(i);
-        irr::core::matrix4 matrix = pLightSceneNode->getAbsoluteTransformation();
-        irr::core::vector3df directionVector = irr::core::vector3df(0.0f, 0.0f, 1.0f);
-        matrix.rotateVect(directionVector);
-        // Build DirectionalLightDirectionArray
-        DirectionalLightDirectionArray[3 * i + 0] = directionVector.X;
-        DirectionalLightDirectionArray[3 * i + 1] = directionVector.Y;
-        DirectionalLightDirectionArray[3 * i + 2] = directionVector.Z;
-        // Build DirectionalLightColorArray
-        DirectionalLightColorArray[3 * i + 0] = pLightSceneNode->getLightData().DiffuseColor.r;
-        DirectionalLightColorArray[3 * i + 1] = pLightSceneNode->getLightData().DiffuseColor.g;
-        DirectionalLightColorArray[3 * i + 2] = pLightSceneNode->getLightData().DiffuseColor.b;
+        // Skip the slots the shader does not use
+        if (shaderConstantTable.isGroupUsed((E_SHADER_CONSTANT_GROUP)(ESCG_TEXTURE0 + i)) == false)
+            continue;
+        // Is the Texture in use?
+        float textureInUse = ((material.getTexture(i) == 0) ? 0.0f : 1.0f);
+        // Pass the flag into the Shader
+        shaderConstantTable.set(pServices, ShaderConstantTable::getTextureConstant(ESC_TEXTURE0_IN_USE, i), &textureInUse, 1);
+        // Irrlicht automatically binds 'material.getTexture(i)' to location i
+        irr::s32 textureSlot = (irr::s32)i;
+        // Pass the texture into the Shader
+        shaderConstantTable.set(pServices, ShaderConstantTable::getTextureConstant(ESC_TEXTURE0, i), &textureSlot, 1);
+        // Set the shader's Texture Matrix
+        shaderConstantTable.set(pServices, ShaderConstantTable::getTextureConstant(ESC_TEXTURE0_MATRIX, i), material.getTextureMatrix(i).pointer(), 16);
     }
-    // Set the vertex Shader's Point Light Positions
-    pServices->setVertexShaderConstant("DirectionalLightDirection[0]", reinterpret_cast<irr::f32*>(&DirectionalLightDirectionArray[0]), directionalLightCount * 3);
-    // Set the pixel Shader's Point Light Positions
-    pServices->setPixelShaderConstant("DirectionalLightDirection[0]", reinterpret_cast<irr::f32*>(&DirectionalLightDirectionArray[0]), directionalLightCount * 3);
-    // Set the vertex Shader's Point Light Positions
-    pServices->setVertexShaderConstant("DirectionalLightColor[0]", reinterpret_cast<irr::f32*>(&DirectionalLightColorArray[0]), directionalLightCount * 3);
-    // Set the pixel Shader's Point Light Positions
-    pServices->setPixelShaderConstant("DirectionalLightColor[0]", reinterpret_cast<irr::f32*>(&DirectionalLightColorArray[0]), directionalLightCount * 3);
-    // DO POINT LIGHTS
-    // Get the PointLightCount
-    int pointLightCount = this->pointLights.size();
-    // Set Point Light Count for the Vertex Shader
-    pServices->setVertexShaderConstant("PointLightCount", &pointLightCount, 1);
-    // Set Point Light Count for the Pixel Shader
-    pServices->setPixelShaderConstant("PointLightCount", &pointLightCount, 1);
-    // Make a container for the PointLightPositions
-    float PointLightPositionArray[3 * 50];
-    // Make a container for the PointLight DiffuseColors
-    float PointLightDiffuseArray [3 * 50];
-    // Make a container for the PointLightAttenuation
-    float PointLightAttenuationArray[3 * 50];
-    // Make the list of point lights for the scene node
-    for (int i = 0; i < pointLightCount; i++)
-    {
-        // Get a light from the list
-        irr::scene::ILightSceneNode* pLightSceneNode = this->pointLights.at(i);
-        // Build the PointLightPositionArray
-        PointLightPositionArray[3 * i + 0] = pLightSceneNode->getPosition().X;
-        PointLightPositionArray[3 * i + 1] = pLightSceneNode->getPosition().Y;
-        PointLightPositionArray[3 * i + 2] = pLightSceneNode->getPosition().Z;
-        //PointLightPositionArray[4 * i + 3] = 1.0f;
-        //std::cout << "LightPosition" << "(" << PointLightPositionArray[4 * i + 0] << ", " << PointLightPositionArray[4 * i + 1] << ", " << PointLightPositionArray[4 * i + 2] << std::endl;
-        //// Build the PointAmbientLightArray
-        //PointLightAmbientArray[4 * i + 0] = pLightSceneNode->getLightData().AmbientColor.r;
-        //PointLightAmbientArray[4 * i + 1] = pLightSceneNode->getLightData().AmbientColor.g;
-        //PointLightAmbientArray[4 * i + 2] = pLightSceneNode->getLightData().AmbientColor.b;
-        //PointLightAmbientArray[4 * i + 3] = 1.0f;
-        //std::cout << "AmbientLight" << "(" << pPointLightAmbientArray[4 * i + 0] << ", " << pPointLightAmbientArray[4 * i + 1] << ", " << pPointLightAmbientArray[4 * i + 2] << std::endl;
-        // Build the PointLightSpecularArray
-        PointLightDiffuseArray[3 * i + 0] = pLightSceneNode->getLightData().DiffuseColor.r;
-        PointLightDiffuseArray[3 * i + 1] = pLightSceneNode->getLightData().DiffuseColor.g;
-        PointLightDiffuseArray[3 * i + 2] = pLightSceneNode->getLightData().DiffuseColor.b;
-        //PointLightDiffuseArray[4 * i + 3] = 1.0f;
-        //std::cout << "DiffuseLight" << "(" << pPointLightDiffuseArray[4 * i + 0] << ", " << pPointLightDiffuseArray[4 * i + 1] << ", " << pPointLightDiffuseArray[4 * i + 2] << std::endl;
-        //// Build the PointLightSpecularArray
-        //PointLightSpecularArray[4 * i + 0] = pLightSceneNode->getLightData().SpecularColor.r;
-        //PointLightSpecularArray[4 * i + 1] = pLightSceneNode->getLightData().SpecularColor.g;
-        //PointLightSpecularArray[4 * i + 2] = pLightSceneNode->getLightData().SpecularColor.b;
-        //PointLightSpecularArray[4 * i + 3] = 1.0f;
-        //std::cout << "SpecularLight" << "(" << pPointLightSpecularArray[4 * i + 0] << ", " << pPointLightSpecularArray[4 * i + 1] << ", " << pPointLightSpecularArray[4 * i + 2] << std::endl;\
-        // Build the Attenuation Array
-        PointLightAttenuationArray[3 * i + 0] = pLightSceneNode->getLightData().Attenuation.X; // Constant Attenuation
-        PointLightAttenuationArray[3 * i + 1] = pLightSceneNode->getLightData().Attenuation.Y; // Linear Attenuation
-        PointLightAttenuationArray[3 * i + 2] = pLightSceneNode->getLightData().Attenuation.Z; // Quadratic Attenuation
-    }
-    // Set the vertex Shader's Point Light Positions
-    pServices->setVertexShaderConstant("PointLightPosition[0]", reinterpret_cast<irr::f32*>(&PointLightPositionArray[0]), pointLightCount * 3);
-    // Set the pixel Shader's Point Light Positions
-    pServices->setPixelShaderConstant("PointLightPosition[0]", reinterpret_cast<irr::f32*>(&PointLightPositionArray[0]), pointLightCount * 3);
-    //// Set the vertex Shader's Point Light Ambient Colors
-    //pServices->setVertexShaderConstant("PointLightAmbientColor[0]", reinterpret_cast<irr::f32*>(&PointLightAmbientArray[0]), pointLightCount * 4);
-    //// Set the pixel Shader's Point Light Positions
-    //pServices->setPixelShaderConstant("PointLightAmbientColor[0]", reinterpret_cast<irr::f32*>(&PointLightAmbientArray[0]), pointLightCount * 4);
-    // Set the vertex Shader's Point Light Diffuse Colors
-    pServices->setVertexShaderConstant("PointLightDiffuseColor[0]", reinterpret_cast<irr::f32*>(&PointLightDiffuseArray[0]), pointLightCount * 3);
-    // Set the pixel Shader's Point Light Positions
-    pServices->setPixelShaderConstant("PointLightDiffuseColor[0]", reinterpret_cast<irr::f32*>(&PointLightDiffuseArray[0]), pointLightCount * 3);
-    //// Set the vertex Shader's Point Light Specular Colors
-    //pServices->setVertexShaderConstant("PointLightSpecularColor[0]", reinterpret_cast<irr::f32*>(&PointLightSpecularArray[0]), pointLightCount * 4);
-    //// Set the pixel Shader's Point Light Specular Colors
-    //pServices->setPixelShaderConstant("PointLightSpecularColor[0]", reinterpret_cast<irr::f32*>(&PointLightSpecularArray[0]), pointLightCount * 4);
-    // Set the vertex Shader's Point Light Specular Colors
-    pServices->setVertexShaderConstant("PointLightAttenuation[0]", reinterpret_cast<irr::f32*>(&PointLightAttenuationArray[0]), pointLightCount * 3);
-    // Set the pixel Shader's Point Light Specular Colors
-    pServices->setPixelShaderConstant("PointLightAttenuation[0]", reinterpret_cast<irr::f32*>(&PointLightAttenuationArray[0]), pointLightCount * 3);
-    // DO SPOT LIGHTS
-    // Get the SpotLightCount
-    int spotLightCount = this->spotLights.size();
-    //std::cout << "spotLightCount: " << spotLightCount << std::endl;
-    // Set Spot Light Count for the Vertex Shader
-    pServices->setVertexShaderConstant("SpotLightCount", &spotLightCount, 1);
-    // Set Spot Light Count for the Pixel Shader
-    pServices->setPixelShaderConstant("SpotLightCount", &spotLightCount, 1);
-    // Make a container for the SpotLightPositions
-    float SpotLightPositionArray[3 * 25];
-    // Make a container for the SpotLightDirections
-    float SpotLightDirectionArray[3 * 25];
-    //// Make a container for the SpotLightAmbientColors
-    //float SpotLightAmbientArray[4 * 25];
-    // Make a container for the SpotLightDiffuseColors
-    float SpotLightDiffuseArray[3 * 25];
-    //// Make a container for the SpotLightSpecularColors
-    //float SpotLightSpecularArray[4 * 25];
-    // Make a container for the SpotLightAttenuations
-    float SpotLightAttenuationArray[3 * 25];
-    // Make a container for the Inner Cones
-    float SpotLightInnerCone[25];
-    // Make a container for the Outer Cones
-    float SpotLightOuterCone[25];
-    // Make a container for the Falloffs
-    float SpotLightFalloff[25];
-    //std::cout << "spotLightCount: " << spotLightCount << std::endl;
-    // Make the list of spot lights for the scene node
-    for (int i = 0; i < spotLightCount; i++)
-    {
-        irr::scene::ILightSceneNode* pLightSceneNode = this->spotLights.at(i);
-        // Build the SpotLightPositionArray
-        SpotLightPositionArray[i * 3 + 0] = pLightSceneNode->getPosition().X;
-        SpotLightPositionArray[i * 3 + 1] = pLightSceneNode->getPosition().Y;
-        SpotLightPositionArray[i * 3 + 2] = pLightSceneNode->getPosition().Z;
-        // Build the SpotLightDirectionArray
-        irr::core::matrix4 matrix = pLightSceneNode->getAbsoluteTransformation();
-        irr::core::vector3df directionVector = irr::core::vector3df(0.0f, 0.0f, 1.0f);
-        matrix.rotateVect(directionVector);
-        SpotLightDirectionArray[i * 3 + 0] = directionVector.X;
-        SpotLightDirectionArray[i * 3 + 1] = directionVector.Y;
-        SpotLightDirectionArray[i * 3 + 2] = directionVector.Z;
-        //// Build the SpotAmbientLightArray
-        //SpotLightAmbientArray[4 * i + 0] = pLightSceneNode->getLightData().AmbientColor.r;
-        //SpotLightAmbientArray[4 * i + 1] = pLightSceneNode->getLightData().AmbientColor.g;
-        //SpotLightAmbientArray[4 * i + 2] = pLightSceneNode->getLightData().AmbientColor.b;
-        //SpotLightAmbientArray[4 * i + 3] = 1.0f;
-        // Build the SpotLightSpecularArray
-        SpotLightDiffuseArray[3 * i + 0] = pLightSceneNode->getLightData().DiffuseColor.r;
-        SpotLightDiffuseArray[3 * i + 1] = pLightSceneNode->getLightData().DiffuseColor.g;
-        SpotLightDiffuseArray[3 * i + 2] = pLightSceneNode->getLightData().DiffuseColor.b;
-        //// Build the SpotLightSpecularArray
-        //SpotLightSpecularArray[4 * i + 0] = pLightSceneNode->getLightData().SpecularColor.r;
-        //SpotLightSpecularArray[4 * i + 1] = pLightSceneNode->getLightData().SpecularColor.g;
-        //SpotLightSpecularArray[4 * i + 2] = pLightSceneNode->getLightData().SpecularColor.b;
-        //SpotLightSpecularArray[4 * i + 3] = 1.0f;
-        // Build the Attenuation Array
-        SpotLightAttenuationArray[3 * i + 0] = pLightSceneNode->getLightData().Attenuation.X; // Constant Attenuation
-        SpotLightAttenuationArray[3 * i + 1] = pLightSceneNode->getLightData().Attenuation.Y; // Linear Attenuation
-        SpotLightAttenuationArray[3 * i + 2] = pLightSceneNode->getLightData().Attenuation.Z; // Quadratic Attenuation
-        // Build the InnerConeArray
-        SpotLightInnerCone[i] = pLightSceneNode->getLightData().InnerCone * M_PI / 180.0f;
-        // Build the OuterConeArray
-        SpotLightOuterCone[i] = pLightSceneNode->getLightData().OuterCone * M_PI / 180.0f;
-        // Build the FalloffArray
-        SpotLightFalloff[i] = pLightSceneNode->getLightData().Falloff;
-    }
-    // Set the vertex Shader's Spot Light Positions
-    pServices->setVertexShaderConstant("SpotLightPosition[0]", reinterpret_cast<irr::f32*>(&SpotLightPositionArray[0]), spotLightCount * 3);
-    // Set the pixel Shader's Spot Light Positions
-    pServices->setPixelShaderConstant("SpotLightPosition[0]", reinterpret_cast<irr::f32*>(&SpotLightPositionArray[0]), spotLightCount * 3);
-    // Set the vertex Shader's Spot Light Directions
-    pServices->setVertexShaderConstant("SpotLightDirection[0]", reinterpret_cast<irr::f32*>(&SpotLightDirectionArray[0]), spotLightCount * 3);
-    // Set the pixel Shader's Spot Light Directions
-    pServices->setPixelShaderConstant("SpotLightDirection[0]", reinterpret_cast<irr::f32*>(&SpotLightDirectionArray[0]), spotLightCount * 3);
-//            // Set the vertex Shader's Spot Light Ambient Colors
-//            pServices->setVertexShaderConstant("SpotLightAmbientColor[0]", reinterpret_cast<irr::f32*>(&SpotLightAmbientArray[0]), spotLightCount * 4);
-//            // Set the pixel Shader's Spot Light Positions
-//            pServices->setPixelShaderConstant("SpotLightAmbientColor[0]", reinterpret_cast<irr::f32*>(&SpotLightAmbientArray[0]), spotLightCount * 4);
-    // Set the vertex Shader's Spot Light Diffuse Colors
-    pServices->setVertexShaderConstant("SpotLightDiffuseColor[0]", reinterpret_cast<irr::f32*>(&SpotLightDiffuseArray[0]), spotLightCount * 3);
-    // Set the pixel Shader's Spot Light Positions
-    pServices->setPixelShaderConstant("SpotLightDiffuseColor[0]", reinterpret_cast<irr::f32*>(&SpotLightDiffuseArray[0]), spotLightCount * 3);
-//            // Set the vertex Shader's Spot Light Specular Colors
-//            pServices->setVertexShaderConstant("SpotLightSpecularColor[0]", reinterpret_cast<irr::f32*>(&SpotLightSpecularArray[0]), spotLightCount * 4);
-//            // Set the pixel Shader's Spot Light Specular Colors
-//            pServices->setPixelShaderConstant("SpotLightSpecularColor[0]", reinterpret_cast<irr::f32*>(&SpotLightSpecularArray[0]), spotLightCount * 4);
-    //bool results = false;
-    // Set the vertex Shader's Spot Light Specular Colors
-    pServices->setVertexShaderConstant("SpotLightAttenuation[0]", reinterpret_cast<irr::f32*>(&SpotLightAttenuationArray[0]), spotLightCount * 3);
-    //std::cout << ((results == true) ? "TRUE" : "FALSE") << std::endl;
-    // Set the pixel Shader's Spot Light Specular Colors
-    pServices->setPixelShaderConstant("SpotLightAttenuation[0]", reinterpret_cast<irr::f32*>(&SpotLightAttenuationArray[0]), spotLightCount * 3);
-    // Set the vertex shader's Spot Light Inner Cones
-    pServices->setVertexShaderConstant("SpotLightInnerCone[0]", reinterpret_cast<irr::f32*>(&SpotLightInnerCone[0]), spotLightCount);
-    // Set the pixel shader's Spot Light Inner Cones
-    pServices->setPixelShaderConstant("SpotLightInnerCone[0]", reinterpret_cast<irr::f32*>(&SpotLightInnerCone[0]), spotLightCount);
-    // Set the vertex shader's Spot Light Outer Cones
-    pServices->setVertexShaderConstant("SpotLightOuterCone[0]", reinterpret_cast<irr::f32*>(&SpotLightOuterCone[0]), spotLightCount);
-    // Set the pixel shader's Spot Light Outer Cones
-    pServices->setPixelShaderConstant("SpotLightOuterCone[0]", reinterpret_cast<irr::f32*>(&SpotLightOuterCone[0]), spotLightCount);
-    // Set the vertex shader's Spot Light Falloffs
-    pServices->setVertexShaderConstant("SpotLightFalloff[0]", reinterpret_cast<irr::f32*>(&SpotLightFalloff[0]), spotLightCount);
-    // Set the pixel shader's Spot Light Falloffs
-    pServices->setPixelShaderConstant("SpotLightFalloff[0]", reinterpret_cast<irr::f32*>(&SpotLightFalloff[0]), spotLightCount);
 }
 
 void Game::mouseGUIEvent(const irr::SEvent& event)
@@ -1800,12 +2056,25 @@ void Game::keyboardEvent(const irr::SEvent& event)
                 this->pIrrlichtDevice->closeDevice();
                 break;
             }
+            case irr::KEY_F3:
+            {
+                this->profiler.toggleOverlay();
+                break;
+            }
+            case irr::KEY_F11:
+            {
+                // Start or stop capturing a sequence of frames
+                if (this->frameCapture.isCapturing() == true)
+                    this->frameCapture.stopSequence();
+                else
+                    this->frameCapture.startSequence(this->captureFrameCount);
+                break;
+            }
             case irr::KEY_F12:
             {
-                irr::video::IImage* pScreenshot = this->pVideoDriver->createScreenShot();
-                if (this->pVideoDriver->writeImageToFile(pScreenshot, "screenShots/screenshot.bmp") == false)
-                    std::cout << "Unable to save screenshot" << std::endl;
-                pScreenshot->drop();
+                // Capture the next frame drawn (it is written on a background thread)
+                this->frameCapture.requestFrame();
+                break;
             }
             default:
             {
@@ -1818,52 +2087,55 @@ void Game::keyboardEvent(const irr::SEvent& event)
 void Game::OnPreRender(irr::core::array<irr::scene::ISceneNode*>& lightList)
 {
     /* NOTES:
-        - Can use this callback to exclude lights that are a certain distance away from the camera
-        - This is where I should search some form of quadtree datastructure to exlude certain lights
-        - Only add lights to the list if they are visible
+        - The light index (a loose octree of light ranges) is refitted for the lights that moved
+        - Only the lights whose range reaches the camera's frustum are kept for this frame
     */
-    // Ambient Light Magnitude
-    float ambientLightMagnitude = sqrt(this->pIrrlichtDevice->getSceneManager()->getAmbientLight().r * this->pIrrlichtDevice->getSceneManager()->getAmbientLight().r + this->pIrrlichtDevice->getSceneManager()->getAmbientLight().g * this->pIrrlichtDevice->getSceneManager()->getAmbientLight().g + this->pIrrlichtDevice->getSceneManager()->getAmbientLight().b * this->pIrrlichtDevice->getSceneManager()->getAmbientLight().b);
-    // Clear the list of directional lights
-    this->directionalLights.clear();
+    // Trace the light list setup
+    TraceScope traceScope(&this->traceRecorder, "OnPreRender", "light", 0, 0, "lights", (int)lightList.size());
+    // Bring the light index up to date (only moved lights are refitted)
+    this->lightIndex.update(lightList);
+    // Directional lights reach everything
+    this->directionalLights = this->lightIndex.getDirectionalLights();
     // Clear the list of point lights
     this->pointLights.clear();
     // Clear the list of spot lights
     this->spotLights.clear();
+    // Forget where last frame's lights were packed
+    for (size_t i = 0; i < this->visibleLightIDs.size(); i++)
+        if (this->visibleLightIDs[i] < this->lightSlots.size())
+            this->lightSlots[this->visibleLightIDs[i]] = -1;
+    this->visibleLightIDs.clear();
+    this->lightSlots.resize(this->lightIndex.getCapacity(), -1);
     // Grab the Camera
     irr::scene::ICameraSceneNode* pCamera = this->pIrrlichtDevice->getSceneManager()->getActiveCamera();
     // There must be a camera
-    if (pCamera == 0) return;
-    // TODO: Only include lights which are infront of the Camera (that is visible to the cameras Frustrum
-    // Build the list of light sources
-    for (int i = 0; i < lightList.size(); i++)
+    if (pCamera != 0)
     {
-        // Grab a light
-        irr::scene::ILightSceneNode* pLightSceneNode = (irr::scene::ILightSceneNode*)lightList[i];
-        // Now lets build lists of lights based on type
-        switch (pLightSceneNode->getLightType())
+        // Find the lights whose range reaches the camera's frustum
+        this->lightIndex.queryFrustum(*pCamera->getViewFrustum(), this->visibleLightIDs);
+        // Now lets build lists of lights based on type (remembering where each is packed)
+        for (size_t i = 0; i < this->visibleLightIDs.size(); i++)
         {
-            case irr::video::ELT_DIRECTIONAL:
-            {
-                this->directionalLights.push_back(pLightSceneNode);
-                break;
-            }
-            case irr::video::ELT_POINT:
-            {
-                this->pointLights.push_back(pLightSceneNode);
-                break;
-            }
-            case irr::video::ELT_SPOT:
+            irr::u32 id = this->visibleLightIDs[i];
+            irr::scene::ILightSceneNode* pLightSceneNode = this->lightIndex.getLight(id);
+            if (pLightSceneNode->getLightType() == irr::video::ELT_SPOT)
             {
+                this->lightSlots[id] = (irr::s32)this->spotLights.size();
                 this->spotLights.push_back(pLightSceneNode);
-                break;
             }
-            default:
+            else
             {
-                break;
+                this->lightSlots[id] = (irr::s32)this->pointLights.size();
+                this->pointLights.push_back(pLightSceneNode);
             }
         }
     }
+    // Compute the shader constants which are the same for every node this frame
+    this->shaderFrameConstants.update(this->pVideoDriver, this->pSceneManager, (irr::f32)this->pIrrlichtDevice->getTimer()->getTime() / 1000.0f,
+                                      this->directionalLights, this->pointLights, this->spotLights);
+    // Bin this frame's lights into the cluster grid read by the clustered Phong shader
+    if (this->clusteredLightingEnabled == true)
+        this->clusteredLighting.update(this->shaderFrameConstants);
 }
 
 void Game::OnPostRender()
@@ -1873,67 +2145,298 @@ void Game::OnPostRender()
 
 void Game::OnRenderPassPreRender(irr::scene::E_SCENE_NODE_RENDER_PASS renderPass)
 {
-    // Nothing needs to be done for each pass
+    // Nothing needs to be done for each pass (other than tracing it)
+    this->traceRecorder.beginEvent(Game::getRenderPassName(renderPass), "pass");
 }
 
 void Game::OnRenderPassPostRender(irr::scene::E_SCENE_NODE_RENDER_PASS renderPass)
 {
-    // Nothing needs to be done after each pass
+    // Nothing needs to be done after each pass (other than tracing it)
+    this->traceRecorder.endEvent(Game::getRenderPassName(renderPass), "pass");
 }
 
 void Game::OnNodePreRender(irr::scene::ISceneNode* node)
 {
-    /* NOTES: Produce a list of lights within distance of this node and
-        Find lights within boundaries of the camera (if this wasn't done in the
-        'virtual void OnPreRender(irr::core::array<irr::scene::ISceneNode*>& lightList)' callback
-
-        VERY IMPORTANT: The list is passed to the shader!!!
-        */
-
-    // 88888 As a test lets just pass in all the lights work in progress as I'd like to do some culling
-
-    // Make the list of directional lights for the scene node
-    for (std::vector<irr::scene::ILightSceneNode*>::iterator i = this->directionalLights.begin(); i != this->directionalLights.end(); i++)
+    /* NOTES: Produce a list of lights within distance of this node, the lists
+        are what OnSetConstants passes to the shader.
+        Directional lights reach everything so they are not selected per node */
+
+    // Keep track of the node so shader uploads can be traced against it
+    this->pCurrentNode = node;
+    this->traceRecorder.beginEvent(Game::getTraceNodeName(node), "node");
+    // The render queue calls back for each of its children as it draws them
+    if (node == this->pRenderQueue)
+        return;
+
+    // The node's bounding sphere in world space
+    irr::core::aabbox3df box = node->getTransformedBoundingBox();
+    irr::core::vector3df center = box.getCenter();
+    irr::f32 radius = box.getExtent().getLength() * 0.5f;
+    // Ask the light index for the lights reaching the sphere and keep those packed this frame
+    this->lightIndex.querySphere(center, radius, this->nodeLightIDs);
+    this->nodePointCandidates.clear();
+    this->nodeSpotCandidates.clear();
+    for (size_t i = 0; i < this->nodeLightIDs.size(); i++)
     {
-        irr::scene::ILightSceneNode* pLightSceneNode = *i;
-        this->tempDirectionalLights.push_back(pLightSceneNode);
+        irr::u32 id = this->nodeLightIDs[i];
+        if (id >= this->lightSlots.size() || this->lightSlots[id] == -1)
+            continue;
+        if (this->lightIndex.getLight(id)->getLightType() == irr::video::ELT_SPOT)
+            this->nodeSpotCandidates.push_back((irr::u32)this->lightSlots[id]);
+        else
+            this->nodePointCandidates.push_back((irr::u32)this->lightSlots[id]);
     }
-    // Make the list of point lights for the scene node
-    for (std::vector<irr::scene::ILightSceneNode*>::iterator i = this->pointLights.begin(); i != this->pointLights.end(); i++)
+    // Select the strongest of them
+    this->lightSelector.select(center, radius, this->shaderFrameConstants.getPointLights(), this->nodePointCandidates, this->nodePointLights);
+    this->lightSelector.select(center, radius, this->shaderFrameConstants.getSpotLights(), this->nodeSpotCandidates, this->nodeSpotLights);
+    // Draw the node with the shader variant for its materials and lights
+    this->selectShaderPermutation(node);
+}
+
+void Game::selectShaderPermutation(irr::scene::ISceneNode* node)
+{
+    /* NOTES: The feature key comes from the material's state (its first texture, lighting flag and
+        fog flag) and the lights reaching the node, so the program drawing it has no branches on
+        them. Instanced nodes add INSTANCED and are only drawn in batches when every one of their
+        materials has an instanced variant. Nodes whose mesh is skinned on the GPU add SKINNED (their
+        vertices stay in the bind pose). Variants are compiled the first time they are needed */
+
+    // Features from the lights
+    irr::u32 lightFeatures = 0;
+    if (this->shaderFrameConstants.getDirectionalLightCount() > 0)
+        lightFeatures |= (1u << ESF_DIRECTIONAL_LIGHTS);
+    if (this->nodePointLights.empty() == false)
+        lightFeatures |= (1u << ESF_POINT_LIGHTS);
+    if (this->nodeSpotLights.empty() == false)
+        lightFeatures |= (1u << ESF_SPOT_LIGHTS);
+    irr::u32 lightCount = irr::core::max_((irr::u32)this->nodePointLights.size(), (irr::u32)this->nodeSpotLights.size());
+    // The fog mode
+    irr::u32 fogFeature = (1u << ESF_FOG_EXP);
+    if (this->shaderFrameConstants.getFogType() == irr::video::EFT_FOG_LINEAR)
+        fogFeature = (1u << ESF_FOG_LINEAR);
+    else if (this->shaderFrameConstants.getFogType() == irr::video::EFT_FOG_EXP2)
+        fogFeature = (1u << ESF_FOG_EXP2);
+    // Instanced nodes are drawn in batches if every material's shader can place the instances
+    InstancedMeshSceneNode* pInstancedNode = (node->getType() == InstancedMeshSceneNode::NODE_TYPE) ? static_cast<InstancedMeshSceneNode*>(node) : 0;
+    bool instancing = (pInstancedNode != 0);
+    // Nodes whose mesh is skinned on the GPU
+    bool skinned = this->gpuSkinning.isSkinned(node);
+    for (irr::u32 i = 0; i < node->getMaterialCount() && instancing == true; i++)
     {
-        irr::scene::ILightSceneNode* pLightSceneNode = *i;
-        this->tempPointLights.push_back(pLightSceneNode);
+        irr::u32 materialType = (irr::u32)node->getMaterial(i).MaterialType;
+        if (materialType >= this->materialPermutations.size() || this->materialPermutations[materialType] == -1)
+            instancing = false;
+        else if ((this->shaderPermutations[this->materialPermutations[materialType]].getSupportedFeatures() & (1u << ESF_INSTANCED)) == 0)
+            instancing = false;
     }
-    // Make the list of spot lights for the scene node
-    for (std::vector<irr::scene::ILightSceneNode*>::iterator i = this->spotLights.begin(); i != this->spotLights.end(); i++)
+
+    for (irr::u32 i = 0; i < node->getMaterialCount(); i++)
     {
-        irr::scene::ILightSceneNode* pLightSceneNode = *i;
-        this->tempSpotLights.push_back(pLightSceneNode);
+        irr::video::SMaterial& material = node->getMaterial(i);
+        irr::u32 materialType = (irr::u32)material.MaterialType;
+        // Materials drawn with other shaders are left alone
+        if (materialType >= this->materialPermutations.size() || this->materialPermutations[materialType] == -1)
+            continue;
+        // Features from the material
+        irr::u32 features = lightFeatures;
+        if (material.getTexture(0) != 0)
+            features |= (1u << ESF_TEXTURED);
+        if (material.Lighting == true)
+            features |= (1u << ESF_LIT);
+        if (material.FogEnable == true)
+            features |= fogFeature;
+        if (instancing == true)
+            features |= (1u << ESF_INSTANCED);
+        if (skinned == true)
+            features |= (1u << ESF_SKINNED);
+        // Keep the current variant if the right one cannot be built
+        irr::s32 variant = this->getShaderVariant((irr::u32)this->materialPermutations[materialType], features, lightCount);
+        // A skinned node must stay on a skinned variant, so fall back to the one built by initShaders
+        if (variant == -1 && skinned == true)
+            variant = this->getShaderVariant((irr::u32)this->materialPermutations[materialType], ShaderPermutations::DEFAULT_FEATURES | (1u << ESF_SKINNED), 0);
+        if (variant != -1)
+            material.MaterialType = (irr::video::E_MATERIAL_TYPE)variant;
+        else if (instancing == true)
+            instancing = false;
     }
-    // 88888
+    // Otherwise each instance is drawn on its own
+    if (pInstancedNode != 0)
+        pInstancedNode->setInstancing(instancing);
 }
 
 void Game::OnNodePostRender(irr::scene::ISceneNode* node)
 {
     // Clear the list of lights used when rendering this scene node
-    this->tempDirectionalLights.clear();
-    this->tempPointLights.clear();
-    this->tempSpotLights.clear();
+    this->nodePointLights.clear();
+    this->nodeSpotLights.clear();
+    // The node's joints move before it is drawn again
+    this->gpuSkinning.reset();
+    // The node has been drawn
+    this->traceRecorder.endEvent(Game::getTraceNodeName(node), "node");
+    this->pCurrentNode = 0;
 }
 
-irr::s32 Game::loadShader(std::string vertexShader, std::string fragmentShader)
+const char* Game::getRenderPassName(irr::scene::E_SCENE_NODE_RENDER_PASS renderPass)
 {
-    // Load a shader
-    irr::s32 shaderHandle = pGPUProgrammingServices->addHighLevelShaderMaterialFromFiles(vertexShader.c_str(), "main", irr::video::EVST_VS_1_1,
-                                                                                            fragmentShader.c_str(), "main", irr::video::EPST_PS_1_1,
-                                                                                            this, irr::video::EMT_SOLID, irr::video::EGSL_DEFAULT);
+    switch (renderPass)
+    {
+        case irr::scene::ESNRP_CAMERA: return "CameraPass";
+        case irr::scene::ESNRP_LIGHT: return "LightPass";
+        case irr::scene::ESNRP_SKY_BOX: return "SkyBoxPass";
+        case irr::scene::ESNRP_SOLID: return "SolidPass";
+        case irr::scene::ESNRP_TRANSPARENT: return "TransparentPass";
+        case irr::scene::ESNRP_TRANSPARENT_EFFECT: return "TransparentEffectPass";
+        case irr::scene::ESNRP_SHADOW: return "ShadowPass";
+        default: return "Pass";
+    }
+}
+
+const char* Game::getTraceNodeName(irr::scene::ISceneNode* pNode)
+{
+    // Unnamed nodes are still traced so that they show up as hitches
+    if (pNode == 0)
+        return "";
+    if (pNode->getName() == 0 || pNode->getName()[0] == '\0')
+        return "Unnamed Node";
+    return pNode->getName();
+}
+
+irr::s32 Game::loadShader(std::string vertexShader, std::string fragmentShader, irr::u32 features)
+{
+    /* NOTES: The stages are read here and kept so that variants can be compiled from memory with
+        defines after each stage's #version line. A variant is built for a feature key (textured,
+        lit, the light types present and the fog mode) and a light capacity, and OnNodePreRender
+        switches each node's materials to the variant for their state (see selectShaderPermutation).
+        The variant for the feature key asked for (with the smallest light capacity) is built now
+        and its material type returned */
+
+    // Read both stages
+    std::string vertexSource;
+    std::string fragmentSource;
+    if (this->readTextFile(vertexShader, vertexSource) == false || this->readTextFile(fragmentShader, fragmentSource) == false)
+    {
+        // Send Error Message to the console
+        LogMessage(ELS_ERROR) << "Unable to load " << vertexShader << " " << fragmentShader;
+        return -1;
+    }
+    // Keep the sources for the variants
+    ShaderPermutations shaderPermutations;
+    shaderPermutations.setSource(vertexShader, fragmentShader, vertexSource, fragmentSource);
+    irr::u32 shaderIndex = (irr::u32)this->shaderPermutations.size();
+    this->shaderPermutations.push_back(shaderPermutations);
+
+    // Build the first variant
+    irr::s32 shaderHandle = this->getShaderVariant(shaderIndex, features, 0);
     // If there was a problem send an error to the log
     if (shaderHandle == -1)
     {
         // Send Error Message to the console
-        std::cout << "ERROR: Unable to load " << vertexShader << " " << fragmentShader << std::endl;
+        LogMessage(ELS_ERROR) << "Unable to load " << vertexShader << " " << fragmentShader;
     }
 
     // Return shader handle or -1 if error
     return shaderHandle;
 }
+
+irr::s32 Game::getShaderVariant(irr::u32 shaderIndex, irr::u32 features, irr::u32 lightCount)
+{
+    if (shaderIndex >= this->shaderPermutations.size())
+        return -1;
+    // Features the shader never tests would only make duplicate programs
+    features &= this->shaderPermutations[shaderIndex].getSupportedFeatures();
+    // Shaders without point or spot light arrays only need one capacity
+    if (this->shaderPermutations[shaderIndex].hasLightCapacities() == false)
+        lightCount = 0;
+    // Use the smallest capacity holding the lights, falling back to smaller ones if it cannot be built
+    irr::u32 lightCapacity = ShaderPermutations::getLightCapacity(lightCount);
+    for (int i = ShaderPermutations::LIGHT_CAPACITY_COUNT - 1; i >= 0; i--)
+    {
+        if (ShaderPermutations::LIGHT_CAPACITIES[i] > lightCapacity)
+            continue;
+        irr::s32 materialType = -1;
+        if (this->shaderPermutations[shaderIndex].find(features, ShaderPermutations::LIGHT_CAPACITIES[i], materialType) == false)
+            materialType = this->buildShaderVariant(shaderIndex, features, ShaderPermutations::LIGHT_CAPACITIES[i]);
+        if (materialType != -1)
+            return materialType;
+    }
+    return -1;
+}
+
+irr::s32 Game::buildShaderVariant(irr::u32 shaderIndex, irr::u32 features, irr::u32 lightCapacity)
+{
+    const ShaderPermutations& shaderPermutations = this->shaderPermutations[shaderIndex];
+    irr::u32 directionalLightCapacity = ShaderFrameConstants::MAX_DIRECTIONAL_LIGHTS;
+    std::string vertexSource = ShaderPermutations::addDefines(shaderPermutations.getVertexSource(), features, lightCapacity, directionalLightCapacity);
+    std::string fragmentSource = ShaderPermutations::addDefines(shaderPermutations.getFragmentSource(), features, lightCapacity, directionalLightCapacity);
+    // Describe the variant for the log
+    std::string variantName;
+    for (int i = 0; i < ESF_COUNT; i++)
+        if ((features & (1u << i)) != 0)
+            variantName += std::string((variantName.empty() == true) ? "" : " ") + ShaderPermutations::getFeatureName((E_SHADER_FEATURE)i);
+    if (variantName.empty() == true)
+        variantName = "no features";
+    if (shaderPermutations.hasLightCapacities() == true)
+    {
+        std::ostringstream capacity;
+        capacity << ", " << lightCapacity << " lights";
+        variantName += capacity.str();
+    }
+
+    // The userData passed back to OnSetConstants is the index of the variant's constant table
+    irr::s32 userData = (irr::s32)this->shaderConstantTables.size();
+    // Load a shader
+    irr::s32 shaderHandle = pGPUProgrammingServices->addHighLevelShaderMaterial(vertexSource.c_str(), "main", irr::video::EVST_VS_1_1,
+                                                                                fragmentSource.c_str(), "main", irr::video::EPST_PS_1_1,
+                                                                                this, irr::video::EMT_SOLID, userData, irr::video::EGSL_DEFAULT);
+    // Remember failures too so the variant is not compiled again every frame
+    this->shaderPermutations[shaderIndex].add(features, lightCapacity, shaderHandle);
+    // If there was a problem send an error to the log (a large capacity may not fit the driver's uniform limits)
+    if (shaderHandle == -1)
+    {
+        // Send Error Message to the console
+        LogMessage(ELS_ERROR) << "Unable to build " << shaderPermutations.getVertexShader() << " " << shaderPermutations.getFragmentShader() << " (" << variantName << ")";
+        return -1;
+    }
+    // Build the variant's upload plan from the uniforms its stages declare (the IDs are looked up the first time the variant is used)
+    ShaderConstantTable shaderConstantTable;
+    shaderConstantTable.parseSource(vertexSource);
+    shaderConstantTable.parseSource(fragmentSource);
+    shaderConstantTable.setLightCapacities(lightCapacity, directionalLightCapacity);
+    this->shaderConstantTables.push_back(shaderConstantTable);
+    // Remember which shader the material type is a variant of
+    if ((irr::u32)shaderHandle >= this->materialPermutations.size())
+        this->materialPermutations.resize(shaderHandle + 1, -1);
+    this->materialPermutations[shaderHandle] = (irr::s32)shaderIndex;
+
+    // Report the plan (logged when the message goes out of scope)
+    {
+        LogMessage message(ELS_INFO);
+        message << "Shader " << shaderPermutations.getVertexShader() << " " << shaderPermutations.getFragmentShader() << " (" << variantName << ") declares " << shaderConstantTable.getUsedCount() << " of " << ESC_COUNT << " constants (";
+        bool firstGroup = true;
+        for (int i = 0; i < ESCG_COUNT; i++)
+        {
+            if (shaderConstantTable.isGroupUsed((E_SHADER_CONSTANT_GROUP)i) == false)
+                continue;
+            message << ((firstGroup == true) ? "" : ", ") << ShaderConstantTable::getGroupName((E_SHADER_CONSTANT_GROUP)i);
+            firstGroup = false;
+        }
+        message << ")";
+    }
+
+    // Return shader handle
+    return shaderHandle;
+}
+
+bool Game::readTextFile(std::string fileName, std::string& text)
+{
+    // Open the file through the Irrlicht file system (so archives are searched too)
+    irr::io::IReadFile* pReadFile = this->pIrrlichtDevice->getFileSystem()->createAndOpenFile(fileName.c_str());
+    if (pReadFile == 0)
+        return false;
+    // Read the whole file
+    text.resize(pReadFile->getSize());
+    if (text.empty() == false)
+        pReadFile->read(&text[0], (irr::u32)text.size());
+    pReadFile->drop();
+    return true;
+}
@@ -14,10 +14,39 @@
 #include <fstream>
 #include <vector>
 #include <iomanip>
+#include <sstream>
 
 // Irrlicht Includes
 #include <Irrlicht.h>
 
+// Game Includes
+#include "AssetPackArchive.h"
+#include "AssetPacker.h"
+#include "AssetPrefetcher.h"
+#include "Benchmark.h"
+#include "ClusteredLighting.h"
+#include "CPUSkinning.h"
+#include "FrameCapture.h"
+#include "GPUSkinning.h"
+#include "InstancedMeshSceneNode.h"
+#include "JobSystem.h"
+#include "LightBenchmark.h"
+#include "LightIndex.h"
+#include "LightSelector.h"
+#include "Logger.h"
+#include "MeshCache.h"
+#include "MeshCacheBenchmark.h"
+#include "Profiler.h"
+#include "RenderQueueSceneNode.h"
+#include "SceneState.h"
+#include "ShaderConstantBenchmark.h"
+#include "ShaderConstantTable.h"
+#include "ShaderFrameConstants.h"
+#include "ShaderPermutations.h"
+#include "SkinningBenchmark.h"
+#include "StagedLoader.h"
+#include "TraceRecorder.h"
+
 /** The Game Class is based on the singleton pattern which wraps up
     the games main loop. It follows a microkernel archetecture in that
     engine wide functions and data are stored here and made available
@@ -52,7 +81,70 @@ class Game : public irr::IEventReceiver, irr::video::IShaderConstantSetCallBack,
         virtual void processCommandLineArguments(int argc, char* argv[]);
 
     protected:
-        // Command line params go here
+        // Driver used to create the IrrlichtDevice (--driver=null|software|burnings|opengl)
+        irr::video::E_DRIVER_TYPE driverType;
+        // Number of frames to benchmark, zero disables the benchmark (--frames=N)
+        int benchmarkFrames;
+        // Number of frames run before the benchmark starts recording (--warmup=N)
+        int benchmarkWarmupFrames;
+        // File the benchmark results are written to (--output=benchmark.json)
+        std::string benchmarkOutputFile;
+        // File trace events are written to, empty disables tracing (--trace=trace.json)
+        std::string traceOutputFile;
+        // Number of trace events preallocated (--trace-events=N)
+        unsigned int traceCapacity;
+        // Most point and spot lights uploaded for each node (--lights-per-node=N)
+        unsigned int lightsPerNode;
+        // Number of lights in the light culling benchmark, zero runs the demo (--light-benchmark=N)
+        int lightBenchmarkCount;
+        // Draw the Phong nodes with the clustered Phong shader (--clustered)
+        bool clusteredLightingEnabled;
+        // Number of lights in the light cluster benchmark, zero runs the demo (--cluster-benchmark=N)
+        int clusterBenchmarkCount;
+        // Sort the render queue, false draws the demo nodes in scene graph order (--unsorted)
+        bool renderQueueSorting;
+        // Number of Doominators drawn by the instanced node (--instances=N)
+        int instanceCount;
+        // Skin the Doominator in the vertex shader, false skins it on the CPU (--cpu-skinning)
+        bool gpuSkinningEnabled;
+        // Skin on the CPU in one batched pass, false leaves it to Irrlicht as each node is drawn (--irrlicht-skinning)
+        bool batchedSkinningEnabled;
+        // Worker threads of the job system, -1 for one less than the hardware threads (--job-threads=N)
+        int jobWorkerCount;
+        // Run the CPU skinning benchmark instead of the demo (--skinning-benchmark)
+        bool skinningBenchmark;
+        // Simulate the next frame on a worker while this one is drawn (--pipelined)
+        bool pipelined;
+        // Fixed time steps simulated per second (--tick-rate=N)
+        int tickRate;
+        // Most time steps simulated in one frame, the rest of the time is dropped (--max-ticks=N)
+        int maxTicksPerFrame;
+        // Lowest severity logged, also passed on to Irrlicht's logger (--log-level=debug|info|warning|error|none)
+        E_LOG_SEVERITY logSeverity;
+        // Most messages below errors logged per second, 0 for no limit (--log-rate=N)
+        unsigned int logRateLimit;
+        // Frames captured by a sequence started with F11 (--capture-frames=N)
+        unsigned int captureFrameCount;
+        // File format of screenshots and captured frames (--capture-format=png|tga)
+        E_CAPTURE_FORMAT captureFormat;
+        // Load meshes from their binary caches, false always parses them (--no-mesh-cache)
+        bool meshCacheEnabled;
+        // Optimise meshes for the vertex cache, overdraw and vertex fetch as they are cached (--no-mesh-optimize)
+        bool meshOptimizeEnabled;
+        // Run the mesh cache benchmark instead of the demo (--mesh-cache-benchmark)
+        bool meshCacheBenchmark;
+        // Run the shader constant upload plan check and benchmark instead of the demo (--shader-constant-benchmark)
+        bool shaderConstantBenchmark;
+        // Asset pack media/ is read from when it exists, empty reads the loose files (--asset-pack=FILE, --no-asset-pack)
+        std::string assetPackFile;
+        // Write the asset pack from media/ instead of running the demo (--pack-assets)
+        bool packAssets;
+        // LZ4 compress the asset pack's entries (--pack-lz4)
+        bool packCompression;
+        // Decode the assets init loads on the job system, false loads them one after another (--no-prefetch)
+        bool prefetchEnabled;
+        // Milliseconds of loading run each frame until fully loaded, 0 loads everything before the first frame (--load-budget=ms)
+        double loadBudget;
 
     // ***************
     // * CONSTRUCTOR *
@@ -80,6 +172,8 @@ class Game : public irr::IEventReceiver, irr::video::IShaderConstantSetCallBack,
         virtual bool init();
         //! Init the IrrlichtDevice
         virtual bool initIrrlichtDevice();
+        //! Init Prefetch (start decoding the assets init loads)
+        virtual bool initPrefetch();
         //! Init Window
         virtual bool initWindow();
         //! Initialise InputSystem
@@ -92,12 +186,24 @@ class Game : public irr::IEventReceiver, irr::video::IShaderConstantSetCallBack,
         virtual bool initFonts();
         //! Init Lights
         virtual bool initLights();
-        //! Init Demo
+        //! Init Demo (the render queue the demo nodes are added to as they load)
         virtual bool initDemo();
+        //! Init Shaders
+        virtual bool initShaders();
+        //! Init Doominators (the Basic, Lambert and Phong Doominators)
+        virtual bool initDoominators();
+        //! Init Plane
+        virtual bool initPlane();
+        //! Init Instances (the instanced grid of Doominators)
+        virtual bool initInstances();
         //! Init GUI
         virtual bool initGUI();
         //! Init Sky
         virtual bool initSky();
+        //! Init Frame Capture
+        virtual bool initFrameCapture();
+        //! Init Load Stages (queue the loading left after the first frame)
+        virtual bool initLoadStages();
 
     public:
         //! Handle events
@@ -158,6 +264,91 @@ class Game : public irr::IEventReceiver, irr::video::IShaderConstantSetCallBack,
         bool paused;
 
 
+    // *************
+    // * BENCHMARK *
+    // *************
+    /* NOTE: When a frame count is passed on the command line the main loop runs for
+        that many frames and then writes frame time statistics to a JSON file. Run it
+        with the null or Burning's Video drivers on machines without a GPU */
+
+    public:
+        //! Get the Benchmark
+        virtual Benchmark* getBenchmark() { return &this->benchmark; }
+
+    protected:
+        // Frame time recorder
+        Benchmark benchmark;
+
+    // ***********
+    // * STARTUP *
+    // ***********
+    /* NOTE: init only makes what the first frame needs (the device, window, camera, lights and
+        the empty render queue). The rest is queued as load stages which the main loop runs for
+        up to the load budget at the start of each frame, so the demo nodes, the logo and the sky
+        appear as they load. The benchmark starts recording once everything has loaded */
+
+    public:
+        //! Start the benchmark when a frame count was passed on the command line (once fully loaded)
+        virtual void startBenchmark();
+
+    protected:
+        // Runs the load stages
+        StagedLoader stagedLoader;
+        // When init started
+        std::chrono::steady_clock::time_point initStartTime;
+        // Milliseconds from init starting to the end of the first frame (-1 until drawn)
+        double timeToFirstFrame;
+        // Milliseconds from init starting to the end of the first frame drawn fully loaded (-1 until drawn)
+        double timeToFullyLoaded;
+
+    // ************
+    // * PROFILER *
+    // ************
+    /* NOTE: Each phase of the main loop is timed into a ring buffer of the last few
+        hundred frames. Press F3 to toggle an overlay showing the rolling averages and
+        a frame time graph */
+
+    public:
+        //! Get the Profiler
+        virtual Profiler* getProfiler() { return &this->profiler; }
+
+    protected:
+        // Times the phases of each frame
+        Profiler profiler;
+
+    // *********
+    // * TRACE *
+    // *********
+    /* NOTE: When a trace file is passed on the command line the main loop phases, the
+        light manager callbacks and every OnSetConstants call are recorded as Chrome trace
+        events. Open the file in chrome://tracing or ui.perfetto.dev */
+
+    public:
+        //! Get the TraceRecorder
+        virtual TraceRecorder* getTraceRecorder() { return &this->traceRecorder; }
+
+    protected:
+        //! Get the name of a render pass
+        static const char* getRenderPassName(irr::scene::E_SCENE_NODE_RENDER_PASS renderPass);
+        //! Get the name of a scene node for tracing
+        static const char* getTraceNodeName(irr::scene::ISceneNode* pNode);
+
+    protected:
+        // Records trace events
+        TraceRecorder traceRecorder;
+
+    // ***********
+    // * LOGGING *
+    // ***********
+    /* NOTE: Messages are written to the console by the Logger's background thread so
+        that logging never waits for the console */
+
+    public:
+        //! Get the severity of an Irrlicht log level
+        static E_LOG_SEVERITY getLogSeverity(irr::ELOG_LEVEL logLevel);
+        //! Get the Irrlicht log level of a severity
+        static irr::ELOG_LEVEL getIrrlichtLogLevel(E_LOG_SEVERITY severity);
+
     // ********************
     // * IRRLICHT HANDLES *
     // ********************
@@ -269,13 +460,11 @@ class Game : public irr::IEventReceiver, irr::video::IShaderConstantSetCallBack,
     // * LIGHT MANAGEMENT *
     // ********************
     /* NOTE: This section is the backend for the Irrlicht Light manager */
-    /* TODO: Ok, so this is how things need to work, we need to sort and build lists of ONLY
-        the lights visible on the screen (based on attenuation and position ect)
-        that way we can optimise our deferred lighting model */
+    /* The lights are kept in a loose octree of their ranges (LightIndex) which is refitted each
+        frame for the lights that moved. OnPreRender keeps only the lights reaching the camera's
+        frustum and OnNodePreRender picks the strongest of those reaching each node */
 
     public:
-        /* TODO: For everyframe we need to add/remove lights from nodes inside a quadtree because
-            some lights might have moved in the last frame */
         //! Called after the scene's light list has been built, but before rendering has begun.
         /** As actual device/hardware lights are not created until the
         ESNRP_LIGHT render pass, this provides an opportunity for the
@@ -302,6 +491,10 @@ class Game : public irr::IEventReceiver, irr::video::IShaderConstantSetCallBack,
         /** \param[in] node: the scene node that has just been rendered */
         virtual void OnNodePostRender(irr::scene::ISceneNode* node);
 
+    protected:
+        //! Switch the node's shader materials to the variant for their state and the smallest light capacity holding its selected lights
+        virtual void selectShaderPermutation(irr::scene::ISceneNode* node);
+
     protected:
         // List of Directional Lights
         std::vector<irr::scene::ILightSceneNode*> directionalLights;
@@ -309,12 +502,83 @@ class Game : public irr::IEventReceiver, irr::video::IShaderConstantSetCallBack,
         std::vector<irr::scene::ILightSceneNode*> pointLights;
         // List of Spot Lights
         std::vector<irr::scene::ILightSceneNode*> spotLights;
-        // Temporary List of Directional Lights affecting a scene node (no access is provided to this list its used internally to the shader setup)
-        std::vector<irr::scene::ILightSceneNode*> tempDirectionalLights;
-        // Temporary List of Point Lights affecting a scene node (no access is provided to this list its used internally to the shader setup)
-        std::vector<irr::scene::ILightSceneNode*> tempPointLights;
-        // Temporary List of Spot Light saffecting a scene node (no access is provided to this list its used internally to the shader setup)
-        std::vector<irr::scene::ILightSceneNode*> tempSpotLights;
+        // Point Lights reaching the scene node being rendered (indices into the frame's packed point lights, strongest first)
+        std::vector<irr::u32> nodePointLights;
+        // Spot Lights reaching the scene node being rendered (indices into the frame's packed spot lights, strongest first)
+        std::vector<irr::u32> nodeSpotLights;
+        // Picks the lights for each scene node by range and contribution
+        LightSelector lightSelector;
+        // Loose octree of the lights' ranges
+        LightIndex lightIndex;
+        // Where each light (by light index ID) is packed this frame (-1 when it is not visible)
+        std::vector<irr::s32> lightSlots;
+        // IDs of the lights reaching the camera's frustum this frame
+        std::vector<irr::u32> visibleLightIDs;
+        // IDs of the lights reaching the scene node being rendered
+        std::vector<irr::u32> nodeLightIDs;
+        // Packed point and spot lights reaching the scene node being rendered (before selecting the strongest)
+        std::vector<irr::u32> nodePointCandidates;
+        std::vector<irr::u32> nodeSpotCandidates;
+        // The scene node being rendered (between OnNodePreRender and OnNodePostRender)
+        irr::scene::ISceneNode* pCurrentNode;
+        // Render queue the demo nodes are children of (draws them sorted by shader program and textures)
+        RenderQueueSceneNode* pRenderQueue;
+        // Instanced node of the demo
+        InstancedMeshSceneNode* pInstancedNode;
+        // Shader constants shared by every node drawn this frame (computed in OnPreRender)
+        ShaderFrameConstants shaderFrameConstants;
+        // Lights binned into the view frustum's clusters for the clustered Phong shader
+        ClusteredLighting clusteredLighting;
+        // Skinned meshes animated by the vertex shader
+        GPUSkinning gpuSkinning;
+        // Skinned meshes skinned on the CPU in one batched pass
+        CPUSkinning cpuSkinning;
+        // Runs work fanned out by think, update and the preparation for drawing on the worker threads
+        JobSystem jobSystem;
+        // Writes screenshots (F12) and frame sequences (F11) on a background thread
+        FrameCapture frameCapture;
+        // Loads meshes from binary caches written the first time they are parsed
+        MeshCache meshCache;
+        // Decodes the assets init loads on the job system
+        AssetPrefetcher assetPrefetcher;
+
+    // ************
+    // * PIPELINE *
+    // ************
+    /* NOTE: think and update write the simulation's scene state and draw shows the other one.
+        The two are swapped at the handoff at the start of each frame. In pipelined mode the
+        next frame is simulated on a worker while the main thread draws, which costs a frame
+        of latency for the overlap */
+
+    public:
+        //! Init the scene states from the scene
+        virtual bool initSceneState();
+        //! Copy the drawn scene state into the simulation's, note the camera and start time and count the time steps it covers
+        virtual void beginSimulation();
+        //! Run think and update for each time step timing them into the simulation's scene state (any thread)
+        virtual void simulate();
+        //! Wait for the simulation, swap the scene states and apply the new one to the scene interpolated between its last two time steps
+        virtual void handOff();
+        //! Get the length of a time step (in seconds)
+        virtual irr::f32 getTickLength() const { return 1.0f / (irr::f32)this->tickRate; }
+        //! Get the scene state think and update write
+        virtual SSceneState& getSimulationState() { return this->sceneStates[this->simulationState]; }
+        //! Get the scene state being drawn
+        virtual const SSceneState& getRenderState() const { return this->sceneStates[1 - this->simulationState]; }
+
+    protected:
+        // The scene states (one simulated while the other is drawn)
+        SSceneState sceneStates[2];
+        // Index of the scene state being simulated
+        int simulationState;
+        // The simulation running on a worker (pipelined mode, 0 when none)
+        SJob* pSimulationJob;
+        // Point lights moved by the scene state
+        std::vector<irr::scene::ILightSceneNode*> animatedLights;
+        // Device time (in milliseconds) when the time steps were last counted
+        irr::u32 lastTickTime;
+        // Time (in milliseconds) not yet simulated
+        double tickAccumulator;
 
     // **********
     // * CAMERA *
@@ -343,11 +607,24 @@ class Game : public irr::IEventReceiver, irr::video::IShaderConstantSetCallBack,
     // ***********
 
     public:
-        //! Load Shader
-        virtual irr::s32 loadShader(std::string vertexShader, std::string fragmentShader);
+        //! Load Shader (returns the material type of its variant for a feature key, one bit per E_SHADER_FEATURE)
+        virtual irr::s32 loadShader(std::string vertexShader, std::string fragmentShader, irr::u32 features = ShaderPermutations::DEFAULT_FEATURES);
+        //! Get a loaded shader's variant for a feature key and number of lights, compiling it the first time (-1 if it cannot be built)
+        virtual irr::s32 getShaderVariant(irr::u32 shaderIndex, irr::u32 features, irr::u32 lightCount);
+        //! Read a whole text file (returns false if it could not be opened)
+        virtual bool readTextFile(std::string fileName, std::string& text);
 
     protected:
-        // Methods and memebers
+        //! Compile one variant of a loaded shader and cache it (-1 if it failed)
+        virtual irr::s32 buildShaderVariant(irr::u32 shaderIndex, irr::u32 features, irr::u32 lightCapacity);
+
+    protected:
+        // Constant tables and upload plans for each loaded shader (indexed by the shader's userData)
+        std::vector<ShaderConstantTable> shaderConstantTables;
+        // The sources and compiled variants of each loaded shader
+        std::vector<ShaderPermutations> shaderPermutations;
+        // The index into shaderPermutations of each material type (-1 for material types which are not shader variants)
+        std::vector<irr::s32> materialPermutations;
 
     // ********
     // * DEMO *
@@ -0,0 +1,45 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef SCENESTATE_H
+#define SCENESTATE_H
+
+// C/C++ Includes
+#include <vector>
+#include <chrono>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+/** The SSceneState Struct is everything Game::think and Game::update
+    produce for one frame. They run once per fixed time step, as many
+    steps as the frame covers, and the scene is drawn interpolated between
+    the last two steps. The Game keeps two: the simulation writes one
+    while the scene is drawn from the other, and they are swapped at the
+    handoff at the start of each frame. The simulation must only read and
+    write its own state (never the scene nodes), which is what lets it run
+    on a worker while the main thread draws. The camera is not part of the
+    state: its animator moves it from input on the render side as the
+    scene is drawn, so it stays live and is never a frame behind **/
+struct SSceneState
+{
+    // Animation time of the demo
+    irr::f32 theta;
+    // Positions of the animated point lights at the last tick and the tick before (in the order of Game::animatedLights)
+    std::vector<irr::core::vector3df> lightPositions;
+    std::vector<irr::core::vector3df> previousLightPositions;
+    // Fixed time steps to simulate for this state
+    irr::u32 tickCount;
+    // How far the frame is between the tick before and the last tick (0 to 1) when it is drawn
+    irr::f32 interpolation;
+    // When the simulation of this state started
+    std::chrono::steady_clock::time_point simulationStart;
+    // Time (in milliseconds) think and update took to simulate this state
+    double thinkTime;
+    double updateTime;
+};
+
+#endif // SCENESTATE_H
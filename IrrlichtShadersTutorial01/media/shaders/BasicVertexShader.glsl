@@ -6,6 +6,12 @@
 
 #version 130
 
+// BONE CAPACITY (Game::getShaderVariant builds a SKINNED variant for GPU skinned meshes)
+// -------------
+#ifndef MAX_BONES
+#define MAX_BONES 60
+#endif
+
 // Global Matrices
 uniform mat4 WorldViewProjection;
 uniform mat4 WorldViewInverseTranspose;
@@ -13,7 +19,24 @@ uniform mat4 WorldViewInverse;
 uniform mat4 WorldView;
 uniform vec4 CameraPosition;
 
+// Bones (GPUSkinning uploads the palette of the node being drawn, entry 0 is the identity)
+#ifdef SKINNED
+uniform mat4 BoneMatrix[MAX_BONES];
+#endif
+
 void main()
 {
+#ifdef SKINNED
+    /* Blend the bind pose vertex by up to four bones
+        GPUSkinning packs two bone numbers into each of the tangent's
+        first two co-ordinates, the first weight into its third and
+        the other three weights into the binormal */
+    ivec2 bonePairs = ivec2(gl_MultiTexCoord1.xy + 0.5);
+    ivec4 bones = ivec4(bonePairs.x % 256, bonePairs.x / 256, bonePairs.y % 256, bonePairs.y / 256);
+    vec4 weights = vec4(gl_MultiTexCoord1.z, gl_MultiTexCoord2.xyz);
+    mat4 skin = BoneMatrix[bones.x] * weights.x + BoneMatrix[bones.y] * weights.y + BoneMatrix[bones.z] * weights.z + BoneMatrix[bones.w] * weights.w;
+    gl_Position = gl_ModelViewProjectionMatrix * (skin * gl_Vertex);
+#else
     gl_Position = ftransform();
+#endif
 }
@@ -0,0 +1,272 @@
+// *******************************
+// * (c) Shem Taylor 2013 - 2021 *
+// * All right reserved          *
+// * Company Dodgee Software     *
+// *******************************
+
+#version 130
+
+// LIGHT CAPACITIES (Game::getShaderVariant defines these for each variant)
+// ----------------
+#ifndef MAX_DIRECTIONAL_LIGHTS
+#define MAX_DIRECTIONAL_LIGHTS 8
+#endif
+
+// FEATURES (Game::getShaderVariant defines those each variant is built for)
+// --------
+// TEXTURED: Texture0 is bound
+// LIT: the material is lit
+// DIRECTIONAL_LIGHTS: there are directional lights (point and spot lights come from the clusters)
+// FOG_LINEAR, FOG_EXP, FOG_EXP2: the fog mode of a material with fog enabled
+// INSTANCED: the node is instanced (each instance is tinted by its InstanceColor)
+
+// DATA STRUCTURES
+// ---------------
+
+
+
+// UNIFORM VARIABLES (From C++)
+// ----------------------------
+
+// Screen Width and Height
+uniform float ScreenWidth;
+uniform float ScreenHeight;
+
+// Global Matrices
+uniform mat4 WorldViewProjectionMatrix;
+uniform mat4 WorldMatrix;
+uniform mat4 InverseWorldMatrix;
+uniform mat4 ViewMatrix;
+uniform mat4 InverseViewMatrix;
+uniform mat4 ProjectionMatrix;
+uniform mat4 InverseProjectionMatrix;
+uniform mat4 NormalMatrix;
+
+// Time
+uniform float Time;
+
+// Camera
+uniform vec3 CameraPosition; // Position of the Camera in WorldSpace
+uniform vec3 CameraTarget; // Normalised Vector for Camera Direction
+
+// Irrlicht Material
+uniform float SpecularPower; // Specular Co-Efficient of the material
+uniform vec4 AmbientMaterialColor; // Ambient Color of the material
+uniform vec4 DiffuseMaterialColor; // Diffuse Color of the material
+uniform vec4 SpecularMaterialColor; // Specular Color of the material
+uniform vec4 EmmissiveMaterialColor; // Emmissive Color of the material
+
+// Irrlicht Textures and Texture Matrices
+uniform sampler2D Texture0;
+uniform mat4 Texture0Matrix;
+uniform sampler2D Texture1;
+uniform mat4 Texture1Matrix;
+uniform sampler2D Texture2;
+uniform mat4 Texture2Matrix;
+uniform sampler2D Texture3;
+uniform mat4 Texture3Matrix;
+//uniform float Texture4InUse;
+//uniform sampler2D Texture4;
+//uniform mat4 Texture4Matrix;
+//uniform float Texture5InUse;
+//uniform sampler2D Texture5;
+//uniform mat4 Texture5Matrix;
+//uniform float Texture6InUse;
+//uniform sampler2D Texture6;
+//uniform mat4 Texture6Matrix;
+//uniform float Texture7InUse;
+//uniform sampler2D Texture7;
+//uniform mat4 Texture7Matrix;
+
+// Lighting
+uniform vec4 AmbientLight;
+uniform vec4 ShadowColor;
+#ifdef DIRECTIONAL_LIGHTS
+uniform int DirectionalLightCount;
+uniform vec4 DirectionalLightDirection[MAX_DIRECTIONAL_LIGHTS];
+uniform vec4 DirectionalLightColor[MAX_DIRECTIONAL_LIGHTS];
+#endif
+
+// Clustered Lights (ClusterGrid holds each cluster's offset and count, ClusterLightIndices the light numbers)
+uniform sampler2D ClusterGrid;
+uniform sampler2D ClusterLightIndices;
+uniform vec4 ClusterDimensions; // Clusters across, up and along the view and the width of ClusterLightIndices
+uniform vec2 ClusterDepth; // Near plane and depth slices per unit of log(depth / near)
+uniform int ClusterLightCount;
+uniform vec4 ClusterLightPosition[64]; // Position in WorldSpace and type (0 point, 1 spot)
+uniform vec4 ClusterLightColor[64];
+uniform vec4 ClusterLightAttenuation[64]; // Constant, linear and quadratic attenuation and cosine of the inner cone
+uniform vec4 ClusterLightDirection[64];
+
+// Fog
+#if defined(FOG_LINEAR) || defined(FOG_EXP) || defined(FOG_EXP2)
+uniform vec4 FogColor;
+uniform float FogStart;
+uniform float FogEnd;
+uniform float FogDensity;
+#endif
+
+// VARYING VARIABLES (Communication from the VertexShader)
+// -------------------------------------------------------
+varying vec4 Position;
+varying vec3 Normal;
+varying vec4 Color;
+varying mat4 m;
+varying float ViewDepth;
+
+// ATTRIBUTES
+// ----------
+
+
+// FUNCTIONS
+// ---------
+
+// Read back a byte stored in an 8 bit texture channel
+int decodeByte(float value)
+{
+    return int(value * 255.0 + 0.5);
+}
+
+#if defined(FOG_LINEAR) || defined(FOG_EXP) || defined(FOG_EXP2)
+// How much of a surface shows through the fog at a distance (1 clear, 0 fully fogged)
+float getFogFactor(float distance)
+{
+#if defined(FOG_LINEAR)
+    return clamp((FogEnd - distance) / (FogEnd - FogStart), 0.0, 1.0);
+#elif defined(FOG_EXP)
+    return clamp(exp(-FogDensity * distance), 0.0, 1.0);
+#else
+    return clamp(exp(-(FogDensity * distance) * (FogDensity * distance)), 0.0, 1.0);
+#endif
+}
+#endif
+
+// PIXEL SHADER MAIN
+// -----------------
+
+void main()
+{
+    // Compute the vector from the vertex to the eye position
+    vec3 toEye = normalize(CameraPosition - Position.xyz);
+
+    // Sum of the effect of all lights on the surface
+    vec3 totalLighting = vec3(0.0, 0.0, 0.0);
+    vec3 totalDiffuseLighting = vec3(0.0, 0.0, 0.0);
+    vec3 totalSpecularLighting = vec3(0.0, 0.0, 0.0);
+
+#if defined(LIT) && defined(DIRECTIONAL_LIGHTS)
+    // DO DIRECTIONAL LIGHTS
+    for (int i = 0; i < DirectionalLightCount; i++)
+    {
+        vec3 lightDirection = DirectionalLightDirection[i].xyz;
+        lightDirection = normalize(lightDirection);
+
+        // Calculate diffuse co-efficient
+        float s = max(dot(lightDirection, Normal), 0.0);
+
+        // Compute the reflection Vector
+        vec3 reflectionVec = normalize(reflect(-lightDirection, Normal));
+        // Determine how much (if any) specular light makes it to the eye
+        float t = pow(max(dot(reflectionVec, toEye), 0.0), SpecularPower);
+
+        // Calculate Lighting components
+        vec3 diffuse = s * (DiffuseMaterialColor * vec4(DirectionalLightColor[i].rgb, 1.0)).rgb;
+        vec3 specular = t * (SpecularMaterialColor * vec4(DirectionalLightColor[i].rgb, 1.0)).rgb;
+
+        totalDiffuseLighting = totalDiffuseLighting + diffuse;
+        //totalDiffuseLighting = clamp(totalDiffuseLighting, 0.0, 1.0);
+        totalSpecularLighting = totalSpecularLighting + specular;
+        //totalSpecularLighting = clamp(totalSpecularLighting, 0.0, 1.0);
+    }
+#endif
+
+#ifdef LIT
+    // FIND THIS FRAGMENT'S CLUSTER
+    ivec3 cluster = ivec3(gl_FragCoord.x / ScreenWidth * ClusterDimensions.x,
+                          gl_FragCoord.y / ScreenHeight * ClusterDimensions.y,
+                          log(max(ViewDepth, ClusterDepth.x) / ClusterDepth.x) * ClusterDepth.y);
+    cluster = clamp(cluster, ivec3(0, 0, 0), ivec3(ClusterDimensions.xyz) - ivec3(1, 1, 1));
+    vec4 clusterTexel = texelFetch(ClusterGrid, ivec2(cluster.x + cluster.y * int(ClusterDimensions.x), cluster.z), 0);
+    int lightOffset = decodeByte(clusterTexel.r) + decodeByte(clusterTexel.g) * 256;
+    int lightCount = decodeByte(clusterTexel.b);
+    int indexWidth = int(ClusterDimensions.w);
+
+    // DO THE POINT AND SPOT LIGHTS IN THE CLUSTER
+    for (int n = 0; n < lightCount; n++)
+    {
+        // Grab the light's number from the cluster's run of the index list
+        int index = lightOffset + n;
+        int i = decodeByte(texelFetch(ClusterLightIndices, ivec2(index % indexWidth, index / indexWidth), 0).r);
+
+        // Grab the light position
+        vec3 lightPosition = ClusterLightPosition[i].xyz;
+
+        // Find the normalised vector between the vetex and the light source
+        vec3 lightVec = normalize(lightPosition - Position.xyz);
+
+        // Spot lights only reach fragments inside the cone
+        float intensity = 1.0;
+        if (ClusterLightPosition[i].w == 1.0)
+        {
+            float a = ClusterLightAttenuation[i].w;
+            float d = dot(lightVec, -ClusterLightDirection[i].xyz);
+            if (d < a)
+                continue;
+            intensity = 0.0;
+            if (a < d)
+                intensity = 1.0 - pow(clamp(a / d, 0, 1), 2.0);
+        }
+
+        vec3 reflectVec = normalize(reflect(-lightVec, Normal));
+
+        // Grab the distance between the light and the surface
+        float distanceToLightSource = length(lightPosition - Position.xyz);
+
+        // Compute the diffuse term
+        float s = max(dot(Normal, lightVec), 0.0);
+        // Compute the specular term
+        float t = pow(max(dot(reflectVec, toEye), 0.0), SpecularPower);
+
+        // Calculate Lighting components
+        vec3 diffuse = s * (DiffuseMaterialColor * vec4(ClusterLightColor[i].rgb, 1.0)).rgb;
+        vec3 specular = t * (SpecularMaterialColor * vec4(ClusterLightColor[i].rgb, 1.0)).rgb;
+
+        // Calcular Attenuation
+        vec3 attenuationFactors = ClusterLightAttenuation[i].xyz;
+        float attenuation = (1.0 / (attenuationFactors.x + attenuationFactors.y * distanceToLightSource + attenuationFactors.z * distanceToLightSource * distanceToLightSource));
+
+        // Add lighting to the surface
+        totalDiffuseLighting = totalDiffuseLighting + diffuse * attenuation * intensity;
+        totalSpecularLighting = totalSpecularLighting + specular * attenuation;
+    }
+#endif
+
+    // COMBINE THE LIGHTING WITH THE MATERIAL
+#ifdef LIT
+    vec3 lighting = AmbientLight.rgb + totalDiffuseLighting;
+#else
+    // Unlit materials show their colour as it is
+    vec3 lighting = vec3(1.0, 1.0, 1.0);
+#endif
+#ifdef TEXTURED
+    vec4 textureColor = texture2D(Texture0, gl_TexCoord[0].st);
+    if (textureColor.a == 0.0)
+        discard;
+    vec4 finalColor = EmmissiveMaterialColor + vec4(lighting, 1.0) * DiffuseMaterialColor * textureColor + vec4(totalSpecularLighting.rgb, 1.0) * vec4(SpecularMaterialColor.rgb, 1.0);
+    finalColor.a = textureColor.a;
+#else
+    vec4 finalColor = EmmissiveMaterialColor + vec4(lighting, 1.0) * DiffuseMaterialColor + vec4(totalSpecularLighting.rgb, 1.0) * vec4(SpecularMaterialColor.rgb, 1.0);
+    finalColor.a = DiffuseMaterialColor.a;
+#endif
+
+#ifdef INSTANCED
+    // Tint by the instance's colour (passed on by the vertex shader)
+    finalColor *= Color;
+#endif
+
+    // APPLY FOG
+#if defined(FOG_LINEAR) || defined(FOG_EXP) || defined(FOG_EXP2)
+    finalColor.rgb = mix(FogColor.rgb, finalColor.rgb, getFogFactor(length(CameraPosition - Position.xyz)));
+#endif
+    gl_FragColor = finalColor;
+}
\ No newline at end of file
@@ -0,0 +1,172 @@
+// *******************************
+// * (c) Shem Taylor 2013 - 2021 *
+// * All right reserved          *
+// * Company Dodgee Software     *
+// *******************************
+
+#version 130
+
+// LIGHT CAPACITIES (Game::getShaderVariant defines these for each variant)
+// ----------------
+#ifndef MAX_DIRECTIONAL_LIGHTS
+#define MAX_DIRECTIONAL_LIGHTS 8
+#endif
+#ifndef MAX_INSTANCES
+#define MAX_INSTANCES 32
+#endif
+#ifndef MAX_BONES
+#define MAX_BONES 60
+#endif
+
+// DATA STRUCTURES
+// ---------------
+
+
+
+// UNIFORM VARIABLES (From C++)
+// ----------------------------
+
+// Screen Width and Height
+uniform float ScreenWidth;
+uniform float ScreenHeight;
+
+// Global Matrices
+uniform mat4 WorldViewProjectionMatrix;
+uniform mat4 WorldMatrix;
+uniform mat4 InverseWorldMatrix;
+uniform mat4 ViewMatrix;
+uniform mat4 InverseViewMatrix;
+uniform mat4 ProjectionMatrix;
+uniform mat4 InverseProjectionMatrix;
+uniform mat4 NormalMatrix;
+
+// Instances (an InstancedMeshSceneNode draws a batch of up to MAX_INSTANCES in one call)
+#ifdef INSTANCED
+uniform mat4 InstanceMatrix[MAX_INSTANCES];
+uniform vec4 InstanceColor[MAX_INSTANCES];
+#endif
+
+// Bones (GPUSkinning uploads the palette of the node being drawn, entry 0 is the identity)
+#ifdef SKINNED
+uniform mat4 BoneMatrix[MAX_BONES];
+#endif
+
+// Time
+uniform float Time;
+
+// Camera
+uniform vec3 CameraPosition; // Position of the Camera in WorldSpace
+uniform vec3 CameraTarget; // Normalised Vector for Camera Direction
+
+// Irrlicht Material
+uniform float SpecularPower; // Specular Co-Efficient of the material
+uniform vec4 AmbientMaterialColor; // Ambient Color of the material
+uniform vec4 DiffuseMaterialColor; // Diffuse Color of the material
+uniform vec4 SpecularMaterialColor; // Specular Color of the material
+uniform vec4 EmmissiveMaterialColor; // Emmissive Color of the material
+
+// Irrlicht Textures and Texture Matrices
+uniform sampler2D Texture0;
+uniform mat4 Texture0Matrix;
+uniform sampler2D Texture1;
+uniform mat4 Texture1Matrix;
+uniform sampler2D Texture2;
+uniform mat4 Texture2Matrix;
+uniform sampler2D Texture3;
+uniform mat4 Texture3Matrix;
+//uniform float Texture4InUse;
+//uniform sampler2D Texture4;
+//uniform mat4 Texture4Matrix;
+//uniform float Texture5InUse;
+//uniform sampler2D Texture5;
+//uniform mat4 Texture5Matrix;
+//uniform float Texture6InUse;
+//uniform sampler2D Texture6;
+//uniform mat4 Texture6Matrix;
+//uniform float Texture7InUse;
+//uniform sampler2D Texture7;
+//uniform mat4 Texture7Matrix;
+
+// Lighting
+uniform vec4 AmbientLight;
+uniform vec4 ShadowColor;
+
+uniform int DirectionalLightCount;
+uniform vec4 DirectionalLightDirection[MAX_DIRECTIONAL_LIGHTS];
+uniform vec4 DirectionalLightColor[MAX_DIRECTIONAL_LIGHTS];
+
+// VARYING VARIABLES (Communication from to the Pixel Shader)
+// ----------------------------------------------------------
+varying vec4 Position;
+varying vec3 Normal;
+varying vec4 Color;
+varying mat4 m;
+varying float ViewDepth;
+
+// ATTRIBUTES
+// ----------
+
+
+
+// VERTEX SHADER MAIN
+// ------------------
+
+void main()
+{
+    // Apply Texture Matrices to Texture Co-ordinates (TODO: use the irrlicht texture matrices instead)
+    gl_TexCoord[0]  = gl_TextureMatrix[0] * gl_MultiTexCoord0;
+    gl_TexCoord[1]  = gl_TextureMatrix[1] * gl_MultiTexCoord1;
+    gl_TexCoord[2]  = gl_TextureMatrix[2] * gl_MultiTexCoord2;
+    gl_TexCoord[3]  = gl_TextureMatrix[3] * gl_MultiTexCoord3;
+
+    /* Place the vertex in its instance
+        an instanced batch holds a copy of the mesh for each instance
+        and the copy's slot in the batch is in the second texture
+        co-ordinate */
+#ifdef INSTANCED
+    int instance = int(gl_MultiTexCoord1.x + 0.5);
+    vec4 vertex = InstanceMatrix[instance] * gl_Vertex;
+    vec3 normal = mat3(InstanceMatrix[instance]) * gl_Normal;
+    Color = InstanceColor[instance];
+#else
+    vec4 vertex = gl_Vertex;
+    vec3 normal = gl_Normal;
+    Color = vec4(1.0, 1.0, 1.0, 1.0);
+#endif
+#ifdef SKINNED
+    /* Blend the bind pose vertex by up to four bones
+        GPUSkinning packs two bone numbers into each of the tangent's
+        first two co-ordinates, the first weight into its third and
+        the other three weights into the binormal */
+    ivec2 bonePairs = ivec2(gl_MultiTexCoord1.xy + 0.5);
+    ivec4 bones = ivec4(bonePairs.x % 256, bonePairs.x / 256, bonePairs.y % 256, bonePairs.y / 256);
+    vec4 weights = vec4(gl_MultiTexCoord1.z, gl_MultiTexCoord2.xyz);
+    mat4 skin = BoneMatrix[bones.x] * weights.x + BoneMatrix[bones.y] * weights.y + BoneMatrix[bones.z] * weights.z + BoneMatrix[bones.w] * weights.w;
+    vertex = skin * vertex;
+    normal = mat3(skin) * normal;
+#endif
+
+    /* Transform the vertex
+        gl_Position is converted into screen space by
+        multiplying it by the WorldViewProjection Matrix */
+    gl_Position = WorldViewProjectionMatrix * vertex;
+
+    /* gl_Vertex is a point in the model which has
+        been transformed locally. That is positioned about
+        the point (0,0). We want calculate the position in
+        world space and pass that into our fragment shader
+        through a varying declaration in the vertex and
+        fragment shader */
+    Position = WorldMatrix * vertex;
+
+    /* The depth along the view picks the fragment's
+        depth slice in the light cluster grid */
+    ViewDepth = (ViewMatrix * Position).z;
+
+    /* Compute the vertex Normal
+        the normal matrix here is special. The matrix should rotate
+        but never translate and never scale. */
+    Normal = (NormalMatrix * vec4(normal, 1.0)).xyz;
+    Normal = normalize(Normal);
+}
+
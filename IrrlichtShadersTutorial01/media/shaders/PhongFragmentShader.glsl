@@ -6,6 +6,23 @@
 
 #version 130
 
+// LIGHT CAPACITIES (Game::getShaderVariant defines these for each variant)
+// ----------------
+#ifndef MAX_LIGHTS
+#define MAX_LIGHTS 25
+#endif
+#ifndef MAX_DIRECTIONAL_LIGHTS
+#define MAX_DIRECTIONAL_LIGHTS 8
+#endif
+
+// FEATURES (Game::getShaderVariant defines those each variant is built for)
+// --------
+// TEXTURED: Texture0 is bound
+// LIT: the material is lit
+// DIRECTIONAL_LIGHTS, POINT_LIGHTS, SPOT_LIGHTS: the light types reaching the node
+// FOG_LINEAR, FOG_EXP, FOG_EXP2: the fog mode of a material with fog enabled
+// INSTANCED: the node is instanced (each instance is tinted by its InstanceColor)
+
 // DATA STRUCTURES
 // ---------------
 
@@ -36,7 +53,6 @@ uniform vec3 CameraPosition; // Position of the Camera in WorldSpace
 uniform vec3 CameraTarget; // Normalised Vector for Camera Direction
 
 // Irrlicht Material
-uniform bool LightingEnabled;
 uniform float SpecularPower; // Specular Co-Efficient of the material
 uniform vec4 AmbientMaterialColor; // Ambient Color of the material
 uniform vec4 DiffuseMaterialColor; // Diffuse Color of the material
@@ -44,16 +60,12 @@ uniform vec4 SpecularMaterialColor; // Specular Color of the material
 uniform vec4 EmmissiveMaterialColor; // Emmissive Color of the material
 
 // Irrlicht Textures and Texture Matrices
-uniform float Texture0InUse;
 uniform sampler2D Texture0;
 uniform mat4 Texture0Matrix;
-uniform float Texture1InUse;
 uniform sampler2D Texture1;
 uniform mat4 Texture1Matrix;
-uniform float Texture2InUse;
 uniform sampler2D Texture2;
 uniform mat4 Texture2Matrix;
-uniform float Texture3InUse;
 uniform sampler2D Texture3;
 uniform mat4 Texture3Matrix;
 //uniform float Texture4InUse;
@@ -72,27 +84,38 @@ uniform mat4 Texture3Matrix;
 // Lighting
 uniform vec4 AmbientLight;
 uniform vec4 ShadowColor;
+#ifdef DIRECTIONAL_LIGHTS
 uniform int DirectionalLightCount;
-uniform float DirectionalLightDirection[3 * 1];
-uniform float DirectionalLightColor[3 * 1];
+uniform vec4 DirectionalLightDirection[MAX_DIRECTIONAL_LIGHTS];
+uniform vec4 DirectionalLightColor[MAX_DIRECTIONAL_LIGHTS];
+#endif
 
+#ifdef POINT_LIGHTS
 uniform int PointLightCount;
-uniform float PointLightPosition[25 * 3];
-//uniform float PointLightAmbientColor[25 * 3];
-uniform float PointLightDiffuseColor[25 * 3];
-//uniform float PointLightSpecularColor[25 * 3];
-uniform float PointLightAttenuation[25 * 3];
-
+uniform vec4 PointLightPosition[MAX_LIGHTS];
+//uniform vec4 PointLightAmbientColor[MAX_LIGHTS];
+uniform vec4 PointLightDiffuseColor[MAX_LIGHTS];
+//uniform vec4 PointLightSpecularColor[MAX_LIGHTS];
+uniform vec4 PointLightAttenuation[MAX_LIGHTS];
+#endif
+
+#ifdef SPOT_LIGHTS
 uniform int SpotLightCount;
-uniform float SpotLightPosition[25 * 3];
-uniform float SpotLightDirection[25 * 3];
-//uniform float SpotLightAmbientColor[25 * 3];
-uniform float SpotLightDiffuseColor[25 * 3];
-//uniform float SpotLightSpecularColor[25 * 3];
-uniform float SpotLightAttenuation[25 * 3];
-uniform float SpotLightInnerCone[25];
-uniform float SpotLightOuterCone[25];
-uniform float SpotLightFalloff[25];
+uniform vec4 SpotLightPosition[MAX_LIGHTS]; // Position in WorldSpace and inner cone in radians
+uniform vec4 SpotLightDirection[MAX_LIGHTS]; // Direction and outer cone in radians
+//uniform vec4 SpotLightAmbientColor[MAX_LIGHTS];
+uniform vec4 SpotLightDiffuseColor[MAX_LIGHTS];
+//uniform vec4 SpotLightSpecularColor[MAX_LIGHTS];
+uniform vec4 SpotLightAttenuation[MAX_LIGHTS]; // Constant, linear and quadratic attenuation and falloff
+#endif
+
+// Fog
+#if defined(FOG_LINEAR) || defined(FOG_EXP) || defined(FOG_EXP2)
+uniform vec4 FogColor;
+uniform float FogStart;
+uniform float FogEnd;
+uniform float FogDensity;
+#endif
 
 // VARYING VARIABLES (Communication from the VertexShader)
 // -------------------------------------------------------
@@ -105,6 +128,23 @@ varying mat4 m;
 // ----------
 
 
+// FUNCTIONS
+// ---------
+
+#if defined(FOG_LINEAR) || defined(FOG_EXP) || defined(FOG_EXP2)
+// How much of a surface shows through the fog at a distance (1 clear, 0 fully fogged)
+float getFogFactor(float distance)
+{
+#if defined(FOG_LINEAR)
+    return clamp((FogEnd - distance) / (FogEnd - FogStart), 0.0, 1.0);
+#elif defined(FOG_EXP)
+    return clamp(exp(-FogDensity * distance), 0.0, 1.0);
+#else
+    return clamp(exp(-(FogDensity * distance) * (FogDensity * distance)), 0.0, 1.0);
+#endif
+}
+#endif
+
 // PIXEL SHADER MAIN
 // -----------------
 
@@ -118,10 +158,11 @@ void main()
     vec3 totalDiffuseLighting = vec3(0.0, 0.0, 0.0);
     vec3 totalSpecularLighting = vec3(0.0, 0.0, 0.0);
 
+#if defined(LIT) && defined(DIRECTIONAL_LIGHTS)
     // DO DIRECTIONAL LIGHTS
     for (int i = 0; i < DirectionalLightCount; i++)
     {
-        vec3 lightDirection = vec3(DirectionalLightDirection[3 * i + 0], DirectionalLightDirection[3 * i + 1], DirectionalLightDirection[3 * i + 2]);
+        vec3 lightDirection = DirectionalLightDirection[i].xyz;
         lightDirection = normalize(lightDirection);
 
         // Calculate diffuse co-efficient
@@ -133,20 +174,22 @@ void main()
         float t = pow(max(dot(reflectionVec, toEye), 0.0), SpecularPower);
 
         // Calculate Lighting components
-        vec3 diffuse = s * (DiffuseMaterialColor * vec4(DirectionalLightColor[3 * i + 0], DirectionalLightColor[3 * i + 1], DirectionalLightColor[3 * i + 2], DirectionalLightColor[3 * i + 3])).rgb;
-        vec3 specular = t * (SpecularMaterialColor * vec4(DirectionalLightColor[3 * i + 0], DirectionalLightColor[3 * i + 1], DirectionalLightColor[3 * i + 2], DirectionalLightColor[3 * i + 3])).rgb;
+        vec3 diffuse = s * (DiffuseMaterialColor * vec4(DirectionalLightColor[i].rgb, 1.0)).rgb;
+        vec3 specular = t * (SpecularMaterialColor * vec4(DirectionalLightColor[i].rgb, 1.0)).rgb;
 
         totalDiffuseLighting = totalDiffuseLighting + diffuse;
         //totalDiffuseLighting = clamp(totalDiffuseLighting, 0.0, 1.0);
         totalSpecularLighting = totalSpecularLighting + specular;
         //totalSpecularLighting = clamp(totalSpecularLighting, 0.0, 1.0);
     }
+#endif
 
+#if defined(LIT) && defined(POINT_LIGHTS)
     // DO POINT LIGHTS
     for (int i = 0; i < PointLightCount; i++)
     {
         // Grab the light position
-        vec3 lightPosition = vec3(PointLightPosition[3 * i + 0], PointLightPosition[3 * i + 1], PointLightPosition[3 * i + 2]);
+        vec3 lightPosition = PointLightPosition[i].xyz;
 
         // Find the normalised vector between the vetex and the light source
         vec3 lightVec = normalize(lightPosition - Position.xyz);
@@ -164,39 +207,41 @@ void main()
         float t = pow(max(dot(reflectVec, toEye), 0.0), SpecularPower);
 
         // Calculate Lighting components
-        vec3 diffuse = s * (DiffuseMaterialColor * vec4(PointLightDiffuseColor[3 * i + 0], PointLightDiffuseColor[3 * i + 1], PointLightDiffuseColor[3 * i + 2], 1.0)).rgb;
-        vec3 specular = t * (SpecularMaterialColor * vec4(PointLightDiffuseColor[3 * i + 0], PointLightDiffuseColor[3 * i + 1], PointLightDiffuseColor[3 * i + 2], 1.0)).rgb;
+        vec3 diffuse = s * (DiffuseMaterialColor * vec4(PointLightDiffuseColor[i].rgb, 1.0)).rgb;
+        vec3 specular = t * (SpecularMaterialColor * vec4(PointLightDiffuseColor[i].rgb, 1.0)).rgb;
 
         //specular = vec3(1.0, 0.0 ,0.0);
 
         // Calcular Attenuation
-        float attenuation = (1.0 / (PointLightAttenuation[i * 3 + 0] + PointLightAttenuation[i * 3 + 1] * distanceToLightSource + PointLightAttenuation[i * 3 + 2] * distanceToLightSource * distanceToLightSource));
+        float attenuation = (1.0 / (PointLightAttenuation[i].x + PointLightAttenuation[i].y * distanceToLightSource + PointLightAttenuation[i].z * distanceToLightSource * distanceToLightSource));
 
         totalDiffuseLighting = totalDiffuseLighting + (diffuse) * attenuation;
         //totalDiffuseLighting = clamp(totalDiffuseLighting, 0.0, 1.0);
         totalSpecularLighting = totalSpecularLighting + specular * attenuation;
         //totalSpecularLighting = clamp(totalSpecularLighting, 0.0, 1.0);
     }
+#endif
 
+#if defined(LIT) && defined(SPOT_LIGHTS)
     // DO SPOT LIGHTS
     for (int i = 0; i < SpotLightCount; i++)
     {
         // Grab the light position
-        vec3 lightPosition = vec3(SpotLightPosition[3 * i + 0], SpotLightPosition[3 * i + 1], SpotLightPosition[3 * i + 2]);
+        vec3 lightPosition = SpotLightPosition[i].xyz;
         // Find the normalised vector between the vetex and the light source
         vec3 lightVec = normalize(lightPosition - Position.xyz);
 
         // Grab the light direction
-        vec3 lightDirection = normalize(vec3(SpotLightDirection[3 * i + 0], SpotLightDirection[3 * i + 1], SpotLightDirection[3 * i + 2]));
+        vec3 lightDirection = normalize(SpotLightDirection[i].xyz);
 
         // Grab the distance between the light and the surface
         float distanceToLightSource = length(lightVec);
 
         // Is the spot lighting hitting this fragment
-        if (dot(lightVec, -lightDirection) >= (cos(SpotLightInnerCone[i])))
+        if (dot(lightVec, -lightDirection) >= (cos(SpotLightPosition[i].w)))
         {
             float intensity = 0.0;
-            float a = cos(SpotLightInnerCone[i]);
+            float a = cos(SpotLightPosition[i].w);
             float d = dot(lightVec, -lightDirection);
             if (a < d)
                 intensity = 1.0 - pow(clamp(a / d, 0, 1), 2.0);
@@ -214,11 +259,11 @@ void main()
             float t = pow(max(dot(reflectionVec, toEye), 0.0), SpecularPower);
 
             // Calculate Lighting components
-            vec3 diffuse = s * (DiffuseMaterialColor * vec4(SpotLightDiffuseColor[3 * i + 0], SpotLightDiffuseColor[3 * i + 1], SpotLightDiffuseColor[4 * i + 3], 1.0)).rgb;
-            vec3 specular = t * (SpecularMaterialColor * vec4(SpotLightDiffuseColor[3 * i + 0], SpotLightDiffuseColor[3 * i + 1], SpotLightDiffuseColor[4 * i + 3], 1.0)).rgb;
+            vec3 diffuse = s * (DiffuseMaterialColor * vec4(SpotLightDiffuseColor[i].rgb, 1.0)).rgb;
+            vec3 specular = t * (SpecularMaterialColor * vec4(SpotLightDiffuseColor[i].rgb, 1.0)).rgb;
 
             // Calcular Attenuation
-            float attenuation = (1.0 / (SpotLightAttenuation[i * 3 + 0] + SpotLightAttenuation[i * 3 + 1] * distanceToLightSource + SpotLightAttenuation[i * 3 + 2] * distanceToLightSource * distanceToLightSource));
+            float attenuation = (1.0 / (SpotLightAttenuation[i].x + SpotLightAttenuation[i].y * distanceToLightSource + SpotLightAttenuation[i].z * distanceToLightSource * distanceToLightSource));
 
             // Add lighting to the surface
             totalDiffuseLighting = totalDiffuseLighting + diffuse * attenuation * intensity;
@@ -227,18 +272,34 @@ void main()
             //totalSpecularLighting = clamp(totalSpecularLighting, 0.0, 1.0);
         }
     }
-    if (Texture0InUse == 1.0)
-    {
-        if (texture2D(Texture0, gl_TexCoord[0].st).a == 0.0)
-            discard;
-        vec4 finalColor = EmmissiveMaterialColor + (vec4(AmbientLight.rgb + totalDiffuseLighting, 1.0)) * DiffuseMaterialColor * texture2D(Texture0, gl_TexCoord[0].st) + vec4(totalSpecularLighting.rgb, 1.0) * vec4(SpecularMaterialColor.rgb, 1.0);
-        finalColor.a = texture2D(Texture0, gl_TexCoord[0].st).a;
-        gl_FragColor = finalColor;
-    }
-    else
-    {
-        vec4 finalColor = EmmissiveMaterialColor + vec4(AmbientLight.rgb + totalDiffuseLighting.rgb, 1.0) * DiffuseMaterialColor + vec4(totalSpecularLighting.rgb, 1.0) * vec4(SpecularMaterialColor.rgb, 1.0);
-        finalColor.a = DiffuseMaterialColor.a;
-        gl_FragColor = finalColor;
-    }
-}
+#endif
+
+    // COMBINE THE LIGHTING WITH THE MATERIAL
+#ifdef LIT
+    vec3 lighting = AmbientLight.rgb + totalDiffuseLighting;
+#else
+    // Unlit materials show their colour as it is
+    vec3 lighting = vec3(1.0, 1.0, 1.0);
+#endif
+#ifdef TEXTURED
+    vec4 textureColor = texture2D(Texture0, gl_TexCoord[0].st);
+    if (textureColor.a == 0.0)
+        discard;
+    vec4 finalColor = EmmissiveMaterialColor + vec4(lighting, 1.0) * DiffuseMaterialColor * textureColor + vec4(totalSpecularLighting.rgb, 1.0) * vec4(SpecularMaterialColor.rgb, 1.0);
+    finalColor.a = textureColor.a;
+#else
+    vec4 finalColor = EmmissiveMaterialColor + vec4(lighting, 1.0) * DiffuseMaterialColor + vec4(totalSpecularLighting.rgb, 1.0) * vec4(SpecularMaterialColor.rgb, 1.0);
+    finalColor.a = DiffuseMaterialColor.a;
+#endif
+
+#ifdef INSTANCED
+    // Tint by the instance's colour (passed on by the vertex shader)
+    finalColor *= Color;
+#endif
+
+    // APPLY FOG
+#if defined(FOG_LINEAR) || defined(FOG_EXP) || defined(FOG_EXP2)
+    finalColor.rgb = mix(FogColor.rgb, finalColor.rgb, getFogFactor(length(CameraPosition - Position.xyz)));
+#endif
+    gl_FragColor = finalColor;
+}
\ No newline at end of file
@@ -6,6 +6,21 @@
 
 #version 130
 
+// LIGHT CAPACITIES (Game::getShaderVariant defines these for each variant)
+// ----------------
+#ifndef MAX_LIGHTS
+#define MAX_LIGHTS 25
+#endif
+#ifndef MAX_DIRECTIONAL_LIGHTS
+#define MAX_DIRECTIONAL_LIGHTS 8
+#endif
+#ifndef MAX_INSTANCES
+#define MAX_INSTANCES 32
+#endif
+#ifndef MAX_BONES
+#define MAX_BONES 60
+#endif
+
 // DATA STRUCTURES
 // ---------------
 
@@ -28,6 +43,17 @@ uniform mat4 ProjectionMatrix;
 uniform mat4 InverseProjectionMatrix;
 uniform mat4 NormalMatrix;
 
+// Instances (an InstancedMeshSceneNode draws a batch of up to MAX_INSTANCES in one call)
+#ifdef INSTANCED
+uniform mat4 InstanceMatrix[MAX_INSTANCES];
+uniform vec4 InstanceColor[MAX_INSTANCES];
+#endif
+
+// Bones (GPUSkinning uploads the palette of the node being drawn, entry 0 is the identity)
+#ifdef SKINNED
+uniform mat4 BoneMatrix[MAX_BONES];
+#endif
+
 // Time
 uniform float Time;
 
@@ -36,7 +62,6 @@ uniform vec3 CameraPosition; // Position of the Camera in WorldSpace
 uniform vec3 CameraTarget; // Normalised Vector for Camera Direction
 
 // Irrlicht Material
-uniform bool LightingEnabled;
 uniform float SpecularPower; // Specular Co-Efficient of the material
 uniform vec4 AmbientMaterialColor; // Ambient Color of the material
 uniform vec4 DiffuseMaterialColor; // Diffuse Color of the material
@@ -44,16 +69,12 @@ uniform vec4 SpecularMaterialColor; // Specular Color of the material
 uniform vec4 EmmissiveMaterialColor; // Emmissive Color of the material
 
 // Irrlicht Textures and Texture Matrices
-uniform float Texture0InUse;
 uniform sampler2D Texture0;
 uniform mat4 Texture0Matrix;
-uniform float Texture1InUse;
 uniform sampler2D Texture1;
 uniform mat4 Texture1Matrix;
-uniform float Texture2InUse;
 uniform sampler2D Texture2;
 uniform mat4 Texture2Matrix;
-uniform float Texture3InUse;
 uniform sampler2D Texture3;
 uniform mat4 Texture3Matrix;
 //uniform float Texture4InUse;
@@ -74,26 +95,23 @@ uniform vec4 AmbientLight;
 uniform vec4 ShadowColor;
 
 uniform int DirectionalLightCount;
-uniform float DirectionalLightDirection[3 * 1];
-uniform float DirectionalLightColor[3 * 1];
+uniform vec4 DirectionalLightDirection[MAX_DIRECTIONAL_LIGHTS];
+uniform vec4 DirectionalLightColor[MAX_DIRECTIONAL_LIGHTS];
 
 uniform int PointLightCount;
-uniform float PointLightPosition[25 * 3];
-//uniform float PointLightAmbientColor[25 * 3];
-uniform float PointLightDiffuseColor[25 * 3];
-//uniform float PointLightSpecularColor[25 * 3];
-uniform float PointLightAttenuation[25 * 3];
+uniform vec4 PointLightPosition[MAX_LIGHTS];
+//uniform vec4 PointLightAmbientColor[MAX_LIGHTS];
+uniform vec4 PointLightDiffuseColor[MAX_LIGHTS];
+//uniform vec4 PointLightSpecularColor[MAX_LIGHTS];
+uniform vec4 PointLightAttenuation[MAX_LIGHTS];
 
 uniform int SpotLightCount;
-uniform float SpotLightPosition[25 * 3];
-uniform float SpotLightDirection[25 * 3];
-//uniform float SpotLightAmbientColor[25 * 3];
-uniform float SpotLightDiffuseColor[25 * 3];
-//uniform float SpotLightSpecularColor[25 * 3];
-uniform float SpotLightAttenuation[25 * 3];
-uniform float SpotLightInnerCone[25];
-uniform float SpotLightOuterCone[25];
-uniform float SpotLightFalloff[25];
+uniform vec4 SpotLightPosition[MAX_LIGHTS]; // Position in WorldSpace and inner cone in radians
+uniform vec4 SpotLightDirection[MAX_LIGHTS]; // Direction and outer cone in radians
+//uniform vec4 SpotLightAmbientColor[MAX_LIGHTS];
+uniform vec4 SpotLightDiffuseColor[MAX_LIGHTS];
+//uniform vec4 SpotLightSpecularColor[MAX_LIGHTS];
+uniform vec4 SpotLightAttenuation[MAX_LIGHTS]; // Constant, linear and quadratic attenuation and falloff
 
 // VARYING VARIABLES (Communication from to the Pixel Shader)
 // ----------------------------------------------------------
@@ -118,10 +136,37 @@ void main()
     gl_TexCoord[2]  = gl_TextureMatrix[2] * gl_MultiTexCoord2;
     gl_TexCoord[3]  = gl_TextureMatrix[3] * gl_MultiTexCoord3;
 
+    /* Place the vertex in its instance
+        an instanced batch holds a copy of the mesh for each instance
+        and the copy's slot in the batch is in the second texture
+        co-ordinate */
+#ifdef INSTANCED
+    int instance = int(gl_MultiTexCoord1.x + 0.5);
+    vec4 vertex = InstanceMatrix[instance] * gl_Vertex;
+    vec3 normal = mat3(InstanceMatrix[instance]) * gl_Normal;
+    Color = InstanceColor[instance];
+#else
+    vec4 vertex = gl_Vertex;
+    vec3 normal = gl_Normal;
+    Color = vec4(1.0, 1.0, 1.0, 1.0);
+#endif
+#ifdef SKINNED
+    /* Blend the bind pose vertex by up to four bones
+        GPUSkinning packs two bone numbers into each of the tangent's
+        first two co-ordinates, the first weight into its third and
+        the other three weights into the binormal */
+    ivec2 bonePairs = ivec2(gl_MultiTexCoord1.xy + 0.5);
+    ivec4 bones = ivec4(bonePairs.x % 256, bonePairs.x / 256, bonePairs.y % 256, bonePairs.y / 256);
+    vec4 weights = vec4(gl_MultiTexCoord1.z, gl_MultiTexCoord2.xyz);
+    mat4 skin = BoneMatrix[bones.x] * weights.x + BoneMatrix[bones.y] * weights.y + BoneMatrix[bones.z] * weights.z + BoneMatrix[bones.w] * weights.w;
+    vertex = skin * vertex;
+    normal = mat3(skin) * normal;
+#endif
+
     /* Transform the vertex
         gl_Position is converted into screen space by
         multiplying it by the WorldViewProjection Matrix */
-    gl_Position = WorldViewProjectionMatrix * gl_Vertex;
+    gl_Position = WorldViewProjectionMatrix * vertex;
 
     /* gl_Vertex is a point in the model which has
         been transformed locally. That is positioned about
@@ -129,12 +174,12 @@ void main()
         world space and pass that into our fragment shader
         through a varying declaration in the vertex and
         fragment shader */
-    Position = WorldMatrix * gl_Vertex;
+    Position = WorldMatrix * vertex;
 
     /* Compute the vertex Normal
         the normal matrix here is special. The matrix should rotate
         but never translate and never scale. */
-    Normal = (NormalMatrix * vec4(gl_Normal, 1.0)).xyz;
+    Normal = (NormalMatrix * vec4(normal, 1.0)).xyz;
     Normal = normalize(Normal);
 }
 
@@ -0,0 +1,315 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "JobSystem.h"
+
+#include <chrono>
+
+#include "Logger.h"
+
+// The job system each thread belongs to and its index in it
+struct SJobThread
+{
+    unsigned int systemID;
+    unsigned int index;
+};
+static thread_local SJobThread jobThread = { 0, 0 };
+// Job systems are numbered from one so that zero means none
+static std::atomic<unsigned int> nextJobSystemID(1);
+
+JobDeque::JobDeque()
+{
+    this->bottom = 0;
+    this->top = 0;
+    for (int i = 0; i < JobDeque::CAPACITY; i++)
+        this->jobs[i] = 0;
+}
+
+bool JobDeque::push(SJob* pJob)
+{
+    long long b = this->bottom.load(std::memory_order_relaxed);
+    long long t = this->top.load(std::memory_order_acquire);
+    if (b - t >= JobDeque::CAPACITY)
+        return false;
+    this->jobs[b & (JobDeque::CAPACITY - 1)].store(pJob, std::memory_order_relaxed);
+    // The job must be visible before the thieves see the new bottom
+    this->bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+SJob* JobDeque::pop()
+{
+    long long b = this->bottom.load(std::memory_order_relaxed) - 1;
+    this->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long t = this->top.load(std::memory_order_relaxed);
+    if (t > b)
+    {
+        // Empty
+        this->bottom.store(b + 1, std::memory_order_relaxed);
+        return 0;
+    }
+    SJob* pJob = this->jobs[b & (JobDeque::CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (t == b)
+    {
+        // The last job, a thief may be taking it too
+        if (this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed) == false)
+            pJob = 0;
+        this->bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return pJob;
+}
+
+SJob* JobDeque::steal()
+{
+    long long t = this->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long b = this->bottom.load(std::memory_order_acquire);
+    if (t >= b)
+        return 0;
+    SJob* pJob = this->jobs[t & (JobDeque::CAPACITY - 1)].load(std::memory_order_relaxed);
+    // Another thief or the owner got there first
+    if (this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed) == false)
+        return 0;
+    return pJob;
+}
+
+JobSystem::JobSystem()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->queuedJobs = 0;
+    this->stopping = false;
+    this->id = nextJobSystemID++;
+}
+
+JobSystem::~JobSystem()
+{
+    // **************
+    // * DESTRUCTOR *
+    // **************
+
+    this->shutdown();
+}
+
+unsigned int JobSystem::getDefaultWorkerCount()
+{
+    unsigned int hardwareThreads = std::thread::hardware_concurrency();
+    return (hardwareThreads > 1) ? hardwareThreads - 1 : 0;
+}
+
+bool JobSystem::init(unsigned int workerCount)
+{
+    // ********
+    // * INIT *
+    // ********
+
+    this->shutdown();
+    // A deque and a job pool for each thread
+    for (unsigned int i = 0; i < workerCount + 1; i++)
+    {
+        this->deques.push_back(new JobDeque());
+        this->jobPools.push_back(new SJob[JobSystem::JOB_POOL_SIZE]);
+        this->nextJobs.push_back(0);
+    }
+    // The calling thread is the main thread
+    jobThread.systemID = this->id;
+    jobThread.index = 0;
+    this->stopping = false;
+    for (unsigned int i = 0; i < workerCount; i++)
+        this->workers.push_back(std::thread(&JobSystem::workerMain, this, i + 1));
+    LogMessage(ELS_INFO) << "JobSystem::init() " << workerCount << " worker threads";
+    return true;
+}
+
+void JobSystem::shutdown()
+{
+    // ************
+    // * SHUTDOWN *
+    // ************
+
+    {
+        std::lock_guard<std::mutex> lock(this->wakeMutex);
+        this->stopping = true;
+    }
+    this->wakeCondition.notify_all();
+    for (size_t i = 0; i < this->workers.size(); i++)
+        this->workers[i].join();
+    this->workers.clear();
+    for (size_t i = 0; i < this->deques.size(); i++)
+        delete this->deques[i];
+    this->deques.clear();
+    for (size_t i = 0; i < this->jobPools.size(); i++)
+        delete [] this->jobPools[i];
+    this->jobPools.clear();
+    this->nextJobs.clear();
+    this->queuedJobs = 0;
+}
+
+unsigned int JobSystem::getThreadIndex() const
+{
+    // Threads the job system does not know are treated as the main thread
+    return (jobThread.systemID == this->id) ? jobThread.index : 0;
+}
+
+SJob* JobSystem::createJob(const std::function<void()>& function, SJob* pParent)
+{
+    unsigned int threadIndex = this->getThreadIndex();
+    SJob* pJob = &this->jobPools[threadIndex][this->nextJobs[threadIndex]++ & (JobSystem::JOB_POOL_SIZE - 1)];
+    pJob->function = function;
+    pJob->pParent = pParent;
+    pJob->unfinishedJobs = 1;
+    pJob->pendingDependencies = 1;
+    pJob->dependentCount = 0;
+    pJob->released = false;
+    pJob->dependentLock.clear();
+    // The parent is not finished until this job is
+    if (pParent != 0)
+        pParent->unfinishedJobs++;
+    return pJob;
+}
+
+void JobSystem::addDependency(SJob* pJob, SJob* pDependency)
+{
+    bool full = false;
+    while (pDependency->dependentLock.test_and_set(std::memory_order_acquire) == true)
+        std::this_thread::yield();
+    // A finished dependency no longer holds the job back
+    if (pDependency->released == false)
+    {
+        if (pDependency->dependentCount < SJob::MAX_DEPENDENTS)
+        {
+            pDependency->pDependents[pDependency->dependentCount++] = pJob;
+            pJob->pendingDependencies++;
+        }
+        else
+            full = true;
+    }
+    pDependency->dependentLock.clear(std::memory_order_release);
+    // A dependency with no room for another dependent is waited for here instead
+    if (full == true)
+        this->wait(pDependency);
+}
+
+void JobSystem::run(SJob* pJob)
+{
+    // Submitting counts as the last dependency
+    if (--pJob->pendingDependencies == 0)
+        this->push(pJob);
+}
+
+void JobSystem::push(SJob* pJob)
+{
+    if (this->deques.empty() == true || this->deques[this->getThreadIndex()]->push(pJob) == false)
+    {
+        // No workers started or the deque is full
+        this->execute(pJob);
+        return;
+    }
+    this->queuedJobs++;
+    if (this->workers.empty() == false)
+        this->wakeCondition.notify_one();
+}
+
+SJob* JobSystem::getJob(unsigned int threadIndex)
+{
+    if (this->deques.empty() == true)
+        return 0;
+    // Newest of our own first (its data is still in the cache)
+    SJob* pJob = this->deques[threadIndex]->pop();
+    // Then the oldest of another thread's, starting with the next thread along
+    for (unsigned int i = 1; pJob == 0 && i < this->deques.size(); i++)
+        pJob = this->deques[(threadIndex + i) % this->deques.size()]->steal();
+    if (pJob != 0)
+        this->queuedJobs--;
+    return pJob;
+}
+
+void JobSystem::execute(SJob* pJob)
+{
+    if (pJob->function)
+        pJob->function();
+    this->finish(pJob);
+}
+
+void JobSystem::finish(SJob* pJob)
+{
+    if (--pJob->unfinishedJobs > 0)
+        return;
+    // Release the jobs depending on this one (none can be added after this)
+    while (pJob->dependentLock.test_and_set(std::memory_order_acquire) == true)
+        std::this_thread::yield();
+    pJob->released = true;
+    int dependentCount = pJob->dependentCount;
+    pJob->dependentLock.clear(std::memory_order_release);
+    SJob* pParent = pJob->pParent;
+    for (int i = 0; i < dependentCount; i++)
+        if (--pJob->pDependents[i]->pendingDependencies == 0)
+            this->push(pJob->pDependents[i]);
+    if (pParent != 0)
+        this->finish(pParent);
+}
+
+void JobSystem::wait(const SJob* pJob)
+{
+    unsigned int threadIndex = this->getThreadIndex();
+    while (this->isFinished(pJob) == false)
+    {
+        // Help rather than block
+        SJob* pOther = this->getJob(threadIndex);
+        if (pOther != 0)
+            this->execute(pOther);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::parallelFor(unsigned int count, unsigned int grainSize, const std::function<void(unsigned int, unsigned int)>& function)
+{
+    if (count == 0)
+        return;
+    // One range runs where it is
+    if (grainSize == 0)
+        grainSize = 1;
+    if (this->workers.empty() == true || count <= grainSize)
+    {
+        function(0, count);
+        return;
+    }
+    // Keep the ranges within a quarter of the job pool
+    unsigned int maxRanges = JobSystem::JOB_POOL_SIZE / 4;
+    if ((count + grainSize - 1) / grainSize > maxRanges)
+        grainSize = (count + maxRanges - 1) / maxRanges;
+    SJob* pRoot = this->createJob(std::function<void()>());
+    for (unsigned int first = 0; first < count; first += grainSize)
+    {
+        unsigned int end = (count - first > grainSize) ? first + grainSize : count;
+        this->run(this->createJob([&function, first, end]() { function(first, end); }, pRoot));
+    }
+    this->run(pRoot);
+    this->wait(pRoot);
+}
+
+void JobSystem::workerMain(unsigned int threadIndex)
+{
+    jobThread.systemID = this->id;
+    jobThread.index = threadIndex;
+    while (this->stopping == false)
+    {
+        SJob* pJob = this->getJob(threadIndex);
+        if (pJob != 0)
+        {
+            this->execute(pJob);
+            continue;
+        }
+        // Sleep until a job is queued (the timeout covers a wake up sent just before waiting)
+        std::unique_lock<std::mutex> lock(this->wakeMutex);
+        if (this->stopping == false && this->queuedJobs.load() <= 0)
+            this->wakeCondition.wait_for(lock, std::chrono::milliseconds(1));
+    }
+}
@@ -0,0 +1,154 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+// C/C++ Includes
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+//! A job run by the JobSystem (allocated by JobSystem::createJob)
+struct SJob
+{
+    // Work to do
+    std::function<void()> function;
+    // Job waiting for this one and its other children to finish (0 for none)
+    SJob* pParent;
+    // This job plus its unfinished children (the job is finished at zero)
+    std::atomic<int> unfinishedJobs;
+    // Dependencies still running plus one until the job is submitted (queued at zero)
+    std::atomic<int> pendingDependencies;
+    // Jobs depending on this one
+    static const int MAX_DEPENDENTS = 16;
+    SJob* pDependents[MAX_DEPENDENTS];
+    int dependentCount;
+    // Set when the job finishes, after which no dependents are added
+    bool released;
+    // Guards the dependents
+    std::atomic_flag dependentLock;
+};
+
+//! A work stealing deque of jobs (the owner pushes and pops the bottom, other threads steal the top)
+class JobDeque
+{
+    public:
+        //! Constructor
+        JobDeque();
+        //! Push a job (returns false if the deque is full)
+        bool push(SJob* pJob);
+        //! Pop the newest job (owner only, 0 if empty)
+        SJob* pop();
+        //! Steal the oldest job (any thread, 0 if empty or lost to another thread)
+        SJob* steal();
+
+    public:
+        // Jobs a deque holds (a power of two)
+        static const int CAPACITY = 4096;
+
+    protected:
+        // Next slot to push to and first slot to steal from
+        std::atomic<long long> bottom;
+        std::atomic<long long> top;
+        // The jobs
+        std::atomic<SJob*> jobs[CAPACITY];
+};
+
+/** The JobSystem Class runs jobs on a pool of worker threads plus the
+    thread that created it (the main thread). Each thread has its own deque
+    of jobs: it pushes and pops its newest jobs at one end while idle
+    threads steal the oldest from the other end, so a thread mostly works
+    through the jobs it made itself and nobody contends for a single queue.
+    A job can have a parent (which only finishes when all of its children
+    have) and dependencies (it is queued once they have all finished).
+    Waiting for a job runs other jobs on the waiting thread until it has
+    finished, so the main thread helps rather than blocking.
+    Jobs are taken from a ring of JOB_POOL_SIZE per thread and reused, so a
+    job must have finished before that many more are created on its thread **/
+class JobSystem
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        JobSystem();
+        //! Destructor (shuts down)
+        virtual ~JobSystem();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Start the worker threads (0 runs every job on the thread that waits for it)
+        bool init(unsigned int workerCount);
+        //! Stop the worker threads (the jobs must have finished)
+        void shutdown();
+        //! Get the number of worker threads
+        unsigned int getWorkerCount() const { return (unsigned int)this->workers.size(); }
+        //! Get the number of threads running jobs (the workers and the main thread)
+        unsigned int getThreadCount() const { return (unsigned int)this->workers.size() + 1; }
+        //! Get a worker count leaving one hardware thread for the main thread
+        static unsigned int getDefaultWorkerCount();
+
+    public:
+        //! Create a job (submit it with run)
+        SJob* createJob(const std::function<void()>& function, SJob* pParent = 0);
+        //! Make a job wait for another (before the job is run, the other must have been run already if it has MAX_DEPENDENTS dependents)
+        void addDependency(SJob* pJob, SJob* pDependency);
+        //! Submit a job (it is queued once its dependencies have finished)
+        void run(SJob* pJob);
+        //! Run jobs on this thread until a job has finished
+        void wait(const SJob* pJob);
+        //! Has a job and all of its children finished
+        bool isFinished(const SJob* pJob) const { return (pJob->unfinishedJobs.load() <= 0); }
+        //! Split [0, count) into ranges of at least grainSize, run function(first, end) on each and wait for them
+        void parallelFor(unsigned int count, unsigned int grainSize, const std::function<void(unsigned int, unsigned int)>& function);
+
+    public:
+        // Jobs each thread allocates from before reusing them
+        static const unsigned int JOB_POOL_SIZE = 4096;
+
+    protected:
+        //! Get the calling thread's index (0 for the main thread, 1 onwards for the workers)
+        unsigned int getThreadIndex() const;
+        //! Queue a job on the calling thread's deque (runs it at once if the deque is full)
+        void push(SJob* pJob);
+        //! Take a job from this thread's deque or steal one (0 if there are none)
+        SJob* getJob(unsigned int threadIndex);
+        //! Run a job and finish it
+        void execute(SJob* pJob);
+        //! Count a job (or child) as finished, releasing its parent and dependents
+        void finish(SJob* pJob);
+        //! Worker thread loop
+        void workerMain(unsigned int threadIndex);
+
+    protected:
+        // Worker threads
+        std::vector<std::thread> workers;
+        // One deque per thread (the main thread's first)
+        std::vector<JobDeque*> deques;
+        // One job pool per thread and the next job to hand out of each
+        std::vector<SJob*> jobPools;
+        std::vector<unsigned int> nextJobs;
+        // Queued jobs not yet taken (idle workers sleep while it is zero)
+        std::atomic<int> queuedJobs;
+        // Wakes idle workers
+        std::mutex wakeMutex;
+        std::condition_variable wakeCondition;
+        // Are the workers being stopped
+        std::atomic<bool> stopping;
+        // Identifies this job system in the threads' indices
+        unsigned int id;
+};
+
+#endif // JOBSYSTEM_H
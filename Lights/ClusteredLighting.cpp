@@ -0,0 +1,227 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "ClusteredLighting.h"
+
+#include <iostream>
+#include <cmath>
+
+#include "Logger.h"
+
+ClusteredLighting::ClusteredLighting()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->pVideoDriver = 0;
+    this->pGridTexture = 0;
+    this->pIndexTexture = 0;
+    this->nearPlane = 0.0f;
+    this->farPlane = 0.0f;
+    this->lightCount = 0;
+    this->droppedLightCount = 0;
+    this->lightClusters.setGridSize(GRID_X, GRID_Y, GRID_Z);
+    this->lightClusters.setMaxLightIndices(INDEX_TEXTURE_WIDTH * INDEX_TEXTURE_HEIGHT);
+    this->clusterDimensions[0] = (irr::f32)GRID_X;
+    this->clusterDimensions[1] = (irr::f32)GRID_Y;
+    this->clusterDimensions[2] = (irr::f32)GRID_Z;
+    this->clusterDimensions[3] = (irr::f32)INDEX_TEXTURE_WIDTH;
+    this->clusterDepth[0] = 1.0f;
+    this->clusterDepth[1] = 1.0f;
+}
+
+bool ClusteredLighting::init(irr::video::IVideoDriver* pVideoDriver)
+{
+    // ********
+    // * INIT *
+    // ********
+
+    this->pVideoDriver = pVideoDriver;
+    // The textures are rewritten every frame so they must not carry mip maps
+    bool createMipMaps = pVideoDriver->getTextureCreationFlag(irr::video::ETCF_CREATE_MIP_MAPS);
+    pVideoDriver->setTextureCreationFlag(irr::video::ETCF_CREATE_MIP_MAPS, false);
+    irr::core::dimension2du gridSize(GRID_X * GRID_Y, GRID_TEXTURE_HEIGHT);
+    irr::core::dimension2du indexSize(INDEX_TEXTURE_WIDTH, INDEX_TEXTURE_HEIGHT);
+    this->pGridTexture = pVideoDriver->addTexture(gridSize, "ClusterGrid", irr::video::ECF_A8R8G8B8);
+    this->pIndexTexture = pVideoDriver->addTexture(indexSize, "ClusterLightIndices", irr::video::ECF_A8R8G8B8);
+    pVideoDriver->setTextureCreationFlag(irr::video::ETCF_CREATE_MIP_MAPS, createMipMaps);
+    // Both textures must exist at exactly the size asked for (texelFetch addresses them by texel)
+    if (this->pGridTexture == 0 || this->pIndexTexture == 0 || this->pGridTexture->getSize() != gridSize || this->pIndexTexture->getSize() != indexSize ||
+        this->pGridTexture->getColorFormat() != irr::video::ECF_A8R8G8B8 || this->pIndexTexture->getColorFormat() != irr::video::ECF_A8R8G8B8)
+    {
+        LogMessage(ELS_ERROR) << "ClusteredLighting::init() could not create the cluster textures";
+        if (this->pGridTexture != 0)
+            pVideoDriver->removeTexture(this->pGridTexture);
+        if (this->pIndexTexture != 0)
+            pVideoDriver->removeTexture(this->pIndexTexture);
+        this->pGridTexture = 0;
+        this->pIndexTexture = 0;
+        return false;
+    }
+    return true;
+}
+
+void ClusteredLighting::update(const ShaderFrameConstants& shaderFrameConstants)
+{
+    // **********
+    // * UPDATE *
+    // **********
+
+    this->lightCount = 0;
+    this->droppedLightCount = 0;
+    this->clusterLights.clear();
+    // Without a camera there is no frustum to cluster
+    if (shaderFrameConstants.getCameraFarPlane() <= shaderFrameConstants.getCameraNearPlane())
+        return;
+    // Rebuild the cluster boxes when the projection changes
+    const irr::core::matrix4& projectionMatrix = shaderFrameConstants.getProjectionMatrix();
+    if (projectionMatrix != this->projectionMatrix || shaderFrameConstants.getCameraNearPlane() != this->nearPlane || shaderFrameConstants.getCameraFarPlane() != this->farPlane)
+    {
+        this->projectionMatrix = projectionMatrix;
+        this->nearPlane = shaderFrameConstants.getCameraNearPlane();
+        this->farPlane = shaderFrameConstants.getCameraFarPlane();
+        this->lightClusters.setProjection(this->projectionMatrix, this->nearPlane, this->farPlane);
+        this->clusterDepth[0] = this->lightClusters.getNearPlane();
+        this->clusterDepth[1] = this->lightClusters.getDepthScale();
+    }
+
+    // Pack the point lights then the spot lights
+    const irr::core::matrix4& viewMatrix = shaderFrameConstants.getViewMatrix();
+    for (int type = 0; type < 2; type++)
+    {
+        bool spot = (type == 1);
+        const std::vector<SShaderLight>& lights = (spot == true) ? shaderFrameConstants.getSpotLights() : shaderFrameConstants.getPointLights();
+        for (size_t i = 0; i < lights.size(); i++)
+        {
+            if (this->lightCount == MAX_LIGHTS)
+            {
+                this->droppedLightCount++;
+                continue;
+            }
+            const SShaderLight& light = lights[i];
+            int index = this->lightCount;
+            irr::core::vector3df direction = light.direction;
+            direction.normalize();
+            this->lightPosition[4 * index + 0] = light.position.X;
+            this->lightPosition[4 * index + 1] = light.position.Y;
+            this->lightPosition[4 * index + 2] = light.position.Z;
+            this->lightPosition[4 * index + 3] = (spot == true) ? 1.0f : 0.0f;
+            this->lightColor[4 * index + 0] = light.diffuse[0];
+            this->lightColor[4 * index + 1] = light.diffuse[1];
+            this->lightColor[4 * index + 2] = light.diffuse[2];
+            this->lightColor[4 * index + 3] = 1.0f;
+            this->lightAttenuation[4 * index + 0] = light.attenuation[0];
+            this->lightAttenuation[4 * index + 1] = light.attenuation[1];
+            this->lightAttenuation[4 * index + 2] = light.attenuation[2];
+            this->lightAttenuation[4 * index + 3] = (spot == true) ? cosf(light.innerCone) : -1.0f;
+            this->lightDirection[4 * index + 0] = direction.X;
+            this->lightDirection[4 * index + 1] = direction.Y;
+            this->lightDirection[4 * index + 2] = direction.Z;
+            this->lightDirection[4 * index + 3] = 0.0f;
+            this->clusterLights.push_back(ClusteredLighting::makeClusterLight(light, spot, viewMatrix));
+            this->lightCount++;
+        }
+    }
+
+    // Bin the lights and hand the result to the shader
+    this->lightClusters.build(this->clusterLights);
+    this->uploadTextures();
+}
+
+void ClusteredLighting::uploadTextures()
+{
+    // ***************************
+    // * UPLOAD CLUSTER TEXTURES *
+    // ***************************
+
+    if (this->isInitialised() == false)
+        return;
+    // Grid (one row per depth slice)
+    irr::u32* pPixels = (irr::u32*)this->pGridTexture->lock(irr::video::ETLM_WRITE_ONLY);
+    if (pPixels != 0)
+    {
+        irr::u32 pitch = this->pGridTexture->getPitch() / 4;
+        for (irr::u32 z = 0; z < GRID_Z; z++)
+        {
+            for (irr::u32 xy = 0; xy < GRID_X * GRID_Y; xy++)
+            {
+                irr::u32 cluster = xy + z * GRID_X * GRID_Y;
+                irr::u32 offset = this->lightClusters.getLightOffset(cluster);
+                irr::u32 count = irr::core::min_(this->lightClusters.getLightCount(cluster), 255u);
+                pPixels[z * pitch + xy] = irr::video::SColor(255, offset & 0xff, (offset >> 8) & 0xff, count).color;
+            }
+        }
+        this->pGridTexture->unlock();
+    }
+    // Light indices (only the rows in use, the shader never reads past a cluster's run)
+    const std::vector<irr::u16>& lightIndices = this->lightClusters.getLightIndices();
+    if (lightIndices.empty() == true)
+        return;
+    pPixels = (irr::u32*)this->pIndexTexture->lock(irr::video::ETLM_WRITE_ONLY);
+    if (pPixels != 0)
+    {
+        irr::u32 pitch = this->pIndexTexture->getPitch() / 4;
+        for (size_t i = 0; i < lightIndices.size(); i++)
+            pPixels[(i / INDEX_TEXTURE_WIDTH) * pitch + (i % INDEX_TEXTURE_WIDTH)] = irr::video::SColor(255, lightIndices[i], 0, 0).color;
+        this->pIndexTexture->unlock();
+    }
+}
+
+void ClusteredLighting::upload(irr::video::IMaterialRendererServices* pServices, const ShaderConstantTable& shaderConstantTable) const
+{
+    // **********
+    // * UPLOAD *
+    // **********
+
+    irr::s32 gridTextureLayer = GRID_TEXTURE_LAYER;
+    irr::s32 indexTextureLayer = INDEX_TEXTURE_LAYER;
+    shaderConstantTable.set(pServices, ESC_CLUSTER_GRID, &gridTextureLayer, 1);
+    shaderConstantTable.set(pServices, ESC_CLUSTER_LIGHT_INDICES, &indexTextureLayer, 1);
+    shaderConstantTable.set(pServices, ESC_CLUSTER_DIMENSIONS, &this->clusterDimensions[0], 4);
+    shaderConstantTable.set(pServices, ESC_CLUSTER_DEPTH, &this->clusterDepth[0], 2);
+    shaderConstantTable.set(pServices, ESC_CLUSTER_LIGHT_COUNT, &this->lightCount, 1);
+    if (this->lightCount > 0)
+    {
+        shaderConstantTable.set(pServices, ESC_CLUSTER_LIGHT_POSITION, &this->lightPosition[0], this->lightCount * 4);
+        shaderConstantTable.set(pServices, ESC_CLUSTER_LIGHT_COLOR, &this->lightColor[0], this->lightCount * 4);
+        shaderConstantTable.set(pServices, ESC_CLUSTER_LIGHT_ATTENUATION, &this->lightAttenuation[0], this->lightCount * 4);
+        shaderConstantTable.set(pServices, ESC_CLUSTER_LIGHT_DIRECTION, &this->lightDirection[0], this->lightCount * 4);
+    }
+}
+
+void ClusteredLighting::applyToMaterial(irr::video::SMaterial& material) const
+{
+    // The textures are read texel by texel so filtering is turned off
+    material.setTexture(GRID_TEXTURE_LAYER, this->pGridTexture);
+    material.setTexture(INDEX_TEXTURE_LAYER, this->pIndexTexture);
+    material.TextureLayer[GRID_TEXTURE_LAYER].BilinearFilter = false;
+    material.TextureLayer[GRID_TEXTURE_LAYER].TrilinearFilter = false;
+    material.TextureLayer[INDEX_TEXTURE_LAYER].BilinearFilter = false;
+    material.TextureLayer[INDEX_TEXTURE_LAYER].TrilinearFilter = false;
+}
+
+void ClusteredLighting::applyToNode(irr::scene::ISceneNode* pNode) const
+{
+    for (irr::u32 i = 0; i < pNode->getMaterialCount(); i++)
+        this->applyToMaterial(pNode->getMaterial(i));
+}
+
+SClusterLight ClusteredLighting::makeClusterLight(const SShaderLight& light, bool spot, const irr::core::matrix4& viewMatrix)
+{
+    SClusterLight clusterLight;
+    viewMatrix.transformVect(clusterLight.position, light.position);
+    clusterLight.range = light.range;
+    clusterLight.spot = spot;
+    clusterLight.direction = light.direction;
+    viewMatrix.rotateVect(clusterLight.direction);
+    clusterLight.direction.normalize();
+    // The shader cuts spots off at the inner cone, culling uses the wider of the two
+    irr::f32 cone = irr::core::min_(irr::core::max_(light.innerCone, light.outerCone), irr::core::PI);
+    clusterLight.cosCone = cosf(cone);
+    clusterLight.sinCone = sinf(cone);
+    return clusterLight;
+}
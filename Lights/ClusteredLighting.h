@@ -0,0 +1,117 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef CLUSTEREDLIGHTING_H
+#define CLUSTEREDLIGHTING_H
+
+// C/C++ Includes
+#include <vector>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+// Game Includes
+#include "LightClusters.h"
+#include "ShaderConstantTable.h"
+#include "ShaderFrameConstants.h"
+
+/** The ClusteredLighting Class feeds the clustered Phong shader. Each frame
+    the point and spot lights reaching the frustum are packed into vec4
+    uniform arrays (world space, so the shader lights exactly like the Phong
+    shader) and binned into LightClusters in view space.
+    Irrlicht 1.8 stores every texture as 8 bit colour so the grid and the
+    index list are packed into A8R8G8B8 textures which the shader reads
+    with texelFetch: each grid texel holds a cluster's offset (red and
+    green) and light count (blue), each index texel holds a light number
+    (red). The textures are bound to texture layers of the materials drawn
+    with the clustered shader **/
+class ClusteredLighting
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        ClusteredLighting();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Create the grid and index textures (returns false if the driver could not make them)
+        bool init(irr::video::IVideoDriver* pVideoDriver);
+        //! Is the clustered path ready
+        bool isInitialised() const { return (this->pGridTexture != 0 && this->pIndexTexture != 0); }
+        //! Pack this frame's lights, bin them and upload the grid and index textures
+        void update(const ShaderFrameConstants& shaderFrameConstants);
+        //! Upload the cluster constants to a shader
+        void upload(irr::video::IMaterialRendererServices* pServices, const ShaderConstantTable& shaderConstantTable) const;
+        //! Bind the grid and index textures to a material's texture layers
+        void applyToMaterial(irr::video::SMaterial& material) const;
+        //! Bind the grid and index textures to every material of a scene node
+        void applyToNode(irr::scene::ISceneNode* pNode) const;
+        //! Get the light clusters
+        const LightClusters& getLightClusters() const { return this->lightClusters; }
+        //! Get the number of lights packed this frame
+        irr::s32 getLightCount() const { return this->lightCount; }
+        //! Get the number of lights left out this frame (beyond MAX_LIGHTS)
+        irr::u32 getDroppedLightCount() const { return this->droppedLightCount; }
+        //! Make a cluster light (view space) from a packed light
+        static SClusterLight makeClusterLight(const SShaderLight& light, bool spot, const irr::core::matrix4& viewMatrix);
+
+    public:
+        // Most lights packed each frame (the size of the shader's light arrays)
+        static const int MAX_LIGHTS = 64;
+        // Clusters across, up and along the view
+        static const irr::u32 GRID_X = 16;
+        static const irr::u32 GRID_Y = 8;
+        static const irr::u32 GRID_Z = 24;
+        // Height of the grid texture (one row per depth slice, rounded up to a power of two)
+        static const irr::u32 GRID_TEXTURE_HEIGHT = 32;
+        // Size of the index texture (its texel count is the most light indices kept)
+        static const irr::u32 INDEX_TEXTURE_WIDTH = 1024;
+        static const irr::u32 INDEX_TEXTURE_HEIGHT = 64;
+        // Texture layers the grid and index textures are bound to
+        static const irr::u32 GRID_TEXTURE_LAYER = 1;
+        static const irr::u32 INDEX_TEXTURE_LAYER = 2;
+
+    protected:
+        //! Write the grid and index textures
+        void uploadTextures();
+
+    protected:
+        // Video Driver
+        irr::video::IVideoDriver* pVideoDriver;
+        // Cluster offsets and counts (GRID_X * GRID_Y texels across, GRID_Z rows)
+        irr::video::ITexture* pGridTexture;
+        // Cluster light indices
+        irr::video::ITexture* pIndexTexture;
+        // The cluster grid
+        LightClusters lightClusters;
+        // This frame's lights in view space, reused between frames
+        std::vector<SClusterLight> clusterLights;
+        // The projection and planes the cluster boxes were built for
+        irr::core::matrix4 projectionMatrix;
+        irr::f32 nearPlane;
+        irr::f32 farPlane;
+
+    protected:
+        // Packed lights (position and type, colour, attenuation and inner cone cosine, direction)
+        irr::s32 lightCount;
+        irr::f32 lightPosition[4 * MAX_LIGHTS];
+        irr::f32 lightColor[4 * MAX_LIGHTS];
+        irr::f32 lightAttenuation[4 * MAX_LIGHTS];
+        irr::f32 lightDirection[4 * MAX_LIGHTS];
+        // Lights left out this frame
+        irr::u32 droppedLightCount;
+        // Grid size, index texture width and depth slicing for the shader
+        irr::f32 clusterDimensions[4];
+        irr::f32 clusterDepth[2];
+};
+
+#endif // CLUSTEREDLIGHTING_H
@@ -0,0 +1,295 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "LightBenchmark.h"
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+#include <Irrlicht.h>
+
+#include "Benchmark.h"
+#include "LightClusters.h"
+#include "LightOctree.h"
+#include "LightSelector.h"
+#include "Logger.h"
+
+LightBenchmark::LightBenchmark()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->nodeCount = 500;
+    this->worldHalfSize = 1000.0f;
+    this->movingFraction = 0.1f;
+    this->lookupCount = 10000;
+}
+
+bool LightBenchmark::run(int lightCount, int frameCount, int warmupFrames, const std::string& outputFile)
+{
+    // *******
+    // * RUN *
+    // *******
+
+    LogMessage(ELS_INFO) << "LightBenchmark::run() " << lightCount << " lights, " << this->nodeCount << " nodes, " << frameCount << " frames";
+    // Always use the same scene
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-this->worldHalfSize, this->worldHalfSize);
+    std::uniform_real_distribution<float> lightRange(20.0f, 80.0f);
+    std::uniform_real_distribution<float> nodeRadius(5.0f, 50.0f);
+    std::uniform_real_distribution<float> jitter(-2.0f, 2.0f);
+    std::uniform_int_distribution<int> pickLight(0, lightCount - 1);
+
+    // Make the lights (white with quadratic falloff reaching the chosen range)
+    std::vector<SShaderLight> lights(lightCount);
+    LightOctree octree;
+    octree.reset(irr::core::vector3df(0.0f, 0.0f, 0.0f), this->worldHalfSize, 8);
+    for (int i = 0; i < lightCount; i++)
+    {
+        SShaderLight& light = lights[i];
+        light.position = irr::core::vector3df(position(random), position(random), position(random));
+        irr::f32 range = lightRange(random);
+        for (int j = 0; j < 3; j++)
+            light.diffuse[j] = 1.0f;
+        light.attenuation[0] = 1.0f;
+        light.attenuation[1] = 0.0f;
+        light.attenuation[2] = 255.0f / (range * range);
+        light.intensity = 1.0f;
+        light.range = range;
+        octree.update((irr::u32)i, light.position, light.range);
+    }
+    // Make the nodes
+    std::vector<irr::core::vector3df> nodeCenters(this->nodeCount);
+    std::vector<irr::f32> nodeRadii(this->nodeCount);
+    for (int i = 0; i < this->nodeCount; i++)
+    {
+        nodeCenters[i] = irr::core::vector3df(position(random), position(random), position(random));
+        nodeRadii[i] = nodeRadius(random);
+    }
+    // A box shaped frustum covering the middle of the world (the planes face outwards)
+    irr::scene::SViewFrustum frustum;
+    for (int i = 0; i < irr::scene::SViewFrustum::VF_PLANE_COUNT; i++)
+    {
+        irr::f32 sign = ((i & 1) != 0) ? -1.0f : 1.0f;
+        frustum.planes[i].Normal = irr::core::vector3df((i / 2 == 0) ? sign : 0.0f, (i / 2 == 1) ? sign : 0.0f, (i / 2 == 2) ? sign : 0.0f);
+        frustum.planes[i].D = -this->worldHalfSize * 0.5f;
+    }
+
+    // Record each frame's phases
+    Benchmark benchmark;
+    std::vector<std::string> phaseNames;
+    phaseNames.push_back("Refit");
+    phaseNames.push_back("FrustumQuery");
+    phaseNames.push_back("OctreeSelect");
+    phaseNames.push_back("LinearSelect");
+    benchmark.setPhaseNames(phaseNames);
+    benchmark.setProperty("mode", std::string("lights"));
+    benchmark.setProperty("lightCount", (double)lightCount);
+    benchmark.setProperty("nodeCount", (double)this->nodeCount);
+    benchmark.setProperty("movingFraction", (double)this->movingFraction);
+    benchmark.start(frameCount, warmupFrames);
+
+    LightSelector octreeSelector;
+    LightSelector linearSelector;
+    std::vector<irr::u32> candidateLights;
+    std::vector<irr::u32> octreeSelected;
+    std::vector<irr::u32> linearSelected;
+    double candidateTotal = 0.0;
+    double visibleTotal = 0.0;
+    int mismatches = 0;
+    int movingLights = (int)(lightCount * this->movingFraction);
+    std::vector<irr::u32> movedLights;
+    movedLights.reserve(movingLights);
+    while (benchmark.isFinished() == false)
+    {
+        double phaseTimes[4] = { 0.0, 0.0, 0.0, 0.0 };
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        // Move some of the lights and refit them
+        movedLights.clear();
+        for (int i = 0; i < movingLights; i++)
+        {
+            int index = pickLight(random);
+            lights[index].position += irr::core::vector3df(jitter(random), jitter(random), jitter(random));
+            movedLights.push_back((irr::u32)index);
+        }
+        std::chrono::steady_clock::time_point phaseStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < movedLights.size(); i++)
+            octree.update(movedLights[i], lights[movedLights[i]].position, lights[movedLights[i]].range);
+        std::chrono::steady_clock::time_point phaseEnd = std::chrono::steady_clock::now();
+        phaseTimes[0] = std::chrono::duration<double, std::milli>(phaseEnd - phaseStart).count();
+        // Find the lights reaching the frustum
+        phaseStart = std::chrono::steady_clock::now();
+        octree.queryFrustum(frustum, candidateLights);
+        phaseEnd = std::chrono::steady_clock::now();
+        phaseTimes[1] = std::chrono::duration<double, std::milli>(phaseEnd - phaseStart).count();
+        visibleTotal += (double)candidateLights.size();
+        // Select each node's lights through the octree and by scanning every light
+        for (int i = 0; i < this->nodeCount; i++)
+        {
+            phaseStart = std::chrono::steady_clock::now();
+            octree.querySphere(nodeCenters[i], nodeRadii[i], candidateLights);
+            octreeSelector.select(nodeCenters[i], nodeRadii[i], lights, candidateLights, octreeSelected);
+            phaseEnd = std::chrono::steady_clock::now();
+            phaseTimes[2] += std::chrono::duration<double, std::milli>(phaseEnd - phaseStart).count();
+            candidateTotal += (double)candidateLights.size();
+
+            phaseStart = std::chrono::steady_clock::now();
+            linearSelector.select(nodeCenters[i], nodeRadii[i], lights, linearSelected);
+            phaseEnd = std::chrono::steady_clock::now();
+            phaseTimes[3] += std::chrono::duration<double, std::milli>(phaseEnd - phaseStart).count();
+            // Both must pick the same lights (the order can differ between equally strong lights)
+            if (octreeSelected.size() != linearSelected.size())
+                mismatches++;
+        }
+        double frameTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        benchmark.addFrame(frameTime, phaseTimes);
+    }
+    // Report
+    int totalFrames = frameCount + warmupFrames;
+    benchmark.setProperty("octreeNodes", (double)octree.getNodeCount());
+    benchmark.setProperty("averageVisibleLights", visibleTotal / totalFrames);
+    benchmark.setProperty("averageCandidatesPerNode", candidateTotal / ((double)totalFrames * this->nodeCount));
+    benchmark.setProperty("mismatches", (double)mismatches);
+    LogMessage(ELS_INFO) << "LightBenchmark::run() " << octree.getNodeCount() << " octree nodes, " << (candidateTotal / ((double)totalFrames * this->nodeCount)) << " candidates per node";
+    if (mismatches > 0)
+        LogMessage(ELS_ERROR) << "LightBenchmark::run() octree and linear selection disagreed " << mismatches << " times";
+    return benchmark.writeJSON(outputFile);
+}
+
+bool LightBenchmark::runClusters(int lightCount, int frameCount, int warmupFrames, const std::string& outputFile)
+{
+    // ****************
+    // * RUN CLUSTERS *
+    // ****************
+
+    // Light numbers are stored in 16 bits
+    lightCount = irr::core::min_(lightCount, 65535);
+    LogMessage(ELS_INFO) << "LightBenchmark::runClusters() " << lightCount << " lights, " << this->lookupCount << " lookups, " << frameCount << " frames";
+    // Always use the same scene
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> lightRange(20.0f, 200.0f);
+    std::uniform_real_distribution<float> spotCone(0.1f, 0.8f);
+    std::uniform_real_distribution<float> jitter(-2.0f, 2.0f);
+
+    // A camera at the origin looking down +Z (the view matrix is the identity)
+    irr::f32 nearPlane = 1.0f;
+    irr::f32 farPlane = 3000.0f;
+    irr::core::matrix4 projectionMatrix;
+    projectionMatrix.buildProjectionMatrixPerspectiveFovLH(irr::core::PI / 2.5f, 16.0f / 9.0f, nearPlane, farPlane);
+    LightClusters lightClusters;
+    lightClusters.setMaxLightIndices(0xffffffff);
+    lightClusters.setProjection(projectionMatrix, nearPlane, farPlane);
+    std::uniform_real_distribution<float> depth(nearPlane, farPlane * 0.75f);
+
+    // Scatter the lights through the frustum (every other one a spot light)
+    std::vector<SClusterLight> lights(lightCount);
+    for (int i = 0; i < lightCount; i++)
+    {
+        SClusterLight& light = lights[i];
+        irr::f32 z = depth(random);
+        light.position = irr::core::vector3df(unit(random) * z / projectionMatrix[0], unit(random) * z / projectionMatrix[5], z);
+        light.range = lightRange(random);
+        light.spot = ((i & 1) != 0);
+        light.direction = irr::core::vector3df(unit(random), unit(random), unit(random));
+        light.direction.normalize();
+        irr::f32 cone = spotCone(random);
+        light.cosCone = cosf(cone);
+        light.sinCone = sinf(cone);
+    }
+
+    // Record each frame's phases
+    Benchmark benchmark;
+    std::vector<std::string> phaseNames;
+    phaseNames.push_back("Build");
+    phaseNames.push_back("BruteForce");
+    phaseNames.push_back("Lookup");
+    benchmark.setPhaseNames(phaseNames);
+    benchmark.setProperty("mode", std::string("clusters"));
+    benchmark.setProperty("lightCount", (double)lightCount);
+    benchmark.setProperty("clusterCount", (double)lightClusters.getClusterCount());
+    benchmark.setProperty("lookupCount", (double)this->lookupCount);
+    benchmark.start(frameCount, warmupFrames);
+
+    std::vector<irr::u16> bruteForce;
+    double indexTotal = 0.0;
+    int clusterMismatches = 0;
+    int lookupMisses = 0;
+    while (benchmark.isFinished() == false)
+    {
+        double phaseTimes[3] = { 0.0, 0.0, 0.0 };
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        // Move the lights
+        for (int i = 0; i < lightCount; i++)
+            lights[i].position += irr::core::vector3df(jitter(random), jitter(random), jitter(random));
+        // Bin them
+        std::chrono::steady_clock::time_point phaseStart = std::chrono::steady_clock::now();
+        lightClusters.build(lights);
+        std::chrono::steady_clock::time_point phaseEnd = std::chrono::steady_clock::now();
+        phaseTimes[0] = std::chrono::duration<double, std::milli>(phaseEnd - phaseStart).count();
+        const std::vector<irr::u16>& lightIndices = lightClusters.getLightIndices();
+        indexTotal += (double)lightIndices.size();
+        // Every cluster must hold exactly the lights which reach its box
+        phaseStart = std::chrono::steady_clock::now();
+        for (irr::u32 cluster = 0; cluster < lightClusters.getClusterCount(); cluster++)
+        {
+            irr::core::aabbox3df bounds = lightClusters.getClusterBounds(cluster);
+            bruteForce.clear();
+            for (int i = 0; i < lightCount; i++)
+                if (LightClusters::intersects(lights[i], bounds) == true)
+                    bruteForce.push_back((irr::u16)i);
+            irr::u32 offset = lightClusters.getLightOffset(cluster);
+            if (bruteForce.size() != lightClusters.getLightCount(cluster) || std::equal(bruteForce.begin(), bruteForce.end(), lightIndices.begin() + offset) == false)
+                clusterMismatches++;
+        }
+        phaseEnd = std::chrono::steady_clock::now();
+        phaseTimes[1] = std::chrono::duration<double, std::milli>(phaseEnd - phaseStart).count();
+        // Every light reaching a point must be in the point's cluster
+        phaseStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < this->lookupCount; i++)
+        {
+            irr::f32 z = depth(random);
+            irr::core::vector3df point(unit(random) * z / projectionMatrix[0], unit(random) * z / projectionMatrix[5], z);
+            irr::s32 cluster = lightClusters.getCluster(point);
+            if (cluster == -1)
+                continue;
+            irr::u32 offset = lightClusters.getLightOffset((irr::u32)cluster);
+            irr::u32 count = lightClusters.getLightCount((irr::u32)cluster);
+            for (int j = 0; j < lightCount; j++)
+            {
+                const SClusterLight& light = lights[j];
+                irr::core::vector3df toPoint = point - light.position;
+                if (toPoint.getLengthSQ() > light.range * light.range)
+                    continue;
+                if (light.spot == true && toPoint.dotProduct(light.direction) < light.cosCone * toPoint.getLength())
+                    continue;
+                if (std::binary_search(lightIndices.begin() + offset, lightIndices.begin() + offset + count, (irr::u16)j) == false)
+                    lookupMisses++;
+            }
+        }
+        phaseEnd = std::chrono::steady_clock::now();
+        phaseTimes[2] = std::chrono::duration<double, std::milli>(phaseEnd - phaseStart).count();
+        double frameTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        benchmark.addFrame(frameTime, phaseTimes);
+    }
+    // Report
+    int totalFrames = frameCount + warmupFrames;
+    benchmark.setProperty("averageLightIndices", indexTotal / totalFrames);
+    benchmark.setProperty("clusterMismatches", (double)clusterMismatches);
+    benchmark.setProperty("lookupMisses", (double)lookupMisses);
+    LogMessage(ELS_INFO) << "LightBenchmark::runClusters() " << (indexTotal / totalFrames) << " light indices per frame";
+    if (clusterMismatches > 0)
+        LogMessage(ELS_ERROR) << "LightBenchmark::runClusters() binning and brute force disagreed for " << clusterMismatches << " clusters";
+    if (lookupMisses > 0)
+        LogMessage(ELS_ERROR) << "LightBenchmark::runClusters() " << lookupMisses << " lights reaching a point were missing from its cluster";
+    bool written = benchmark.writeJSON(outputFile);
+    return (written == true && clusterMismatches == 0 && lookupMisses == 0);
+}
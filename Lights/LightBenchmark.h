@@ -0,0 +1,55 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef LIGHTBENCHMARK_H
+#define LIGHTBENCHMARK_H
+
+// C/C++ Includes
+#include <string>
+
+/** The LightBenchmark Class measures light culling without a device. It
+    scatters point lights through a cube, moves a tenth of them each frame
+    and selects the lights for a set of node spheres twice: through the
+    LightOctree and by scanning every light (the old behaviour). Both must
+    pick the same lights. The per frame times are written with the
+    Benchmark class.
+    runClusters does the same for LightClusters: point and spot lights are
+    scattered through a camera's frustum and binned each frame, then every
+    cluster's list is checked against testing every light against every
+    cluster, and points through the frustum are looked up to check that
+    each light reaching a point is in its cluster's list **/
+class LightBenchmark
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        LightBenchmark();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Run the benchmark (returns false if the results could not be written)
+        bool run(int lightCount, int frameCount, int warmupFrames, const std::string& outputFile);
+        //! Run the light cluster benchmark (returns false if the results disagree with brute force or could not be written)
+        bool runClusters(int lightCount, int frameCount, int warmupFrames, const std::string& outputFile);
+
+    public:
+        // Number of node spheres lights are selected for each frame
+        int nodeCount;
+        // Half the width of the cube the lights and nodes are scattered through
+        float worldHalfSize;
+        // Fraction of the lights moved each frame
+        float movingFraction;
+        // Number of points looked up in the cluster grid each frame
+        int lookupCount;
+};
+
+#endif // LIGHTBENCHMARK_H
@@ -0,0 +1,260 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "LightClusters.h"
+
+#include <cmath>
+#include <algorithm>
+
+// Test four cluster boxes at a time when SSE is available
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define LIGHTCLUSTERS_SSE
+#endif
+
+//! Does a spot light's cone reach a sphere (the cone is treated as having a round cap at its range)
+static bool coneReachesSphere(const SClusterLight& light, const irr::core::vector3df& center, irr::f32 radius)
+{
+    irr::core::vector3df toCenter = center - light.position;
+    irr::f32 lengthSquared = toCenter.dotProduct(toCenter);
+    irr::f32 alongAxis = toCenter.dotProduct(light.direction);
+    irr::f32 distanceToCone = light.cosCone * sqrtf(std::max(lengthSquared - alongAxis * alongAxis, 0.0f)) - alongAxis * light.sinCone;
+    if (distanceToCone > radius)
+        return false;
+    if (alongAxis > radius + light.range)
+        return false;
+    if (alongAxis < -radius)
+        return false;
+    return true;
+}
+
+LightClusters::LightClusters()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->gridX = 0;
+    this->gridY = 0;
+    this->gridZ = 0;
+    this->scaleX = 1.0f;
+    this->scaleY = 1.0f;
+    this->offsetX = 0.0f;
+    this->offsetY = 0.0f;
+    this->nearPlane = 1.0f;
+    this->farPlane = 3000.0f;
+    this->depthScale = 1.0f;
+    this->maxLightIndices = 65536;
+    this->overflowCount = 0;
+    this->setGridSize(16, 8, 24);
+}
+
+void LightClusters::setGridSize(irr::u32 gridX, irr::u32 gridY, irr::u32 gridZ)
+{
+    this->gridX = std::max(gridX, 1u);
+    this->gridY = std::max(gridY, 1u);
+    this->gridZ = std::max(gridZ, 1u);
+    irr::u32 clusterCount = this->getClusterCount();
+    this->minX.assign(clusterCount, 0.0f);
+    this->minY.assign(clusterCount, 0.0f);
+    this->minZ.assign(clusterCount, 0.0f);
+    this->maxX.assign(clusterCount, 0.0f);
+    this->maxY.assign(clusterCount, 0.0f);
+    this->maxZ.assign(clusterCount, 0.0f);
+    this->lightOffsets.assign(clusterCount, 0);
+    this->lightCounts.assign(clusterCount, 0);
+}
+
+void LightClusters::setProjection(const irr::core::matrix4& projectionMatrix, irr::f32 nearPlane, irr::f32 farPlane)
+{
+    /* NOTES: For a perspective projection clip w is the view depth so
+        ndc x = (M[0] * x + M[8] * z) / z. A tile's edges are lines through
+        the eye, so its box in a slice is spanned by the edges at the slice's
+        near and far depths */
+
+    this->scaleX = projectionMatrix[0];
+    this->scaleY = projectionMatrix[5];
+    this->offsetX = projectionMatrix[8];
+    this->offsetY = projectionMatrix[9];
+    this->nearPlane = std::max(nearPlane, 0.0001f);
+    this->farPlane = std::max(farPlane, this->nearPlane * 1.001f);
+    this->depthScale = (irr::f32)this->gridZ / logf(this->farPlane / this->nearPlane);
+    for (irr::u32 z = 0; z < this->gridZ; z++)
+    {
+        irr::f32 depth0 = this->getSliceDepth(z);
+        irr::f32 depth1 = this->getSliceDepth(z + 1);
+        for (irr::u32 y = 0; y < this->gridY; y++)
+        {
+            irr::f32 ndcY0 = -1.0f + 2.0f * (irr::f32)y / (irr::f32)this->gridY - this->offsetY;
+            irr::f32 ndcY1 = -1.0f + 2.0f * (irr::f32)(y + 1) / (irr::f32)this->gridY - this->offsetY;
+            for (irr::u32 x = 0; x < this->gridX; x++)
+            {
+                irr::f32 ndcX0 = -1.0f + 2.0f * (irr::f32)x / (irr::f32)this->gridX - this->offsetX;
+                irr::f32 ndcX1 = -1.0f + 2.0f * (irr::f32)(x + 1) / (irr::f32)this->gridX - this->offsetX;
+                irr::u32 cluster = x + y * this->gridX + z * this->gridX * this->gridY;
+                this->minX[cluster] = std::min(ndcX0 * depth0, ndcX0 * depth1) / this->scaleX;
+                this->maxX[cluster] = std::max(ndcX1 * depth0, ndcX1 * depth1) / this->scaleX;
+                this->minY[cluster] = std::min(ndcY0 * depth0, ndcY0 * depth1) / this->scaleY;
+                this->maxY[cluster] = std::max(ndcY1 * depth0, ndcY1 * depth1) / this->scaleY;
+                this->minZ[cluster] = depth0;
+                this->maxZ[cluster] = depth1;
+            }
+        }
+    }
+}
+
+void LightClusters::build(const std::vector<SClusterLight>& lights)
+{
+    /* NOTES: Every light reaching the frustum is tested against the rows of
+        clusters in the slices its range spans (one slice of slack either side
+        covers rounding in getSlice). Rows whose height misses the light are
+        skipped since every box in a row has the same height. The hits are
+        then counted into each cluster's run of the index list */
+
+    this->hitClusters.clear();
+    this->hitLights.clear();
+    irr::u32 rowStride = this->gridX;
+    irr::u32 sliceStride = this->gridX * this->gridY;
+    for (size_t i = 0; i < lights.size(); i++)
+    {
+        const SClusterLight& light = lights[i];
+        // Skip lights in front of the near plane or beyond the far plane
+        if (light.position.Z + light.range < this->nearPlane || light.position.Z - light.range > this->farPlane)
+            continue;
+        irr::s32 firstSlice = std::max(this->getSlice(light.position.Z - light.range) - 1, 0);
+        irr::s32 lastSlice = std::min(this->getSlice(light.position.Z + light.range) + 1, (irr::s32)this->gridZ - 1);
+        for (irr::s32 z = firstSlice; z <= lastSlice; z++)
+        {
+            for (irr::u32 y = 0; y < this->gridY; y++)
+            {
+                irr::u32 rowStart = y * rowStride + (irr::u32)z * sliceStride;
+                if (this->minY[rowStart] > light.position.Y + light.range || this->maxY[rowStart] < light.position.Y - light.range)
+                    continue;
+                this->testRow(light, (irr::u16)i, rowStart, rowStart + this->gridX - 1);
+            }
+        }
+    }
+
+    // Count the lights in each cluster
+    irr::u32 clusterCount = this->getClusterCount();
+    std::fill(this->lightCounts.begin(), this->lightCounts.end(), 0u);
+    for (size_t i = 0; i < this->hitClusters.size(); i++)
+        this->lightCounts[this->hitClusters[i]]++;
+    // Give each cluster its run of the index list (dropping whatever does not fit)
+    this->overflowCount = 0;
+    irr::u32 offset = 0;
+    for (irr::u32 i = 0; i < clusterCount; i++)
+    {
+        this->lightOffsets[i] = offset;
+        irr::u32 room = this->maxLightIndices - offset;
+        if (this->lightCounts[i] > room)
+        {
+            this->overflowCount += this->lightCounts[i] - room;
+            this->lightCounts[i] = room;
+        }
+        offset += this->lightCounts[i];
+    }
+    // Fill the runs (lights were binned in order so each run stays sorted)
+    this->lightIndices.resize(offset);
+    this->writeCursors.assign(this->lightOffsets.begin(), this->lightOffsets.end());
+    for (size_t i = 0; i < this->hitClusters.size(); i++)
+    {
+        irr::u32 cluster = this->hitClusters[i];
+        if (this->writeCursors[cluster] < this->lightOffsets[cluster] + this->lightCounts[cluster])
+            this->lightIndices[this->writeCursors[cluster]++] = this->hitLights[i];
+    }
+}
+
+void LightClusters::testRow(const SClusterLight& light, irr::u16 lightIndex, irr::u32 first, irr::u32 last)
+{
+    irr::f32 rangeSquared = light.range * light.range;
+    irr::u32 cluster = first;
+#ifdef LIGHTCLUSTERS_SSE
+    __m128 zero = _mm_setzero_ps();
+    __m128 centerX = _mm_set1_ps(light.position.X);
+    __m128 centerY = _mm_set1_ps(light.position.Y);
+    __m128 centerZ = _mm_set1_ps(light.position.Z);
+    __m128 rangeSquared4 = _mm_set1_ps(rangeSquared);
+    for (; cluster + 3 <= last; cluster += 4)
+    {
+        // Distance from the light to each box along each axis (zero inside)
+        __m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&this->minX[cluster]), centerX), zero), _mm_max_ps(_mm_sub_ps(centerX, _mm_loadu_ps(&this->maxX[cluster])), zero));
+        __m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&this->minY[cluster]), centerY), zero), _mm_max_ps(_mm_sub_ps(centerY, _mm_loadu_ps(&this->maxY[cluster])), zero));
+        __m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&this->minZ[cluster]), centerZ), zero), _mm_max_ps(_mm_sub_ps(centerZ, _mm_loadu_ps(&this->maxZ[cluster])), zero));
+        __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        int mask = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, rangeSquared4));
+        if (mask == 0)
+            continue;
+        for (irr::u32 j = 0; j < 4; j++)
+        {
+            if ((mask & (1 << j)) == 0)
+                continue;
+            if (light.spot == true)
+            {
+                irr::core::aabbox3df bounds = this->getClusterBounds(cluster + j);
+                if (coneReachesSphere(light, bounds.getCenter(), bounds.getExtent().getLength() * 0.5f) == false)
+                    continue;
+            }
+            this->hitClusters.push_back(cluster + j);
+            this->hitLights.push_back(lightIndex);
+        }
+    }
+#endif
+    // The rest of the row one box at a time
+    for (; cluster <= last; cluster++)
+    {
+        if (LightClusters::intersects(light, this->getClusterBounds(cluster)) == false)
+            continue;
+        this->hitClusters.push_back(cluster);
+        this->hitLights.push_back(lightIndex);
+    }
+}
+
+bool LightClusters::intersects(const SClusterLight& light, const irr::core::aabbox3df& bounds)
+{
+    // Sphere against the box
+    irr::f32 dx = std::max(bounds.MinEdge.X - light.position.X, 0.0f) + std::max(light.position.X - bounds.MaxEdge.X, 0.0f);
+    irr::f32 dy = std::max(bounds.MinEdge.Y - light.position.Y, 0.0f) + std::max(light.position.Y - bounds.MaxEdge.Y, 0.0f);
+    irr::f32 dz = std::max(bounds.MinEdge.Z - light.position.Z, 0.0f) + std::max(light.position.Z - bounds.MaxEdge.Z, 0.0f);
+    if (dx * dx + dy * dy + dz * dz > light.range * light.range)
+        return false;
+    // Cone against the box's bounding sphere
+    if (light.spot == true)
+        return coneReachesSphere(light, bounds.getCenter(), bounds.getExtent().getLength() * 0.5f);
+    return true;
+}
+
+irr::s32 LightClusters::getCluster(const irr::core::vector3df& viewPosition) const
+{
+    if (viewPosition.Z < this->nearPlane || viewPosition.Z > this->farPlane)
+        return -1;
+    irr::f32 ndcX = this->scaleX * viewPosition.X / viewPosition.Z + this->offsetX;
+    irr::f32 ndcY = this->scaleY * viewPosition.Y / viewPosition.Z + this->offsetY;
+    if (ndcX < -1.0f || ndcX > 1.0f || ndcY < -1.0f || ndcY > 1.0f)
+        return -1;
+    irr::s32 x = std::min((irr::s32)((ndcX * 0.5f + 0.5f) * (irr::f32)this->gridX), (irr::s32)this->gridX - 1);
+    irr::s32 y = std::min((irr::s32)((ndcY * 0.5f + 0.5f) * (irr::f32)this->gridY), (irr::s32)this->gridY - 1);
+    return x + y * (irr::s32)this->gridX + this->getSlice(viewPosition.Z) * (irr::s32)(this->gridX * this->gridY);
+}
+
+irr::s32 LightClusters::getSlice(irr::f32 depth) const
+{
+    // Slices grow exponentially with depth so clusters stay roughly cube shaped
+    if (depth <= this->nearPlane)
+        return 0;
+    irr::s32 slice = (irr::s32)floorf(logf(depth / this->nearPlane) * this->depthScale);
+    return std::min(std::max(slice, 0), (irr::s32)this->gridZ - 1);
+}
+
+irr::core::aabbox3df LightClusters::getClusterBounds(irr::u32 cluster) const
+{
+    return irr::core::aabbox3df(irr::core::vector3df(this->minX[cluster], this->minY[cluster], this->minZ[cluster]), irr::core::vector3df(this->maxX[cluster], this->maxY[cluster], this->maxZ[cluster]));
+}
+
+irr::f32 LightClusters::getSliceDepth(irr::u32 slice) const
+{
+    return this->nearPlane * powf(this->farPlane / this->nearPlane, (irr::f32)slice / (irr::f32)this->gridZ);
+}
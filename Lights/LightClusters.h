@@ -0,0 +1,145 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef LIGHTCLUSTERS_H
+#define LIGHTCLUSTERS_H
+
+// C/C++ Includes
+#include <vector>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+//! A light as seen by the cluster grid (view space)
+struct SClusterLight
+{
+    // Position in view space
+    irr::core::vector3df position;
+    // Distance at which the light no longer visibly contributes
+    irr::f32 range;
+    // Is this a spot light
+    bool spot;
+    // Normalised direction in view space (spot lights)
+    irr::core::vector3df direction;
+    // Cosine and sine of the cone's half angle (spot lights)
+    irr::f32 cosCone;
+    irr::f32 sinCone;
+};
+
+/** The LightClusters Class splits the view frustum into a grid of clusters
+    (screen tiles across, exponential depth slices along the view) and bins
+    lights into the clusters they reach. Each light only visits the depth
+    slices and rows its range spans and is tested against each cluster's box
+    there (spheres for point lights, the cone for spot lights).
+    The cluster boxes are kept as separate arrays of each coordinate so a
+    row of clusters is tested four at a time with SSE where it is available.
+    The result is one list of light indices per cluster which the clustered
+    shaders read through ClusteredLighting **/
+class LightClusters
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        LightClusters();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Set the number of clusters across, up and along the view (the boxes are rebuilt by setProjection)
+        void setGridSize(irr::u32 gridX, irr::u32 gridY, irr::u32 gridZ);
+        //! Build the cluster boxes for a perspective projection (only when the projection or planes change)
+        void setProjection(const irr::core::matrix4& projectionMatrix, irr::f32 nearPlane, irr::f32 farPlane);
+        //! Bin lights (view space) into the clusters
+        void build(const std::vector<SClusterLight>& lights);
+        //! Get the cluster containing a view space point (-1 outside the frustum)
+        irr::s32 getCluster(const irr::core::vector3df& viewPosition) const;
+        //! Get the depth slice containing a view space depth
+        irr::s32 getSlice(irr::f32 depth) const;
+        //! Get the box of a cluster in view space
+        irr::core::aabbox3df getClusterBounds(irr::u32 cluster) const;
+        //! Does a light reach a box (the exact test used for every cluster)
+        static bool intersects(const SClusterLight& light, const irr::core::aabbox3df& bounds);
+
+    public:
+        //! Get the number of clusters across
+        irr::u32 getGridX() const { return this->gridX; }
+        //! Get the number of clusters up
+        irr::u32 getGridY() const { return this->gridY; }
+        //! Get the number of depth slices
+        irr::u32 getGridZ() const { return this->gridZ; }
+        //! Get the number of clusters
+        irr::u32 getClusterCount() const { return this->gridX * this->gridY * this->gridZ; }
+        //! Get the near plane
+        irr::f32 getNearPlane() const { return this->nearPlane; }
+        //! Get the far plane
+        irr::f32 getFarPlane() const { return this->farPlane; }
+        //! Get the slices per unit of log(depth / near)
+        irr::f32 getDepthScale() const { return this->depthScale; }
+        //! Get where a cluster's lights start in getLightIndices
+        irr::u32 getLightOffset(irr::u32 cluster) const { return this->lightOffsets[cluster]; }
+        //! Get the number of lights in a cluster
+        irr::u32 getLightCount(irr::u32 cluster) const { return this->lightCounts[cluster]; }
+        //! Get every cluster's light indices (each cluster's run is sorted)
+        const std::vector<irr::u16>& getLightIndices() const { return this->lightIndices; }
+        //! Get the most light indices kept (the rest are dropped and counted)
+        irr::u32 getMaxLightIndices() const { return this->maxLightIndices; }
+        //! Set the most light indices kept
+        void setMaxLightIndices(irr::u32 maxLightIndices) { this->maxLightIndices = maxLightIndices; }
+        //! Get the number of light indices dropped by the last build
+        irr::u32 getOverflowCount() const { return this->overflowCount; }
+
+    protected:
+        //! Test a light against clusters [first, last] of one row, adding the hits
+        void testRow(const SClusterLight& light, irr::u16 lightIndex, irr::u32 first, irr::u32 last);
+        //! Get the view space depth where a slice starts
+        irr::f32 getSliceDepth(irr::u32 slice) const;
+
+    protected:
+        // Number of clusters across, up and along the view
+        irr::u32 gridX;
+        irr::u32 gridY;
+        irr::u32 gridZ;
+        // Projection terms (ndc = scale * view / depth + offset)
+        irr::f32 scaleX;
+        irr::f32 scaleY;
+        irr::f32 offsetX;
+        irr::f32 offsetY;
+        // Near and far planes
+        irr::f32 nearPlane;
+        irr::f32 farPlane;
+        // Slices per unit of log(depth / near)
+        irr::f32 depthScale;
+
+    protected:
+        // Cluster boxes, one array per coordinate
+        std::vector<irr::f32> minX;
+        std::vector<irr::f32> minY;
+        std::vector<irr::f32> minZ;
+        std::vector<irr::f32> maxX;
+        std::vector<irr::f32> maxY;
+        std::vector<irr::f32> maxZ;
+        // Where each cluster's lights start and how many there are
+        std::vector<irr::u32> lightOffsets;
+        std::vector<irr::u32> lightCounts;
+        // Every cluster's light indices
+        std::vector<irr::u16> lightIndices;
+        // (cluster, light) pairs found while binning, reused between builds
+        std::vector<irr::u32> hitClusters;
+        std::vector<irr::u16> hitLights;
+        // Where the next index goes in each cluster's run, reused between builds
+        std::vector<irr::u32> writeCursors;
+        // Most light indices kept
+        irr::u32 maxLightIndices;
+        // Light indices dropped by the last build
+        irr::u32 overflowCount;
+};
+
+#endif // LIGHTCLUSTERS_H
@@ -0,0 +1,140 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "LightIndex.h"
+
+#include "ShaderFrameConstants.h"
+
+LightIndex::LightIndex()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->updateCount = 0;
+    this->refitCount = 0;
+}
+
+LightIndex::~LightIndex()
+{
+    // **************
+    // * DESTRUCTOR *
+    // **************
+
+    this->clear();
+}
+
+void LightIndex::reset(const irr::core::vector3df& center, irr::f32 halfSize, irr::u32 maxDepth)
+{
+    // *********
+    // * RESET *
+    // *********
+
+    this->clear();
+    this->octree.reset(center, halfSize, maxDepth);
+}
+
+void LightIndex::clear()
+{
+    // *********
+    // * CLEAR *
+    // *********
+
+    for (size_t i = 0; i < this->entries.size(); i++)
+    {
+        if (this->entries[i].pLight == 0)
+            continue;
+        this->octree.remove((irr::u32)i);
+        this->entries[i].pLight->drop();
+    }
+    this->ids.clear();
+    this->entries.clear();
+    this->indexedIDs.clear();
+    this->previousIDs.clear();
+    this->freeIDs.clear();
+    this->directionalLights.clear();
+    this->refitCount = 0;
+}
+
+void LightIndex::update(const irr::core::array<irr::scene::ISceneNode*>& lightList)
+{
+    // **********
+    // * UPDATE *
+    // **********
+
+    this->updateCount++;
+    this->refitCount = 0;
+    this->directionalLights.clear();
+    this->indexedIDs.swap(this->previousIDs);
+    this->indexedIDs.clear();
+    for (irr::u32 i = 0; i < lightList.size(); i++)
+    {
+        irr::scene::ILightSceneNode* pLight = (irr::scene::ILightSceneNode*)lightList[i];
+        // Directional lights are not indexed
+        if (pLight->getLightType() == irr::video::ELT_DIRECTIONAL)
+        {
+            this->directionalLights.push_back(pLight);
+            continue;
+        }
+        // Find the light's ID (giving new lights one)
+        std::unordered_map<irr::scene::ILightSceneNode*, irr::u32>::iterator found = this->ids.find(pLight);
+        irr::u32 id = 0;
+        bool isNew = (found == this->ids.end());
+        if (isNew == true)
+        {
+            if (this->freeIDs.empty() == false)
+            {
+                id = this->freeIDs.back();
+                this->freeIDs.pop_back();
+            }
+            else
+            {
+                id = (irr::u32)this->entries.size();
+                this->entries.push_back(SLightIndexEntry());
+            }
+            this->ids[pLight] = id;
+            this->entries[id].pLight = pLight;
+            pLight->grab();
+        }
+        else
+        {
+            id = found->second;
+        }
+        // Refit the light only if it is new, moved or changed range
+        SLightIndexEntry& entry = this->entries[id];
+        entry.lastSeen = this->updateCount;
+        this->indexedIDs.push_back(id);
+        irr::core::vector3df position = pLight->getAbsolutePosition();
+        irr::f32 range = ShaderFrameConstants::getLightRange(pLight->getLightData());
+        if (isNew == true || position != entry.position || range != entry.range)
+        {
+            entry.position = position;
+            entry.range = range;
+            this->octree.update(id, position, range);
+            this->refitCount++;
+        }
+    }
+    // Remove the lights indexed last update which are no longer in the list (deleted or hidden)
+    for (size_t i = 0; i < this->previousIDs.size(); i++)
+    {
+        if (this->entries[this->previousIDs[i]].lastSeen != this->updateCount)
+            this->remove(this->previousIDs[i]);
+    }
+}
+
+void LightIndex::remove(irr::u32 id)
+{
+    // **********
+    // * REMOVE *
+    // **********
+
+    SLightIndexEntry& entry = this->entries[id];
+    this->octree.remove(id);
+    this->ids.erase(entry.pLight);
+    entry.pLight->drop();
+    entry.pLight = 0;
+    this->freeIDs.push_back(id);
+}
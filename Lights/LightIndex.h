@@ -0,0 +1,102 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef LIGHTINDEX_H
+#define LIGHTINDEX_H
+
+// C/C++ Includes
+#include <vector>
+#include <unordered_map>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+// Game Includes
+#include "LightOctree.h"
+
+//! A light tracked by the LightIndex
+struct SLightIndexEntry
+{
+    // The light, grabbed while indexed (0 when the ID is free)
+    irr::scene::ILightSceneNode* pLight;
+    // Position and range the light was last indexed with
+    irr::core::vector3df position;
+    irr::f32 range;
+    // Last update the light was in the scene's light list
+    irr::u32 lastSeen;
+};
+
+/** The LightIndex Class keeps the point and spot lights of the scene in a
+    LightOctree keyed by their range so the light manager can ask for the
+    lights reaching the view frustum or a scene node without walking every
+    light. Each update compares the scene's light list with what was
+    indexed and only refits the lights that moved or changed range.
+    Indexed lights are grabbed so a deleted light's address cannot be
+    reused by a new light while it is still indexed, and only the lights
+    indexed by the last update are checked for removal.
+    Directional lights reach everything so they are kept in a plain list **/
+class LightIndex
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        LightIndex();
+        //! Destructor
+        ~LightIndex();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Empty the index and set the region its octree covers
+        void reset(const irr::core::vector3df& center, irr::f32 halfSize, irr::u32 maxDepth);
+        //! Empty the index (dropping its lights, call before the scene manager goes)
+        void clear();
+        //! Bring the index up to date with the scene's light list
+        void update(const irr::core::array<irr::scene::ISceneNode*>& lightList);
+        //! Get the IDs of the lights whose range reaches a view frustum
+        void queryFrustum(const irr::scene::SViewFrustum& frustum, std::vector<irr::u32>& ids) const { this->octree.queryFrustum(frustum, ids); }
+        //! Get the IDs of the lights whose range reaches a sphere
+        void querySphere(const irr::core::vector3df& center, irr::f32 radius, std::vector<irr::u32>& ids) const { this->octree.querySphere(center, radius, ids); }
+        //! Get a light from its ID
+        irr::scene::ILightSceneNode* getLight(irr::u32 id) const { return this->entries[id].pLight; }
+        //! Get the number of IDs in use or free (every ID is less than this)
+        irr::u32 getCapacity() const { return (irr::u32)this->entries.size(); }
+        //! Get the Directional Lights
+        const std::vector<irr::scene::ILightSceneNode*>& getDirectionalLights() const { return this->directionalLights; }
+        //! Get the number of lights refitted by the last update
+        irr::u32 getRefitCount() const { return this->refitCount; }
+
+    protected:
+        //! Remove a light from the index and free its ID
+        void remove(irr::u32 id);
+
+    protected:
+        // Octree of the point and spot light ranges
+        LightOctree octree;
+        // ID of each indexed light
+        std::unordered_map<irr::scene::ILightSceneNode*, irr::u32> ids;
+        // Indexed lights by ID
+        std::vector<SLightIndexEntry> entries;
+        // IDs of the lights indexed by the last update
+        std::vector<irr::u32> indexedIDs;
+        // IDs indexed by the update before (swapped with indexedIDs each update)
+        std::vector<irr::u32> previousIDs;
+        // IDs of removed lights which can be reused
+        std::vector<irr::u32> freeIDs;
+        // Directional Lights in the scene
+        std::vector<irr::scene::ILightSceneNode*> directionalLights;
+        // Number of updates so far
+        irr::u32 updateCount;
+        // Number of lights refitted by the last update
+        irr::u32 refitCount;
+};
+
+#endif // LIGHTINDEX_H
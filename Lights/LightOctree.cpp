@@ -0,0 +1,211 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "LightOctree.h"
+
+#include <cmath>
+
+LightOctree::LightOctree()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->itemCount = 0;
+    this->maxDepth = 0;
+    this->reset(irr::core::vector3df(0.0f, 0.0f, 0.0f), 4096.0f, 8);
+}
+
+void LightOctree::reset(const irr::core::vector3df& center, irr::f32 halfSize, irr::u32 maxDepth)
+{
+    // *********
+    // * RESET *
+    // *********
+
+    this->nodes.clear();
+    this->items.clear();
+    this->itemCount = 0;
+    this->maxDepth = maxDepth;
+    // Make the root
+    SLightOctreeNode root;
+    root.center = center;
+    root.halfSize = halfSize;
+    root.depth = 0;
+    for (int i = 0; i < 8; i++)
+        root.children[i] = -1;
+    this->nodes.push_back(root);
+}
+
+bool LightOctree::update(irr::u32 id, const irr::core::vector3df& center, irr::f32 radius)
+{
+    // **********
+    // * UPDATE *
+    // **********
+
+    // Make room for new IDs
+    if (id >= this->items.size())
+    {
+        SLightOctreeItem empty;
+        empty.radius = 0.0f;
+        empty.node = -1;
+        empty.slot = 0;
+        this->items.resize(id + 1, empty);
+    }
+    SLightOctreeItem& item = this->items[id];
+    // Refit in place while the item still fits its cell
+    if (item.node != -1 && this->fits(this->nodes[item.node], center, radius) == true)
+    {
+        item.center = center;
+        item.radius = radius;
+        return false;
+    }
+    // Otherwise move it to the cell it belongs in
+    this->remove(id);
+    irr::s32 nodeIndex = this->findNode(center, radius);
+    SLightOctreeItem& movedItem = this->items[id];
+    movedItem.center = center;
+    movedItem.radius = radius;
+    movedItem.node = nodeIndex;
+    movedItem.slot = (irr::u32)this->nodes[nodeIndex].items.size();
+    this->nodes[nodeIndex].items.push_back(id);
+    this->itemCount++;
+    return true;
+}
+
+void LightOctree::remove(irr::u32 id)
+{
+    // **********
+    // * REMOVE *
+    // **********
+
+    if (this->contains(id) == false)
+        return;
+    SLightOctreeItem& item = this->items[id];
+    // Swap the last item of the cell into the removed item's slot
+    std::vector<irr::u32>& cellItems = this->nodes[item.node].items;
+    irr::u32 lastID = cellItems.back();
+    cellItems[item.slot] = lastID;
+    this->items[lastID].slot = item.slot;
+    cellItems.pop_back();
+    item.node = -1;
+    this->itemCount--;
+}
+
+bool LightOctree::fits(const SLightOctreeNode& node, const irr::core::vector3df& center, irr::f32 radius) const
+{
+    // The root holds anything that does not fit elsewhere
+    if (node.depth == 0)
+        return (this->maxDepth == 0 || radius > node.halfSize * 0.5f || fabsf(center.X - node.center.X) > node.halfSize || fabsf(center.Y - node.center.Y) > node.halfSize || fabsf(center.Z - node.center.Z) > node.halfSize);
+    // The centre must be in the cell and the sphere within its loose bounds
+    return (radius <= node.halfSize &&
+            fabsf(center.X - node.center.X) <= node.halfSize &&
+            fabsf(center.Y - node.center.Y) <= node.halfSize &&
+            fabsf(center.Z - node.center.Z) <= node.halfSize);
+}
+
+irr::s32 LightOctree::findNode(const irr::core::vector3df& center, irr::f32 radius)
+{
+    irr::s32 nodeIndex = 0;
+    // Items outside the root stay in the root
+    const SLightOctreeNode& root = this->nodes[0];
+    if (fabsf(center.X - root.center.X) > root.halfSize || fabsf(center.Y - root.center.Y) > root.halfSize || fabsf(center.Z - root.center.Z) > root.halfSize)
+        return 0;
+    // Go down while the item is no bigger than the child cell
+    while (this->nodes[nodeIndex].depth < this->maxDepth && radius <= this->nodes[nodeIndex].halfSize * 0.5f)
+    {
+        // Pick the child containing the centre
+        const irr::core::vector3df nodeCenter = this->nodes[nodeIndex].center;
+        int child = ((center.X >= nodeCenter.X) ? 1 : 0) | ((center.Y >= nodeCenter.Y) ? 2 : 0) | ((center.Z >= nodeCenter.Z) ? 4 : 0);
+        if (this->nodes[nodeIndex].children[child] == -1)
+        {
+            // Make the child (this may move the node list so take copies first)
+            SLightOctreeNode childNode;
+            childNode.halfSize = this->nodes[nodeIndex].halfSize * 0.5f;
+            childNode.center = nodeCenter + irr::core::vector3df(((child & 1) != 0) ? childNode.halfSize : -childNode.halfSize,
+                                                                 ((child & 2) != 0) ? childNode.halfSize : -childNode.halfSize,
+                                                                 ((child & 4) != 0) ? childNode.halfSize : -childNode.halfSize);
+            childNode.depth = this->nodes[nodeIndex].depth + 1;
+            for (int i = 0; i < 8; i++)
+                childNode.children[i] = -1;
+            this->nodes.push_back(childNode);
+            this->nodes[nodeIndex].children[child] = (irr::s32)this->nodes.size() - 1;
+        }
+        nodeIndex = this->nodes[nodeIndex].children[child];
+    }
+    return nodeIndex;
+}
+
+void LightOctree::querySphere(const irr::core::vector3df& center, irr::f32 radius, std::vector<irr::u32>& ids) const
+{
+    ids.clear();
+    this->querySphere(0, center, radius, ids);
+}
+
+void LightOctree::querySphere(irr::s32 nodeIndex, const irr::core::vector3df& center, irr::f32 radius, std::vector<irr::u32>& ids) const
+{
+    const SLightOctreeNode& node = this->nodes[nodeIndex];
+    // Skip cells whose loose bounds miss the sphere (the root holds outliers so it is always searched)
+    if (nodeIndex != 0)
+    {
+        irr::f32 looseSize = node.halfSize * 2.0f;
+        irr::f32 distanceSquared = 0.0f;
+        irr::f32 offset[3] = { fabsf(center.X - node.center.X) - looseSize, fabsf(center.Y - node.center.Y) - looseSize, fabsf(center.Z - node.center.Z) - looseSize };
+        for (int i = 0; i < 3; i++)
+            if (offset[i] > 0.0f)
+                distanceSquared += offset[i] * offset[i];
+        if (distanceSquared > radius * radius)
+            return;
+    }
+    // Test the cell's items
+    for (size_t i = 0; i < node.items.size(); i++)
+    {
+        const SLightOctreeItem& item = this->items[node.items[i]];
+        irr::f32 reach = item.radius + radius;
+        if (item.center.getDistanceFromSQ(center) <= reach * reach)
+            ids.push_back(node.items[i]);
+    }
+    // Visit the children
+    for (int i = 0; i < 8; i++)
+        if (node.children[i] != -1)
+            this->querySphere(node.children[i], center, radius, ids);
+}
+
+void LightOctree::queryFrustum(const irr::scene::SViewFrustum& frustum, std::vector<irr::u32>& ids) const
+{
+    ids.clear();
+    this->queryFrustum(0, frustum, ids);
+}
+
+void LightOctree::queryFrustum(irr::s32 nodeIndex, const irr::scene::SViewFrustum& frustum, std::vector<irr::u32>& ids) const
+{
+    const SLightOctreeNode& node = this->nodes[nodeIndex];
+    // Skip cells whose loose bounds are completely in front of a frustum plane (the planes face outwards)
+    if (nodeIndex != 0)
+    {
+        irr::f32 looseSize = node.halfSize * 2.0f;
+        for (int i = 0; i < irr::scene::SViewFrustum::VF_PLANE_COUNT; i++)
+        {
+            const irr::core::plane3df& plane = frustum.planes[i];
+            irr::f32 extent = looseSize * (fabsf(plane.Normal.X) + fabsf(plane.Normal.Y) + fabsf(plane.Normal.Z));
+            if (plane.getDistanceTo(node.center) - extent > 0.0f)
+                return;
+        }
+    }
+    // Test the cell's items
+    for (size_t i = 0; i < node.items.size(); i++)
+    {
+        const SLightOctreeItem& item = this->items[node.items[i]];
+        bool outside = false;
+        for (int j = 0; j < irr::scene::SViewFrustum::VF_PLANE_COUNT && outside == false; j++)
+            outside = (frustum.planes[j].getDistanceTo(item.center) > item.radius);
+        if (outside == false)
+            ids.push_back(node.items[i]);
+    }
+    // Visit the children
+    for (int i = 0; i < 8; i++)
+        if (node.children[i] != -1)
+            this->queryFrustum(node.children[i], frustum, ids);
+}
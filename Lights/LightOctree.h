@@ -0,0 +1,103 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef LIGHTOCTREE_H
+#define LIGHTOCTREE_H
+
+// C/C++ Includes
+#include <vector>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+//! A cell of the LightOctree
+struct SLightOctreeNode
+{
+    // Centre of the cell
+    irr::core::vector3df center;
+    // Half the width of the cell (the loose bounds are twice this)
+    irr::f32 halfSize;
+    // Depth of the cell (the root is 0)
+    irr::u32 depth;
+    // Index of each child cell (-1 until it is needed)
+    irr::s32 children[8];
+    // Items stored in this cell
+    std::vector<irr::u32> items;
+};
+
+//! A sphere stored in the LightOctree
+struct SLightOctreeItem
+{
+    // Centre of the sphere
+    irr::core::vector3df center;
+    // Radius of the sphere
+    irr::f32 radius;
+    // Cell holding the item (-1 when the item is not in the tree)
+    irr::s32 node;
+    // Position of the item in its cell's list
+    irr::u32 slot;
+};
+
+/** The LightOctree Class is a loose octree of spheres (the light ranges)
+    identified by small integer IDs. Each cell's loose bounds are twice its
+    size, so an item lives in the deepest cell which contains its centre and
+    is at least as big as its radius. Moving an item only touches the tree
+    when it leaves its cell, and queries only visit the cells whose loose
+    bounds they overlap. Items outside the root are kept in the root **/
+class LightOctree
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        LightOctree();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Empty the tree and set the region it covers
+        void reset(const irr::core::vector3df& center, irr::f32 halfSize, irr::u32 maxDepth);
+        //! Add or move an item (returns true if it had to change cell)
+        bool update(irr::u32 id, const irr::core::vector3df& center, irr::f32 radius);
+        //! Remove an item
+        void remove(irr::u32 id);
+        //! Is an item in the tree
+        bool contains(irr::u32 id) const { return (id < this->items.size() && this->items[id].node != -1); }
+        //! Get the items whose sphere overlaps a sphere
+        void querySphere(const irr::core::vector3df& center, irr::f32 radius, std::vector<irr::u32>& ids) const;
+        //! Get the items whose sphere is inside or touches a view frustum
+        void queryFrustum(const irr::scene::SViewFrustum& frustum, std::vector<irr::u32>& ids) const;
+        //! Get the number of items in the tree
+        irr::u32 getItemCount() const { return this->itemCount; }
+        //! Get the number of cells allocated
+        irr::u32 getNodeCount() const { return (irr::u32)this->nodes.size(); }
+
+    protected:
+        //! Find (creating as needed) the cell an item belongs in
+        irr::s32 findNode(const irr::core::vector3df& center, irr::f32 radius);
+        //! Does a cell hold an item without it moving
+        bool fits(const SLightOctreeNode& node, const irr::core::vector3df& center, irr::f32 radius) const;
+        //! Query a cell and its children with a sphere
+        void querySphere(irr::s32 nodeIndex, const irr::core::vector3df& center, irr::f32 radius, std::vector<irr::u32>& ids) const;
+        //! Query a cell and its children with a frustum
+        void queryFrustum(irr::s32 nodeIndex, const irr::scene::SViewFrustum& frustum, std::vector<irr::u32>& ids) const;
+
+    protected:
+        // Cells (index 0 is the root)
+        std::vector<SLightOctreeNode> nodes;
+        // Items indexed by ID
+        std::vector<SLightOctreeItem> items;
+        // Number of items in the tree
+        irr::u32 itemCount;
+        // Deepest level a cell can be created at
+        irr::u32 maxDepth;
+};
+
+#endif // LIGHTOCTREE_H
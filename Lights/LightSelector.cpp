@@ -0,0 +1,84 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "LightSelector.h"
+
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+LightSelector::LightSelector()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->maxLightsPerNode = 8;
+}
+
+void LightSelector::setMaxLightsPerNode(irr::u32 maxLightsPerNode)
+{
+    this->maxLightsPerNode = irr::core::min_(maxLightsPerNode, (irr::u32)ShaderFrameConstants::MAX_NODE_LIGHTS);
+}
+
+void LightSelector::select(irr::scene::ISceneNode* pNode, const std::vector<SShaderLight>& lights, std::vector<irr::u32>& selected)
+{
+    // The node's bounding sphere in world space
+    irr::core::aabbox3df box = pNode->getTransformedBoundingBox();
+    this->select(box.getCenter(), box.getExtent().getLength() * 0.5f, lights, selected);
+}
+
+void LightSelector::select(const irr::core::vector3df& center, irr::f32 radius, const std::vector<SShaderLight>& lights, std::vector<irr::u32>& selected)
+{
+    // **********
+    // * SELECT *
+    // **********
+
+    // Consider every light
+    this->candidates.clear();
+    for (size_t i = 0; i < lights.size(); i++)
+        this->addCandidate(center, radius, lights[i], (irr::u32)i);
+    this->keepStrongest(selected);
+}
+
+void LightSelector::select(const irr::core::vector3df& center, irr::f32 radius, const std::vector<SShaderLight>& lights, const std::vector<irr::u32>& candidateLights, std::vector<irr::u32>& selected)
+{
+    // Consider only the candidates
+    this->candidates.clear();
+    for (size_t i = 0; i < candidateLights.size(); i++)
+        this->addCandidate(center, radius, lights[candidateLights[i]], candidateLights[i]);
+    this->keepStrongest(selected);
+}
+
+void LightSelector::addCandidate(const irr::core::vector3df& center, irr::f32 radius, const SShaderLight& light, irr::u32 index)
+{
+    // Keep the light if its range overlaps the sphere
+    irr::f32 reach = light.range + radius;
+    irr::f32 distanceSquared = light.position.getDistanceFromSQ(center);
+    if (distanceSquared > reach * reach)
+        return;
+    // Rank by brightness at the nearest point of the sphere
+    irr::f32 distance = irr::core::max_(sqrtf(distanceSquared) - radius, 0.0f);
+    this->candidates.push_back(std::make_pair(LightSelector::getContribution(light, distance), index));
+}
+
+void LightSelector::keepStrongest(std::vector<irr::u32>& selected)
+{
+    selected.clear();
+    size_t count = irr::core::min_(this->candidates.size(), (size_t)this->maxLightsPerNode);
+    std::partial_sort(this->candidates.begin(), this->candidates.begin() + count, this->candidates.end(), std::greater<std::pair<irr::f32, irr::u32> >());
+    for (size_t i = 0; i < count; i++)
+        selected.push_back(this->candidates[i].second);
+}
+
+irr::f32 LightSelector::getContribution(const SShaderLight& light, irr::f32 distance)
+{
+    // Same falloff as the shaders
+    irr::f32 attenuation = light.attenuation[0] + light.attenuation[1] * distance + light.attenuation[2] * distance * distance;
+    if (attenuation <= 0.0f)
+        return light.intensity;
+    return light.intensity / attenuation;
+}
@@ -0,0 +1,66 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef LIGHTSELECTOR_H
+#define LIGHTSELECTOR_H
+
+// C/C++ Includes
+#include <vector>
+#include <utility>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+// Game Includes
+#include "ShaderFrameConstants.h"
+
+/** The LightSelector Class picks the lights which reach a scene node. A
+    light survives if its range (see ShaderFrameConstants::getLightRange)
+    overlaps the node's transformed bounding sphere; the survivors are
+    ranked by how bright they are at the nearest point of the sphere and
+    only the strongest K are kept **/
+class LightSelector
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        LightSelector();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Select the lights reaching a node, strongest first (indices into lights)
+        void select(irr::scene::ISceneNode* pNode, const std::vector<SShaderLight>& lights, std::vector<irr::u32>& selected);
+        //! Select the lights reaching a sphere, strongest first (indices into lights)
+        void select(const irr::core::vector3df& center, irr::f32 radius, const std::vector<SShaderLight>& lights, std::vector<irr::u32>& selected);
+        //! Select from candidate lights (eg from a LightIndex query) the ones reaching a sphere, strongest first (indices into lights)
+        void select(const irr::core::vector3df& center, irr::f32 radius, const std::vector<SShaderLight>& lights, const std::vector<irr::u32>& candidateLights, std::vector<irr::u32>& selected);
+        //! Get the most lights of one type kept for a node
+        irr::u32 getMaxLightsPerNode() const { return this->maxLightsPerNode; }
+        //! Set the most lights of one type kept for a node (clamped to the shader arrays)
+        void setMaxLightsPerNode(irr::u32 maxLightsPerNode);
+        //! How bright a light is at a distance
+        static irr::f32 getContribution(const SShaderLight& light, irr::f32 distance);
+
+    protected:
+        //! Consider one light for the sphere
+        void addCandidate(const irr::core::vector3df& center, irr::f32 radius, const SShaderLight& light, irr::u32 index);
+        //! Keep the strongest candidates
+        void keepStrongest(std::vector<irr::u32>& selected);
+
+    protected:
+        // Most lights of one type kept for a node
+        irr::u32 maxLightsPerNode;
+        // Surviving lights as (contribution, index), reused between calls
+        std::vector<std::pair<irr::f32, irr::u32> > candidates;
+};
+
+#endif // LIGHTSELECTOR_H
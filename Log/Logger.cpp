@@ -0,0 +1,214 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "Logger.h"
+
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+
+Logger* Logger::getInstance()
+{
+    // Made on first use and destroyed (writing what is left) when the program exits
+    static Logger logger;
+    return &logger;
+}
+
+Logger::Logger() : messages(Logger::CAPACITY)
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    // Every slot is ready to be written at its own position
+    for (unsigned int i = 0; i < Logger::CAPACITY; i++)
+        this->messages[i].sequence = i;
+    this->writePosition = 0;
+    this->readPosition = 0;
+    this->severity = ELS_INFO;
+    this->rateLimit = 1000;
+    this->rateSecond = 0;
+    this->rateCount = 0;
+    this->dropped = 0;
+    this->droppedTotal = 0;
+    this->running = false;
+}
+
+Logger::~Logger()
+{
+    // **************
+    // * DESTRUCTOR *
+    // **************
+
+    this->shutdown();
+}
+
+void Logger::start()
+{
+    if (this->running == true)
+        return;
+    this->running = true;
+    this->writer = std::thread(&Logger::writerMain, this);
+}
+
+void Logger::shutdown()
+{
+    if (this->running == false)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(this->wakeMutex);
+        this->running = false;
+    }
+    this->wakeCondition.notify_one();
+    this->writer.join();
+    // Anything logged while the writer stopped
+    std::string batch;
+    this->drain(batch);
+}
+
+bool Logger::parseSeverity(const std::string& name, E_LOG_SEVERITY& severity)
+{
+    if (name == "debug")
+        severity = ELS_DEBUG;
+    else if (name == "info")
+        severity = ELS_INFO;
+    else if (name == "warning")
+        severity = ELS_WARNING;
+    else if (name == "error")
+        severity = ELS_ERROR;
+    else if (name == "none")
+        severity = ELS_NONE;
+    else
+        return false;
+    return true;
+}
+
+bool Logger::claimRate(E_LOG_SEVERITY severity)
+{
+    unsigned int limit = this->rateLimit.load(std::memory_order_relaxed);
+    if (limit == 0 || severity >= ELS_ERROR)
+        return true;
+    // Start counting again each second (whichever thread sees the new second first resets the count)
+    long long second = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    long long lastSecond = this->rateSecond.load(std::memory_order_relaxed);
+    if (second != lastSecond && this->rateSecond.compare_exchange_strong(lastSecond, second) == true)
+        this->rateCount = 0;
+    return (this->rateCount++ < limit);
+}
+
+bool Logger::log(E_LOG_SEVERITY severity, const std::string& text)
+{
+    if (this->isEnabled(severity) == false)
+        return false;
+    if (this->running == false)
+    {
+        writeDirect(severity, text.c_str());
+        return true;
+    }
+    if (this->claimRate(severity) == false)
+    {
+        this->dropped++;
+        this->droppedTotal++;
+        return false;
+    }
+    // CLAIM A SLOT
+    unsigned long long position = this->writePosition.load(std::memory_order_relaxed);
+    SLogMessage* pMessage = 0;
+    while (true)
+    {
+        pMessage = &this->messages[position & (Logger::CAPACITY - 1)];
+        unsigned long long sequence = pMessage->sequence.load(std::memory_order_acquire);
+        if (sequence == position)
+        {
+            // Free, take it unless another thread got there first (which reloads position)
+            if (this->writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed) == true)
+                break;
+        }
+        else if (sequence < position)
+        {
+            // The writer has not read this slot since the last time round, drop rather than wait
+            this->dropped++;
+            this->droppedTotal++;
+            return false;
+        }
+        else
+            position = this->writePosition.load(std::memory_order_relaxed);
+    }
+    // WRITE THE MESSAGE
+    pMessage->severity = severity;
+    size_t length = std::min(text.size(), sizeof(pMessage->text) - 1);
+    memcpy(pMessage->text, text.c_str(), length);
+    pMessage->text[length] = '\0';
+    // Hand it to the writer
+    pMessage->sequence.store(position + 1, std::memory_order_release);
+    this->wakeCondition.notify_one();
+    return true;
+}
+
+void Logger::format(std::string& output, E_LOG_SEVERITY severity, const char* text)
+{
+    switch (severity)
+    {
+        case ELS_DEBUG: output += "DEBUG: "; break;
+        case ELS_WARNING: output += "WARNING: "; break;
+        case ELS_ERROR: output += "ERROR: "; break;
+        default: break;
+    }
+    output += text;
+    output += '\n';
+}
+
+void Logger::writeDirect(E_LOG_SEVERITY severity, const char* text)
+{
+    std::string line;
+    Logger::format(line, severity, text);
+    std::cout << line << std::flush;
+}
+
+unsigned int Logger::drain(std::string& batch)
+{
+    batch.clear();
+    unsigned int count = 0;
+    while (true)
+    {
+        SLogMessage& message = this->messages[this->readPosition & (Logger::CAPACITY - 1)];
+        if (message.sequence.load(std::memory_order_acquire) != this->readPosition + 1)
+            break;
+        Logger::format(batch, message.severity, message.text);
+        // Ready to be written again one time round the ring later
+        message.sequence.store(this->readPosition + Logger::CAPACITY, std::memory_order_release);
+        this->readPosition++;
+        count++;
+    }
+    // Report the drops since last time
+    unsigned long long dropped = this->dropped.exchange(0);
+    if (dropped > 0)
+    {
+        std::ostringstream text;
+        text << dropped << " log messages dropped";
+        Logger::format(batch, ELS_WARNING, text.str().c_str());
+    }
+    // One write and one flush for the whole batch
+    if (batch.empty() == false)
+        std::cout << batch << std::flush;
+    return count;
+}
+
+void Logger::writerMain()
+{
+    std::string batch;
+    batch.reserve(64 * 1024);
+    while (this->running == true)
+    {
+        if (this->drain(batch) > 0)
+            continue;
+        // Sleep until a message is logged (the timeout covers a wake up sent just before waiting)
+        std::unique_lock<std::mutex> lock(this->wakeMutex);
+        if (this->running == true)
+            this->wakeCondition.wait_for(lock, std::chrono::milliseconds(10));
+    }
+}
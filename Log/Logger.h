@@ -0,0 +1,161 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+// C/C++ Includes
+#include <string>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+//! Severity of a log message (messages below the Logger's severity are discarded)
+enum E_LOG_SEVERITY
+{
+    // Detail only wanted when tracking a problem down
+    ELS_DEBUG = 0,
+    // Progress messages
+    ELS_INFO,
+    // Something went wrong but the game carries on
+    ELS_WARNING,
+    // Something failed
+    ELS_ERROR,
+    // Log nothing (only used as the Logger's severity)
+    ELS_NONE
+};
+
+//! A slot of the Logger's ring buffer
+struct SLogMessage
+{
+    // Position in the ring the slot is ready for: equal when it can be written, one more when it can be read
+    std::atomic<unsigned long long> sequence;
+    // Severity of the message
+    E_LOG_SEVERITY severity;
+    // The message (truncated to fit)
+    char text[512];
+};
+
+/** The Logger Class writes log messages to stdout on a background thread
+    so that the thread logging never waits for the console. Messages are
+    copied into a fixed size ring buffer which any number of threads write
+    to without locks (each claims a slot by advancing the write position
+    with a compare and swap). The writer thread takes every ready message,
+    writes them in one batch and flushes once. When the ring is full, or
+    more than the rate limit are logged in a second, the message is dropped
+    and counted instead, and the writer reports how many were dropped.
+    Errors are never rate limited. Before start and after shutdown messages
+    are written straight to stdout **/
+class Logger
+{
+    // ***********************
+    // * SINGLETON FUNCTIONS *
+    // ***********************
+
+    public:
+        //! Get the Logger
+        static Logger* getInstance();
+
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    protected:
+        //! Constructor
+        Logger();
+        //! Destructor (writes what is left)
+        virtual ~Logger();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Start the writer thread
+        void start();
+        //! Write the messages left and stop the writer thread
+        void shutdown();
+        //! Log a message (any thread, returns false if it was filtered or dropped)
+        bool log(E_LOG_SEVERITY severity, const std::string& text);
+        //! Would a message of a severity be logged
+        bool isEnabled(E_LOG_SEVERITY severity) const { return (severity >= this->severity.load(std::memory_order_relaxed) && severity != ELS_NONE); }
+        //! Set the lowest severity logged
+        void setSeverity(E_LOG_SEVERITY severity) { this->severity = severity; }
+        //! Get the lowest severity logged
+        E_LOG_SEVERITY getSeverity() const { return this->severity; }
+        //! Set the most messages logged per second below ERROR (0 for no limit)
+        void setRateLimit(unsigned int rateLimit) { this->rateLimit = rateLimit; }
+        //! Get the number of messages dropped so far
+        unsigned long long getDroppedCount() const { return this->droppedTotal.load(); }
+        //! Parse a severity name (debug, info, warning, error or none, returns false if unknown)
+        static bool parseSeverity(const std::string& name, E_LOG_SEVERITY& severity);
+
+    public:
+        // Messages the ring buffer holds (a power of two)
+        static const unsigned int CAPACITY = 4096;
+
+    protected:
+        //! Is the message within the rate limit
+        bool claimRate(E_LOG_SEVERITY severity);
+        //! Write a message to stdout (used when the writer is not running)
+        static void writeDirect(E_LOG_SEVERITY severity, const char* text);
+        //! Append a message with its severity prefix
+        static void format(std::string& output, E_LOG_SEVERITY severity, const char* text);
+        //! Writer thread loop
+        void writerMain();
+        //! Write every ready message (returns the number written)
+        unsigned int drain(std::string& batch);
+
+    protected:
+        // The ring buffer
+        std::vector<SLogMessage> messages;
+        // Next position written and next position read (only the writer reads)
+        std::atomic<unsigned long long> writePosition;
+        unsigned long long readPosition;
+        // Lowest severity logged
+        std::atomic<E_LOG_SEVERITY> severity;
+        // Rate limit (messages per second, 0 for none) and the current second and its count
+        std::atomic<unsigned int> rateLimit;
+        std::atomic<long long> rateSecond;
+        std::atomic<unsigned int> rateCount;
+        // Messages dropped since the writer last reported and in total
+        std::atomic<unsigned long long> dropped;
+        std::atomic<unsigned long long> droppedTotal;
+        // Writer thread
+        std::thread writer;
+        // Is the writer running
+        std::atomic<bool> running;
+        // Wakes the writer
+        std::mutex wakeMutex;
+        std::condition_variable wakeCondition;
+};
+
+/** The LogMessage Class builds a message with << and logs it when it goes
+    out of scope, e.g. LogMessage(ELS_INFO) << "Loaded " << count << " meshes";
+    Nothing is formatted when the severity is filtered out **/
+class LogMessage
+{
+    public:
+        //! Constructor
+        LogMessage(E_LOG_SEVERITY severity) : severity(severity), enabled(Logger::getInstance()->isEnabled(severity)) {}
+        //! Destructor (logs the message)
+        ~LogMessage() { if (this->enabled == true) Logger::getInstance()->log(this->severity, this->stream.str()); }
+        //! Append to the message
+        template <typename T> LogMessage& operator<<(const T& value) { if (this->enabled == true) this->stream << value; return *this; }
+
+    protected:
+        // Severity of the message
+        E_LOG_SEVERITY severity;
+        // Is the severity logged
+        bool enabled;
+        // The message so far
+        std::ostringstream stream;
+};
+
+#endif // LOGGER_H
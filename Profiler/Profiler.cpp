@@ -0,0 +1,205 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "Profiler.h"
+
+Profiler::Profiler()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    // The overlay is hidden until toggled
+    this->overlayVisible = false;
+    // Not tracing
+    this->pTraceRecorder = 0;
+    this->lastFrameEndTimestamp = 0;
+    // Clear the history
+    this->reset();
+}
+
+Profiler::~Profiler()
+{
+    // **************
+    // * DESTRUCTOR *
+    // **************
+}
+
+void Profiler::reset()
+{
+    // Clear the ring buffer
+    for (int i = 0; i < Profiler::HISTORY_SIZE; i++)
+        for (int j = 0; j < EPS_COUNT; j++)
+            this->history[i][j] = 0.0;
+    for (int j = 0; j < EPS_COUNT; j++)
+    {
+        this->currentFrame[j] = 0.0;
+        this->historySum[j] = 0.0;
+    }
+    this->historyHead = 0;
+    this->historyCount = 0;
+    for (int j = 0; j < EPC_COUNT; j++)
+        this->counters[j] = 0;
+    // Restart the frame clock
+    this->lastFrameEnd = std::chrono::steady_clock::now();
+    if (this->pTraceRecorder != 0)
+        this->lastFrameEndTimestamp = this->pTraceRecorder->getTimestamp();
+}
+
+void Profiler::beginSection(E_PROFILER_SECTION section)
+{
+    this->sectionStart[section] = std::chrono::steady_clock::now();
+    if (this->pTraceRecorder != 0)
+        this->pTraceRecorder->beginEvent(Profiler::getSectionName(section), "frame");
+}
+
+void Profiler::endSection(E_PROFILER_SECTION section)
+{
+    // Accumulate so that sections hit more than once per frame add up
+    this->currentFrame[section] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->sectionStart[section]).count();
+    if (this->pTraceRecorder != 0)
+        this->pTraceRecorder->endEvent(Profiler::getSectionName(section), "frame");
+}
+
+void Profiler::endFrame()
+{
+    // The frame time is the time between the ends of consecutive frames
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    this->currentFrame[EPS_FRAME] = std::chrono::duration<double, std::milli>(now - this->lastFrameEnd).count();
+    this->lastFrameEnd = now;
+    // Record the whole frame as one trace event
+    if (this->pTraceRecorder != 0 && this->pTraceRecorder->isRecording() == true)
+    {
+        this->pTraceRecorder->completeEvent(Profiler::getSectionName(EPS_FRAME), "frame", this->lastFrameEndTimestamp);
+        this->lastFrameEndTimestamp = this->pTraceRecorder->getTimestamp();
+    }
+    // Write the frame into the ring buffer keeping the running totals up to date
+    for (int j = 0; j < EPS_COUNT; j++)
+    {
+        this->historySum[j] = this->historySum[j] - this->history[this->historyHead][j] + this->currentFrame[j];
+        this->history[this->historyHead][j] = this->currentFrame[j];
+        this->currentFrame[j] = 0.0;
+    }
+    this->historyHead = (this->historyHead + 1) % Profiler::HISTORY_SIZE;
+    if (this->historyCount < Profiler::HISTORY_SIZE)
+        this->historyCount++;
+}
+
+const double* Profiler::getLastFrame()
+{
+    // The last frame written sits behind the head of the ring buffer
+    return this->history[(this->historyHead + Profiler::HISTORY_SIZE - 1) % Profiler::HISTORY_SIZE];
+}
+
+double Profiler::getAverage(E_PROFILER_SECTION section)
+{
+    if (this->historyCount == 0)
+        return 0.0;
+    return this->historySum[section] / (double)this->historyCount;
+}
+
+const char* Profiler::getSectionName(E_PROFILER_SECTION section)
+{
+    switch (section)
+    {
+        case EPS_FRAME: return "frame";
+        case EPS_HANDLE_EVENTS: return "handleEvents";
+        case EPS_THINK: return "think";
+        case EPS_UPDATE: return "update";
+        case EPS_DRAW: return "draw";
+        case EPS_DRAW_SCENE: return "drawScene";
+        case EPS_DRAW_GUI: return "drawGUI";
+        case EPS_HANDOFF: return "handoff";
+        case EPS_LATENCY: return "latency";
+        case EPS_LOAD: return "load";
+        default: return "unknown";
+    }
+}
+
+const char* Profiler::getCounterName(E_PROFILER_COUNTER counter)
+{
+    switch (counter)
+    {
+        case EPC_QUEUED_NODES: return "queuedNodes";
+        case EPC_PROGRAM_BINDS: return "programBinds";
+        case EPC_TEXTURE_BINDS: return "textureBinds";
+        case EPC_INSTANCES: return "instances";
+        case EPC_INSTANCE_DRAW_CALLS: return "instanceDrawCalls";
+        case EPC_SKINNED_NODES: return "skinnedNodes";
+        default: return "unknown";
+    }
+}
+
+void Profiler::drawOverlay(irr::video::IVideoDriver* pVideoDriver, irr::gui::IGUIFont* pGUIFont, const irr::core::position2di& position)
+{
+    // ****************
+    // * DRAW OVERLAY *
+    // ****************
+
+    // Only draw if visible
+    if (this->overlayVisible == false || pVideoDriver == 0 || pGUIFont == 0)
+        return;
+
+    // Layout
+    const int lineHeight = 16;
+    const int textWidth = 260;
+    const int graphHeight = 100;
+    // Frame budget drawn as a reference line on the graph (60 Hz)
+    const double frameBudget = 1000.0 / 60.0;
+    // Time at the top of the graph
+    const double graphScale = 2.0 * frameBudget;
+
+    // Background
+    int textHeight = lineHeight * (EPS_COUNT + EPC_COUNT) + 4;
+    pVideoDriver->draw2DRectangle(irr::video::SColor(160, 0, 0, 0), irr::core::rect<irr::s32>(position.X, position.Y, position.X + irr::core::max_(textWidth, (int)Profiler::HISTORY_SIZE) + 8, position.Y + textHeight + graphHeight + 8));
+
+    // ROLLING AVERAGES
+    for (int j = 0; j < EPS_COUNT; j++)
+    {
+        double average = this->getAverage((E_PROFILER_SECTION)j);
+        std::wostringstream text;
+        text << std::fixed << std::setprecision(2);
+        // Nested sections are indented under draw
+        if (j == EPS_DRAW_SCENE || j == EPS_DRAW_GUI)
+            text << L"  ";
+        text << Profiler::getSectionName((E_PROFILER_SECTION)j) << L": " << average << L" ms";
+        if (j == EPS_FRAME && average > 0.0)
+            text << L" (" << std::setprecision(0) << 1000.0 / average << L" fps)";
+        irr::core::rect<irr::s32> rect(position.X + 4, position.Y + 4 + j * lineHeight, position.X + 4 + textWidth, position.Y + 4 + (j + 1) * lineHeight);
+        pGUIFont->draw(irr::core::stringw(text.str().c_str()), rect, irr::video::SColor(255, 255, 255, 255), false, false, 0);
+    }
+
+    // COUNTERS
+    for (int j = 0; j < EPC_COUNT; j++)
+    {
+        std::wostringstream text;
+        text << Profiler::getCounterName((E_PROFILER_COUNTER)j) << L": " << this->counters[j];
+        int line = EPS_COUNT + j;
+        irr::core::rect<irr::s32> rect(position.X + 4, position.Y + 4 + line * lineHeight, position.X + 4 + textWidth, position.Y + 4 + (line + 1) * lineHeight);
+        pGUIFont->draw(irr::core::stringw(text.str().c_str()), rect, irr::video::SColor(255, 255, 255, 255), false, false, 0);
+    }
+
+    // FRAME TIME GRAPH
+    int graphLeft = position.X + 4;
+    int graphBottom = position.Y + textHeight + graphHeight + 4;
+    // One bar per frame oldest on the left
+    for (int i = 0; i < this->historyCount; i++)
+    {
+        int index = (this->historyHead - this->historyCount + i + Profiler::HISTORY_SIZE) % Profiler::HISTORY_SIZE;
+        double frameTime = this->history[index][EPS_FRAME];
+        int barHeight = (int)(irr::core::clamp(frameTime / graphScale, 0.0, 1.0) * graphHeight);
+        // Green inside the budget, yellow up to twice the budget, red beyond that
+        irr::video::SColor colour(255, 0, 255, 0);
+        if (frameTime > frameBudget)
+            colour = irr::video::SColor(255, 255, 255, 0);
+        if (frameTime >= graphScale)
+            colour = irr::video::SColor(255, 255, 0, 0);
+        pVideoDriver->draw2DLine(irr::core::position2di(graphLeft + i, graphBottom), irr::core::position2di(graphLeft + i, graphBottom - barHeight), colour);
+    }
+    // Frame budget reference line
+    int budgetY = graphBottom - (int)(frameBudget / graphScale * graphHeight);
+    pVideoDriver->draw2DLine(irr::core::position2di(graphLeft, budgetY), irr::core::position2di(graphLeft + Profiler::HISTORY_SIZE, budgetY), irr::video::SColor(255, 255, 255, 255));
+}
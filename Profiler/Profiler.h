@@ -0,0 +1,177 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// C/C++ Includes
+#include <string>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+// Game Includes
+#include "TraceRecorder.h"
+
+//! Sections of a frame timed by the Profiler
+enum E_PROFILER_SECTION
+{
+    // The whole frame (from the end of the last frame to the end of this frame)
+    EPS_FRAME = 0,
+    // Game::handleEvents
+    EPS_HANDLE_EVENTS,
+    // Game::think
+    EPS_THINK,
+    // Game::update
+    EPS_UPDATE,
+    // Game::draw
+    EPS_DRAW,
+    // ISceneManager::drawAll inside Game::draw
+    EPS_DRAW_SCENE,
+    // IGUIEnvironment::drawAll inside Game::draw
+    EPS_DRAW_GUI,
+    // Waiting for the simulation running ahead to hand over its scene state (pipelined mode)
+    EPS_HANDOFF,
+    // From the start of simulating the scene state drawn this frame to the end of drawing it
+    EPS_LATENCY,
+    // Load stages run by Game::run until the game is fully loaded
+    EPS_LOAD,
+    // Number of sections
+    EPS_COUNT
+};
+
+//! Counts reported by the Profiler each frame
+enum E_PROFILER_COUNTER
+{
+    // Nodes drawn by the render queue
+    EPC_QUEUED_NODES = 0,
+    // Shader program changes made by the render queue
+    EPC_PROGRAM_BINDS,
+    // Texture changes made by the render queue
+    EPC_TEXTURE_BINDS,
+    // Instances drawn by the instanced node
+    EPC_INSTANCES,
+    // Draw calls made by the instanced node
+    EPC_INSTANCE_DRAW_CALLS,
+    // Nodes skinned by the batched CPU skinning pass
+    EPC_SKINNED_NODES,
+    // Number of counters
+    EPC_COUNT
+};
+
+/** The Profiler Class times each section of a frame with a high resolution
+    clock and keeps the times of the last HISTORY_SIZE frames in a fixed size
+    ring buffer. It can draw an overlay showing the rolling averages, the
+    last frame's counters and a graph of the frame times **/
+class Profiler
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        Profiler();
+        //! Destructor
+        virtual ~Profiler();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        // Number of frames kept in the ring buffer
+        static const int HISTORY_SIZE = 240;
+
+    public:
+        //! Clear the history and restart the frame clock
+        virtual void reset();
+        //! Start timing a section of the current frame
+        virtual void beginSection(E_PROFILER_SECTION section);
+        //! Stop timing a section of the current frame (a section may be timed many times per frame)
+        virtual void endSection(E_PROFILER_SECTION section);
+        //! Add a time (in milliseconds) measured elsewhere to a section of the current frame
+        virtual void addSectionTime(E_PROFILER_SECTION section, double time) { this->currentFrame[section] += time; }
+        //! End the current frame and push its times into the ring buffer
+        virtual void endFrame();
+        //! Get the times (in milliseconds) of each section of the last completed frame
+        virtual const double* getLastFrame();
+        //! Get the rolling average time (in milliseconds) of a section
+        virtual double getAverage(E_PROFILER_SECTION section);
+        //! Get the number of frames in the ring buffer
+        virtual int getFrameCount() { return this->historyCount; }
+        //! Get the name of a section
+        static const char* getSectionName(E_PROFILER_SECTION section);
+        //! Set a counter for the current frame (shown until it is set again)
+        virtual void setCounter(E_PROFILER_COUNTER counter, irr::u32 value) { this->counters[counter] = value; }
+        //! Get a counter
+        virtual irr::u32 getCounter(E_PROFILER_COUNTER counter) { return this->counters[counter]; }
+        //! Get the name of a counter
+        static const char* getCounterName(E_PROFILER_COUNTER counter);
+        //! Set the TraceRecorder sections are also written to (0 for none)
+        virtual void setTraceRecorder(TraceRecorder* pTraceRecorder) { this->pTraceRecorder = pTraceRecorder; }
+
+    protected:
+        // Sections are also recorded as trace events when this is set
+        TraceRecorder* pTraceRecorder;
+        // Trace timestamp of the end of the last frame
+        long long lastFrameEndTimestamp;
+        // Start of each section that is currently being timed
+        std::chrono::steady_clock::time_point sectionStart[EPS_COUNT];
+        // End of the last frame
+        std::chrono::steady_clock::time_point lastFrameEnd;
+        // Times of the frame being recorded
+        double currentFrame[EPS_COUNT];
+        // Ring buffer of the times of the last HISTORY_SIZE frames
+        double history[HISTORY_SIZE][EPS_COUNT];
+        // Running totals of the ring buffer (used for the rolling averages)
+        double historySum[EPS_COUNT];
+        // Index the next frame is written to
+        int historyHead;
+        // Number of frames in the ring buffer
+        int historyCount;
+        // Last value of each counter
+        irr::u32 counters[EPC_COUNT];
+
+    // ***********
+    // * OVERLAY *
+    // ***********
+
+    public:
+        //! Draw the overlay (averages and a frame time graph)
+        virtual void drawOverlay(irr::video::IVideoDriver* pVideoDriver, irr::gui::IGUIFont* pGUIFont, const irr::core::position2di& position);
+        //! Is the overlay visible
+        virtual bool isOverlayVisible() { return this->overlayVisible; }
+        //! Set the overlay visible
+        virtual void setOverlayVisible(bool state) { this->overlayVisible = state; }
+        //! Toggle the overlay
+        virtual void toggleOverlay() { this->overlayVisible = !this->overlayVisible; }
+
+    protected:
+        // Is the overlay drawn
+        bool overlayVisible;
+};
+
+/** The ProfilerScope Class times a section for as long as it is in scope **/
+class ProfilerScope
+{
+    public:
+        //! Constructor (starts timing the section)
+        ProfilerScope(Profiler* pProfiler, E_PROFILER_SECTION section) : pProfiler(pProfiler), section(section) { this->pProfiler->beginSection(this->section); }
+        //! Destructor (stops timing the section)
+        ~ProfilerScope() { this->pProfiler->endSection(this->section); }
+
+    protected:
+        // The profiler being written to
+        Profiler* pProfiler;
+        // The section being timed
+        E_PROFILER_SECTION section;
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,351 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "CPUSkinning.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "GPUSkinning.h"
+#include "Logger.h"
+
+// Blend the bone matrices four floats at a time when SSE is available
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define CPUSKINNING_SSE
+#endif
+
+CPUSkinning::CPUSkinning()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->pJobSystem = 0;
+    this->skinnedNodeCount = 0;
+    this->skinnedVertexCount = 0;
+}
+
+bool CPUSkinning::addMesh(irr::scene::ISkinnedMesh* pSkinnedMesh)
+{
+    // ************
+    // * ADD MESH *
+    // ************
+
+    if (pSkinnedMesh == 0)
+        return false;
+    for (size_t i = 0; i < this->meshes.size(); i++)
+        if (this->meshes[i].pMesh == pSkinnedMesh)
+            return true;
+    irr::core::array<irr::scene::ISkinnedMesh::SJoint*>& joints = pSkinnedMesh->getAllJoints();
+    if (joints.size() > 65535)
+    {
+        LogMessage(ELS_WARNING) << "A mesh with " << joints.size() << " joints is left to Irrlicht's skinning";
+        return false;
+    }
+
+    // Put the vertices back in the bind pose and stop Irrlicht moving them
+    pSkinnedMesh->setHardwareSkinning(true);
+
+    SCPUSkinnedMesh mesh;
+    mesh.pMesh = pSkinnedMesh;
+    mesh.buffers.resize(pSkinnedMesh->getMeshBufferCount());
+    mesh.bufferJoints.resize(pSkinnedMesh->getMeshBufferCount(), -1);
+
+    // COPY THE BIND POSE
+    for (irr::u32 i = 0; i < pSkinnedMesh->getMeshBufferCount(); i++)
+    {
+        irr::scene::IMeshBuffer* pMeshBuffer = pSkinnedMesh->getMeshBuffer(i);
+        SCPUSkinnedBuffer& buffer = mesh.buffers[i];
+        buffer.vertexType = pMeshBuffer->getVertexType();
+        buffer.vertexPitch = irr::video::getVertexPitchFromType(buffer.vertexType);
+        buffer.vertexCount = pMeshBuffer->getVertexCount();
+        buffer.positions.resize(4 * buffer.vertexCount, 0.0f);
+        buffer.normals.resize(4 * buffer.vertexCount, 0.0f);
+        // Every vertex type starts with the standard vertex
+        const irr::u8* pVertices = (const irr::u8*)pMeshBuffer->getVertices();
+        for (irr::u32 j = 0; j < buffer.vertexCount; j++)
+        {
+            const irr::video::S3DVertex& vertex = *(const irr::video::S3DVertex*)(pVertices + j * buffer.vertexPitch);
+            buffer.positions[4 * j + 0] = vertex.Pos.X;
+            buffer.positions[4 * j + 1] = vertex.Pos.Y;
+            buffer.positions[4 * j + 2] = vertex.Pos.Z;
+            buffer.normals[4 * j + 0] = vertex.Normal.X;
+            buffer.normals[4 * j + 1] = vertex.Normal.Y;
+            buffer.normals[4 * j + 2] = vertex.Normal.Z;
+        }
+    }
+
+    // GATHER EACH VERTEX'S BONES
+    /* Every weight is kept (Irrlicht applies them all), counted first and
+        then written into one array per buffer */
+    for (irr::u32 i = 0; i < mesh.buffers.size(); i++)
+        mesh.buffers[i].influenceOffsets.resize(mesh.buffers[i].vertexCount + 1, 0);
+    for (irr::u32 j = 0; j < joints.size(); j++)
+    {
+        const irr::core::array<irr::scene::ISkinnedMesh::SWeight>& weights = joints[j]->Weights;
+        for (irr::u32 k = 0; k < weights.size(); k++)
+            if (weights[k].buffer_id < mesh.buffers.size() && weights[k].vertex_id < mesh.buffers[weights[k].buffer_id].vertexCount)
+                mesh.buffers[weights[k].buffer_id].influenceOffsets[weights[k].vertex_id + 1]++;
+        for (irr::u32 k = 0; k < joints[j]->AttachedMeshes.size(); k++)
+            if (joints[j]->AttachedMeshes[k] < mesh.bufferJoints.size())
+                mesh.bufferJoints[joints[j]->AttachedMeshes[k]] = (irr::s32)j;
+    }
+    std::vector<std::vector<irr::u32> > cursors(mesh.buffers.size());
+    for (irr::u32 i = 0; i < mesh.buffers.size(); i++)
+    {
+        SCPUSkinnedBuffer& buffer = mesh.buffers[i];
+        for (irr::u32 j = 0; j < buffer.vertexCount; j++)
+            buffer.influenceOffsets[j + 1] += buffer.influenceOffsets[j];
+        buffer.influenceBones.resize(buffer.influenceOffsets[buffer.vertexCount]);
+        buffer.influenceWeights.resize(buffer.influenceOffsets[buffer.vertexCount]);
+        cursors[i].assign(buffer.influenceOffsets.begin(), buffer.influenceOffsets.end() - 1);
+    }
+    for (irr::u32 j = 0; j < joints.size(); j++)
+    {
+        const irr::core::array<irr::scene::ISkinnedMesh::SWeight>& weights = joints[j]->Weights;
+        for (irr::u32 k = 0; k < weights.size(); k++)
+        {
+            const irr::scene::ISkinnedMesh::SWeight& weight = weights[k];
+            if (weight.buffer_id >= mesh.buffers.size() || weight.vertex_id >= mesh.buffers[weight.buffer_id].vertexCount)
+                continue;
+            irr::u32 influence = cursors[weight.buffer_id][weight.vertex_id]++;
+            mesh.buffers[weight.buffer_id].influenceBones[influence] = (irr::u16)j;
+            mesh.buffers[weight.buffer_id].influenceWeights[influence] = weight.strength;
+        }
+    }
+    this->meshes.push_back(mesh);
+    return true;
+}
+
+bool CPUSkinning::isSkinned(irr::scene::ISceneNode* pNode) const
+{
+    irr::scene::ISkinnedMesh* pSkinnedMesh = GPUSkinning::getSkinnedMesh(pNode);
+    if (pSkinnedMesh == 0)
+        return false;
+    for (size_t i = 0; i < this->meshes.size(); i++)
+        if (this->meshes[i].pMesh == pSkinnedMesh)
+            return true;
+    return false;
+}
+
+irr::u32 CPUSkinning::getNodeIndex(irr::scene::IAnimatedMeshSceneNode* pNode, irr::u32 meshIndex)
+{
+    std::map<irr::scene::ISceneNode*, irr::u32>::iterator found = this->nodeIndices.find(pNode);
+    if (found != this->nodeIndices.end() && this->nodes[found->second].meshIndex == meshIndex)
+        return found->second;
+    // A new node (or one whose mesh was changed) starts from copies of the mesh's vertices
+    irr::u32 index = (found != this->nodeIndices.end()) ? found->second : (irr::u32)this->nodes.size();
+    if (found == this->nodeIndices.end())
+    {
+        this->nodes.push_back(SCPUSkinnedNode());
+        this->nodeIndices[pNode] = index;
+    }
+    SCPUSkinnedNode& node = this->nodes[index];
+    const SCPUSkinnedMesh& mesh = this->meshes[meshIndex];
+    node.pNode = pNode;
+    node.meshIndex = meshIndex;
+    node.bufferTransforms.assign(mesh.buffers.size(), irr::core::matrix4());
+    node.vertices.resize(mesh.buffers.size());
+    for (irr::u32 i = 0; i < mesh.buffers.size(); i++)
+    {
+        const irr::u8* pVertices = (const irr::u8*)mesh.pMesh->getMeshBuffer(i)->getVertices();
+        node.vertices[i].assign(pVertices, pVertices + mesh.buffers[i].vertexCount * mesh.buffers[i].vertexPitch);
+    }
+    return index;
+}
+
+void CPUSkinning::skin(const std::vector<irr::scene::ISceneNode*>& nodes)
+{
+    // ********
+    // * SKIN *
+    // ********
+
+    this->jobs.clear();
+    this->skinnedNodeCount = 0;
+    this->skinnedVertexCount = 0;
+
+    // POSE THE NODES
+    /* The joints belong to the mesh every node shares so each node's pose
+        is built and copied one at a time */
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        irr::scene::ISkinnedMesh* pSkinnedMesh = GPUSkinning::getSkinnedMesh(nodes[i]);
+        if (pSkinnedMesh == 0)
+            continue;
+        irr::u32 meshIndex = 0;
+        while (meshIndex < this->meshes.size() && this->meshes[meshIndex].pMesh != pSkinnedMesh)
+            meshIndex++;
+        if (meshIndex == this->meshes.size())
+            continue;
+        irr::scene::IAnimatedMeshSceneNode* pNode = static_cast<irr::scene::IAnimatedMeshSceneNode*>(nodes[i]);
+        irr::u32 nodeIndex = this->getNodeIndex(pNode, meshIndex);
+        SCPUSkinnedNode& node = this->nodes[nodeIndex];
+        const SCPUSkinnedMesh& mesh = this->meshes[meshIndex];
+        // What CAnimatedMeshSceneNode does before it draws (the vertices are left alone in hardware skinning mode)
+        pSkinnedMesh->animateMesh(pNode->getFrameNr(), 1.0f);
+        pSkinnedMesh->skinMesh();
+        const irr::core::array<irr::scene::ISkinnedMesh::SJoint*>& joints = pSkinnedMesh->getAllJoints();
+        node.palette.resize(16 * joints.size());
+        for (irr::u32 j = 0; j < joints.size(); j++)
+        {
+            irr::core::matrix4 bone = joints[j]->GlobalAnimatedMatrix * joints[j]->GlobalInversedMatrix;
+            memcpy(&node.palette[16 * j], bone.pointer(), 16 * sizeof(irr::f32));
+        }
+        for (irr::u32 j = 0; j < mesh.bufferJoints.size(); j++)
+            if (mesh.bufferJoints[j] != -1)
+                node.bufferTransforms[j] = joints[mesh.bufferJoints[j]]->GlobalAnimatedMatrix;
+        // Split the node's vertices into jobs
+        for (irr::u32 j = 0; j < mesh.buffers.size(); j++)
+        {
+            for (irr::u32 first = 0; first < mesh.buffers[j].vertexCount; first += CPUSkinning::JOB_SIZE)
+            {
+                SCPUSkinningJob job;
+                job.node = nodeIndex;
+                job.buffer = j;
+                job.first = first;
+                job.count = irr::core::min_(CPUSkinning::JOB_SIZE, mesh.buffers[j].vertexCount - first);
+                this->jobs.push_back(job);
+            }
+            this->skinnedVertexCount += mesh.buffers[j].vertexCount;
+        }
+        this->skinnedNodeCount++;
+    }
+    if (this->jobs.empty() == true)
+        return;
+
+    // SKIN THE VERTICES
+    // The calling thread skins alongside the workers until every job is done
+    if (this->pJobSystem == 0)
+        this->runJobs(0, (irr::u32)this->jobs.size());
+    else
+        this->pJobSystem->parallelFor((unsigned int)this->jobs.size(), 1, [this](unsigned int first, unsigned int end) { this->runJobs(first, end); });
+}
+
+void CPUSkinning::runJobs(irr::u32 first, irr::u32 end)
+{
+    for (irr::u32 i = first; i < end; i++)
+    {
+        const SCPUSkinningJob& job = this->jobs[i];
+        SCPUSkinnedNode& node = this->nodes[job.node];
+        CPUSkinning::skinRange(this->meshes[node.meshIndex].buffers[job.buffer], &node.palette[0], job.first, job.count, &node.vertices[job.buffer][0]);
+    }
+}
+
+void CPUSkinning::skinRange(const SCPUSkinnedBuffer& buffer, const irr::f32* pPalette, irr::u32 first, irr::u32 count, irr::u8* pVertices)
+{
+    /* NOTES: Irrlicht adds up each bone's transformation of the vertex times
+        its weight. The same sum is found by blending the matrices first and
+        transforming once, which costs the same for one bone and much less
+        for several. The matrices are column major so a transformed point is
+        the columns scaled by x, y and z plus the fourth column */
+
+    const irr::u32* pOffsets = &buffer.influenceOffsets[0];
+    for (irr::u32 i = first; i < first + count; i++)
+    {
+        irr::video::S3DVertex& vertex = *(irr::video::S3DVertex*)(pVertices + i * buffer.vertexPitch);
+        irr::u32 influenceStart = pOffsets[i];
+        irr::u32 influenceEnd = pOffsets[i + 1];
+        // Vertices no bone moves keep the bind pose
+        if (influenceStart == influenceEnd)
+        {
+            vertex.Pos.set(buffer.positions[4 * i + 0], buffer.positions[4 * i + 1], buffer.positions[4 * i + 2]);
+            vertex.Normal.set(buffer.normals[4 * i + 0], buffer.normals[4 * i + 1], buffer.normals[4 * i + 2]);
+            continue;
+        }
+#ifdef CPUSKINNING_SSE
+        // Blend the matrices
+        __m128 column0 = _mm_setzero_ps();
+        __m128 column1 = _mm_setzero_ps();
+        __m128 column2 = _mm_setzero_ps();
+        __m128 column3 = _mm_setzero_ps();
+        for (irr::u32 j = influenceStart; j < influenceEnd; j++)
+        {
+            const irr::f32* pBone = pPalette + 16 * buffer.influenceBones[j];
+            __m128 weight = _mm_set1_ps(buffer.influenceWeights[j]);
+            column0 = _mm_add_ps(column0, _mm_mul_ps(weight, _mm_loadu_ps(pBone + 0)));
+            column1 = _mm_add_ps(column1, _mm_mul_ps(weight, _mm_loadu_ps(pBone + 4)));
+            column2 = _mm_add_ps(column2, _mm_mul_ps(weight, _mm_loadu_ps(pBone + 8)));
+            column3 = _mm_add_ps(column3, _mm_mul_ps(weight, _mm_loadu_ps(pBone + 12)));
+        }
+        // Transform the position and normal
+        const irr::f32* pPosition = &buffer.positions[4 * i];
+        const irr::f32* pNormal = &buffer.normals[4 * i];
+        __m128 position = _mm_add_ps(_mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(pPosition[0])), _mm_mul_ps(column1, _mm_set1_ps(pPosition[1]))),
+                                     _mm_add_ps(_mm_mul_ps(column2, _mm_set1_ps(pPosition[2])), column3));
+        __m128 normal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(pNormal[0])), _mm_mul_ps(column1, _mm_set1_ps(pNormal[1]))),
+                                   _mm_mul_ps(column2, _mm_set1_ps(pNormal[2])));
+        irr::f32 result[8];
+        _mm_storeu_ps(&result[0], position);
+        _mm_storeu_ps(&result[4], normal);
+        vertex.Pos.set(result[0], result[1], result[2]);
+        vertex.Normal.set(result[4], result[5], result[6]);
+#else
+        // Blend the matrices
+        irr::f32 blend[16];
+        for (int k = 0; k < 16; k++)
+            blend[k] = 0.0f;
+        for (irr::u32 j = influenceStart; j < influenceEnd; j++)
+        {
+            const irr::f32* pBone = pPalette + 16 * buffer.influenceBones[j];
+            irr::f32 weight = buffer.influenceWeights[j];
+            for (int k = 0; k < 16; k++)
+                blend[k] += weight * pBone[k];
+        }
+        // Transform the position and normal
+        const irr::f32* pPosition = &buffer.positions[4 * i];
+        const irr::f32* pNormal = &buffer.normals[4 * i];
+        vertex.Pos.set(blend[0] * pPosition[0] + blend[4] * pPosition[1] + blend[8] * pPosition[2] + blend[12],
+                       blend[1] * pPosition[0] + blend[5] * pPosition[1] + blend[9] * pPosition[2] + blend[13],
+                       blend[2] * pPosition[0] + blend[6] * pPosition[1] + blend[10] * pPosition[2] + blend[14]);
+        vertex.Normal.set(blend[0] * pNormal[0] + blend[4] * pNormal[1] + blend[8] * pNormal[2],
+                          blend[1] * pNormal[0] + blend[5] * pNormal[1] + blend[9] * pNormal[2],
+                          blend[2] * pNormal[0] + blend[6] * pNormal[1] + blend[10] * pNormal[2]);
+#endif
+    }
+}
+
+bool CPUSkinning::render(irr::scene::ISceneNode* pNode)
+{
+    // **********
+    // * RENDER *
+    // **********
+
+    std::map<irr::scene::ISceneNode*, irr::u32>::const_iterator found = this->nodeIndices.find(pNode);
+    if (found == this->nodeIndices.end())
+        return false;
+    const SCPUSkinnedNode& node = this->nodes[found->second];
+    const SCPUSkinnedMesh& mesh = this->meshes[node.meshIndex];
+    irr::video::IVideoDriver* pVideoDriver = pNode->getSceneManager()->getVideoDriver();
+    for (irr::u32 i = 0; i < mesh.buffers.size() && i < pNode->getMaterialCount(); i++)
+    {
+        const SCPUSkinnedBuffer& buffer = mesh.buffers[i];
+        irr::scene::IMeshBuffer* pMeshBuffer = mesh.pMesh->getMeshBuffer(i);
+        if (buffer.vertexCount == 0 || pMeshBuffer->getIndexCount() == 0)
+            continue;
+        // Same as CAnimatedMeshSceneNode draws a skinned mesh buffer, from the node's own vertices
+        pVideoDriver->setTransform(irr::video::ETS_WORLD, pNode->getAbsoluteTransformation() * node.bufferTransforms[i]);
+        pVideoDriver->setMaterial(pNode->getMaterial(i));
+        pVideoDriver->drawVertexPrimitiveList(&node.vertices[i][0], buffer.vertexCount, pMeshBuffer->getIndices(), pMeshBuffer->getIndexCount() / 3,
+                                              buffer.vertexType, irr::scene::EPT_TRIANGLES, pMeshBuffer->getIndexType());
+    }
+    return true;
+}
+
+const irr::u8* CPUSkinning::getVertices(irr::scene::ISceneNode* pNode, irr::u32 buffer) const
+{
+    std::map<irr::scene::ISceneNode*, irr::u32>::const_iterator found = this->nodeIndices.find(pNode);
+    if (found == this->nodeIndices.end() || buffer >= this->nodes[found->second].vertices.size() || this->nodes[found->second].vertices[buffer].empty() == true)
+        return 0;
+    return &this->nodes[found->second].vertices[buffer][0];
+}
+
+void CPUSkinning::clearNodes()
+{
+    this->nodes.clear();
+    this->nodeIndices.clear();
+    this->jobs.clear();
+}
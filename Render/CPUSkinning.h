@@ -0,0 +1,147 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef CPUSKINNING_H
+#define CPUSKINNING_H
+
+// C/C++ Includes
+#include <vector>
+#include <map>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+// Game Includes
+#include "JobSystem.h"
+
+//! The bind pose and bone weights of a mesh buffer skinned by CPUSkinning
+struct SCPUSkinnedBuffer
+{
+    // Vertex type and size
+    irr::video::E_VERTEX_TYPE vertexType;
+    irr::u32 vertexPitch;
+    irr::u32 vertexCount;
+    // Bind pose positions and normals (x, y, z, 0 for each vertex)
+    std::vector<irr::f32> positions;
+    std::vector<irr::f32> normals;
+    // Where each vertex's influences start (vertexCount + 1 entries, a vertex without any keeps its bind pose)
+    std::vector<irr::u32> influenceOffsets;
+    // Joint number and weight of each influence
+    std::vector<irr::u16> influenceBones;
+    std::vector<irr::f32> influenceWeights;
+};
+
+//! A skinned mesh prepared for CPUSkinning
+struct SCPUSkinnedMesh
+{
+    // The mesh (owned by the mesh cache)
+    irr::scene::ISkinnedMesh* pMesh;
+    // One entry per mesh buffer
+    std::vector<SCPUSkinnedBuffer> buffers;
+    // Joint each mesh buffer is attached to rigidly (-1 for none)
+    std::vector<irr::s32> bufferJoints;
+};
+
+//! The pose of a node skinned by CPUSkinning
+struct SCPUSkinnedNode
+{
+    // The node
+    irr::scene::IAnimatedMeshSceneNode* pNode;
+    // Index of its mesh in the meshes
+    irr::u32 meshIndex;
+    // Each joint's animated matrix times its inverse bind matrix (16 floats each)
+    std::vector<irr::f32> palette;
+    // Transformation of each mesh buffer (the joint of rigidly attached buffers)
+    std::vector<irr::core::matrix4> bufferTransforms;
+    // Skinned vertices of each mesh buffer
+    std::vector<std::vector<irr::u8> > vertices;
+};
+
+//! A range of vertices skinned by one worker
+struct SCPUSkinningJob
+{
+    // Node, mesh buffer and vertex range
+    irr::u32 node;
+    irr::u32 buffer;
+    irr::u32 first;
+    irr::u32 count;
+};
+
+/** The CPUSkinning Class skins every visible node of its meshes in one
+    batched pass instead of Irrlicht's skinning each node as it is drawn.
+    A mesh added here is switched to Irrlicht's hardware skinning mode so
+    Irrlicht only animates its joints and leaves the vertices alone. The
+    render queue hands over the nodes it queued once it has culled them:
+    the joints are animated node by node (they belong to the shared mesh),
+    each node's bone palette is copied and then the vertices of every node
+    are split into ranges which the JobSystem's threads skin at the same
+    time. Each vertex blends the matrices of its bones and is moved by the
+    blend, four floats at a time with SSE where it is available.
+    Each node keeps its own copy of the vertices which the render queue
+    draws in place of the node's own render **/
+class CPUSkinning
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        CPUSkinning();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Set the job system the vertices are skinned on (0 skins them on the calling thread)
+        void setJobSystem(JobSystem* pJobSystem) { this->pJobSystem = pJobSystem; }
+        //! Skin a mesh in the batched pass from now on (returns false if it cannot be)
+        bool addMesh(irr::scene::ISkinnedMesh* pSkinnedMesh);
+        //! Is a node's mesh skinned by the batched pass
+        bool isSkinned(irr::scene::ISceneNode* pNode) const;
+        //! Skin the nodes of the batched pass's meshes (other nodes are skipped)
+        void skin(const std::vector<irr::scene::ISceneNode*>& nodes);
+        //! Draw a node with its skinned vertices (returns false if it has never been skinned)
+        bool render(irr::scene::ISceneNode* pNode);
+        //! Get a node's skinned vertices for a mesh buffer (0 if it has never been skinned)
+        const irr::u8* getVertices(irr::scene::ISceneNode* pNode, irr::u32 buffer) const;
+        //! Forget every node (call before the nodes are removed)
+        void clearNodes();
+        //! Get the number of nodes skinned by the last pass
+        irr::u32 getSkinnedNodeCount() const { return this->skinnedNodeCount; }
+        //! Get the number of vertices skinned by the last pass
+        irr::u32 getSkinnedVertexCount() const { return this->skinnedVertexCount; }
+
+    public:
+        // Vertices in each job
+        static const irr::u32 JOB_SIZE = 512;
+
+    protected:
+        //! Get the node entry for a node (added the first time)
+        irr::u32 getNodeIndex(irr::scene::IAnimatedMeshSceneNode* pNode, irr::u32 meshIndex);
+        //! Run jobs [first, end)
+        void runJobs(irr::u32 first, irr::u32 end);
+        //! Skin a range of vertices
+        static void skinRange(const SCPUSkinnedBuffer& buffer, const irr::f32* pPalette, irr::u32 first, irr::u32 count, irr::u8* pVertices);
+
+    protected:
+        // Meshes skinned by the batched pass
+        std::vector<SCPUSkinnedMesh> meshes;
+        // Nodes skinned so far
+        std::vector<SCPUSkinnedNode> nodes;
+        // Index of each node in the nodes
+        std::map<irr::scene::ISceneNode*, irr::u32> nodeIndices;
+        // Jobs of the current pass
+        std::vector<SCPUSkinningJob> jobs;
+        // Job system the jobs run on
+        JobSystem* pJobSystem;
+        // Nodes and vertices skinned by the last pass
+        irr::u32 skinnedNodeCount;
+        irr::u32 skinnedVertexCount;
+};
+
+#endif // CPUSKINNING_H
@@ -0,0 +1,314 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "FrameCapture.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include "Logger.h"
+
+// CRC32 of PNG chunks
+static irr::u32 crc32(const irr::u8* pData, size_t size, irr::u32 crc = 0xFFFFFFFF)
+{
+    static irr::u32 table[256];
+    static bool tableBuilt = false;
+    if (tableBuilt == false)
+    {
+        for (irr::u32 i = 0; i < 256; i++)
+        {
+            irr::u32 value = i;
+            for (int j = 0; j < 8; j++)
+                value = (value & 1) ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+            table[i] = value;
+        }
+        tableBuilt = true;
+    }
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+// Append a 32 bit value most significant byte first
+static void appendBigEndian(std::vector<irr::u8>& output, irr::u32 value)
+{
+    output.push_back((irr::u8)(value >> 24));
+    output.push_back((irr::u8)(value >> 16));
+    output.push_back((irr::u8)(value >> 8));
+    output.push_back((irr::u8)value);
+}
+
+// Finish a PNG chunk whose length and type start at chunkStart
+static void endChunk(std::vector<irr::u8>& output, size_t chunkStart)
+{
+    irr::u32 length = (irr::u32)(output.size() - chunkStart - 8);
+    output[chunkStart] = (irr::u8)(length >> 24);
+    output[chunkStart + 1] = (irr::u8)(length >> 16);
+    output[chunkStart + 2] = (irr::u8)(length >> 8);
+    output[chunkStart + 3] = (irr::u8)length;
+    // The CRC covers the type and the data
+    appendBigEndian(output, crc32(&output[chunkStart + 4], output.size() - chunkStart - 4) ^ 0xFFFFFFFF);
+}
+
+// Start a PNG chunk (the length is filled in by endChunk)
+static size_t beginChunk(std::vector<irr::u8>& output, const char* type)
+{
+    size_t chunkStart = output.size();
+    appendBigEndian(output, 0);
+    output.insert(output.end(), type, type + 4);
+    return chunkStart;
+}
+
+FrameCapture::FrameCapture()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->format = ECFMT_PNG;
+    this->pendingFrames = 0;
+    this->nextNumber = 0;
+    this->skippedCount = 0;
+    this->stopping = false;
+}
+
+FrameCapture::~FrameCapture()
+{
+    // **************
+    // * DESTRUCTOR *
+    // **************
+
+    this->shutdown();
+}
+
+bool FrameCapture::parseFormat(const std::string& name, E_CAPTURE_FORMAT& format)
+{
+    if (name == "png")
+        format = ECFMT_PNG;
+    else if (name == "tga")
+        format = ECFMT_TGA;
+    else
+        return false;
+    return true;
+}
+
+bool FrameCapture::init(const std::string& directory, const std::string& prefix, E_CAPTURE_FORMAT format, irr::u32 slotCount)
+{
+    // ********
+    // * INIT *
+    // ********
+
+    this->shutdown();
+    this->directory = directory;
+    this->prefix = prefix;
+    this->format = format;
+    this->slots.resize(irr::core::max_(slotCount, (irr::u32)1));
+    this->freeSlots.clear();
+    for (irr::u32 i = 0; i < this->slots.size(); i++)
+    {
+        this->slots[i].pImage = 0;
+        this->freeSlots.push_back(i);
+    }
+    this->queuedSlots.clear();
+    this->stopping = false;
+    this->writer = std::thread(&FrameCapture::writerMain, this);
+    return true;
+}
+
+void FrameCapture::shutdown()
+{
+    // ************
+    // * SHUTDOWN *
+    // ************
+
+    if (this->writer.joinable() == false)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wakeCondition.notify_one();
+    this->writer.join();
+    this->pendingFrames = 0;
+    if (this->skippedCount > 0)
+        LogMessage(ELS_WARNING) << "FrameCapture::shutdown() " << this->skippedCount << " frames were skipped while the writer was busy";
+}
+
+void FrameCapture::captureFrame(irr::video::IVideoDriver* pVideoDriver)
+{
+    if (this->pendingFrames == 0 || this->writer.joinable() == false)
+        return;
+    this->pendingFrames--;
+    // Take a free slot, skipping the frame if the writer is behind
+    irr::u32 slot = 0;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->freeSlots.empty() == true)
+        {
+            this->skippedCount++;
+            return;
+        }
+        slot = this->freeSlots.back();
+        this->freeSlots.pop_back();
+    }
+    // The readback is all the render thread does
+    irr::video::IImage* pImage = pVideoDriver->createScreenShot();
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (pImage == 0)
+    {
+        LogMessage(ELS_ERROR) << "Unable to read the frame back for a screenshot";
+        this->freeSlots.push_back(slot);
+        return;
+    }
+    this->slots[slot].pImage = pImage;
+    this->queuedSlots.push_back(slot);
+    this->wakeCondition.notify_one();
+}
+
+void FrameCapture::writerMain()
+{
+    while (true)
+    {
+        irr::u32 slot = 0;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            while (this->queuedSlots.empty() == true && this->stopping == false)
+                this->wakeCondition.wait(lock);
+            // Write everything queued before stopping
+            if (this->queuedSlots.empty() == true)
+                return;
+            slot = this->queuedSlots.front();
+            this->queuedSlots.pop_front();
+        }
+        this->writeSlot(this->slots[slot]);
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->freeSlots.push_back(slot);
+    }
+}
+
+bool FrameCapture::writeSlot(SCaptureSlot& slot)
+{
+    // CONVERT
+    // (whatever the frame buffer's format, into A8R8G8B8)
+    irr::video::IImage* pImage = slot.pImage;
+    irr::u32 width = pImage->getDimension().Width;
+    irr::u32 height = pImage->getDimension().Height;
+    slot.pixels.resize(width * height);
+    pImage->copyToScaling(&slot.pixels[0], width, height, irr::video::ECF_A8R8G8B8, width * 4);
+    pImage->drop();
+    slot.pImage = 0;
+
+    // ENCODE
+    slot.encoded.clear();
+    if (this->format == ECFMT_TGA)
+        FrameCapture::encodeTGA(slot, width, height);
+    else
+        FrameCapture::encodePNG(slot, width, height);
+
+    // WRITE
+    // (to the next number not already on disk)
+    std::string fileName;
+    while (true)
+    {
+        std::ostringstream name;
+        name << this->directory << "/" << this->prefix << "_" << std::setw(5) << std::setfill('0') << this->nextNumber++ << ((this->format == ECFMT_TGA) ? ".tga" : ".png");
+        fileName = name.str();
+        std::ifstream existing(fileName.c_str());
+        if (existing.is_open() == false)
+            break;
+    }
+    std::ofstream file(fileName.c_str(), std::ios::binary);
+    if (file.is_open() == false)
+    {
+        LogMessage(ELS_ERROR) << "Unable to save screenshot " << fileName;
+        return false;
+    }
+    file.write((const char*)&slot.encoded[0], slot.encoded.size());
+    LogMessage(ELS_DEBUG) << "Screenshot written to " << fileName;
+    return true;
+}
+
+void FrameCapture::encodePNG(SCaptureSlot& slot, irr::u32 width, irr::u32 height)
+{
+    std::vector<irr::u8>& output = slot.encoded;
+    const irr::u8 signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    output.insert(output.end(), signature, signature + 8);
+
+    // HEADER (8 bit RGB)
+    size_t chunkStart = beginChunk(output, "IHDR");
+    appendBigEndian(output, width);
+    appendBigEndian(output, height);
+    output.push_back(8);
+    output.push_back(2);
+    output.push_back(0);
+    output.push_back(0);
+    output.push_back(0);
+    endChunk(output, chunkStart);
+
+    // IMAGE DATA
+    /* A zlib stream of stored (uncompressed) deflate blocks holding each row
+        as a filter type of 0 followed by its RGB bytes */
+    chunkStart = beginChunk(output, "IDAT");
+    output.push_back(0x78);
+    output.push_back(0x01);
+    irr::u32 rowSize = 1 + width * 3;
+    irr::u32 dataSize = rowSize * height;
+    output.reserve(output.size() + dataSize + (dataSize / 65535 + 1) * 5 + 16);
+    irr::u32 adlerA = 1;
+    irr::u32 adlerB = 0;
+    irr::u32 blockLeft = 0;
+    irr::u32 written = 0;
+    for (irr::u32 y = 0; y < height; y++)
+    {
+        const irr::u32* pRow = &slot.pixels[y * width];
+        for (irr::u32 x = 0; x < rowSize; x++)
+        {
+            // Stored blocks hold at most 65535 bytes
+            if (blockLeft == 0)
+            {
+                blockLeft = irr::core::min_(dataSize - written, (irr::u32)65535);
+                output.push_back((written + blockLeft == dataSize) ? 1 : 0);
+                output.push_back((irr::u8)blockLeft);
+                output.push_back((irr::u8)(blockLeft >> 8));
+                output.push_back((irr::u8)~blockLeft);
+                output.push_back((irr::u8)(~blockLeft >> 8));
+            }
+            irr::u8 value = 0;
+            if (x > 0)
+                value = (irr::u8)(pRow[(x - 1) / 3] >> (16 - 8 * ((x - 1) % 3)));
+            output.push_back(value);
+            adlerA = (adlerA + value) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+            blockLeft--;
+            written++;
+        }
+    }
+    appendBigEndian(output, (adlerB << 16) | adlerA);
+    endChunk(output, chunkStart);
+
+    // END
+    chunkStart = beginChunk(output, "IEND");
+    endChunk(output, chunkStart);
+}
+
+void FrameCapture::encodeTGA(SCaptureSlot& slot, irr::u32 width, irr::u32 height)
+{
+    std::vector<irr::u8>& output = slot.encoded;
+    // Uncompressed true colour, 32 bits per pixel with 8 bits of alpha and the origin at the top left
+    irr::u8 header[18] = { 0 };
+    header[2] = 2;
+    header[12] = (irr::u8)width;
+    header[13] = (irr::u8)(width >> 8);
+    header[14] = (irr::u8)height;
+    header[15] = (irr::u8)(height >> 8);
+    header[16] = 32;
+    header[17] = 0x28;
+    output.insert(output.end(), header, header + 18);
+    // A8R8G8B8 is already the BGRA byte order TGA wants on little endian machines
+    const irr::u8* pPixels = (const irr::u8*)&slot.pixels[0];
+    output.insert(output.end(), pPixels, pPixels + width * height * 4);
+}
@@ -0,0 +1,122 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+// C/C++ Includes
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+//! File formats the FrameCapture writes
+enum E_CAPTURE_FORMAT
+{
+    // PNG with uncompressed deflate blocks (fast to write, any viewer opens it)
+    ECFMT_PNG = 0,
+    // Uncompressed 32 bit TGA
+    ECFMT_TGA
+};
+
+//! A capture slot of the FrameCapture's pool
+struct SCaptureSlot
+{
+    // The frame read back by the render thread (a new image each capture, dropped by the writer)
+    irr::video::IImage* pImage;
+    // The frame converted to A8R8G8B8 (reused)
+    std::vector<irr::u32> pixels;
+    // The encoded file (reused)
+    std::vector<irr::u8> encoded;
+};
+
+/** The FrameCapture Class saves frames without stalling the render thread.
+    The render thread only reads the frame back into an image; converting,
+    encoding and writing it happens on a background writer thread. There
+    are a fixed number of slots, each reusing its conversion and encoding
+    buffers from frame to frame. The read back image is not pooled, as
+    Irrlicht's createScreenShot allocates a new IImage every call. When every slot is still being written the
+    frame is skipped and counted rather than waiting. Files are numbered
+    (screenshot_00000.png onwards) and numbers already on disk are skipped.
+    A sequence captures the next N frames **/
+class FrameCapture
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        FrameCapture();
+        //! Destructor (writes the frames left)
+        virtual ~FrameCapture();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Start the writer thread (files go to directory/prefix_NNNNN.ext)
+        bool init(const std::string& directory, const std::string& prefix, E_CAPTURE_FORMAT format, irr::u32 slotCount);
+        //! Write the frames left and stop the writer thread
+        void shutdown();
+        //! Capture the next frame read back
+        void requestFrame() { this->pendingFrames = irr::core::max_(this->pendingFrames, (irr::u32)1); }
+        //! Capture the next frameCount frames
+        void startSequence(irr::u32 frameCount) { this->pendingFrames = frameCount; }
+        //! Stop a sequence
+        void stopSequence() { this->pendingFrames = 0; }
+        //! Is a frame or sequence waiting to be captured
+        bool isCapturing() const { return (this->pendingFrames > 0); }
+        //! Read the frame back if one was requested (render thread, call before endScene)
+        void captureFrame(irr::video::IVideoDriver* pVideoDriver);
+        //! Get the number of frames skipped because every slot was busy
+        irr::u32 getSkippedCount() const { return this->skippedCount; }
+        //! Parse a format name (png or tga, returns false if unknown)
+        static bool parseFormat(const std::string& name, E_CAPTURE_FORMAT& format);
+
+    protected:
+        //! Writer thread loop
+        void writerMain();
+        //! Convert, encode and write a slot
+        bool writeSlot(SCaptureSlot& slot);
+        //! Encode a slot's pixels as a PNG
+        static void encodePNG(SCaptureSlot& slot, irr::u32 width, irr::u32 height);
+        //! Encode a slot's pixels as a TGA
+        static void encodeTGA(SCaptureSlot& slot, irr::u32 width, irr::u32 height);
+
+    protected:
+        // Where the files go and their names
+        std::string directory;
+        std::string prefix;
+        E_CAPTURE_FORMAT format;
+        // The slots
+        std::vector<SCaptureSlot> slots;
+        // Slots free for the render thread and slots waiting for the writer (indices into slots)
+        std::vector<irr::u32> freeSlots;
+        std::deque<irr::u32> queuedSlots;
+        // Frames still to capture
+        irr::u32 pendingFrames;
+        // Next number tried for a file name
+        irr::u32 nextNumber;
+        // Frames skipped because every slot was busy
+        irr::u32 skippedCount;
+        // Writer thread
+        std::thread writer;
+        // Guards the slot lists and stopping
+        std::mutex mutex;
+        // Wakes the writer
+        std::condition_variable wakeCondition;
+        // Is the writer being stopped
+        bool stopping;
+};
+
+#endif // FRAMECAPTURE_H
@@ -0,0 +1,165 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "GPUSkinning.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Logger.h"
+
+GPUSkinning::GPUSkinning()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->pPaletteNode = 0;
+    this->boneCount = 0;
+    // Entry 0 is the identity (it holds the vertices no joint moves)
+    memcpy(&this->palette[0], irr::core::matrix4().pointer(), 16 * sizeof(irr::f32));
+}
+
+bool GPUSkinning::addMesh(irr::scene::ISkinnedMesh* pSkinnedMesh)
+{
+    // ************
+    // * ADD MESH *
+    // ************
+
+    if (pSkinnedMesh == 0)
+        return false;
+    if (std::find(this->meshes.begin(), this->meshes.end(), pSkinnedMesh) != this->meshes.end())
+        return true;
+    irr::core::array<irr::scene::ISkinnedMesh::SJoint*>& joints = pSkinnedMesh->getAllJoints();
+    if (joints.size() + 1 > GPUSkinning::MAX_BONES)
+    {
+        LogMessage(ELS_WARNING) << "A mesh with " << joints.size() << " joints has more than the " << GPUSkinning::MAX_BONES - 1 << " the skinned shaders hold, it is skinned on the CPU";
+        return false;
+    }
+
+    // Put the vertices back in the bind pose, stop Irrlicht moving them and make room for the bones
+    pSkinnedMesh->setHardwareSkinning(true);
+    pSkinnedMesh->convertMeshToTangents();
+
+    // GATHER EACH VERTEX'S STRONGEST BONES
+    std::vector<std::vector<SBoneInfluences> > influences(pSkinnedMesh->getMeshBufferCount());
+    for (irr::u32 i = 0; i < pSkinnedMesh->getMeshBufferCount(); i++)
+    {
+        SBoneInfluences none;
+        for (int k = 0; k < 4; k++)
+        {
+            none.bones[k] = 0;
+            none.weights[k] = 0.0f;
+        }
+        influences[i].resize(pSkinnedMesh->getMeshBuffer(i)->getVertexCount(), none);
+    }
+    for (irr::u32 j = 0; j < joints.size(); j++)
+    {
+        const irr::core::array<irr::scene::ISkinnedMesh::SWeight>& weights = joints[j]->Weights;
+        for (irr::u32 k = 0; k < weights.size(); k++)
+        {
+            const irr::scene::ISkinnedMesh::SWeight& weight = weights[k];
+            if (weight.buffer_id >= influences.size() || weight.vertex_id >= influences[weight.buffer_id].size())
+                continue;
+            // Palette entries start after the identity
+            GPUSkinning::addInfluence(influences[weight.buffer_id][weight.vertex_id], j + 1, weight.strength);
+        }
+    }
+
+    // PACK THEM INTO THE TANGENTS AND BINORMALS
+    for (irr::u32 i = 0; i < pSkinnedMesh->getMeshBufferCount(); i++)
+    {
+        irr::scene::IMeshBuffer* pMeshBuffer = pSkinnedMesh->getMeshBuffer(i);
+        if (pMeshBuffer->getVertexType() != irr::video::EVT_TANGENTS)
+            continue;
+        irr::video::S3DVertexTangents* pVertices = (irr::video::S3DVertexTangents*)pMeshBuffer->getVertices();
+        for (irr::u32 j = 0; j < pMeshBuffer->getVertexCount(); j++)
+        {
+            SBoneInfluences& vertexInfluences = influences[i][j];
+            // The weights kept must add up to one (a vertex without bones follows the identity)
+            irr::f32 total = vertexInfluences.weights[0] + vertexInfluences.weights[1] + vertexInfluences.weights[2] + vertexInfluences.weights[3];
+            if (total <= 0.0f)
+            {
+                vertexInfluences.bones[0] = 0;
+                vertexInfluences.weights[0] = 1.0f;
+                total = 1.0f;
+            }
+            for (int k = 0; k < 4; k++)
+                vertexInfluences.weights[k] /= total;
+            pVertices[j].Tangent = irr::core::vector3df((irr::f32)(vertexInfluences.bones[0] + 256 * vertexInfluences.bones[1]), (irr::f32)(vertexInfluences.bones[2] + 256 * vertexInfluences.bones[3]), vertexInfluences.weights[0]);
+            pVertices[j].Binormal = irr::core::vector3df(vertexInfluences.weights[1], vertexInfluences.weights[2], vertexInfluences.weights[3]);
+        }
+        // The buffer never changes again so it can live on the graphics card
+        pMeshBuffer->setHardwareMappingHint(irr::scene::EHM_STATIC);
+        pMeshBuffer->setDirty();
+    }
+    this->meshes.push_back(pSkinnedMesh);
+    return true;
+}
+
+void GPUSkinning::addInfluence(SBoneInfluences& influences, irr::u32 bone, irr::f32 weight)
+{
+    // Find the first weaker influence and move the rest down over the weakest
+    for (int i = 0; i < 4; i++)
+    {
+        if (weight <= influences.weights[i])
+            continue;
+        for (int j = 3; j > i; j--)
+        {
+            influences.bones[j] = influences.bones[j - 1];
+            influences.weights[j] = influences.weights[j - 1];
+        }
+        influences.bones[i] = bone;
+        influences.weights[i] = weight;
+        return;
+    }
+}
+
+bool GPUSkinning::isSkinned(irr::scene::ISceneNode* pNode) const
+{
+    irr::scene::ISkinnedMesh* pSkinnedMesh = GPUSkinning::getSkinnedMesh(pNode);
+    return (pSkinnedMesh != 0 && std::find(this->meshes.begin(), this->meshes.end(), pSkinnedMesh) != this->meshes.end());
+}
+
+void GPUSkinning::upload(irr::video::IMaterialRendererServices* pServices, const ShaderConstantTable& shaderConstantTable, irr::scene::ISceneNode* pNode)
+{
+    // **********
+    // * UPLOAD *
+    // **********
+
+    // BUILD THE PALETTE
+    /* The joints of a mesh shared by several nodes are animated by each node
+        as it is drawn so the palette is built once per node per draw */
+    if (pNode != this->pPaletteNode)
+    {
+        this->pPaletteNode = pNode;
+        this->boneCount = 0;
+        irr::scene::ISkinnedMesh* pSkinnedMesh = GPUSkinning::getSkinnedMesh(pNode);
+        if (pSkinnedMesh == 0)
+            return;
+        const irr::core::array<irr::scene::ISkinnedMesh::SJoint*>& joints = pSkinnedMesh->getAllJoints();
+        this->boneCount = 1;
+        for (irr::u32 i = 0; i < joints.size() && this->boneCount < GPUSkinning::MAX_BONES; i++)
+        {
+            // The same product Irrlicht moves the vertices by when it skins on the CPU
+            irr::core::matrix4 bone = joints[i]->GlobalAnimatedMatrix * joints[i]->GlobalInversedMatrix;
+            memcpy(&this->palette[16 * this->boneCount], bone.pointer(), 16 * sizeof(irr::f32));
+            this->boneCount++;
+        }
+    }
+    if (this->boneCount > 0)
+        shaderConstantTable.set(pServices, ESC_BONE_MATRIX, &this->palette[0], 16 * this->boneCount);
+}
+
+irr::scene::ISkinnedMesh* GPUSkinning::getSkinnedMesh(irr::scene::ISceneNode* pNode)
+{
+    if (pNode == 0 || pNode->getType() != irr::scene::ESNT_ANIMATED_MESH)
+        return 0;
+    irr::scene::IAnimatedMesh* pAnimatedMesh = static_cast<irr::scene::IAnimatedMeshSceneNode*>(pNode)->getMesh();
+    if (pAnimatedMesh == 0 || pAnimatedMesh->getMeshType() != irr::scene::EAMT_SKINNED)
+        return 0;
+    return static_cast<irr::scene::ISkinnedMesh*>(pAnimatedMesh);
+}
@@ -0,0 +1,86 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef GPUSKINNING_H
+#define GPUSKINNING_H
+
+// C/C++ Includes
+#include <vector>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+// Game Includes
+#include "ShaderConstantTable.h"
+
+//! The strongest bones moving a vertex
+struct SBoneInfluences
+{
+    // Bone numbers (palette entries, 0 is the identity)
+    irr::u32 bones[4];
+    // Weights (strongest first)
+    irr::f32 weights[4];
+};
+
+/** The GPUSkinning Class moves the skinning of Irrlicht's skinned meshes
+    into the vertex shader. A mesh added here is switched to Irrlicht's
+    hardware skinning mode, which keeps its vertices in the bind pose and
+    only animates the joints, so the vertex buffers never change and can
+    stay on the graphics card. Irrlicht 1.8 has no custom vertex attributes
+    so the buffers are converted to tangent vertices and the four strongest
+    bones of each vertex are packed into the tangent and binormal (two bone
+    numbers per co-ordinate, then the weights).
+    While a node is drawn its bone palette (each joint's animated matrix
+    times its inverse bind matrix) is built once and uploaded to the SKINNED
+    shader variants' BoneMatrix array **/
+class GPUSkinning
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        GPUSkinning();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Skin a mesh on the GPU from now on (returns false if it has too many joints, it is then skinned on the CPU)
+        bool addMesh(irr::scene::ISkinnedMesh* pSkinnedMesh);
+        //! Is a node's mesh skinned on the GPU
+        bool isSkinned(irr::scene::ISceneNode* pNode) const;
+        //! Upload the bone palette of the node being drawn (built the first time it is asked for)
+        void upload(irr::video::IMaterialRendererServices* pServices, const ShaderConstantTable& shaderConstantTable, irr::scene::ISceneNode* pNode);
+        //! Forget the palette (call when the node has been drawn, its joints move before the next draw)
+        void reset() { this->pPaletteNode = 0; }
+        //! Get the number of meshes skinned on the GPU
+        irr::u32 getMeshCount() const { return (irr::u32)this->meshes.size(); }
+        //! Get the skinned mesh of a node (0 when it has none)
+        static irr::scene::ISkinnedMesh* getSkinnedMesh(irr::scene::ISceneNode* pNode);
+
+    public:
+        // Size of the bone palette (the MAX_BONES of the skinned shaders, one entry is the identity)
+        static const irr::u32 MAX_BONES = 60;
+
+    protected:
+        //! Add a weight to a vertex's influences (only the strongest four are kept)
+        static void addInfluence(SBoneInfluences& influences, irr::u32 bone, irr::f32 weight);
+
+    protected:
+        // Meshes skinned on the GPU (owned by the mesh cache)
+        std::vector<irr::scene::ISkinnedMesh*> meshes;
+        // The node the palette was built for
+        irr::scene::ISceneNode* pPaletteNode;
+        // Entries in the palette
+        irr::u32 boneCount;
+        // Bone palette
+        irr::f32 palette[16 * MAX_BONES];
+};
+
+#endif // GPUSKINNING_H
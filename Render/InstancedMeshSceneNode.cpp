@@ -0,0 +1,250 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "InstancedMeshSceneNode.h"
+
+InstancedMeshSceneNode::InstancedMeshSceneNode(irr::scene::IMesh* pMesh, irr::scene::ISceneNode* pParent, irr::scene::ISceneManager* pSceneManager, irr::s32 id)
+    : irr::scene::ISceneNode(pParent, pSceneManager, id)
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->pMesh = pMesh;
+    if (this->pMesh != 0)
+        this->pMesh->grab();
+    this->boundingBox = irr::core::aabbox3d<irr::f32>(irr::core::vector3df(0.0f, 0.0f, 0.0f), irr::core::vector3df(0.0f, 0.0f, 0.0f));
+    this->instancing = true;
+    this->visibleCount = 0;
+    this->batchStart = 0;
+    this->batchCount = 0;
+    this->drawCallCount = 0;
+    this->buildBatchBuffers();
+}
+
+InstancedMeshSceneNode::~InstancedMeshSceneNode()
+{
+    // **************
+    // * DESTRUCTOR *
+    // **************
+
+    for (size_t i = 0; i < this->batchBuffers.size(); i++)
+        if (this->batchBuffers[i] != 0)
+            this->batchBuffers[i]->drop();
+    if (this->pMesh != 0)
+        this->pMesh->drop();
+}
+
+void InstancedMeshSceneNode::buildBatchBuffers()
+{
+    // ***********************
+    // * BUILD BATCH BUFFERS *
+    // ***********************
+
+    if (this->pMesh == 0)
+        return;
+    for (irr::u32 i = 0; i < this->pMesh->getMeshBufferCount(); i++)
+    {
+        irr::scene::IMeshBuffer* pMeshBuffer = this->pMesh->getMeshBuffer(i);
+        this->materials.push_back(pMeshBuffer->getMaterial());
+        // Every copy has to be addressable with 16 bit indices
+        irr::u32 vertexCount = pMeshBuffer->getVertexCount();
+        irr::u32 capacity = (vertexCount == 0) ? 0 : irr::core::min_(InstancedMeshSceneNode::BATCH_SIZE, 65536u / vertexCount);
+        if (pMeshBuffer->getIndexType() != irr::video::EIT_16BIT || capacity == 0)
+        {
+            this->batchBuffers.push_back(0);
+            this->batchCapacities.push_back(0);
+            continue;
+        }
+        // Copy the buffer once for each slot of the batch
+        irr::scene::SMeshBufferLightMap* pBatchBuffer = new irr::scene::SMeshBufferLightMap();
+        pBatchBuffer->Vertices.reallocate(vertexCount * capacity);
+        pBatchBuffer->Indices.reallocate(pMeshBuffer->getIndexCount() * capacity);
+        // Every vertex type starts with the standard vertex
+        const irr::u8* pVertices = (const irr::u8*)pMeshBuffer->getVertices();
+        irr::u32 vertexPitch = irr::video::getVertexPitchFromType(pMeshBuffer->getVertexType());
+        const irr::u16* pIndices = pMeshBuffer->getIndices();
+        for (irr::u32 slot = 0; slot < capacity; slot++)
+        {
+            for (irr::u32 j = 0; j < vertexCount; j++)
+            {
+                const irr::video::S3DVertex& source = *(const irr::video::S3DVertex*)(pVertices + j * vertexPitch);
+                irr::video::S3DVertex2TCoords vertex;
+                vertex.Pos = source.Pos;
+                vertex.Normal = source.Normal;
+                vertex.Color = source.Color;
+                vertex.TCoords = source.TCoords;
+                // The slot picks the instance's matrix and colour in the shader
+                vertex.TCoords2 = irr::core::vector2df((irr::f32)slot, 0.0f);
+                pBatchBuffer->Vertices.push_back(vertex);
+            }
+            for (irr::u32 j = 0; j < pMeshBuffer->getIndexCount(); j++)
+                pBatchBuffer->Indices.push_back((irr::u16)(pIndices[j] + slot * vertexCount));
+        }
+        pBatchBuffer->setBoundingBox(pMeshBuffer->getBoundingBox());
+        // The batch never changes so it can live on the graphics card
+        pBatchBuffer->setHardwareMappingHint(irr::scene::EHM_STATIC);
+        this->batchBuffers.push_back(pBatchBuffer);
+        this->batchCapacities.push_back(capacity);
+    }
+}
+
+irr::u32 InstancedMeshSceneNode::addInstance(const irr::core::matrix4& transform, const irr::video::SColorf& color)
+{
+    SMeshInstance instance;
+    instance.transform = transform;
+    instance.color = color;
+    this->instances.push_back(instance);
+    this->addToBoundingBox(transform);
+    return (irr::u32)(this->instances.size() - 1);
+}
+
+void InstancedMeshSceneNode::setInstanceTransform(irr::u32 index, const irr::core::matrix4& transform)
+{
+    this->instances[index].transform = transform;
+    // The box only grows (rebuild it with clearInstances when instances move away for good)
+    this->addToBoundingBox(transform);
+}
+
+void InstancedMeshSceneNode::clearInstances()
+{
+    this->instances.clear();
+    this->boundingBox = irr::core::aabbox3d<irr::f32>(irr::core::vector3df(0.0f, 0.0f, 0.0f), irr::core::vector3df(0.0f, 0.0f, 0.0f));
+}
+
+void InstancedMeshSceneNode::addToBoundingBox(const irr::core::matrix4& transform)
+{
+    if (this->pMesh == 0)
+        return;
+    irr::core::aabbox3d<irr::f32> box = this->pMesh->getBoundingBox();
+    transform.transformBoxEx(box);
+    if (this->instances.size() == 1)
+        this->boundingBox = box;
+    else
+        this->boundingBox.addInternalBox(box);
+}
+
+void InstancedMeshSceneNode::OnRegisterSceneNode()
+{
+    // **************************
+    // * ON REGISTER SCENE NODE *
+    // **************************
+
+    if (this->IsVisible == true && this->instances.empty() == false)
+    {
+        // Transparent materials are drawn in the transparent pass
+        bool transparent = false;
+        irr::video::IVideoDriver* pVideoDriver = this->SceneManager->getVideoDriver();
+        for (size_t i = 0; i < this->materials.size(); i++)
+        {
+            irr::video::IMaterialRenderer* pMaterialRenderer = pVideoDriver->getMaterialRenderer(this->materials[i].MaterialType);
+            if (pMaterialRenderer != 0 && pMaterialRenderer->isTransparent() == true)
+                transparent = true;
+        }
+        this->SceneManager->registerNodeForRendering(this, (transparent == true) ? irr::scene::ESNRP_TRANSPARENT : irr::scene::ESNRP_SOLID);
+    }
+    irr::scene::ISceneNode::OnRegisterSceneNode();
+}
+
+void InstancedMeshSceneNode::render()
+{
+    // **********
+    // * RENDER *
+    // **********
+
+    this->drawCallCount = 0;
+    this->visibleCount = 0;
+    this->visibleInstances.clear();
+    this->visibleMatrices.clear();
+    this->visibleColors.clear();
+    if (this->pMesh == 0)
+        return;
+    irr::video::IVideoDriver* pVideoDriver = this->SceneManager->getVideoDriver();
+
+    // CULL THE INSTANCES
+    /* Each instance's box is turned into a bounding sphere in world space and
+        tested against the frustum planes (which face out of the frustum) */
+    irr::scene::ICameraSceneNode* pCamera = this->SceneManager->getActiveCamera();
+    const irr::scene::SViewFrustum* pViewFrustum = (pCamera != 0) ? pCamera->getViewFrustum() : 0;
+    for (size_t i = 0; i < this->instances.size(); i++)
+    {
+        const SMeshInstance& instance = this->instances[i];
+        if (pViewFrustum != 0)
+        {
+            irr::core::aabbox3d<irr::f32> box = this->pMesh->getBoundingBox();
+            (this->AbsoluteTransformation * instance.transform).transformBoxEx(box);
+            irr::core::vector3df center = box.getCenter();
+            irr::f32 radius = box.getExtent().getLength() * 0.5f;
+            bool outside = false;
+            for (int j = 0; j < irr::scene::SViewFrustum::VF_PLANE_COUNT && outside == false; j++)
+                outside = (pViewFrustum->planes[j].getDistanceTo(center) > radius);
+            if (outside == true)
+                continue;
+        }
+        // Pack the instance for the shader
+        const irr::f32* pMatrix = instance.transform.pointer();
+        this->visibleMatrices.insert(this->visibleMatrices.end(), pMatrix, pMatrix + 16);
+        this->visibleColors.push_back(instance.color.r);
+        this->visibleColors.push_back(instance.color.g);
+        this->visibleColors.push_back(instance.color.b);
+        this->visibleColors.push_back(instance.color.a);
+        this->visibleInstances.push_back((irr::u32)i);
+    }
+    this->visibleCount = (irr::u32)this->visibleInstances.size();
+    if (this->visibleCount == 0)
+        return;
+
+    // DRAW THE INSTANCES
+    bool transparentPass = (this->SceneManager->getSceneNodeRenderPass() == irr::scene::ESNRP_TRANSPARENT);
+    for (irr::u32 i = 0; i < this->pMesh->getMeshBufferCount() && i < this->materials.size(); i++)
+    {
+        // Only draw the buffers belonging to this pass
+        irr::video::IMaterialRenderer* pMaterialRenderer = pVideoDriver->getMaterialRenderer(this->materials[i].MaterialType);
+        bool transparent = (pMaterialRenderer != 0 && pMaterialRenderer->isTransparent() == true);
+        if (transparent != transparentPass)
+            continue;
+        irr::scene::IMeshBuffer* pMeshBuffer = this->pMesh->getMeshBuffer(i);
+        pVideoDriver->setMaterial(this->materials[i]);
+        if (this->instancing == true && this->batchBuffers[i] != 0)
+        {
+            // One draw call per batch, the shader places each copy
+            pVideoDriver->setTransform(irr::video::ETS_WORLD, this->AbsoluteTransformation);
+            irr::scene::SMeshBufferLightMap* pBatchBuffer = this->batchBuffers[i];
+            irr::u32 capacity = this->batchCapacities[i];
+            for (this->batchStart = 0; this->batchStart < this->visibleCount; this->batchStart += capacity)
+            {
+                this->batchCount = irr::core::min_(capacity, this->visibleCount - this->batchStart);
+                // A full batch comes from the hardware buffer, the last one only draws the copies in use
+                if (this->batchCount == capacity)
+                    pVideoDriver->drawMeshBuffer(pBatchBuffer);
+                else
+                    pVideoDriver->drawVertexPrimitiveList(pBatchBuffer->getVertices(), this->batchCount * pMeshBuffer->getVertexCount(), pBatchBuffer->getIndices(),
+                                                          this->batchCount * pMeshBuffer->getIndexCount() / 3, irr::video::EVT_2TCOORDS, irr::scene::EPT_TRIANGLES, irr::video::EIT_16BIT);
+                this->drawCallCount++;
+            }
+            this->batchStart = 0;
+            this->batchCount = 0;
+        }
+        else
+        {
+            // One draw call per instance
+            for (irr::u32 j = 0; j < this->visibleCount; j++)
+            {
+                pVideoDriver->setTransform(irr::video::ETS_WORLD, this->AbsoluteTransformation * this->instances[this->visibleInstances[j]].transform);
+                pVideoDriver->drawMeshBuffer(pMeshBuffer);
+                this->drawCallCount++;
+            }
+        }
+    }
+}
+
+void InstancedMeshSceneNode::uploadInstances(irr::video::IMaterialRendererServices* pServices, const ShaderConstantTable& shaderConstantTable) const
+{
+    if (this->batchCount == 0)
+        return;
+    shaderConstantTable.set(pServices, ESC_INSTANCE_MATRIX, &this->visibleMatrices[16 * this->batchStart], 16 * this->batchCount);
+    shaderConstantTable.set(pServices, ESC_INSTANCE_COLOR, &this->visibleColors[4 * this->batchStart], 4 * this->batchCount);
+}
@@ -0,0 +1,138 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef INSTANCEDMESHSCENENODE_H
+#define INSTANCEDMESHSCENENODE_H
+
+// C/C++ Includes
+#include <vector>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+// Game Includes
+#include "ShaderConstantTable.h"
+
+//! A copy of the mesh drawn by an InstancedMeshSceneNode
+struct SMeshInstance
+{
+    // Transformation relative to the node
+    irr::core::matrix4 transform;
+    // Colour the instance's materials are tinted by
+    irr::video::SColorf color;
+};
+
+/** The InstancedMeshSceneNode Class draws many copies (instances) of one
+    mesh, each with its own transformation and tint, in a few draw calls.
+    Irrlicht 1.8 has no instanced draw call and no per-instance vertex
+    streams so each mesh buffer is copied BATCH_SIZE times into a batch
+    buffer, every copy carrying its slot in the batch in the second texture
+    co-ordinate. Each frame the instances in the view frustum are packed into
+    arrays and drawn a batch at a time: the shader (built with INSTANCED)
+    reads the slot's matrix and colour from the InstanceMatrix and
+    InstanceColor uniforms which the Game uploads from here in
+    OnSetConstants, so a batch costs one draw call and one constant upload
+    instead of one of each per instance.
+    When the material's shader cannot be instanced each visible instance is
+    drawn on its own with the mesh's buffers **/
+class InstancedMeshSceneNode : public irr::scene::ISceneNode
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor (the node keeps its own copy of the mesh buffers' materials)
+        InstancedMeshSceneNode(irr::scene::IMesh* pMesh, irr::scene::ISceneNode* pParent, irr::scene::ISceneManager* pSceneManager, irr::s32 id = -1);
+        //! Destructor
+        virtual ~InstancedMeshSceneNode();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Register the node for the solid or transparent pass
+        virtual void OnRegisterSceneNode();
+        //! Cull the instances and draw the visible ones
+        virtual void render();
+        //! Get the bounding box (of every instance)
+        virtual const irr::core::aabbox3d<irr::f32>& getBoundingBox() const { return this->boundingBox; }
+        //! Get a material (one per mesh buffer)
+        virtual irr::video::SMaterial& getMaterial(irr::u32 i) { return this->materials[i]; }
+        //! Get the number of materials
+        virtual irr::u32 getMaterialCount() const { return (irr::u32)this->materials.size(); }
+        //! Get the type of the node
+        virtual irr::scene::ESCENE_NODE_TYPE getType() const { return (irr::scene::ESCENE_NODE_TYPE)InstancedMeshSceneNode::NODE_TYPE; }
+        //! Get the mesh
+        irr::scene::IMesh* getMesh() const { return this->pMesh; }
+
+    public:
+        //! Add an instance (returns its index)
+        irr::u32 addInstance(const irr::core::matrix4& transform, const irr::video::SColorf& color = irr::video::SColorf(1.0f, 1.0f, 1.0f, 1.0f));
+        //! Move an instance
+        void setInstanceTransform(irr::u32 index, const irr::core::matrix4& transform);
+        //! Tint an instance
+        void setInstanceColor(irr::u32 index, const irr::video::SColorf& color) { this->instances[index].color = color; }
+        //! Get an instance
+        const SMeshInstance& getInstance(irr::u32 index) const { return this->instances[index]; }
+        //! Get the number of instances
+        irr::u32 getInstanceCount() const { return (irr::u32)this->instances.size(); }
+        //! Remove every instance
+        void clearInstances();
+        //! Are the instances drawn in batches (false draws each on its own)
+        bool isInstancing() const { return this->instancing; }
+        //! Set whether the instances are drawn in batches (only when the material's shader is built with INSTANCED)
+        void setInstancing(bool instancing) { this->instancing = instancing; }
+        //! Get the number of instances drawn last frame
+        irr::u32 getVisibleInstanceCount() const { return this->visibleCount; }
+        //! Get the number of draw calls made last frame
+        irr::u32 getDrawCallCount() const { return this->drawCallCount; }
+        //! Upload the matrices and colours of the batch being drawn (called from OnSetConstants)
+        void uploadInstances(irr::video::IMaterialRendererServices* pServices, const ShaderConstantTable& shaderConstantTable) const;
+
+    public:
+        // Scene node type
+        static const irr::s32 NODE_TYPE = MAKE_IRR_ID('i', 'n', 's', 't');
+        // Most instances in a batch (the MAX_INSTANCES of the instanced shaders)
+        static const irr::u32 BATCH_SIZE = 32;
+
+    protected:
+        //! Copy each mesh buffer into a batch buffer
+        void buildBatchBuffers();
+        //! Grow the bounding box by an instance
+        void addToBoundingBox(const irr::core::matrix4& transform);
+
+    protected:
+        // The mesh
+        irr::scene::IMesh* pMesh;
+        // Material of each mesh buffer
+        std::vector<irr::video::SMaterial> materials;
+        // Batch buffer of each mesh buffer (0 when it cannot be batched)
+        std::vector<irr::scene::SMeshBufferLightMap*> batchBuffers;
+        // Instances each batch buffer holds
+        std::vector<irr::u32> batchCapacities;
+        // Bounding box of every instance
+        irr::core::aabbox3d<irr::f32> boundingBox;
+        // The instances
+        std::vector<SMeshInstance> instances;
+        // Are the instances drawn in batches
+        bool instancing;
+
+    protected:
+        // Indices, matrices and colours of the instances drawn this frame
+        std::vector<irr::u32> visibleInstances;
+        std::vector<irr::f32> visibleMatrices;
+        std::vector<irr::f32> visibleColors;
+        irr::u32 visibleCount;
+        // The batch being drawn (first visible instance and count)
+        irr::u32 batchStart;
+        irr::u32 batchCount;
+        // Draw calls made last frame
+        irr::u32 drawCallCount;
+};
+
+#endif // INSTANCEDMESHSCENENODE_H
@@ -0,0 +1,159 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "RenderQueueSceneNode.h"
+
+#include <algorithm>
+#include <cstring>
+
+RenderQueueSceneNode::RenderQueueSceneNode(irr::scene::ISceneNode* pParent, irr::scene::ISceneManager* pSceneManager, irr::s32 id)
+    : irr::scene::ISceneNode(pParent, pSceneManager, id)
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->boundingBox = irr::core::aabbox3d<irr::f32>(irr::core::vector3df(0.0f, 0.0f, 0.0f), irr::core::vector3df(0.0f, 0.0f, 0.0f));
+    this->pLightManager = 0;
+    this->sorting = true;
+    this->pCPUSkinning = 0;
+    this->nodeCount = 0;
+    this->programBindCount = 0;
+    this->textureBindCount = 0;
+    // The children are culled one by one
+    this->setAutomaticCulling(irr::scene::EAC_OFF);
+}
+
+void RenderQueueSceneNode::OnRegisterSceneNode()
+{
+    // **************************
+    // * ON REGISTER SCENE NODE *
+    // **************************
+
+    this->entries.clear();
+    this->textureSetIDs.clear();
+    this->queuedNodes.clear();
+    this->nodeCount = 0;
+    this->programBindCount = 0;
+    this->textureBindCount = 0;
+    if (this->IsVisible == false)
+        return;
+
+    // Depth is measured from the active camera
+    irr::scene::ICameraSceneNode* pCamera = this->SceneManager->getActiveCamera();
+    irr::core::vector3df cameraPosition = (pCamera != 0) ? pCamera->getAbsolutePosition() : irr::core::vector3df(0.0f, 0.0f, 0.0f);
+
+    // QUEUE THE CHILDREN
+    const irr::core::list<irr::scene::ISceneNode*>& children = this->getChildren();
+    for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator child = children.begin(); child != children.end(); ++child)
+    {
+        irr::scene::ISceneNode* pNode = *child;
+        if (pNode->isVisible() == false)
+            continue;
+        // Nodes the queue cannot draw in the solid pass are left to the scene manager
+        if (pNode->getMaterialCount() == 0 || this->isTransparent(pNode) == true)
+        {
+            pNode->OnRegisterSceneNode();
+            continue;
+        }
+        // The node's own children are registered as usual
+        const irr::core::list<irr::scene::ISceneNode*>& grandchildren = pNode->getChildren();
+        for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator grandchild = grandchildren.begin(); grandchild != grandchildren.end(); ++grandchild)
+            (*grandchild)->OnRegisterSceneNode();
+        // Skip nodes outside the view
+        if (this->SceneManager->isCulled(pNode) == true)
+            continue;
+        // Build the key (program, then texture set, then depth, the first material stands for the node)
+        const irr::video::SMaterial& material = pNode->getMaterial(0);
+        std::pair<std::map<SRenderQueueTextureSet, irr::u32>::iterator, bool> textureSet = this->textureSetIDs.insert(std::make_pair(RenderQueueSceneNode::getTextureSet(material), (irr::u32)this->textureSetIDs.size()));
+        // Positive floats order the same as their bits
+        irr::f32 depth = pNode->getTransformedBoundingBox().getCenter().getDistanceFromSQ(cameraPosition);
+        irr::u32 depthBits = 0;
+        memcpy(&depthBits, &depth, sizeof(depthBits));
+        SRenderQueueEntry entry;
+        entry.key = ((irr::u64)((irr::u32)material.MaterialType & 0xffff) << 48) | ((irr::u64)(textureSet.first->second & 0xffff) << 32) | (irr::u64)depthBits;
+        entry.pNode = pNode;
+        this->entries.push_back(entry);
+        this->queuedNodes.push_back(pNode);
+    }
+
+    // SKIN THE QUEUE
+    /* After OnAnimate has set this frame's animation frames and before any
+        node is drawn */
+    if (this->pCPUSkinning != 0)
+        this->pCPUSkinning->skin(this->queuedNodes);
+
+    // SORT THE QUEUE
+    if (this->sorting == true)
+        std::sort(this->entries.begin(), this->entries.end());
+    // The queue is drawn with the solid nodes
+    if (this->entries.empty() == false)
+        this->SceneManager->registerNodeForRendering(this, irr::scene::ESNRP_SOLID);
+}
+
+void RenderQueueSceneNode::render()
+{
+    // **********
+    // * RENDER *
+    // **********
+
+    this->nodeCount = (irr::u32)this->entries.size();
+    // The program and textures bound before the queue are unknown so the first of each counts
+    irr::s32 lastMaterialType = -1;
+    SRenderQueueTextureSet lastTextureSet;
+    for (irr::u32 i = 0; i < TEXTURE_SET_SIZE; i++)
+        lastTextureSet.pTextures[i] = 0;
+    for (size_t i = 0; i < this->entries.size(); i++)
+    {
+        irr::scene::ISceneNode* pNode = this->entries[i].pNode;
+        if (this->pLightManager != 0)
+            this->pLightManager->OnNodePreRender(pNode);
+        // Count the binds (after the light manager, which may switch the node to another shader variant)
+        for (irr::u32 j = 0; j < pNode->getMaterialCount(); j++)
+        {
+            const irr::video::SMaterial& material = pNode->getMaterial(j);
+            if ((irr::s32)material.MaterialType != lastMaterialType)
+            {
+                this->programBindCount++;
+                lastMaterialType = (irr::s32)material.MaterialType;
+            }
+            for (irr::u32 layer = 0; layer < TEXTURE_SET_SIZE; layer++)
+            {
+                irr::video::ITexture* pTexture = material.getTexture(layer);
+                if (pTexture != lastTextureSet.pTextures[layer])
+                {
+                    if (pTexture != 0)
+                        this->textureBindCount++;
+                    lastTextureSet.pTextures[layer] = pTexture;
+                }
+            }
+        }
+        if (this->pCPUSkinning == 0 || this->pCPUSkinning->render(pNode) == false)
+            pNode->render();
+        if (this->pLightManager != 0)
+            this->pLightManager->OnNodePostRender(pNode);
+    }
+}
+
+bool RenderQueueSceneNode::isTransparent(irr::scene::ISceneNode* pNode) const
+{
+    irr::video::IVideoDriver* pVideoDriver = this->SceneManager->getVideoDriver();
+    for (irr::u32 i = 0; i < pNode->getMaterialCount(); i++)
+    {
+        irr::video::IMaterialRenderer* pMaterialRenderer = pVideoDriver->getMaterialRenderer(pNode->getMaterial(i).MaterialType);
+        if (pMaterialRenderer != 0 && pMaterialRenderer->isTransparent() == true)
+            return true;
+    }
+    return false;
+}
+
+SRenderQueueTextureSet RenderQueueSceneNode::getTextureSet(const irr::video::SMaterial& material)
+{
+    SRenderQueueTextureSet textureSet;
+    for (irr::u32 i = 0; i < TEXTURE_SET_SIZE; i++)
+        textureSet.pTextures[i] = material.getTexture(i);
+    return textureSet;
+}
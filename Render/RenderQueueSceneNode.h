@@ -0,0 +1,127 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef RENDERQUEUESCENENODE_H
+#define RENDERQUEUESCENENODE_H
+
+// C/C++ Includes
+#include <map>
+#include <vector>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+// Game Includes
+#include "CPUSkinning.h"
+
+//! A node waiting to be drawn by the RenderQueueSceneNode
+struct SRenderQueueEntry
+{
+    // Shader program, texture set and depth packed so that one comparison orders the queue
+    irr::u64 key;
+    // The node
+    irr::scene::ISceneNode* pNode;
+    //! Order by key
+    bool operator<(const SRenderQueueEntry& other) const { return (this->key < other.key); }
+};
+
+//! The textures bound by a material (the part of it the render queue sorts on)
+struct SRenderQueueTextureSet
+{
+    // Textures of the first four layers
+    irr::video::ITexture* pTextures[4];
+    //! Order by texture pointers
+    bool operator<(const SRenderQueueTextureSet& other) const
+    {
+        for (int i = 0; i < 4; i++)
+            if (this->pTextures[i] != other.pTextures[i])
+                return (this->pTextures[i] < other.pTextures[i]);
+        return false;
+    }
+};
+
+/** The RenderQueueSceneNode Class draws its children itself instead of
+    letting the scene manager register them. Each frame the visible solid
+    children are put in a queue sorted by shader program (material type),
+    then texture set, then front to back depth, and drawn in that order in
+    the solid pass, so a program or texture is bound once for a run of nodes
+    sharing it rather than whenever the scene graph's order changes to
+    another. Children with transparent materials (and the children of
+    children) are registered with the scene manager as usual.
+    The light manager's node callbacks are called around each child just
+    as the scene manager would. The program and texture binds made by the
+    queue are counted every frame.
+    When a CPUSkinning pass is set the queued nodes are handed to it in
+    one batch once they are culled and the nodes it skinned are drawn from
+    its vertices **/
+class RenderQueueSceneNode : public irr::scene::ISceneNode
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        RenderQueueSceneNode(irr::scene::ISceneNode* pParent, irr::scene::ISceneManager* pSceneManager, irr::s32 id = -1);
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Queue the visible solid children and register the queue for the solid pass
+        virtual void OnRegisterSceneNode();
+        //! Draw the queue
+        virtual void render();
+        //! Get the bounding box (empty, the queue is never culled as a whole)
+        virtual const irr::core::aabbox3d<irr::f32>& getBoundingBox() const { return this->boundingBox; }
+        //! Set the light manager called around each child (the scene manager's light manager, 0 for none)
+        void setLightManager(irr::scene::ILightManager* pLightManager) { this->pLightManager = pLightManager; }
+        //! Is the queue sorted (when off the children are drawn in scene graph order, to compare)
+        bool isSorting() const { return this->sorting; }
+        //! Set whether the queue is sorted
+        void setSorting(bool sorting) { this->sorting = sorting; }
+        //! Set the batched skinning pass run on the queued nodes (0 leaves skinning to Irrlicht)
+        void setCPUSkinning(CPUSkinning* pCPUSkinning) { this->pCPUSkinning = pCPUSkinning; }
+        //! Get the number of nodes drawn by the queue last frame
+        irr::u32 getNodeCount() const { return this->nodeCount; }
+        //! Get the number of shader program changes made by the queue last frame
+        irr::u32 getProgramBindCount() const { return this->programBindCount; }
+        //! Get the number of texture changes made by the queue last frame
+        irr::u32 getTextureBindCount() const { return this->textureBindCount; }
+
+    public:
+        // Texture layers compared when sorting and counting binds
+        static const irr::u32 TEXTURE_SET_SIZE = 4;
+
+    protected:
+        //! Does any of a node's materials need the transparent pass
+        bool isTransparent(irr::scene::ISceneNode* pNode) const;
+        //! Get the texture set of a material
+        static SRenderQueueTextureSet getTextureSet(const irr::video::SMaterial& material);
+
+    protected:
+        // Bounding box
+        irr::core::aabbox3d<irr::f32> boundingBox;
+        // Light manager called around each child
+        irr::scene::ILightManager* pLightManager;
+        // Is the queue sorted
+        bool sorting;
+        // Batched skinning pass
+        CPUSkinning* pCPUSkinning;
+        // This frame's queue, reused between frames
+        std::vector<SRenderQueueEntry> entries;
+        // This frame's queued nodes, handed to the skinning pass
+        std::vector<irr::scene::ISceneNode*> queuedNodes;
+        // Texture sets numbered in the order they are first seen this frame
+        std::map<SRenderQueueTextureSet, irr::u32> textureSetIDs;
+        // Last frame's counts
+        irr::u32 nodeCount;
+        irr::u32 programBindCount;
+        irr::u32 textureBindCount;
+};
+
+#endif // RENDERQUEUESCENENODE_H
@@ -0,0 +1,183 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "SkinningBenchmark.h"
+
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+#include <Irrlicht.h>
+
+#include "Benchmark.h"
+#include "CPUSkinning.h"
+#include "JobSystem.h"
+#include "Logger.h"
+
+SkinningBenchmark::SkinningBenchmark()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->meshFile = "media/meshes/Doominator.x";
+    this->nodeCounts.push_back(1);
+    this->nodeCounts.push_back(10);
+    this->nodeCounts.push_back(100);
+    this->workerCount = 0;
+    this->tolerance = 0.0001f;
+}
+
+bool SkinningBenchmark::run(int frameCount, int warmupFrames, const std::string& outputFile)
+{
+    // *******
+    // * RUN *
+    // *******
+
+    LogMessage(ELS_INFO) << "SkinningBenchmark::run() " << this->meshFile << ", " << this->workerCount << " workers, " << frameCount << " frames";
+    // The null driver loads meshes without opening a window
+    irr::IrrlichtDevice* pDevice = irr::createDevice(irr::video::EDT_NULL);
+    if (pDevice == 0)
+    {
+        LogMessage(ELS_ERROR) << "SkinningBenchmark::run() could not create the null device";
+        return false;
+    }
+    irr::scene::ISceneManager* pSceneManager = pDevice->getSceneManager();
+    irr::scene::IAnimatedMesh* pAnimatedMesh = pSceneManager->getMesh(this->meshFile.c_str());
+    if (pAnimatedMesh == 0 || pAnimatedMesh->getMeshType() != irr::scene::EAMT_SKINNED)
+    {
+        LogMessage(ELS_ERROR) << "SkinningBenchmark::run() " << this->meshFile << " is not a skinned mesh";
+        pDevice->drop();
+        return false;
+    }
+    irr::scene::ISkinnedMesh* pSkinnedMesh = static_cast<irr::scene::ISkinnedMesh*>(pAnimatedMesh);
+    JobSystem jobSystem;
+    jobSystem.init((unsigned int)std::max(this->workerCount, 0));
+    CPUSkinning cpuSkinning;
+    cpuSkinning.setJobSystem(&jobSystem);
+    if (cpuSkinning.addMesh(pSkinnedMesh) == false)
+    {
+        pDevice->drop();
+        return false;
+    }
+
+    // Make the nodes, each starting at a different frame
+    int maxNodeCount = 0;
+    for (size_t i = 0; i < this->nodeCounts.size(); i++)
+        maxNodeCount = std::max(maxNodeCount, this->nodeCounts[i]);
+    irr::f32 frameRange = (irr::f32)std::max(pAnimatedMesh->getFrameCount(), (irr::u32)1);
+    std::vector<irr::scene::ISceneNode*> nodes;
+    std::vector<irr::f32> startFrames;
+    for (int i = 0; i < maxNodeCount; i++)
+    {
+        nodes.push_back(pSceneManager->addAnimatedMeshSceneNode(pAnimatedMesh));
+        startFrames.push_back(fmodf((irr::f32)i * 7.3f, frameRange));
+    }
+    irr::u32 vertexCount = 0;
+    for (irr::u32 i = 0; i < pSkinnedMesh->getMeshBufferCount(); i++)
+        vertexCount += pSkinnedMesh->getMeshBuffer(i)->getVertexCount();
+
+    // Record each frame's phases (both ways of skinning for each node count)
+    Benchmark benchmark;
+    std::vector<std::string> phaseNames;
+    for (size_t i = 0; i < this->nodeCounts.size(); i++)
+    {
+        std::ostringstream count;
+        count << this->nodeCounts[i];
+        phaseNames.push_back("Irrlicht" + count.str());
+        phaseNames.push_back("Batched" + count.str());
+    }
+    benchmark.setPhaseNames(phaseNames);
+    benchmark.setProperty("mode", std::string("skinning"));
+    benchmark.setProperty("mesh", this->meshFile);
+    benchmark.setProperty("meshVertices", (double)vertexCount);
+    benchmark.setProperty("meshJoints", (double)pSkinnedMesh->getAllJoints().size());
+    benchmark.setProperty("workerCount", (double)jobSystem.getWorkerCount());
+    benchmark.start(frameCount, warmupFrames);
+
+    std::vector<double> phaseTimes(phaseNames.size(), 0.0);
+    std::vector<irr::scene::ISceneNode*> batch;
+    int frame = 0;
+    int mismatches = 0;
+    double maxError = 0.0;
+    while (benchmark.isFinished() == false)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        // Advance every node's animation
+        for (int i = 0; i < maxNodeCount; i++)
+            static_cast<irr::scene::IAnimatedMeshSceneNode*>(nodes[i])->setCurrentFrame(fmodf(startFrames[i] + (irr::f32)frame * 0.5f, frameRange));
+        for (size_t i = 0; i < this->nodeCounts.size(); i++)
+        {
+            int nodeCount = this->nodeCounts[i];
+            batch.assign(nodes.begin(), nodes.begin() + nodeCount);
+            // The batched pass (the mesh's vertices stay in the bind pose)
+            pSkinnedMesh->setHardwareSkinning(true);
+            std::chrono::steady_clock::time_point phaseStart = std::chrono::steady_clock::now();
+            cpuSkinning.skin(batch);
+            std::chrono::steady_clock::time_point phaseEnd = std::chrono::steady_clock::now();
+            phaseTimes[2 * i + 1] = std::chrono::duration<double, std::milli>(phaseEnd - phaseStart).count();
+            // Irrlicht skinning each node in turn into the mesh's own buffers (as CAnimatedMeshSceneNode does before drawing)
+            pSkinnedMesh->setHardwareSkinning(false);
+            // Forget the frame the pass left the joints at so the first node is skinned
+            pSkinnedMesh->animateMesh(-1.0f, 1.0f);
+            phaseStart = std::chrono::steady_clock::now();
+            for (int j = 0; j < nodeCount; j++)
+            {
+                pSkinnedMesh->animateMesh(static_cast<irr::scene::IAnimatedMeshSceneNode*>(nodes[j])->getFrameNr(), 1.0f);
+                pSkinnedMesh->skinMesh();
+            }
+            phaseEnd = std::chrono::steady_clock::now();
+            phaseTimes[2 * i] = std::chrono::duration<double, std::milli>(phaseEnd - phaseStart).count();
+            // The mesh buffers now hold the last node's vertices, which the pass must match
+            irr::scene::ISceneNode* pLastNode = nodes[nodeCount - 1];
+            for (irr::u32 j = 0; j < pSkinnedMesh->getMeshBufferCount(); j++)
+            {
+                irr::scene::IMeshBuffer* pMeshBuffer = pSkinnedMesh->getMeshBuffer(j);
+                irr::u32 vertexPitch = irr::video::getVertexPitchFromType(pMeshBuffer->getVertexType());
+                const irr::u8* pExpected = (const irr::u8*)pMeshBuffer->getVertices();
+                const irr::u8* pSkinned = cpuSkinning.getVertices(pLastNode, j);
+                if (pSkinned == 0)
+                {
+                    mismatches += (int)pMeshBuffer->getVertexCount();
+                    continue;
+                }
+                for (irr::u32 k = 0; k < pMeshBuffer->getVertexCount(); k++)
+                {
+                    const irr::video::S3DVertex& expected = *(const irr::video::S3DVertex*)(pExpected + k * vertexPitch);
+                    const irr::video::S3DVertex& skinned = *(const irr::video::S3DVertex*)(pSkinned + k * vertexPitch);
+                    const irr::f32 expectedValues[6] = { expected.Pos.X, expected.Pos.Y, expected.Pos.Z, expected.Normal.X, expected.Normal.Y, expected.Normal.Z };
+                    const irr::f32 skinnedValues[6] = { skinned.Pos.X, skinned.Pos.Y, skinned.Pos.Z, skinned.Normal.X, skinned.Normal.Y, skinned.Normal.Z };
+                    bool mismatch = false;
+                    for (int l = 0; l < 6; l++)
+                    {
+                        double error = fabs((double)expectedValues[l] - (double)skinnedValues[l]) / std::max(1.0, fabs((double)expectedValues[l]));
+                        maxError = std::max(maxError, error);
+                        if (error > this->tolerance)
+                            mismatch = true;
+                    }
+                    if (mismatch == true)
+                        mismatches++;
+                }
+            }
+        }
+        double frameTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        benchmark.addFrame(frameTime, &phaseTimes[0]);
+        frame++;
+    }
+    // Report
+    benchmark.setProperty("tolerance", (double)this->tolerance);
+    benchmark.setProperty("maxRelativeError", maxError);
+    benchmark.setProperty("mismatchedVertices", (double)mismatches);
+    LogMessage(ELS_INFO) << "SkinningBenchmark::run() " << vertexCount << " vertices per node, largest relative difference " << maxError;
+    if (mismatches > 0)
+        LogMessage(ELS_ERROR) << "SkinningBenchmark::run() the batched pass and Irrlicht disagreed on " << mismatches << " vertices";
+    cpuSkinning.clearNodes();
+    pDevice->drop();
+    bool written = benchmark.writeJSON(outputFile);
+    return (written == true && mismatches == 0);
+}
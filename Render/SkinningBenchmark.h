@@ -0,0 +1,52 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef SKINNINGBENCHMARK_H
+#define SKINNINGBENCHMARK_H
+
+// C/C++ Includes
+#include <string>
+#include <vector>
+
+/** The SkinningBenchmark Class measures CPU skinning without a window. It
+    loads a skinned mesh with the null driver, adds nodes playing it at
+    different frames and each frame skins the first 1, 10 and 100 of them
+    twice: with the CPUSkinning pass and the way Irrlicht skins each node
+    as it is drawn (animating the joints and skinning the shared mesh
+    buffers node after node). The last node's vertices from both must agree
+    to within rounding (the pass blends the bone matrices before moving a
+    vertex, Irrlicht moves it by each bone in turn). The per frame times
+    are written with the Benchmark class **/
+class SkinningBenchmark
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        SkinningBenchmark();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Run the benchmark (returns false if the mesh could not be loaded, the vertices disagree or the results could not be written)
+        bool run(int frameCount, int warmupFrames, const std::string& outputFile);
+
+    public:
+        // Skinned mesh to load (relative to the working directory)
+        std::string meshFile;
+        // Numbers of nodes skinned each frame
+        std::vector<int> nodeCounts;
+        // Worker threads of the JobSystem the pass runs on
+        int workerCount;
+        // Largest difference allowed between the two, relative to the size of the value (at least 1)
+        float tolerance;
+};
+
+#endif // SKINNINGBENCHMARK_H
@@ -0,0 +1,333 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "ShaderConstantBenchmark.h"
+
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iterator>
+#include <chrono>
+
+#include <Irrlicht.h>
+
+#include "ShaderConstantTable.h"
+#include "ShaderFrameConstants.h"
+#include "Benchmark.h"
+#include "Logger.h"
+
+// The test program's vertex stage
+static const char* vertexSource =
+    "uniform mat4 WorldViewProjectionMatrix;\n"
+    "uniform mat4 WorldMatrix;\n"
+    "// uniform float ScreenWidth;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_Position = WorldViewProjectionMatrix * gl_Vertex;\n"
+    "}\n";
+
+// The test program's fragment stage (commented out uniforms and a longer identifier must not count)
+static const char* fragmentSource =
+    "#define MAX_LIGHTS 4\n"
+    "#define MAX_DIRECTIONAL_LIGHTS 2\n"
+    "uniform float Time;\n"
+    "uniform vec3 CameraPosition;\n"
+    "uniform vec4 AmbientLight;\n"
+    "/* uniform vec4 ShadowColor; */\n"
+    "uniform vec4 FogColor;\n"
+    "uniform float FogStart;\n"
+    "uniform int DirectionalLightCount;\n"
+    "uniform vec4 DirectionalLightDirection[MAX_DIRECTIONAL_LIGHTS];\n"
+    "uniform vec4 DirectionalLightColor[MAX_DIRECTIONAL_LIGHTS];\n"
+    "uniform int PointLightCount;\n"
+    "uniform vec4 PointLightPosition[MAX_LIGHTS];\n"
+    "uniform vec4 PointLightDiffuseColor[MAX_LIGHTS];\n"
+    "uniform vec4 PointLightAttenuation[MAX_LIGHTS];\n"
+    "float uniformity = 1.0;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = FogColor * uniformity;\n"
+    "}\n";
+
+// The test program's light capacities (its MAX_LIGHTS and MAX_DIRECTIONAL_LIGHTS)
+static const irr::u32 testLightCapacity = 4;
+static const irr::u32 testDirectionalLightCapacity = 2;
+
+// A constant uploaded to the mock services (by name so it can be compared)
+struct SShaderConstantUpload
+{
+    std::string name;
+    int count;
+    bool ints;
+
+    bool operator<(const SShaderConstantUpload& other) const { return (this->name < other.name); }
+    bool operator==(const SShaderConstantUpload& other) const { return (this->name == other.name && this->count == other.count && this->ints == other.ints); }
+};
+
+/* Stands in for a program's renderer services. Every name gets an ID except
+    the ones the "linker" dropped, and lookups and uploads are recorded */
+class MockMaterialRendererServices : public irr::video::IMaterialRendererServices
+{
+    public:
+        MockMaterialRendererServices()
+        {
+            this->recording = true;
+            this->uploadCount = 0;
+        }
+        virtual void setBasicRenderStates(const irr::video::SMaterial& material, const irr::video::SMaterial& lastMaterial, bool resetAllRenderstates) {}
+        // GLSL shares the uniforms of both stages, so the vertex calls go to the same table
+        virtual irr::s32 getVertexShaderConstantID(const irr::c8* name) { return this->getPixelShaderConstantID(name); }
+        virtual bool setVertexShaderConstant(irr::s32 index, const irr::f32* floats, int count) { return this->record(index, count, false); }
+        virtual bool setVertexShaderConstant(irr::s32 index, const irr::s32* ints, int count) { return this->record(index, count, true); }
+        virtual void setVertexShaderConstant(const irr::f32* data, irr::s32 startRegister, irr::s32 constantAmount) {}
+        virtual irr::s32 getPixelShaderConstantID(const irr::c8* name)
+        {
+            this->lookups.push_back(name);
+            if (std::find(this->dropped.begin(), this->dropped.end(), std::string(name)) != this->dropped.end())
+                return -1;
+            std::map<std::string, irr::s32>::iterator it = this->ids.find(name);
+            if (it != this->ids.end())
+                return it->second;
+            this->ids[name] = (irr::s32)this->names.size();
+            this->names.push_back(name);
+            return (irr::s32)this->names.size() - 1;
+        }
+        virtual bool setPixelShaderConstant(irr::s32 index, const irr::f32* floats, int count) { return this->record(index, count, false); }
+        virtual bool setPixelShaderConstant(irr::s32 index, const irr::s32* ints, int count) { return this->record(index, count, true); }
+        virtual void setPixelShaderConstant(const irr::f32* data, irr::s32 startRegister, irr::s32 constantAmount) {}
+        virtual irr::video::IVideoDriver* getVideoDriver() { return 0; }
+
+    protected:
+        bool record(irr::s32 index, int count, bool ints)
+        {
+            this->uploadCount++;
+            bool valid = (index >= 0 && index < (irr::s32)this->names.size());
+            if (this->recording == true)
+            {
+                SShaderConstantUpload upload;
+                upload.name = (valid == true) ? this->names[index] : std::string("<invalid>");
+                upload.count = count;
+                upload.ints = ints;
+                this->uploads.push_back(upload);
+            }
+            return valid;
+        }
+
+    public:
+        // Declared names the linker dropped (their IDs are -1)
+        std::vector<std::string> dropped;
+        // Names looked up, in order
+        std::vector<std::string> lookups;
+        // Uploads (while recording)
+        std::vector<SShaderConstantUpload> uploads;
+        // Record uploads (off while timing)
+        bool recording;
+        // Uploads made
+        unsigned int uploadCount;
+
+    protected:
+        // The ID of each name and the name of each ID
+        std::map<std::string, irr::s32> ids;
+        std::vector<std::string> names;
+};
+
+// Compare two sorted lists of names (returns the number of differences, logging each)
+static int compareNames(const std::string& what, std::vector<std::string> expected, std::vector<std::string> actual)
+{
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    std::vector<std::string> missing;
+    std::vector<std::string> extra;
+    std::set_difference(expected.begin(), expected.end(), actual.begin(), actual.end(), std::back_inserter(missing));
+    std::set_difference(actual.begin(), actual.end(), expected.begin(), expected.end(), std::back_inserter(extra));
+    for (size_t i = 0; i < missing.size(); i++)
+        LogMessage(ELS_ERROR) << "ShaderConstantBenchmark::run() " << what << " is missing " << missing[i];
+    for (size_t i = 0; i < extra.size(); i++)
+        LogMessage(ELS_ERROR) << "ShaderConstantBenchmark::run() " << what << " has an unexpected " << extra[i];
+    return (int)(missing.size() + extra.size());
+}
+
+// Add an expected upload
+static void expectUpload(std::vector<SShaderConstantUpload>& uploads, E_SHADER_CONSTANT constant, int count, bool ints)
+{
+    SShaderConstantUpload upload;
+    upload.name = ShaderConstantTable::getName(constant);
+    upload.count = count;
+    upload.ints = ints;
+    uploads.push_back(upload);
+}
+
+ShaderConstantBenchmark::ShaderConstantBenchmark()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->drawCount = 1000;
+}
+
+bool ShaderConstantBenchmark::run(int frameCount, int warmupFrames, const std::string& outputFile)
+{
+    // *******
+    // * RUN *
+    // *******
+
+    LogMessage(ELS_INFO) << "ShaderConstantBenchmark::run() " << this->drawCount << " draws, " << frameCount << " frames";
+    // The null driver and scene manager fill in the frame constants without opening a window
+    irr::IrrlichtDevice* pDevice = irr::createDevice(irr::video::EDT_NULL);
+    if (pDevice == 0)
+    {
+        LogMessage(ELS_ERROR) << "ShaderConstantBenchmark::run() could not create the null device";
+        return false;
+    }
+    irr::scene::ISceneManager* pSceneManager = pDevice->getSceneManager();
+    pSceneManager->addCameraSceneNode(0, irr::core::vector3df(0.0f, 50.0f, -100.0f), irr::core::vector3df(0.0f, 0.0f, 0.0f));
+    // More lights than the test program holds, so the uploads must be clamped
+    std::vector<irr::scene::ILightSceneNode*> directionalLights;
+    std::vector<irr::scene::ILightSceneNode*> pointLights;
+    std::vector<irr::scene::ILightSceneNode*> spotLights;
+    for (int i = 0; i < 3; i++)
+        directionalLights.push_back(pSceneManager->addLightSceneNode(0, irr::core::vector3df(0.0f, 100.0f, 0.0f), irr::video::SColorf(0.5f, 0.5f, 0.5f, 1.0f)));
+    for (int i = 0; i < 6; i++)
+        pointLights.push_back(pSceneManager->addLightSceneNode(0, irr::core::vector3df(i * 20.0f, 10.0f, 0.0f), irr::video::SColorf(1.0f, 0.5f, 0.25f, 1.0f), 50.0f));
+    for (int i = 0; i < 2; i++)
+        spotLights.push_back(pSceneManager->addLightSceneNode(0, irr::core::vector3df(0.0f, 10.0f, i * 20.0f), irr::video::SColorf(0.25f, 0.5f, 1.0f, 1.0f), 50.0f));
+    ShaderFrameConstants frameConstants;
+    frameConstants.update(pDevice->getVideoDriver(), pSceneManager, 1.0f, directionalLights, pointLights, spotLights);
+    std::vector<irr::u32> pointLightIndices;
+    for (irr::u32 i = 0; i < pointLights.size(); i++)
+        pointLightIndices.push_back(i);
+    std::vector<irr::u32> spotLightIndices;
+    for (irr::u32 i = 0; i < spotLights.size(); i++)
+        spotLightIndices.push_back(i);
+    int differences = 0;
+
+    // PARSE
+    // (commented out uniforms and longer identifiers are not declarations)
+    MockMaterialRendererServices plannedServices;
+    plannedServices.dropped.push_back(ShaderConstantTable::getName(ESC_FOG_START));
+    plannedServices.dropped.push_back(ShaderConstantTable::getName(ESC_DIRECTIONAL_LIGHT_COLOR));
+    ShaderConstantTable plannedTable;
+    plannedTable.parseSource(vertexSource);
+    plannedTable.parseSource(fragmentSource);
+    plannedTable.setLightCapacities(testLightCapacity, testDirectionalLightCapacity);
+    const E_SHADER_CONSTANT declared[] = {
+        ESC_WORLD_VIEW_PROJECTION_MATRIX, ESC_WORLD_MATRIX, ESC_TIME, ESC_CAMERA_POSITION, ESC_AMBIENT_LIGHT,
+        ESC_FOG_COLOR, ESC_FOG_START, ESC_DIRECTIONAL_LIGHT_COUNT, ESC_DIRECTIONAL_LIGHT_DIRECTION, ESC_DIRECTIONAL_LIGHT_COLOR,
+        ESC_POINT_LIGHT_COUNT, ESC_POINT_LIGHT_POSITION, ESC_POINT_LIGHT_DIFFUSE_COLOR, ESC_POINT_LIGHT_ATTENUATION };
+    const irr::u32 declaredCount = sizeof(declared) / sizeof(declared[0]);
+    std::vector<std::string> declaredNames;
+    for (irr::u32 i = 0; i < declaredCount; i++)
+        declaredNames.push_back(ShaderConstantTable::getName(declared[i]));
+    if (plannedTable.getUsedCount() != declaredCount)
+    {
+        LogMessage(ELS_ERROR) << "ShaderConstantBenchmark::run() the source declares " << declaredCount << " constants but " << plannedTable.getUsedCount() << " were found";
+        differences++;
+    }
+    if (plannedTable.isGroupUsed(ESCG_SCREEN) == true || plannedTable.isGroupUsed(ESCG_SPOT_LIGHTS) == true || plannedTable.isGroupUsed(ESCG_FOG) == false)
+    {
+        LogMessage(ELS_ERROR) << "ShaderConstantBenchmark::run() the groups found in the source are wrong";
+        differences++;
+    }
+
+    // RESOLVE
+    // (only the declared names are looked up, and the dropped ones are skipped from then on)
+    plannedTable.resolve(&plannedServices);
+    differences += compareNames("the lookups", declaredNames, plannedServices.lookups);
+    if (plannedTable.getUsedCount() != declaredCount - plannedServices.dropped.size() || plannedTable.isUsed(ESC_FOG_START) == true || plannedTable.isUsed(ESC_DIRECTIONAL_LIGHT_COLOR) == true)
+    {
+        LogMessage(ELS_ERROR) << "ShaderConstantBenchmark::run() the constants the linker dropped are still used";
+        differences++;
+    }
+
+    // UPLOAD
+    // (the world constants are set by the node's callback, not the frame constants)
+    std::vector<SShaderConstantUpload> expected;
+    expectUpload(expected, ESC_TIME, 1, false);
+    expectUpload(expected, ESC_CAMERA_POSITION, 3, false);
+    expectUpload(expected, ESC_AMBIENT_LIGHT, 4, false);
+    expectUpload(expected, ESC_FOG_COLOR, 4, false);
+    expectUpload(expected, ESC_DIRECTIONAL_LIGHT_COUNT, 1, true);
+    expectUpload(expected, ESC_DIRECTIONAL_LIGHT_DIRECTION, 4 * testDirectionalLightCapacity, false);
+    expectUpload(expected, ESC_POINT_LIGHT_COUNT, 1, true);
+    expectUpload(expected, ESC_POINT_LIGHT_POSITION, 4 * testLightCapacity, false);
+    expectUpload(expected, ESC_POINT_LIGHT_DIFFUSE_COLOR, 4 * testLightCapacity, false);
+    expectUpload(expected, ESC_POINT_LIGHT_ATTENUATION, 4 * testLightCapacity, false);
+    frameConstants.upload(&plannedServices, plannedTable);
+    frameConstants.uploadNodeLights(&plannedServices, plannedTable, pointLightIndices, spotLightIndices);
+    std::vector<SShaderConstantUpload> uploads = plannedServices.uploads;
+    std::sort(expected.begin(), expected.end());
+    std::sort(uploads.begin(), uploads.end());
+    std::vector<std::string> expectedNames;
+    std::vector<std::string> uploadedNames;
+    for (size_t i = 0; i < expected.size(); i++)
+        expectedNames.push_back(expected[i].name);
+    for (size_t i = 0; i < uploads.size(); i++)
+        uploadedNames.push_back(uploads[i].name);
+    int uploadDifferences = compareNames("the uploads", expectedNames, uploadedNames);
+    differences += uploadDifferences;
+    for (size_t i = 0; i < expected.size() && uploadDifferences == 0; i++)
+    {
+        if ((expected[i] == uploads[i]) == false)
+        {
+            LogMessage(ELS_ERROR) << "ShaderConstantBenchmark::run() " << uploads[i].name << " was uploaded as " << uploads[i].count << (uploads[i].ints == true ? " ints" : " floats")
+                << " instead of " << expected[i].count << (expected[i].ints == true ? " ints" : " floats");
+            differences++;
+        }
+    }
+    if (differences > 0)
+    {
+        LogMessage(ELS_ERROR) << "ShaderConstantBenchmark::run() the upload plan differs from the program in " << differences << " places";
+        pDevice->drop();
+        return false;
+    }
+
+    // A table that has not scanned the source looks up and uploads every group
+    MockMaterialRendererServices allServices;
+    allServices.dropped = plannedServices.dropped;
+    allServices.recording = false;
+    plannedServices.recording = false;
+    ShaderConstantTable allTable;
+    allTable.setLightCapacities(testLightCapacity, testDirectionalLightCapacity);
+    allTable.resolve(&allServices);
+    allServices.uploadCount = 0;
+    frameConstants.upload(&allServices, allTable);
+    frameConstants.uploadNodeLights(&allServices, allTable, pointLightIndices, spotLightIndices);
+
+    // TIME THE UPLOADS
+    Benchmark benchmark;
+    std::vector<std::string> phaseNames;
+    phaseNames.push_back("UploadAll");
+    phaseNames.push_back("UploadPlanned");
+    benchmark.setPhaseNames(phaseNames);
+    benchmark.setProperty("mode", std::string("shaderConstants"));
+    benchmark.setProperty("draws", (double)this->drawCount);
+    benchmark.setProperty("uploadsPerDrawAll", (double)allServices.uploadCount);
+    benchmark.setProperty("uploadsPerDrawPlanned", (double)uploads.size());
+    benchmark.start(frameCount, warmupFrames);
+    double phaseTimes[2] = { 0.0, 0.0 };
+    while (benchmark.isFinished() == false)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < this->drawCount; i++)
+        {
+            frameConstants.upload(&allServices, allTable);
+            frameConstants.uploadNodeLights(&allServices, allTable, pointLightIndices, spotLightIndices);
+        }
+        std::chrono::steady_clock::time_point planned = std::chrono::steady_clock::now();
+        for (int i = 0; i < this->drawCount; i++)
+        {
+            frameConstants.upload(&plannedServices, plannedTable);
+            frameConstants.uploadNodeLights(&plannedServices, plannedTable, pointLightIndices, spotLightIndices);
+        }
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        phaseTimes[0] = std::chrono::duration<double, std::milli>(planned - start).count();
+        phaseTimes[1] = std::chrono::duration<double, std::milli>(end - planned).count();
+        benchmark.addFrame(std::chrono::duration<double, std::milli>(end - start).count(), phaseTimes);
+    }
+    pDevice->drop();
+    return benchmark.writeJSON(outputFile);
+}
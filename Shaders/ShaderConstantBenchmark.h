@@ -0,0 +1,47 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef SHADERCONSTANTBENCHMARK_H
+#define SHADERCONSTANTBENCHMARK_H
+
+// C/C++ Includes
+#include <string>
+
+/** The ShaderConstantBenchmark Class checks and measures the shader constant
+    upload plan without a window. A test program's source is scanned by a
+    ShaderConstantTable and resolved against a mock IMaterialRendererServices
+    that drops some declared uniforms the way a linker would. The check
+    fails unless only the declared names are looked up and the frame and
+    node uploads send exactly the constants the program uses, at the sizes
+    the shader's arrays expect (clamped to its light capacities). Then each
+    frame the constants for a number of draws are uploaded to the mock,
+    once with a table that has not scanned the source (every group) and
+    once with the planned table. The per frame times are written with the
+    Benchmark class **/
+class ShaderConstantBenchmark
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        ShaderConstantBenchmark();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Run the benchmark (returns false if the upload plan is wrong or the results could not be written)
+        bool run(int frameCount, int warmupFrames, const std::string& outputFile);
+
+    public:
+        // Draws whose constants are uploaded each frame
+        int drawCount;
+};
+
+#endif // SHADERCONSTANTBENCHMARK_H
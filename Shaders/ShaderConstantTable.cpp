@@ -0,0 +1,282 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "ShaderConstantTable.h"
+
+#include <cctype>
+
+ShaderConstantTable::ShaderConstantTable()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->resolved = false;
+    this->sourceParsed = false;
+    for (int i = 0; i < ESC_COUNT; i++)
+    {
+        this->ids[i] = -1;
+        this->declared[i] = false;
+    }
+    // Until the source is scanned every group is uploaded
+    this->groupMask = (1u << ESCG_COUNT) - 1;
+    // The capacities the shaders fall back to without defines
+    this->lightCapacity = 25;
+    this->directionalLightCapacity = 8;
+}
+
+void ShaderConstantTable::parseSource(const std::string& source)
+{
+    // ****************
+    // * PARSE SOURCE *
+    // ****************
+
+    // Strip the comments so commented out uniforms are not counted
+    std::string code;
+    code.reserve(source.size());
+    for (size_t i = 0; i < source.size(); i++)
+    {
+        if (source.compare(i, 2, "//") == 0)
+        {
+            i = source.find('\n', i);
+            if (i == std::string::npos)
+                break;
+            code += '\n';
+        }
+        else if (source.compare(i, 2, "/*") == 0)
+        {
+            i = source.find("*/", i + 2);
+            if (i == std::string::npos)
+                break;
+            i++;
+            code += ' ';
+        }
+        else
+        {
+            code += source[i];
+        }
+    }
+    // Find each "uniform <type> <name>" declaration
+    size_t position = 0;
+    while ((position = code.find("uniform", position)) != std::string::npos)
+    {
+        // Make sure it is the keyword and not part of a longer identifier
+        bool startOfWord = (position == 0 || (isalnum((unsigned char)code[position - 1]) == 0 && code[position - 1] != '_'));
+        position += 7;
+        if (startOfWord == false || position >= code.size() || isspace((unsigned char)code[position]) == 0)
+            continue;
+        // Skip the type
+        size_t typeStart = code.find_first_not_of(" \t\r\n", position);
+        if (typeStart == std::string::npos)
+            break;
+        size_t typeEnd = code.find_first_of(" \t\r\n", typeStart);
+        if (typeEnd == std::string::npos)
+            break;
+        // Read the name (up to an array size, whitespace or the end of the statement)
+        size_t nameStart = code.find_first_not_of(" \t\r\n", typeEnd);
+        if (nameStart == std::string::npos)
+            break;
+        size_t nameEnd = code.find_first_of(" \t\r\n[;", nameStart);
+        std::string name = code.substr(nameStart, (nameEnd == std::string::npos) ? std::string::npos : nameEnd - nameStart);
+        // Mark the matching constant
+        for (int i = 0; i < ESC_COUNT; i++)
+        {
+            std::string constantName = ShaderConstantTable::getName((E_SHADER_CONSTANT)i);
+            size_t bracket = constantName.find('[');
+            if (bracket != std::string::npos)
+                constantName.erase(bracket);
+            if (constantName == name)
+                this->declared[i] = true;
+        }
+        position = nameStart;
+    }
+    this->sourceParsed = true;
+    this->updateGroupMask();
+}
+
+void ShaderConstantTable::resolve(irr::video::IMaterialRendererServices* pServices)
+{
+    // ***********
+    // * RESOLVE *
+    // ***********
+
+    // Look up each declared constant once (this is the only place names are searched)
+    for (int i = 0; i < ESC_COUNT; i++)
+    {
+        if (this->sourceParsed == true && this->declared[i] == false)
+            this->ids[i] = -1;
+        else
+            this->ids[i] = pServices->getPixelShaderConstantID(ShaderConstantTable::getName((E_SHADER_CONSTANT)i));
+    }
+    this->resolved = true;
+    // Drop any group the linker optimised away
+    this->updateGroupMask();
+}
+
+void ShaderConstantTable::updateGroupMask()
+{
+    this->groupMask = 0;
+    for (int i = 0; i < ESC_COUNT; i++)
+    {
+        bool used = (this->resolved == true) ? (this->ids[i] != -1) : this->declared[i];
+        if (used == true)
+            this->groupMask |= (1u << ShaderConstantTable::getGroup((E_SHADER_CONSTANT)i));
+    }
+}
+
+irr::u32 ShaderConstantTable::getUsedCount() const
+{
+    irr::u32 count = 0;
+    for (int i = 0; i < ESC_COUNT; i++)
+    {
+        bool used = (this->resolved == true) ? (this->ids[i] != -1) : (this->sourceParsed == false || this->declared[i] == true);
+        if (used == true)
+            count++;
+    }
+    return count;
+}
+
+const char* ShaderConstantTable::getName(E_SHADER_CONSTANT constant)
+{
+    // Texture slots
+    if (constant >= ESC_TEXTURE0_IN_USE && constant <= ESC_TEXTURE_LAST)
+    {
+        static const char* textureNames[3 * 8] = {
+            "Texture0InUse", "Texture0", "Texture0Matrix",
+            "Texture1InUse", "Texture1", "Texture1Matrix",
+            "Texture2InUse", "Texture2", "Texture2Matrix",
+            "Texture3InUse", "Texture3", "Texture3Matrix",
+            "Texture4InUse", "Texture4", "Texture4Matrix",
+            "Texture5InUse", "Texture5", "Texture5Matrix",
+            "Texture6InUse", "Texture6", "Texture6Matrix",
+            "Texture7InUse", "Texture7", "Texture7Matrix" };
+        return textureNames[constant - ESC_TEXTURE0_IN_USE];
+    }
+    switch (constant)
+    {
+        case ESC_SCREEN_WIDTH: return "ScreenWidth";
+        case ESC_SCREEN_HEIGHT: return "ScreenHeight";
+        case ESC_WORLD_VIEW_PROJECTION_MATRIX: return "WorldViewProjectionMatrix";
+        case ESC_WORLD_MATRIX: return "WorldMatrix";
+        case ESC_INVERSE_WORLD_MATRIX: return "InverseWorldMatrix";
+        case ESC_VIEW_MATRIX: return "ViewMatrix";
+        case ESC_INVERSE_VIEW_MATRIX: return "InverseViewMatrix";
+        case ESC_PROJECTION_MATRIX: return "ProjectionMatrix";
+        case ESC_INVERSE_PROJECTION_MATRIX: return "InverseProjectionMatrix";
+        case ESC_NORMAL_MATRIX: return "NormalMatrix";
+        case ESC_TIME: return "Time";
+        case ESC_CAMERA_POSITION: return "CameraPosition";
+        case ESC_CAMERA_TARGET: return "CameraTarget";
+        case ESC_CAMERA_VIEW_MATRIX: return "CameraViewMatrix";
+        case ESC_INVERSE_CAMERA_VIEW_MATRIX: return "InverseCameraViewMatrix";
+        case ESC_CAMERA_PROJECTION_MATRIX: return "CameraProjectionMatrix";
+        case ESC_INVERSE_CAMERA_PROJECTION_MATRIX: return "InverseCameraProjectionMatrix";
+        case ESC_CAMERA_NEAR_PLANE: return "CameraNearPlane";
+        case ESC_CAMERA_FAR_PLANE: return "CameraFarPlane";
+        case ESC_CAMERA_FOV: return "CameraFOV";
+        case ESC_LIGHTING_ENABLED: return "LightingEnabled";
+        case ESC_ZWRITE_ENABLE: return "ZWriteEnable";
+        case ESC_SPECULAR_POWER: return "SpecularPower";
+        case ESC_AMBIENT_MATERIAL_COLOR: return "AmbientMaterialColor";
+        case ESC_DIFFUSE_MATERIAL_COLOR: return "DiffuseMaterialColor";
+        case ESC_SPECULAR_MATERIAL_COLOR: return "SpecularMaterialColor";
+        case ESC_EMISSIVE_MATERIAL_COLOR: return "EmissiveMaterialColor";
+        case ESC_MATERIAL_TYPE_PARAM: return "MaterialTypeParam";
+        case ESC_MATERIAL_TYPE_PARAM2: return "MaterialTypeParam2";
+        case ESC_AMBIENT_LIGHT: return "AmbientLight";
+        case ESC_SHADOW_COLOR: return "ShadowColor";
+        case ESC_FOG_COLOR: return "FogColor";
+        case ESC_FOG_START: return "FogStart";
+        case ESC_FOG_END: return "FogEnd";
+        case ESC_FOG_DENSITY: return "FogDensity";
+        case ESC_DIRECTIONAL_LIGHT_COUNT: return "DirectionalLightCount";
+        case ESC_DIRECTIONAL_LIGHT_DIRECTION: return "DirectionalLightDirection[0]";
+        case ESC_DIRECTIONAL_LIGHT_COLOR: return "DirectionalLightColor[0]";
+        case ESC_POINT_LIGHT_COUNT: return "PointLightCount";
+        case ESC_POINT_LIGHT_POSITION: return "PointLightPosition[0]";
+        case ESC_POINT_LIGHT_DIFFUSE_COLOR: return "PointLightDiffuseColor[0]";
+        case ESC_POINT_LIGHT_ATTENUATION: return "PointLightAttenuation[0]";
+        case ESC_SPOT_LIGHT_COUNT: return "SpotLightCount";
+        case ESC_SPOT_LIGHT_POSITION: return "SpotLightPosition[0]";
+        case ESC_SPOT_LIGHT_DIRECTION: return "SpotLightDirection[0]";
+        case ESC_SPOT_LIGHT_DIFFUSE_COLOR: return "SpotLightDiffuseColor[0]";
+        case ESC_SPOT_LIGHT_ATTENUATION: return "SpotLightAttenuation[0]";
+        case ESC_CLUSTER_GRID: return "ClusterGrid";
+        case ESC_CLUSTER_LIGHT_INDICES: return "ClusterLightIndices";
+        case ESC_CLUSTER_DIMENSIONS: return "ClusterDimensions";
+        case ESC_CLUSTER_DEPTH: return "ClusterDepth";
+        case ESC_CLUSTER_LIGHT_COUNT: return "ClusterLightCount";
+        case ESC_CLUSTER_LIGHT_POSITION: return "ClusterLightPosition[0]";
+        case ESC_CLUSTER_LIGHT_COLOR: return "ClusterLightColor[0]";
+        case ESC_CLUSTER_LIGHT_ATTENUATION: return "ClusterLightAttenuation[0]";
+        case ESC_CLUSTER_LIGHT_DIRECTION: return "ClusterLightDirection[0]";
+        case ESC_INSTANCE_MATRIX: return "InstanceMatrix[0]";
+        case ESC_INSTANCE_COLOR: return "InstanceColor[0]";
+        case ESC_BONE_MATRIX: return "BoneMatrix[0]";
+        default: return "";
+    }
+}
+
+E_SHADER_CONSTANT_GROUP ShaderConstantTable::getGroup(E_SHADER_CONSTANT constant)
+{
+    // Texture slots
+    if (constant >= ESC_TEXTURE0_IN_USE && constant <= ESC_TEXTURE_LAST)
+        return (E_SHADER_CONSTANT_GROUP)(ESCG_TEXTURE0 + (constant - ESC_TEXTURE0_IN_USE) / 3);
+    if (constant <= ESC_SCREEN_HEIGHT)
+        return ESCG_SCREEN;
+    if (constant == ESC_WORLD_VIEW_PROJECTION_MATRIX || constant == ESC_WORLD_MATRIX || constant == ESC_INVERSE_WORLD_MATRIX || constant == ESC_NORMAL_MATRIX)
+        return ESCG_WORLD;
+    if (constant <= ESC_INVERSE_PROJECTION_MATRIX)
+        return ESCG_VIEW;
+    if (constant == ESC_TIME)
+        return ESCG_TIME;
+    if (constant <= ESC_CAMERA_FOV)
+        return ESCG_CAMERA;
+    if (constant <= ESC_MATERIAL_TYPE_PARAM2)
+        return ESCG_MATERIAL;
+    if (constant <= ESC_SHADOW_COLOR)
+        return ESCG_AMBIENT;
+    if (constant <= ESC_FOG_DENSITY)
+        return ESCG_FOG;
+    if (constant <= ESC_DIRECTIONAL_LIGHT_COLOR)
+        return ESCG_DIRECTIONAL_LIGHTS;
+    if (constant <= ESC_POINT_LIGHT_ATTENUATION)
+        return ESCG_POINT_LIGHTS;
+    if (constant <= ESC_SPOT_LIGHT_ATTENUATION)
+        return ESCG_SPOT_LIGHTS;
+    if (constant <= ESC_CLUSTER_LIGHT_DIRECTION)
+        return ESCG_CLUSTERS;
+    if (constant <= ESC_INSTANCE_COLOR)
+        return ESCG_INSTANCES;
+    return ESCG_SKINNING;
+}
+
+const char* ShaderConstantTable::getGroupName(E_SHADER_CONSTANT_GROUP group)
+{
+    if (group >= ESCG_TEXTURE0 && group <= ESCG_TEXTURE_LAST)
+    {
+        static const char* textureNames[8] = { "Texture0", "Texture1", "Texture2", "Texture3", "Texture4", "Texture5", "Texture6", "Texture7" };
+        return textureNames[group - ESCG_TEXTURE0];
+    }
+    switch (group)
+    {
+        case ESCG_SCREEN: return "Screen";
+        case ESCG_TIME: return "Time";
+        case ESCG_VIEW: return "View";
+        case ESCG_WORLD: return "World";
+        case ESCG_CAMERA: return "Camera";
+        case ESCG_MATERIAL: return "Material";
+        case ESCG_AMBIENT: return "Ambient";
+        case ESCG_FOG: return "Fog";
+        case ESCG_DIRECTIONAL_LIGHTS: return "DirectionalLights";
+        case ESCG_POINT_LIGHTS: return "PointLights";
+        case ESCG_SPOT_LIGHTS: return "SpotLights";
+        case ESCG_CLUSTERS: return "Clusters";
+        case ESCG_INSTANCES: return "Instances";
+        case ESCG_SKINNING: return "Skinning";
+        default: return "";
+    }
+}
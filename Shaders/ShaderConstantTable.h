@@ -0,0 +1,214 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef SHADERCONSTANTTABLE_H
+#define SHADERCONSTANTTABLE_H
+
+// C/C++ Includes
+#include <string>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+//! Every uniform the Game passes to its shaders (see ShaderConstantTable::getName for the GLSL names)
+enum E_SHADER_CONSTANT
+{
+    // Screen
+    ESC_SCREEN_WIDTH = 0,
+    ESC_SCREEN_HEIGHT,
+    // Matrices
+    ESC_WORLD_VIEW_PROJECTION_MATRIX,
+    ESC_WORLD_MATRIX,
+    ESC_INVERSE_WORLD_MATRIX,
+    ESC_VIEW_MATRIX,
+    ESC_INVERSE_VIEW_MATRIX,
+    ESC_PROJECTION_MATRIX,
+    ESC_INVERSE_PROJECTION_MATRIX,
+    ESC_NORMAL_MATRIX,
+    // Time
+    ESC_TIME,
+    // Camera
+    ESC_CAMERA_POSITION,
+    ESC_CAMERA_TARGET,
+    ESC_CAMERA_VIEW_MATRIX,
+    ESC_INVERSE_CAMERA_VIEW_MATRIX,
+    ESC_CAMERA_PROJECTION_MATRIX,
+    ESC_INVERSE_CAMERA_PROJECTION_MATRIX,
+    ESC_CAMERA_NEAR_PLANE,
+    ESC_CAMERA_FAR_PLANE,
+    ESC_CAMERA_FOV,
+    // Material
+    ESC_LIGHTING_ENABLED,
+    ESC_ZWRITE_ENABLE,
+    ESC_SPECULAR_POWER,
+    ESC_AMBIENT_MATERIAL_COLOR,
+    ESC_DIFFUSE_MATERIAL_COLOR,
+    ESC_SPECULAR_MATERIAL_COLOR,
+    ESC_EMISSIVE_MATERIAL_COLOR,
+    ESC_MATERIAL_TYPE_PARAM,
+    ESC_MATERIAL_TYPE_PARAM2,
+    // Textures (each slot has an InUse flag, a sampler and a matrix)
+    ESC_TEXTURE0_IN_USE,
+    ESC_TEXTURE0,
+    ESC_TEXTURE0_MATRIX,
+    ESC_TEXTURE_LAST = ESC_TEXTURE0_IN_USE + 3 * 8 - 1,
+    // Global lighting
+    ESC_AMBIENT_LIGHT,
+    ESC_SHADOW_COLOR,
+    // Fog
+    ESC_FOG_COLOR,
+    ESC_FOG_START,
+    ESC_FOG_END,
+    ESC_FOG_DENSITY,
+    // Directional lights
+    ESC_DIRECTIONAL_LIGHT_COUNT,
+    ESC_DIRECTIONAL_LIGHT_DIRECTION,
+    ESC_DIRECTIONAL_LIGHT_COLOR,
+    // Point lights
+    ESC_POINT_LIGHT_COUNT,
+    ESC_POINT_LIGHT_POSITION,
+    ESC_POINT_LIGHT_DIFFUSE_COLOR,
+    ESC_POINT_LIGHT_ATTENUATION,
+    // Spot lights
+    ESC_SPOT_LIGHT_COUNT,
+    ESC_SPOT_LIGHT_POSITION,
+    ESC_SPOT_LIGHT_DIRECTION,
+    ESC_SPOT_LIGHT_DIFFUSE_COLOR,
+    ESC_SPOT_LIGHT_ATTENUATION,
+    // Clustered lights (see ClusteredLighting)
+    ESC_CLUSTER_GRID,
+    ESC_CLUSTER_LIGHT_INDICES,
+    ESC_CLUSTER_DIMENSIONS,
+    ESC_CLUSTER_DEPTH,
+    ESC_CLUSTER_LIGHT_COUNT,
+    ESC_CLUSTER_LIGHT_POSITION,
+    ESC_CLUSTER_LIGHT_COLOR,
+    ESC_CLUSTER_LIGHT_ATTENUATION,
+    ESC_CLUSTER_LIGHT_DIRECTION,
+    // Instances (see InstancedMeshSceneNode)
+    ESC_INSTANCE_MATRIX,
+    ESC_INSTANCE_COLOR,
+    // Bone palette (see GPUSkinning)
+    ESC_BONE_MATRIX,
+    // Number of constants
+    ESC_COUNT
+};
+
+//! Groups of constants which are computed and uploaded together
+enum E_SHADER_CONSTANT_GROUP
+{
+    ESCG_SCREEN = 0,
+    ESCG_TIME,
+    ESCG_VIEW,
+    ESCG_WORLD,
+    ESCG_CAMERA,
+    ESCG_MATERIAL,
+    ESCG_TEXTURE0,
+    ESCG_TEXTURE_LAST = ESCG_TEXTURE0 + 8 - 1,
+    ESCG_AMBIENT,
+    ESCG_FOG,
+    ESCG_DIRECTIONAL_LIGHTS,
+    ESCG_POINT_LIGHTS,
+    ESCG_SPOT_LIGHTS,
+    ESCG_CLUSTERS,
+    ESCG_INSTANCES,
+    ESCG_SKINNING,
+    // Number of groups
+    ESCG_COUNT
+};
+
+/** The ShaderConstantTable Class holds the constant IDs of one shader
+    program. The IDs are looked up by name (a search of the program's
+    uniforms) the first time the program is used and after that every
+    upload goes straight to the ID. GLSL shares one set of uniforms between
+    the vertex and fragment stages of a program so each constant is only
+    uploaded once.
+    The table is also the program's upload plan. When the shader is loaded
+    its source is scanned for uniform declarations and when the IDs are
+    looked up any constant the linker dropped is removed as well. A group of
+    constants is only computed and uploaded if the program uses one of its
+    constants **/
+class ShaderConstantTable
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        ShaderConstantTable();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Scan the source of one of the program's stages for uniform declarations
+        void parseSource(const std::string& source);
+        //! Look up the ID of every constant in the program
+        void resolve(irr::video::IMaterialRendererServices* pServices);
+        //! Have the IDs been looked up
+        bool isResolved() const { return this->resolved; }
+        //! Forget the IDs (eg after the program is rebuilt)
+        void invalidate() { this->resolved = false; }
+        //! Get the ID of a constant (-1 when the program does not use it)
+        irr::s32 getID(E_SHADER_CONSTANT constant) const { return this->ids[constant]; }
+        //! Does the program use a constant
+        bool isUsed(E_SHADER_CONSTANT constant) const { return (this->ids[constant] != -1); }
+        //! Does the program use any constant in a group
+        bool isGroupUsed(E_SHADER_CONSTANT_GROUP group) const { return ((this->groupMask & (1u << group)) != 0); }
+        //! Get the number of constants the program uses (declared before resolving)
+        irr::u32 getUsedCount() const;
+        //! Get the GLSL name of a constant
+        static const char* getName(E_SHADER_CONSTANT constant);
+        //! Get the group a constant belongs to
+        static E_SHADER_CONSTANT_GROUP getGroup(E_SHADER_CONSTANT constant);
+        //! Get the name of a group
+        static const char* getGroupName(E_SHADER_CONSTANT_GROUP group);
+        //! Get the most point or spot lights the program's arrays hold (its MAX_LIGHTS)
+        irr::u32 getLightCapacity() const { return this->lightCapacity; }
+        //! Get the most directional lights the program's arrays hold (its MAX_DIRECTIONAL_LIGHTS)
+        irr::u32 getDirectionalLightCapacity() const { return this->directionalLightCapacity; }
+        //! Set the light capacities the program was built with
+        void setLightCapacities(irr::u32 lightCapacity, irr::u32 directionalLightCapacity) { this->lightCapacity = lightCapacity; this->directionalLightCapacity = directionalLightCapacity; }
+        //! Get the constant for a texture slot's InUse flag, sampler or matrix
+        static E_SHADER_CONSTANT getTextureConstant(E_SHADER_CONSTANT textureSlot0Constant, irr::u32 slot) { return (E_SHADER_CONSTANT)(textureSlot0Constant + 3 * slot); }
+
+    public:
+        //! Upload floats to a constant (skipped when the program does not use it)
+        void set(irr::video::IMaterialRendererServices* pServices, E_SHADER_CONSTANT constant, const irr::f32* floats, int count) const
+        {
+            if (this->ids[constant] != -1)
+                pServices->setPixelShaderConstant(this->ids[constant], floats, count);
+        }
+        //! Upload ints to a constant (skipped when the program does not use it)
+        void set(irr::video::IMaterialRendererServices* pServices, E_SHADER_CONSTANT constant, const irr::s32* ints, int count) const
+        {
+            if (this->ids[constant] != -1)
+                pServices->setPixelShaderConstant(this->ids[constant], ints, count);
+        }
+
+    protected:
+        //! Rebuild the group mask from the declared constants (or the IDs once resolved)
+        void updateGroupMask();
+
+    protected:
+        // Have the IDs been looked up
+        bool resolved;
+        // The ID of each constant (-1 when unused)
+        irr::s32 ids[ESC_COUNT];
+        // Has any source been scanned
+        bool sourceParsed;
+        // Is each constant declared in the program's source
+        bool declared[ESC_COUNT];
+        // One bit for each group the program uses
+        irr::u32 groupMask;
+        // Most point or spot lights and directional lights the program's arrays hold
+        irr::u32 lightCapacity;
+        irr::u32 directionalLightCapacity;
+};
+
+#endif // SHADERCONSTANTTABLE_H
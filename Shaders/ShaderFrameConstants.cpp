@@ -0,0 +1,334 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "ShaderFrameConstants.h"
+
+#include <cmath>
+
+ShaderFrameConstants::ShaderFrameConstants()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->screenWidth = 0.0f;
+    this->screenHeight = 0.0f;
+    this->time = 0.0f;
+    this->cameraActive = false;
+    this->cameraNearPlane = 0.0f;
+    this->cameraFarPlane = 0.0f;
+    this->cameraFOV = 0.0f;
+    for (int i = 0; i < 4; i++)
+    {
+        this->ambientLight[i] = 0.0f;
+        this->shadowColour[i] = 0.0f;
+        this->fogColour[i] = 0.0f;
+    }
+    // The Fog Type (EFT_FOG_EXP=0, EFT_FOG_LINEAR, EFT_FOG_EXP2)
+    this->fogType = irr::video::EFT_FOG_LINEAR;
+    this->fogStart = 0.0f;
+    this->fogEnd = 0.0f;
+    this->fogDensity = 0.0f;
+    this->directionalLightCount = 0;
+}
+
+void ShaderFrameConstants::update(irr::video::IVideoDriver* pVideoDriver, irr::scene::ISceneManager* pSceneManager, irr::f32 time,
+                                  const std::vector<irr::scene::ILightSceneNode*>& directionalLights,
+                                  const std::vector<irr::scene::ILightSceneNode*>& pointLights,
+                                  const std::vector<irr::scene::ILightSceneNode*>& spotLights)
+{
+    // **********
+    // * UPDATE *
+    // **********
+
+    // SCREEN AND TIME
+    this->screenWidth = (irr::f32)pVideoDriver->getScreenSize().Width;
+    this->screenHeight = (irr::f32)pVideoDriver->getScreenSize().Height;
+    this->time = time;
+
+    // VIEW AND PROJECTION (the camera has already set these when the light manager is called)
+    this->viewMatrix = pVideoDriver->getTransform(irr::video::ETS_VIEW);
+    this->viewMatrix.getInverse(this->inverseViewMatrix);
+    this->projectionMatrix = pVideoDriver->getTransform(irr::video::ETS_PROJECTION);
+    this->projectionMatrix.getInverse(this->inverseProjectionMatrix);
+    this->viewProjectionMatrix = this->projectionMatrix * this->viewMatrix;
+
+    // CAMERA
+    irr::scene::ICameraSceneNode* pCamera = pSceneManager->getActiveCamera();
+    this->cameraActive = (pCamera != 0);
+    if (this->cameraActive == true)
+    {
+        // Get the camera position
+        this->cameraPosition = pCamera->getPosition();
+        // Get the camera target normal
+        this->cameraTarget = (pCamera->getTarget() - pCamera->getAbsolutePosition()).normalize();
+        // Get the camera view matrix and its inverse
+        this->cameraViewMatrix = pCamera->getViewMatrix();
+        this->cameraViewMatrix.getInverse(this->inverseCameraViewMatrix);
+        // Get the camera projection matrix and its inverse
+        this->cameraProjectionMatrix = pCamera->getProjectionMatrix();
+        this->cameraProjectionMatrix.getInverse(this->inverseCameraProjectionMatrix);
+        // Get the camera planes and FOV
+        this->cameraNearPlane = pCamera->getNearValue();
+        this->cameraFarPlane = pCamera->getFarValue();
+        this->cameraFOV = pCamera->getFOV();
+    }
+
+    // AMBIENT LIGHT AND SHADOW COLOUR
+    irr::video::SColorf ambient = pSceneManager->getAmbientLight();
+    this->ambientLight[0] = ambient.getRed();
+    this->ambientLight[1] = ambient.getGreen();
+    this->ambientLight[2] = ambient.getBlue();
+    this->ambientLight[3] = ambient.getAlpha();
+    irr::video::SColorf shadow = pSceneManager->getShadowColor();
+    this->shadowColour[0] = shadow.getRed();
+    this->shadowColour[1] = shadow.getGreen();
+    this->shadowColour[2] = shadow.getBlue();
+    this->shadowColour[3] = shadow.getAlpha();
+
+    // FOG
+    // The Fog Colour
+    irr::video::SColor fog;
+    // Pixel fog and range fog are irrelevant to our pixel shaders
+    bool fogPixel = false;
+    bool fogRange = false;
+    // Get Information about the fog
+    pVideoDriver->getFog(fog, this->fogType, this->fogStart, this->fogEnd, this->fogDensity, fogPixel, fogRange);
+    this->fogColour[0] = (irr::f32)fog.getRed() / 255.0f;
+    this->fogColour[1] = (irr::f32)fog.getGreen() / 255.0f;
+    this->fogColour[2] = (irr::f32)fog.getBlue() / 255.0f;
+    this->fogColour[3] = (irr::f32)fog.getAlpha() / 255.0f;
+
+    // DIRECTIONAL LIGHTS
+    this->directionalLightCount = (irr::s32)irr::core::min_(directionalLights.size(), (size_t)MAX_DIRECTIONAL_LIGHTS);
+    for (int i = 0; i < this->directionalLightCount; i++)
+    {
+        // Get a light from the list
+        irr::scene::ILightSceneNode* pLightSceneNode = directionalLights[i];
+        irr::core::vector3df directionVector = irr::core::vector3df(0.0f, 0.0f, 1.0f);
+        pLightSceneNode->getAbsoluteTransformation().rotateVect(directionVector);
+        // Build the directions
+        this->directionalLightDirection[4 * i + 0] = directionVector.X;
+        this->directionalLightDirection[4 * i + 1] = directionVector.Y;
+        this->directionalLightDirection[4 * i + 2] = directionVector.Z;
+        this->directionalLightDirection[4 * i + 3] = 0.0f;
+        // Build the colours
+        this->directionalLightColor[4 * i + 0] = pLightSceneNode->getLightData().DiffuseColor.r;
+        this->directionalLightColor[4 * i + 1] = pLightSceneNode->getLightData().DiffuseColor.g;
+        this->directionalLightColor[4 * i + 2] = pLightSceneNode->getLightData().DiffuseColor.b;
+        this->directionalLightColor[4 * i + 3] = 1.0f;
+    }
+
+    // POINT LIGHTS
+    this->pointLights.resize(pointLights.size());
+    for (size_t i = 0; i < pointLights.size(); i++)
+    {
+        // Get a light from the list
+        irr::scene::ILightSceneNode* pLightSceneNode = pointLights[i];
+        const irr::video::SLight& lightData = pLightSceneNode->getLightData();
+        SShaderLight& light = this->pointLights[i];
+        // Position, colour and attenuation (constant, linear, quadratic)
+        light.position = pLightSceneNode->getAbsolutePosition();
+        light.diffuse[0] = lightData.DiffuseColor.r;
+        light.diffuse[1] = lightData.DiffuseColor.g;
+        light.diffuse[2] = lightData.DiffuseColor.b;
+        light.attenuation[0] = lightData.Attenuation.X;
+        light.attenuation[1] = lightData.Attenuation.Y;
+        light.attenuation[2] = lightData.Attenuation.Z;
+        // How far the light reaches and how bright it is (for selecting it per node)
+        light.range = ShaderFrameConstants::getLightRange(lightData);
+        light.intensity = irr::core::max_(lightData.DiffuseColor.r, irr::core::max_(lightData.DiffuseColor.g, lightData.DiffuseColor.b));
+    }
+
+    // SPOT LIGHTS
+    this->spotLights.resize(spotLights.size());
+    for (size_t i = 0; i < spotLights.size(); i++)
+    {
+        // Get a light from the list
+        irr::scene::ILightSceneNode* pLightSceneNode = spotLights[i];
+        const irr::video::SLight& lightData = pLightSceneNode->getLightData();
+        SShaderLight& light = this->spotLights[i];
+        // Position and direction
+        light.position = pLightSceneNode->getAbsolutePosition();
+        light.direction = irr::core::vector3df(0.0f, 0.0f, 1.0f);
+        pLightSceneNode->getAbsoluteTransformation().rotateVect(light.direction);
+        // Colour and attenuation (constant, linear, quadratic)
+        light.diffuse[0] = lightData.DiffuseColor.r;
+        light.diffuse[1] = lightData.DiffuseColor.g;
+        light.diffuse[2] = lightData.DiffuseColor.b;
+        light.attenuation[0] = lightData.Attenuation.X;
+        light.attenuation[1] = lightData.Attenuation.Y;
+        light.attenuation[2] = lightData.Attenuation.Z;
+        // Cones (in radians) and falloff
+        light.innerCone = lightData.InnerCone * M_PI / 180.0f;
+        light.outerCone = lightData.OuterCone * M_PI / 180.0f;
+        light.falloff = lightData.Falloff;
+        // How far the light reaches and how bright it is (for selecting it per node)
+        light.range = ShaderFrameConstants::getLightRange(lightData);
+        light.intensity = irr::core::max_(lightData.DiffuseColor.r, irr::core::max_(lightData.DiffuseColor.g, lightData.DiffuseColor.b));
+    }
+}
+
+void ShaderFrameConstants::upload(irr::video::IMaterialRendererServices* pServices, const ShaderConstantTable& shaderConstantTable) const
+{
+    // **********
+    // * UPLOAD *
+    // **********
+
+    // Screen and Time
+    if (shaderConstantTable.isGroupUsed(ESCG_SCREEN) == true)
+    {
+        shaderConstantTable.set(pServices, ESC_SCREEN_WIDTH, &this->screenWidth, 1);
+        shaderConstantTable.set(pServices, ESC_SCREEN_HEIGHT, &this->screenHeight, 1);
+    }
+    if (shaderConstantTable.isGroupUsed(ESCG_TIME) == true)
+        shaderConstantTable.set(pServices, ESC_TIME, &this->time, 1);
+    // View and Projection
+    if (shaderConstantTable.isGroupUsed(ESCG_VIEW) == true)
+    {
+        shaderConstantTable.set(pServices, ESC_VIEW_MATRIX, this->viewMatrix.pointer(), 16);
+        shaderConstantTable.set(pServices, ESC_INVERSE_VIEW_MATRIX, this->inverseViewMatrix.pointer(), 16);
+        shaderConstantTable.set(pServices, ESC_PROJECTION_MATRIX, this->projectionMatrix.pointer(), 16);
+        shaderConstantTable.set(pServices, ESC_INVERSE_PROJECTION_MATRIX, this->inverseProjectionMatrix.pointer(), 16);
+    }
+    // Camera
+    if (this->cameraActive == true && shaderConstantTable.isGroupUsed(ESCG_CAMERA) == true)
+    {
+        shaderConstantTable.set(pServices, ESC_CAMERA_POSITION, &this->cameraPosition.X, 3);
+        shaderConstantTable.set(pServices, ESC_CAMERA_TARGET, &this->cameraTarget.X, 3);
+        shaderConstantTable.set(pServices, ESC_CAMERA_VIEW_MATRIX, this->cameraViewMatrix.pointer(), 16);
+        shaderConstantTable.set(pServices, ESC_INVERSE_CAMERA_VIEW_MATRIX, this->inverseCameraViewMatrix.pointer(), 16);
+        shaderConstantTable.set(pServices, ESC_CAMERA_PROJECTION_MATRIX, this->cameraProjectionMatrix.pointer(), 16);
+        shaderConstantTable.set(pServices, ESC_INVERSE_CAMERA_PROJECTION_MATRIX, this->inverseCameraProjectionMatrix.pointer(), 16);
+        shaderConstantTable.set(pServices, ESC_CAMERA_NEAR_PLANE, &this->cameraNearPlane, 1);
+        shaderConstantTable.set(pServices, ESC_CAMERA_FAR_PLANE, &this->cameraFarPlane, 1);
+        shaderConstantTable.set(pServices, ESC_CAMERA_FOV, &this->cameraFOV, 1);
+    }
+    // Ambient Light and Shadow Colour
+    if (shaderConstantTable.isGroupUsed(ESCG_AMBIENT) == true)
+    {
+        shaderConstantTable.set(pServices, ESC_AMBIENT_LIGHT, &this->ambientLight[0], 4);
+        shaderConstantTable.set(pServices, ESC_SHADOW_COLOR, &this->shadowColour[0], 4);
+    }
+    // Fog
+    if (shaderConstantTable.isGroupUsed(ESCG_FOG) == true)
+    {
+        shaderConstantTable.set(pServices, ESC_FOG_COLOR, &this->fogColour[0], 4);
+        shaderConstantTable.set(pServices, ESC_FOG_START, &this->fogStart, 1);
+        shaderConstantTable.set(pServices, ESC_FOG_END, &this->fogEnd, 1);
+        shaderConstantTable.set(pServices, ESC_FOG_DENSITY, &this->fogDensity, 1);
+    }
+    // Directional Lights
+    if (shaderConstantTable.isGroupUsed(ESCG_DIRECTIONAL_LIGHTS) == true)
+    {
+        // Never more than the program's arrays hold
+        irr::s32 directionalLightCount = irr::core::min_(this->directionalLightCount, (irr::s32)shaderConstantTable.getDirectionalLightCapacity());
+        shaderConstantTable.set(pServices, ESC_DIRECTIONAL_LIGHT_COUNT, &directionalLightCount, 1);
+        shaderConstantTable.set(pServices, ESC_DIRECTIONAL_LIGHT_DIRECTION, &this->directionalLightDirection[0], directionalLightCount * 4);
+        shaderConstantTable.set(pServices, ESC_DIRECTIONAL_LIGHT_COLOR, &this->directionalLightColor[0], directionalLightCount * 4);
+    }
+}
+
+void ShaderFrameConstants::uploadNodeLights(irr::video::IMaterialRendererServices* pServices, const ShaderConstantTable& shaderConstantTable,
+                                            const std::vector<irr::u32>& pointLightIndices, const std::vector<irr::u32>& spotLightIndices) const
+{
+    // **********************
+    // * UPLOAD NODE LIGHTS *
+    // **********************
+
+    // Point Lights
+    if (shaderConstantTable.isGroupUsed(ESCG_POINT_LIGHTS) == true)
+    {
+        // Gather the selected lights into the shader's layout (never more than the program's arrays hold)
+        irr::s32 pointLightCount = (irr::s32)irr::core::min_(pointLightIndices.size(), (size_t)irr::core::min_((irr::u32)MAX_NODE_LIGHTS, shaderConstantTable.getLightCapacity()));
+        irr::f32 pointLightPosition[4 * MAX_NODE_LIGHTS];
+        irr::f32 pointLightDiffuse[4 * MAX_NODE_LIGHTS];
+        irr::f32 pointLightAttenuation[4 * MAX_NODE_LIGHTS];
+        for (int i = 0; i < pointLightCount; i++)
+        {
+            const SShaderLight& light = this->pointLights[pointLightIndices[i]];
+            pointLightPosition[4 * i + 0] = light.position.X;
+            pointLightPosition[4 * i + 1] = light.position.Y;
+            pointLightPosition[4 * i + 2] = light.position.Z;
+            pointLightPosition[4 * i + 3] = 1.0f;
+            for (int j = 0; j < 3; j++)
+            {
+                pointLightDiffuse[4 * i + j] = light.diffuse[j];
+                pointLightAttenuation[4 * i + j] = light.attenuation[j];
+            }
+            pointLightDiffuse[4 * i + 3] = 1.0f;
+            pointLightAttenuation[4 * i + 3] = 0.0f;
+        }
+        shaderConstantTable.set(pServices, ESC_POINT_LIGHT_COUNT, &pointLightCount, 1);
+        if (pointLightCount > 0)
+        {
+            shaderConstantTable.set(pServices, ESC_POINT_LIGHT_POSITION, &pointLightPosition[0], pointLightCount * 4);
+            shaderConstantTable.set(pServices, ESC_POINT_LIGHT_DIFFUSE_COLOR, &pointLightDiffuse[0], pointLightCount * 4);
+            shaderConstantTable.set(pServices, ESC_POINT_LIGHT_ATTENUATION, &pointLightAttenuation[0], pointLightCount * 4);
+        }
+    }
+    // Spot Lights
+    if (shaderConstantTable.isGroupUsed(ESCG_SPOT_LIGHTS) == true)
+    {
+        // Gather the selected lights into the shader's layout (never more than the program's arrays hold)
+        irr::s32 spotLightCount = (irr::s32)irr::core::min_(spotLightIndices.size(), (size_t)irr::core::min_((irr::u32)MAX_NODE_LIGHTS, shaderConstantTable.getLightCapacity()));
+        irr::f32 spotLightPosition[4 * MAX_NODE_LIGHTS];
+        irr::f32 spotLightDirection[4 * MAX_NODE_LIGHTS];
+        irr::f32 spotLightDiffuse[4 * MAX_NODE_LIGHTS];
+        irr::f32 spotLightAttenuation[4 * MAX_NODE_LIGHTS];
+        for (int i = 0; i < spotLightCount; i++)
+        {
+            const SShaderLight& light = this->spotLights[spotLightIndices[i]];
+            // The cones and falloff go in the w components
+            spotLightPosition[4 * i + 0] = light.position.X;
+            spotLightPosition[4 * i + 1] = light.position.Y;
+            spotLightPosition[4 * i + 2] = light.position.Z;
+            spotLightPosition[4 * i + 3] = light.innerCone;
+            spotLightDirection[4 * i + 0] = light.direction.X;
+            spotLightDirection[4 * i + 1] = light.direction.Y;
+            spotLightDirection[4 * i + 2] = light.direction.Z;
+            spotLightDirection[4 * i + 3] = light.outerCone;
+            for (int j = 0; j < 3; j++)
+            {
+                spotLightDiffuse[4 * i + j] = light.diffuse[j];
+                spotLightAttenuation[4 * i + j] = light.attenuation[j];
+            }
+            spotLightDiffuse[4 * i + 3] = 1.0f;
+            spotLightAttenuation[4 * i + 3] = light.falloff;
+        }
+        shaderConstantTable.set(pServices, ESC_SPOT_LIGHT_COUNT, &spotLightCount, 1);
+        if (spotLightCount > 0)
+        {
+            shaderConstantTable.set(pServices, ESC_SPOT_LIGHT_POSITION, &spotLightPosition[0], spotLightCount * 4);
+            shaderConstantTable.set(pServices, ESC_SPOT_LIGHT_DIRECTION, &spotLightDirection[0], spotLightCount * 4);
+            shaderConstantTable.set(pServices, ESC_SPOT_LIGHT_DIFFUSE_COLOR, &spotLightDiffuse[0], spotLightCount * 4);
+            shaderConstantTable.set(pServices, ESC_SPOT_LIGHT_ATTENUATION, &spotLightAttenuation[0], spotLightCount * 4);
+        }
+    }
+}
+
+irr::f32 ShaderFrameConstants::getLightRange(const irr::video::SLight& lightData)
+{
+    /* The shaders scale a light by 1 / (constant + linear * d + quadratic * d * d). The range is the
+        distance where that drops the brightest colour channel below one step of an 8 bit colour */
+    const irr::f32 cutoff = 1.0f / 256.0f;
+    irr::f32 intensity = irr::core::max_(lightData.DiffuseColor.r, irr::core::max_(lightData.DiffuseColor.g, lightData.DiffuseColor.b));
+    if (intensity <= 0.0f)
+        return 0.0f;
+    irr::f32 constant = lightData.Attenuation.X;
+    irr::f32 linear = lightData.Attenuation.Y;
+    irr::f32 quadratic = lightData.Attenuation.Z;
+    // Solve constant + linear * d + quadratic * d * d = intensity / cutoff
+    irr::f32 target = intensity / cutoff;
+    if (constant >= target)
+        return 0.0f;
+    if (quadratic > 0.0f)
+        return (-linear + sqrtf(linear * linear - 4.0f * quadratic * (constant - target))) / (2.0f * quadratic);
+    if (linear > 0.0f)
+        return (target - constant) / linear;
+    // Constant attenuation never fades so fall back to the light's radius
+    return lightData.Radius;
+}
@@ -0,0 +1,157 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef SHADERFRAMECONSTANTS_H
+#define SHADERFRAMECONSTANTS_H
+
+// C/C++ Includes
+#include <vector>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+// Game Includes
+#include "ShaderConstantTable.h"
+
+//! A light packed for the shaders (once per frame) plus what is needed to select it for a node
+struct SShaderLight
+{
+    // Position in world space
+    irr::core::vector3df position;
+    // Direction (spot lights)
+    irr::core::vector3df direction;
+    // Diffuse colour
+    irr::f32 diffuse[3];
+    // Constant, linear and quadratic attenuation
+    irr::f32 attenuation[3];
+    // Cones in radians and falloff (spot lights)
+    irr::f32 innerCone;
+    irr::f32 outerCone;
+    irr::f32 falloff;
+    // Distance at which the light no longer visibly contributes
+    irr::f32 range;
+    // Brightest colour channel
+    irr::f32 intensity;
+};
+
+/** The ShaderFrameConstants Class holds every shader constant which is the
+    same for all nodes drawn in a frame (screen, time, view and projection
+    matrices, camera, ambient light, fog and the packed light arrays). It is
+    computed once per frame after the light lists are built and then copied
+    straight into each shader, so matrix inversions and light packing no
+    longer scale with the number of nodes drawn.
+    Point and spot lights are packed once per frame into SShaderLight
+    records; each node then uploads only the records selected for it.
+    Light arrays are uploaded as vec4s (a spot light's cones and falloff
+    ride in the w components), as drivers pad each element of a float
+    array to a vec4 and would run out of uniforms **/
+class ShaderFrameConstants
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        ShaderFrameConstants();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Compute the constants for this frame
+        void update(irr::video::IVideoDriver* pVideoDriver, irr::scene::ISceneManager* pSceneManager, irr::f32 time,
+                    const std::vector<irr::scene::ILightSceneNode*>& directionalLights,
+                    const std::vector<irr::scene::ILightSceneNode*>& pointLights,
+                    const std::vector<irr::scene::ILightSceneNode*>& spotLights);
+        //! Upload the constants to a shader
+        void upload(irr::video::IMaterialRendererServices* pServices, const ShaderConstantTable& shaderConstantTable) const;
+        //! Upload the point and spot lights selected for a node (indices into getPointLights and getSpotLights)
+        void uploadNodeLights(irr::video::IMaterialRendererServices* pServices, const ShaderConstantTable& shaderConstantTable,
+                              const std::vector<irr::u32>& pointLightIndices, const std::vector<irr::u32>& spotLightIndices) const;
+        //! Get the View Matrix
+        const irr::core::matrix4& getViewMatrix() const { return this->viewMatrix; }
+        //! Get the Projection Matrix
+        const irr::core::matrix4& getProjectionMatrix() const { return this->projectionMatrix; }
+        //! Get the active camera's near plane (zero without a camera)
+        irr::f32 getCameraNearPlane() const { return this->cameraNearPlane; }
+        //! Get the active camera's far plane (zero without a camera)
+        irr::f32 getCameraFarPlane() const { return this->cameraFarPlane; }
+        //! Get the Projection * View Matrix (a node's WorldViewProjection Matrix is this times its World Matrix)
+        const irr::core::matrix4& getViewProjectionMatrix() const { return this->viewProjectionMatrix; }
+        //! Get the number of Directional Lights packed this frame
+        irr::s32 getDirectionalLightCount() const { return this->directionalLightCount; }
+        //! Get the Fog Type
+        irr::video::E_FOG_TYPE getFogType() const { return this->fogType; }
+        //! Get this frame's packed Point Lights
+        const std::vector<SShaderLight>& getPointLights() const { return this->pointLights; }
+        //! Get this frame's packed Spot Lights
+        const std::vector<SShaderLight>& getSpotLights() const { return this->spotLights; }
+        //! Get the distance at which a light stops visibly contributing (from its colour and attenuation)
+        static irr::f32 getLightRange(const irr::video::SLight& lightData);
+
+    public:
+        // Maximum number of Directional Lights packed each frame (the shaders' MAX_DIRECTIONAL_LIGHTS)
+        static const int MAX_DIRECTIONAL_LIGHTS = 8;
+        // Maximum number of Point or Spot Lights uploaded for a node (the largest shader permutation's MAX_LIGHTS)
+        static const int MAX_NODE_LIGHTS = 64;
+
+    protected:
+        // Screen dimensions
+        irr::f32 screenWidth;
+        irr::f32 screenHeight;
+        // Time in seconds
+        irr::f32 time;
+        // View Matrix and its inverse
+        irr::core::matrix4 viewMatrix;
+        irr::core::matrix4 inverseViewMatrix;
+        // Projection Matrix and its inverse
+        irr::core::matrix4 projectionMatrix;
+        irr::core::matrix4 inverseProjectionMatrix;
+        // Projection * View Matrix
+        irr::core::matrix4 viewProjectionMatrix;
+
+    protected:
+        // Is there an active camera
+        bool cameraActive;
+        // Camera position and normalised direction
+        irr::core::vector3df cameraPosition;
+        irr::core::vector3df cameraTarget;
+        // Camera matrices and their inverses
+        irr::core::matrix4 cameraViewMatrix;
+        irr::core::matrix4 inverseCameraViewMatrix;
+        irr::core::matrix4 cameraProjectionMatrix;
+        irr::core::matrix4 inverseCameraProjectionMatrix;
+        // Camera planes and field of view
+        irr::f32 cameraNearPlane;
+        irr::f32 cameraFarPlane;
+        irr::f32 cameraFOV;
+
+    protected:
+        // Ambient Light
+        irr::f32 ambientLight[4];
+        // Shadow Colour
+        irr::f32 shadowColour[4];
+        // Fog
+        irr::video::E_FOG_TYPE fogType;
+        irr::f32 fogColour[4];
+        irr::f32 fogStart;
+        irr::f32 fogEnd;
+        irr::f32 fogDensity;
+
+    protected:
+        // Directional Lights (a vec4 each so the arrays are not padded)
+        irr::s32 directionalLightCount;
+        irr::f32 directionalLightDirection[4 * MAX_DIRECTIONAL_LIGHTS];
+        irr::f32 directionalLightColor[4 * MAX_DIRECTIONAL_LIGHTS];
+        // Point Lights
+        std::vector<SShaderLight> pointLights;
+        // Spot Lights
+        std::vector<SShaderLight> spotLights;
+};
+
+#endif // SHADERFRAMECONSTANTS_H
@@ -0,0 +1,154 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "ShaderPermutations.h"
+
+#include <cctype>
+#include <sstream>
+
+#include "GPUSkinning.h"
+#include "InstancedMeshSceneNode.h"
+
+const irr::u32 ShaderPermutations::LIGHT_CAPACITIES[ShaderPermutations::LIGHT_CAPACITY_COUNT] = { 4, 16, 64 };
+
+ShaderPermutations::ShaderPermutations()
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->supportedFeatures = 0;
+}
+
+void ShaderPermutations::setSource(const std::string& vertexShader, const std::string& fragmentShader, const std::string& vertexSource, const std::string& fragmentSource)
+{
+    this->vertexShader = vertexShader;
+    this->fragmentShader = fragmentShader;
+    this->vertexSource = vertexSource;
+    this->fragmentSource = fragmentSource;
+    this->supportedFeatures = ShaderPermutations::getSourceFeatures(vertexSource) | ShaderPermutations::getSourceFeatures(fragmentSource);
+}
+
+bool ShaderPermutations::find(irr::u32 features, irr::u32 lightCapacity, irr::s32& materialType) const
+{
+    for (size_t i = 0; i < this->materialTypes.size(); i++)
+    {
+        if (this->features[i] == features && this->lightCapacities[i] == lightCapacity)
+        {
+            materialType = this->materialTypes[i];
+            return true;
+        }
+    }
+    materialType = -1;
+    return false;
+}
+
+void ShaderPermutations::add(irr::u32 features, irr::u32 lightCapacity, irr::s32 materialType)
+{
+    this->features.push_back(features);
+    this->lightCapacities.push_back(lightCapacity);
+    this->materialTypes.push_back(materialType);
+}
+
+bool ShaderPermutations::contains(irr::s32 materialType) const
+{
+    if (materialType == -1)
+        return false;
+    for (size_t i = 0; i < this->materialTypes.size(); i++)
+        if (this->materialTypes[i] == materialType)
+            return true;
+    return false;
+}
+
+irr::u32 ShaderPermutations::getLightCapacity(irr::u32 lightCount)
+{
+    for (irr::u32 i = 0; i < LIGHT_CAPACITY_COUNT; i++)
+        if (lightCount <= LIGHT_CAPACITIES[i])
+            return LIGHT_CAPACITIES[i];
+    return LIGHT_CAPACITIES[LIGHT_CAPACITY_COUNT - 1];
+}
+
+const char* ShaderPermutations::getFeatureName(E_SHADER_FEATURE feature)
+{
+    switch (feature)
+    {
+        case ESF_TEXTURED: return "TEXTURED";
+        case ESF_LIT: return "LIT";
+        case ESF_DIRECTIONAL_LIGHTS: return "DIRECTIONAL_LIGHTS";
+        case ESF_POINT_LIGHTS: return "POINT_LIGHTS";
+        case ESF_SPOT_LIGHTS: return "SPOT_LIGHTS";
+        case ESF_FOG_LINEAR: return "FOG_LINEAR";
+        case ESF_FOG_EXP: return "FOG_EXP";
+        case ESF_FOG_EXP2: return "FOG_EXP2";
+        case ESF_INSTANCED: return "INSTANCED";
+        case ESF_SKINNED: return "SKINNED";
+        default: return "";
+    }
+}
+
+irr::u32 ShaderPermutations::getSourceFeatures(const std::string& source)
+{
+    /* NOTES: Only conditional preprocessor lines are searched so a feature
+        named in a comment or an identifier does not count */
+
+    irr::u32 features = 0;
+    size_t lineStart = 0;
+    while (lineStart < source.size())
+    {
+        size_t lineEnd = source.find('\n', lineStart);
+        if (lineEnd == std::string::npos)
+            lineEnd = source.size();
+        size_t first = source.find_first_not_of(" \t", lineStart);
+        if (first != std::string::npos && first < lineEnd && (source.compare(first, 3, "#if") == 0 || source.compare(first, 5, "#elif") == 0))
+        {
+            // Check each identifier on the line against the feature names
+            size_t i = first + 1;
+            while (i < lineEnd)
+            {
+                if (isalpha((unsigned char)source[i]) == 0 && source[i] != '_')
+                {
+                    i++;
+                    continue;
+                }
+                size_t wordStart = i;
+                while (i < lineEnd && (isalnum((unsigned char)source[i]) != 0 || source[i] == '_'))
+                    i++;
+                std::string word = source.substr(wordStart, i - wordStart);
+                for (int feature = 0; feature < ESF_COUNT; feature++)
+                    if (word == ShaderPermutations::getFeatureName((E_SHADER_FEATURE)feature))
+                        features |= (1u << feature);
+            }
+        }
+        lineStart = lineEnd + 1;
+    }
+    return features;
+}
+
+std::string ShaderPermutations::addDefines(const std::string& source, irr::u32 features, irr::u32 lightCapacity, irr::u32 directionalLightCapacity)
+{
+    /* NOTES: GLSL wants #version before anything else so the defines go on
+        the line after it (or at the top when there is no #version) */
+
+    std::ostringstream defines;
+    defines << "#define MAX_LIGHTS " << lightCapacity << "\n";
+    defines << "#define MAX_DIRECTIONAL_LIGHTS " << directionalLightCapacity << "\n";
+    // Size the instance arrays from the batch the node uploads (not the shader's fallback)
+    if ((features & (1u << ESF_INSTANCED)) != 0)
+        defines << "#define MAX_INSTANCES " << InstancedMeshSceneNode::BATCH_SIZE << "\n";
+    // and the bone arrays from the palette GPUSkinning uploads
+    if ((features & (1u << ESF_SKINNED)) != 0)
+        defines << "#define MAX_BONES " << GPUSkinning::MAX_BONES << "\n";
+    for (int feature = 0; feature < ESF_COUNT; feature++)
+        if ((features & (1u << feature)) != 0)
+            defines << "#define " << ShaderPermutations::getFeatureName((E_SHADER_FEATURE)feature) << "\n";
+    size_t version = source.find("#version");
+    if (version == std::string::npos)
+        return defines.str() + source;
+    size_t lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos)
+        return source + "\n" + defines.str();
+    return source.substr(0, lineEnd + 1) + defines.str() + source.substr(lineEnd + 1);
+}
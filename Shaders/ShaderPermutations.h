@@ -0,0 +1,125 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef SHADERPERMUTATIONS_H
+#define SHADERPERMUTATIONS_H
+
+// C/C++ Includes
+#include <string>
+#include <vector>
+
+// Irrlicht Includes
+#include <Irrlicht.h>
+
+//! Features a shader variant is compiled for (each is a #define of the same name without the prefix)
+enum E_SHADER_FEATURE
+{
+    // Texture0 is bound
+    ESF_TEXTURED = 0,
+    // The material is lit
+    ESF_LIT,
+    // Light types reaching the node
+    ESF_DIRECTIONAL_LIGHTS,
+    ESF_POINT_LIGHTS,
+    ESF_SPOT_LIGHTS,
+    // Fog mode (at most one)
+    ESF_FOG_LINEAR,
+    ESF_FOG_EXP,
+    ESF_FOG_EXP2,
+    // Drawn by an InstancedMeshSceneNode (the vertex shader places each instance)
+    ESF_INSTANCED,
+    // The mesh is skinned by the vertex shader (see GPUSkinning)
+    ESF_SKINNED,
+    // Number of features
+    ESF_COUNT
+};
+
+/** The ShaderPermutations Class holds the variants of one shader. A variant
+    is the shader compiled with a #define for each feature in its key
+    (textured, lit, the light types present, the fog mode and whether the
+    node is instanced or GPU skinned) and with a light capacity (MAX_LIGHTS sizes the point
+    and spot light arrays), so a program only contains the branches,
+    samplers and uniforms its materials need. Features the shader's preprocessor lines never test are dropped
+    from the key so they do not make duplicate programs.
+    Variants are compiled the first time a material needs them (see
+    Game::getShaderVariant) and cached here by key and capacity **/
+class ShaderPermutations
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        ShaderPermutations();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Set the shader's file names and sources (finds the features it tests)
+        void setSource(const std::string& vertexShader, const std::string& fragmentShader, const std::string& vertexSource, const std::string& fragmentSource);
+        //! Get the vertex shader's file name
+        const std::string& getVertexShader() const { return this->vertexShader; }
+        //! Get the fragment shader's file name
+        const std::string& getFragmentShader() const { return this->fragmentShader; }
+        //! Get the vertex shader's source (without defines)
+        const std::string& getVertexSource() const { return this->vertexSource; }
+        //! Get the fragment shader's source (without defines)
+        const std::string& getFragmentSource() const { return this->fragmentSource; }
+        //! Get the features the shader tests (one bit per E_SHADER_FEATURE)
+        irr::u32 getSupportedFeatures() const { return this->supportedFeatures; }
+        //! Is the shader built for several light capacities (it has point or spot light arrays)
+        bool hasLightCapacities() const { return ((this->supportedFeatures & ((1u << ESF_POINT_LIGHTS) | (1u << ESF_SPOT_LIGHTS))) != 0); }
+        //! Find a variant (returns false if it has not been compiled, materialType is -1 if it failed to compile)
+        bool find(irr::u32 features, irr::u32 lightCapacity, irr::s32& materialType) const;
+        //! Add a compiled variant (-1 records one which failed so it is not compiled again)
+        void add(irr::u32 features, irr::u32 lightCapacity, irr::s32 materialType);
+        //! Does a material type belong to one of the variants
+        bool contains(irr::s32 materialType) const;
+        //! Get the number of variants
+        irr::u32 getCount() const { return (irr::u32)this->materialTypes.size(); }
+
+    public:
+        //! Get the smallest light capacity holding a number of lights (the largest if none can)
+        static irr::u32 getLightCapacity(irr::u32 lightCount);
+        //! Get the define for a feature
+        static const char* getFeatureName(E_SHADER_FEATURE feature);
+        //! Find the features a source tests in its #if, #ifdef and #elif lines
+        static irr::u32 getSourceFeatures(const std::string& source);
+        //! Put the defines for a feature key and light capacity (and the instance and bone array sizes of INSTANCED and SKINNED variants) after a shader's #version line
+        static std::string addDefines(const std::string& source, irr::u32 features, irr::u32 lightCapacity, irr::u32 directionalLightCapacity);
+
+    public:
+        // Light capacities each lit shader is built for (64 lights of vec4 arrays is under 2048 fragment uniform components)
+        static const irr::u32 LIGHT_CAPACITY_COUNT = 3;
+        static const irr::u32 LIGHT_CAPACITIES[LIGHT_CAPACITY_COUNT];
+        // Fog mode features
+        static const irr::u32 FOG_FEATURES = (1u << ESF_FOG_LINEAR) | (1u << ESF_FOG_EXP) | (1u << ESF_FOG_EXP2);
+        // Feature key of the variant a shader is first loaded with (every branch except fog)
+        static const irr::u32 DEFAULT_FEATURES = (1u << ESF_TEXTURED) | (1u << ESF_LIT) | (1u << ESF_DIRECTIONAL_LIGHTS) | (1u << ESF_POINT_LIGHTS) | (1u << ESF_SPOT_LIGHTS);
+
+    protected:
+        // Shader file names
+        std::string vertexShader;
+        std::string fragmentShader;
+        // Shader sources (without defines)
+        std::string vertexSource;
+        std::string fragmentSource;
+        // Features the shader tests
+        irr::u32 supportedFeatures;
+
+    protected:
+        // Feature key of each variant
+        std::vector<irr::u32> features;
+        // Light capacity of each variant
+        std::vector<irr::u32> lightCapacities;
+        // Material type of each variant (-1 when it failed to compile)
+        std::vector<irr::s32> materialTypes;
+};
+
+#endif // SHADERPERMUTATIONS_H
@@ -0,0 +1,248 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#include "TraceRecorder.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include "Logger.h"
+
+const unsigned int TraceRecorder::MAX_OPEN_EVENTS;
+
+// Events begun on this thread and not yet ended (innermost last)
+static thread_local STraceEvent openEvents[TraceRecorder::MAX_OPEN_EVENTS];
+static thread_local unsigned int openEventCount = 0;
+
+TraceRecorder::TraceRecorder() : eventCount(0)
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    this->recording = false;
+    this->startTime = std::chrono::steady_clock::now();
+    this->mainThreadID = 0;
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    // **************
+    // * DESTRUCTOR *
+    // **************
+}
+
+bool TraceRecorder::start(unsigned int capacity)
+{
+    // *********
+    // * START *
+    // *********
+
+    if (capacity == 0)
+        return false;
+    // Allocate every event up front so that recording never allocates
+    this->events.clear();
+    this->events.resize(capacity);
+    this->eventCount.store(0);
+    this->startTime = std::chrono::steady_clock::now();
+    this->mainThreadID = TraceRecorder::getThreadID();
+    this->recording = true;
+
+    // Success
+    return true;
+}
+
+void TraceRecorder::stop()
+{
+    // ********
+    // * STOP *
+    // ********
+
+    this->recording = false;
+}
+
+long long TraceRecorder::getTimestamp()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - this->startTime).count();
+}
+
+STraceEvent* TraceRecorder::claimEvent()
+{
+    // One atomic increment claims a slot for this thread
+    unsigned int index = this->eventCount.fetch_add(1, std::memory_order_relaxed);
+    // Drop the event when the buffer is full
+    if (index >= this->events.size())
+        return 0;
+    return &this->events[index];
+}
+
+void TraceRecorder::beginEvent(const char* name, const char* category, const char* detailName, const char* detail, const char* valueName, int value)
+{
+    if (this->recording == false || openEventCount >= TraceRecorder::MAX_OPEN_EVENTS)
+        return;
+    // Held by the thread until it ends (no slot is claimed yet)
+    STraceEvent* pEvent = &openEvents[openEventCount++];
+    pEvent->phase = 'X';
+    pEvent->category = category;
+    TraceRecorder::copyString(pEvent->name, name, sizeof(pEvent->name));
+    pEvent->detailName = detailName;
+    TraceRecorder::copyString(pEvent->detail, detail, sizeof(pEvent->detail));
+    pEvent->valueName = valueName;
+    pEvent->value = value;
+    pEvent->threadID = TraceRecorder::getThreadID();
+    pEvent->timestamp = this->getTimestamp();
+    pEvent->duration = 0;
+}
+
+void TraceRecorder::endEvent(const char* name, const char* category)
+{
+    // Find the innermost open event it ends (none if it began before recording started or beyond MAX_OPEN_EVENTS)
+    char copiedName[sizeof(openEvents[0].name)];
+    TraceRecorder::copyString(copiedName, name, sizeof(copiedName));
+    unsigned int index = openEventCount;
+    while (index > 0 && (strcmp(openEvents[index - 1].category, category) != 0 || strcmp(openEvents[index - 1].name, copiedName) != 0))
+        index--;
+    if (index == 0)
+        return;
+    STraceEvent event = openEvents[index - 1];
+    std::copy(openEvents + index, openEvents + openEventCount, openEvents + index - 1);
+    openEventCount--;
+    // Record it whole (one slot, so a full buffer drops both ends together)
+    if (this->recording == false)
+        return;
+    event.duration = this->getTimestamp() - event.timestamp;
+    STraceEvent* pEvent = this->claimEvent();
+    if (pEvent == 0)
+        return;
+    *pEvent = event;
+}
+
+void TraceRecorder::completeEvent(const char* name, const char* category, long long startTimestamp, const char* detailName, const char* detail, const char* valueName, int value)
+{
+    if (this->recording == false)
+        return;
+    // Read the clock before claiming so the claim is not part of the duration
+    long long endTimestamp = this->getTimestamp();
+    STraceEvent* pEvent = this->claimEvent();
+    if (pEvent == 0)
+        return;
+    pEvent->phase = 'X';
+    pEvent->category = category;
+    TraceRecorder::copyString(pEvent->name, name, sizeof(pEvent->name));
+    pEvent->detailName = detailName;
+    TraceRecorder::copyString(pEvent->detail, detail, sizeof(pEvent->detail));
+    pEvent->valueName = valueName;
+    pEvent->value = value;
+    pEvent->threadID = TraceRecorder::getThreadID();
+    pEvent->timestamp = startTimestamp;
+    pEvent->duration = endTimestamp - startTimestamp;
+}
+
+unsigned int TraceRecorder::getThreadID()
+{
+    // Threads are numbered in the order they first record an event
+    static std::atomic<unsigned int> nextThreadID(1);
+    thread_local unsigned int threadID = nextThreadID.fetch_add(1);
+    return threadID;
+}
+
+void TraceRecorder::copyString(char* pDestination, const char* pSource, unsigned int size)
+{
+    unsigned int i = 0;
+    if (pSource != 0)
+    {
+        for (; i + 1 < size && pSource[i] != '\0'; i++)
+            pDestination[i] = pSource[i];
+    }
+    pDestination[i] = '\0';
+}
+
+void TraceRecorder::writeEscaped(std::ostream& stream, const char* text)
+{
+    for (; *text != '\0'; text++)
+    {
+        if (*text == '"' || *text == '\\')
+            stream << '\\' << *text;
+        else if ((unsigned char)*text < 0x20)
+            stream << ' ';
+        else
+            stream << *text;
+    }
+}
+
+bool TraceRecorder::writeJSON(const std::string& fileName)
+{
+    // ******************
+    // * WRITE THE JSON *
+    // ******************
+
+    std::ofstream file(fileName.c_str());
+    if (file.is_open() == false)
+    {
+        LogMessage(ELS_ERROR) << "Unable to write trace to " << fileName;
+        return false;
+    }
+    // Only the claimed slots inside the buffer hold events
+    unsigned int claimed = this->eventCount.load();
+    unsigned int count = (claimed < this->events.size()) ? claimed : (unsigned int)this->events.size();
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+    // Name the thread that started recording and the workers
+    std::vector<unsigned int> threadIDs(1, this->mainThreadID);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (std::find(threadIDs.begin(), threadIDs.end(), this->events[i].threadID) == threadIDs.end())
+            threadIDs.push_back(this->events[i].threadID);
+    }
+    for (size_t i = 0; i < threadIDs.size(); i++)
+    {
+        file << ((i > 0) ? "," : "") << std::endl << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadIDs[i] << ",\"args\":{\"name\":\"";
+        if (i == 0)
+            file << "Main";
+        else
+            file << "Worker " << i;
+        file << "\"}}";
+    }
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const STraceEvent& event = this->events[i];
+        file << "," << std::endl << "{\"name\":\"";
+        TraceRecorder::writeEscaped(file, event.name);
+        file << "\",\"cat\":\"" << (event.category != 0 ? event.category : "") << "\",\"ph\":\"" << event.phase << "\"";
+        file << ",\"ts\":" << event.timestamp;
+        if (event.phase == 'X')
+            file << ",\"dur\":" << event.duration;
+        file << ",\"pid\":1,\"tid\":" << event.threadID;
+        // Arguments
+        if (event.detailName != 0 || event.valueName != 0)
+        {
+            file << ",\"args\":{";
+            if (event.detailName != 0)
+            {
+                file << "\"" << event.detailName << "\":\"";
+                TraceRecorder::writeEscaped(file, event.detail);
+                file << "\"";
+            }
+            if (event.valueName != 0)
+                file << (event.detailName != 0 ? "," : "") << "\"" << event.valueName << "\":" << event.value;
+            file << "}";
+        }
+        file << "}";
+    }
+    file << std::endl << "]}" << std::endl;
+
+    // Report dropped events so a too small buffer is noticed
+    {
+        LogMessage message(ELS_INFO);
+        message << "Trace written to " << fileName << " (" << count << " events";
+        if (claimed > count)
+            message << ", " << (claimed - count) << " dropped";
+        message << ")";
+    }
+
+    // Success
+    return true;
+}
@@ -0,0 +1,142 @@
+// (c) Copyright Shem Taylor 2021 all rights reserved
+// Author: Shem Taylor
+// Company: DodgeeSoftware
+// Contact Info: dodgeesoftware@gmail.com
+// Youtube: youtube.com/dodgeesoftware
+
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+// C/C++ Includes
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+//! A single recorded trace event (fixed size so the buffer can be preallocated)
+struct STraceEvent
+{
+    // Chrome trace event phase ('X' complete, 'i' instant)
+    char phase;
+    // Category (must point at a string literal)
+    const char* category;
+    // Name of the event (copied so that it stays valid after the source is destroyed)
+    char name[48];
+    // Name of the detail argument or 0 (must point at a string literal)
+    const char* detailName;
+    // Detail argument text (eg the scene node name)
+    char detail[48];
+    // Name of the value argument or 0 (must point at a string literal)
+    const char* valueName;
+    // Value argument (eg the material type)
+    int value;
+    // Recording thread
+    unsigned int threadID;
+    // Time since the trace started in microseconds
+    long long timestamp;
+    // Duration of a complete event in microseconds
+    long long duration;
+};
+
+/** The TraceRecorder Class records Chrome/Perfetto trace events
+    (chrome://tracing, ui.perfetto.dev) into a buffer allocated when
+    recording starts. Recording claims a slot with a single atomic
+    increment so it is lock free and never allocates. Events that do not
+    fit in the buffer are dropped and counted. An event begun with
+    beginEvent is held by its thread until endEvent, then recorded as one
+    complete event, so a full buffer drops whole events and never leaves
+    a begin without its end **/
+class TraceRecorder
+{
+    // ***************
+    // * CONSTRUCTOR *
+    // ***************
+
+    public:
+        //! Constructor
+        TraceRecorder();
+        //! Destructor
+        virtual ~TraceRecorder();
+
+    // *********************
+    // * GENERAL FUNCTIONS *
+    // *********************
+
+    public:
+        //! Allocate the event buffer and start recording
+        virtual bool start(unsigned int capacity);
+        //! Stop recording
+        virtual void stop();
+        //! Is the recorder recording
+        bool isRecording() { return this->recording; }
+        //! Write the recorded events as a Chrome trace event JSON file
+        virtual bool writeJSON(const std::string& fileName);
+
+    public:
+        // Most events a thread can have open at once (events begun beyond it are dropped)
+        static const unsigned int MAX_OPEN_EVENTS = 32;
+
+    public:
+        //! Get the time since recording started in microseconds
+        long long getTimestamp();
+        //! Begin an event on the calling thread (recorded when it ends)
+        void beginEvent(const char* name, const char* category, const char* detailName = 0, const char* detail = 0, const char* valueName = 0, int value = 0);
+        //! End the calling thread's innermost open event with this name and category, recording it as a complete event
+        void endEvent(const char* name, const char* category);
+        //! Record an event that started at startTimestamp and ends now
+        void completeEvent(const char* name, const char* category, long long startTimestamp, const char* detailName = 0, const char* detail = 0, const char* valueName = 0, int value = 0);
+
+    protected:
+        //! Claim the next free event (returns 0 when the buffer is full)
+        STraceEvent* claimEvent();
+        //! Get a small id for the calling thread
+        static unsigned int getThreadID();
+        //! Copy a string into a fixed size buffer
+        static void copyString(char* pDestination, const char* pSource, unsigned int size);
+        //! Write a string escaped for JSON
+        static void writeEscaped(std::ostream& stream, const char* text);
+
+    protected:
+        // Is the recorder recording
+        bool recording;
+        // Preallocated event buffer
+        std::vector<STraceEvent> events;
+        // Number of events claimed (may exceed the capacity when events are dropped)
+        std::atomic<unsigned int> eventCount;
+        // Time recording started
+        std::chrono::steady_clock::time_point startTime;
+        // Thread that started recording (named Main in the trace)
+        unsigned int mainThreadID;
+};
+
+/** The TraceScope Class records a complete event for as long as it is in scope **/
+class TraceScope
+{
+    public:
+        //! Constructor
+        TraceScope(TraceRecorder* pTraceRecorder, const char* name, const char* category, const char* detailName = 0, const char* detail = 0, const char* valueName = 0, int value = 0)
+            : pTraceRecorder(pTraceRecorder), name(name), category(category), detailName(detailName), detail(detail), valueName(valueName), value(value)
+        {
+            this->startTimestamp = (this->pTraceRecorder->isRecording() ? this->pTraceRecorder->getTimestamp() : 0);
+        }
+        //! Destructor
+        ~TraceScope()
+        {
+            if (this->pTraceRecorder->isRecording() == true)
+                this->pTraceRecorder->completeEvent(this->name, this->category, this->startTimestamp, this->detailName, this->detail, this->valueName, this->value);
+        }
+
+    protected:
+        TraceRecorder* pTraceRecorder;
+        const char* name;
+        const char* category;
+        const char* detailName;
+        const char* detail;
+        const char* valueName;
+        int value;
+        long long startTimestamp;
+};
+
+#endif // TRACERECORDER_H